@@ -0,0 +1,170 @@
+/*
+ * This file contains a throughput benchmark for the queue implementations:
+ * the dynamic-array queue from queue.c wrapped in a mutex, the lock-free
+ * SPSC ring from spscq.c and the lock-free MPMC ring from mpmcq.c.  For each
+ * thread count from 1 to N it runs that many producers and that many
+ * consumers, checks that every value was delivered exactly once (by
+ * comparing checksums) and prints millions of operations per second.
+ *
+ * Usage: ./bench_queues [max_threads] [values_per_producer]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "queue.h"
+#include "spscq.h"
+#include "mpmcq.h"
+
+#define RING_CAPACITY 4096
+
+/*
+ * A mutex-protected queue.c queue.  Producers wait while it holds
+ * RING_CAPACITY values so that it's compared with the rings on equal terms.
+ */
+struct locked_queue {
+  pthread_mutex_t lock;
+  struct queue* queue;
+  int size;
+};
+
+/*
+ * Shared benchmark state.  Each producer enqueues `per_producer` values;
+ * consumers stop once `remaining` hits zero.
+ */
+struct bench {
+  int kind;
+  long per_producer;
+  long remaining;
+  uint64_t checksum;
+  struct locked_queue locked;
+  struct spscq* spsc;
+  struct mpmcq* mpmc;
+};
+
+enum { KIND_LOCKED, KIND_SPSC, KIND_MPMC };
+
+double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void bench_enqueue(struct bench* b, void* val) {
+  if (b->kind == KIND_SPSC) {
+    spscq_enqueue(b->spsc, val);
+  } else if (b->kind == KIND_MPMC) {
+    mpmcq_enqueue(b->mpmc, val);
+  } else {
+    while (1) {
+      pthread_mutex_lock(&b->locked.lock);
+      if (b->locked.size < RING_CAPACITY) {
+        queue_enqueue(b->locked.queue, val);
+        b->locked.size++;
+        pthread_mutex_unlock(&b->locked.lock);
+        return;
+      }
+      pthread_mutex_unlock(&b->locked.lock);
+      sched_yield();
+    }
+  }
+}
+
+void* bench_try_dequeue(struct bench* b) {
+  if (b->kind == KIND_SPSC) {
+    return spscq_try_dequeue(b->spsc);
+  } else if (b->kind == KIND_MPMC) {
+    return mpmcq_try_dequeue(b->mpmc);
+  }
+  void* val = NULL;
+  pthread_mutex_lock(&b->locked.lock);
+  if (b->locked.size > 0) {
+    val = queue_dequeue(b->locked.queue);
+    b->locked.size--;
+  }
+  pthread_mutex_unlock(&b->locked.lock);
+  return val;
+}
+
+void* producer(void* arg) {
+  struct bench* b = arg;
+  for (long i = 1; i <= b->per_producer; i++) {
+    bench_enqueue(b, (void*)(uintptr_t)i);
+  }
+  return NULL;
+}
+
+void* consumer(void* arg) {
+  struct bench* b = arg;
+  uint64_t sum = 0;
+  while (__atomic_load_n(&b->remaining, __ATOMIC_RELAXED) > 0) {
+    void* val = bench_try_dequeue(b);
+    if (val) {
+      sum += (uintptr_t)val;
+      __atomic_fetch_sub(&b->remaining, 1, __ATOMIC_RELAXED);
+    } else {
+      sched_yield();
+    }
+  }
+  __atomic_fetch_add(&b->checksum, sum, __ATOMIC_RELAXED);
+  return NULL;
+}
+
+/*
+ * Runs one configuration and prints its throughput.
+ */
+void run(const char* name, int kind, int threads, long per_producer) {
+  struct bench b;
+  pthread_t* tids = malloc(2 * threads * sizeof(pthread_t));
+
+  b.kind = kind;
+  b.per_producer = per_producer;
+  b.remaining = per_producer * threads;
+  b.checksum = 0;
+  pthread_mutex_init(&b.locked.lock, NULL);
+  b.locked.queue = queue_create();
+  b.locked.size = 0;
+  b.spsc = spscq_create(RING_CAPACITY);
+  b.mpmc = mpmcq_create(RING_CAPACITY);
+
+  double start = now();
+  for (int i = 0; i < threads; i++) {
+    pthread_create(&tids[i], NULL, producer, &b);
+    pthread_create(&tids[threads + i], NULL, consumer, &b);
+  }
+  for (int i = 0; i < 2 * threads; i++) {
+    pthread_join(tids[i], NULL);
+  }
+  double elapsed = now() - start;
+
+  uint64_t expected = (uint64_t)threads * per_producer * (per_producer + 1) / 2;
+  long ops = 2 * per_producer * threads;
+  printf("%-12s %3d x %-3d %10.2f Mops/s   checksum %s\n", name, threads,
+    threads, ops / elapsed / 1e6, b.checksum == expected ? "ok" : "MISMATCH");
+
+  queue_free(b.locked.queue);
+  pthread_mutex_destroy(&b.locked.lock);
+  spscq_free(b.spsc);
+  mpmcq_free(b.mpmc);
+  free(tids);
+}
+
+int main(int argc, char** argv) {
+  int max_threads = argc > 1 ? atoi(argv[1]) : 4;
+  long per_producer = argc > 2 ? atol(argv[2]) : 1000000;
+
+  printf("queue        prod x cons     throughput\n");
+  run("spscq", KIND_SPSC, 1, per_producer);
+  for (int t = 1; t <= max_threads; t++) {
+    run("mutex+queue", KIND_LOCKED, t, per_producer);
+    run("mpmcq", KIND_MPMC, t, per_producer);
+  }
+
+  return 0;
+}
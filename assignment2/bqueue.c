@@ -0,0 +1,243 @@
+/*
+ * This file contains an implementation of a thread-safe, blocking queue.  The
+ * values themselves are stored in an ordinary queue from queue.c, protected
+ * by a mutex.  Consumers that find the queue empty sleep on a condition
+ * variable instead of polling, and producers only signal it when somebody is
+ * actually asleep, so an uncontended enqueue never makes a system call.  See
+ * the documentation below for more information on the individual functions
+ * in this implementation.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "bqueue.h"
+#include "queue.h"
+
+/*
+ * This is the structure that represents a blocking queue.  `waiters` counts
+ * consumers currently asleep on `nonempty`.  Once `closed` is set, waiting
+ * consumers return as soon as the queue is drained instead of sleeping.
+ */
+struct bqueue {
+  pthread_mutex_t lock;
+  pthread_cond_t nonempty;
+  struct queue* queue;
+  int waiters;
+  int closed;
+};
+
+/*
+ * This function allocates and initializes a new, empty blocking queue and
+ * returns a pointer to it.
+ */
+struct bqueue* bqueue_create() {
+  struct bqueue* bq = malloc(sizeof(struct bqueue));
+  assert(bq);
+
+  /*
+   * Timed waits are measured on the monotonic clock so that changes to the
+   * wall-clock time can't stretch or cut short a timeout.
+   */
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&bq->nonempty, &attr);
+  pthread_condattr_destroy(&attr);
+  pthread_mutex_init(&bq->lock, NULL);
+
+  bq->queue = queue_create();
+  bq->waiters = 0;
+  bq->closed = 0;
+  return bq;
+}
+
+/*
+ * This function frees the memory associated with a blocking queue.  It must
+ * not be called while any thread is still using the queue.  Freeing any
+ * memory associated with values still stored in the queue is the
+ * responsibility of the caller.
+ *
+ * Params:
+ *   bq - the blocking queue to be destroyed.  May not be NULL.
+ */
+void bqueue_free(struct bqueue* bq) {
+  assert(bq);
+  queue_free(bq->queue);
+  pthread_cond_destroy(&bq->nonempty);
+  pthread_mutex_destroy(&bq->lock);
+  free(bq);
+}
+
+/*
+ * This function returns the number of values currently stored in a blocking
+ * queue.  With other threads active the answer may be stale by the time the
+ * caller acts on it.
+ *
+ * Params:
+ *   bq - the blocking queue whose size is being queried.  May not be NULL.
+ */
+int bqueue_size(struct bqueue* bq) {
+  assert(bq);
+  pthread_mutex_lock(&bq->lock);
+  int size = queue_size(bq->queue);
+  pthread_mutex_unlock(&bq->lock);
+  return size;
+}
+
+/*
+ * This function enqueues a value into a blocking queue, waking one sleeping
+ * consumer if there is one.
+ *
+ * Params:
+ *   bq - the blocking queue into which to enqueue.  May not be NULL.
+ *   val - the value to be enqueued.  May not be NULL, since NULL is what the
+ *     dequeue functions return on timeout.
+ */
+void bqueue_enqueue(struct bqueue* bq, void* val) {
+  assert(bq);
+  assert(val);
+  pthread_mutex_lock(&bq->lock);
+  queue_enqueue(bq->queue, val);
+  int wake = bq->waiters > 0;
+  pthread_mutex_unlock(&bq->lock);
+  if (wake) {
+    pthread_cond_signal(&bq->nonempty);
+  }
+}
+
+/*
+ * Auxilliary function that waits (with the lock held) until the queue is
+ * non-empty, the queue is closed or the deadline passes.  A NULL deadline
+ * waits forever.  Returns 1 if the queue is non-empty on return.
+ */
+int _bqueue_wait(struct bqueue* bq, struct timespec* deadline) {
+  while (queue_isempty(bq->queue) && !bq->closed) {
+    bq->waiters++;
+    int err = deadline
+      ? pthread_cond_timedwait(&bq->nonempty, &bq->lock, deadline)
+      : pthread_cond_wait(&bq->nonempty, &bq->lock);
+    bq->waiters--;
+    if (err != 0) {
+      break;
+    }
+  }
+  return !queue_isempty(bq->queue);
+}
+
+/*
+ * Auxilliary function to compute an absolute monotonic deadline `timeout_ms`
+ * milliseconds from now.  Returns NULL (wait forever) for negative timeouts.
+ */
+struct timespec* _bqueue_deadline(struct timespec* ts, int timeout_ms) {
+  if (timeout_ms < 0) {
+    return NULL;
+  }
+  clock_gettime(CLOCK_MONOTONIC, ts);
+  ts->tv_sec += timeout_ms / 1000;
+  ts->tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+  if (ts->tv_nsec >= 1000000000) {
+    ts->tv_sec++;
+    ts->tv_nsec -= 1000000000;
+  }
+  return ts;
+}
+
+/*
+ * This function dequeues a value from a blocking queue without waiting.
+ *
+ * Params:
+ *   bq - the blocking queue from which to dequeue.  May not be NULL.
+ *
+ * Return:
+ *   This function returns the value that was dequeued, or NULL if the queue
+ *   was empty.
+ */
+void* bqueue_try_dequeue(struct bqueue* bq) {
+  return bqueue_dequeue_wait(bq, 0);
+}
+
+/*
+ * This function dequeues a value from a blocking queue, sleeping until one
+ * arrives if the queue is empty.
+ *
+ * Params:
+ *   bq - the blocking queue from which to dequeue.  May not be NULL.
+ *   timeout_ms - the maximum number of milliseconds to wait.  0 returns
+ *     immediately; a negative value waits until a value arrives or the queue
+ *     is closed.
+ *
+ * Return:
+ *   This function returns the value that was dequeued, or NULL if the wait
+ *   timed out or the queue was closed and drained.
+ */
+void* bqueue_dequeue_wait(struct bqueue* bq, int timeout_ms) {
+  void* val = NULL;
+  bqueue_dequeue_batch(bq, &val, 1, timeout_ms);
+  return val;
+}
+
+/*
+ * This function dequeues up to `max` values from a blocking queue with a
+ * single lock acquisition, sleeping until at least one value arrives if the
+ * queue is empty.  Under heavy load, consumers that take work in batches pay
+ * the synchronization cost once per batch rather than once per value.
+ *
+ * Params:
+ *   bq - the blocking queue from which to dequeue.  May not be NULL.
+ *   out - an array with room for at least `max` values, which are stored in
+ *     the order they were enqueued.  May not be NULL.
+ *   max - the maximum number of values to dequeue.  Must be positive.
+ *   timeout_ms - the maximum number of milliseconds to wait, as for
+ *     bqueue_dequeue_wait().
+ *
+ * Return:
+ *   This function returns the number of values dequeued, which is 0 only if
+ *   the wait timed out or the queue was closed and drained.
+ */
+int bqueue_dequeue_batch(struct bqueue* bq, void** out, int max,
+    int timeout_ms) {
+  assert(bq);
+  assert(out);
+  assert(max > 0);
+
+  struct timespec ts;
+  struct timespec* deadline = _bqueue_deadline(&ts, timeout_ms);
+
+  pthread_mutex_lock(&bq->lock);
+  int n = 0;
+  if (timeout_ms == 0 || _bqueue_wait(bq, deadline)) {
+    n = queue_dequeue_many(bq->queue, out, max);
+  }
+
+  /*
+   * If this batch didn't empty the queue and another consumer is asleep,
+   * pass the wakeup along so the leftover work isn't stranded.
+   */
+  int wake = !queue_isempty(bq->queue) && bq->waiters > 0;
+  pthread_mutex_unlock(&bq->lock);
+  if (wake) {
+    pthread_cond_signal(&bq->nonempty);
+  }
+  return n;
+}
+
+/*
+ * This function closes a blocking queue, waking every sleeping consumer.
+ * Values already in the queue can still be dequeued, but once it's empty,
+ * the dequeue functions return immediately instead of waiting.
+ *
+ * Params:
+ *   bq - the blocking queue to close.  May not be NULL.
+ */
+void bqueue_close(struct bqueue* bq) {
+  assert(bq);
+  pthread_mutex_lock(&bq->lock);
+  bq->closed = 1;
+  pthread_mutex_unlock(&bq->lock);
+  pthread_cond_broadcast(&bq->nonempty);
+}
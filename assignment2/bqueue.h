@@ -0,0 +1,30 @@
+/*
+ * This file contains the definition of the interface for a thread-safe,
+ * blocking queue built on top of the queue in queue.c.  You can find
+ * descriptions of the blocking queue functions, including their parameters
+ * and their return values, in bqueue.c.
+ */
+
+#ifndef __BQUEUE_H
+#define __BQUEUE_H
+
+/*
+ * Structure used to represent a blocking queue.
+ */
+struct bqueue;
+
+/*
+ * Blocking queue interface function prototypes.  Refer to bqueue.c for
+ * documentation about each of these functions.
+ */
+struct bqueue* bqueue_create();
+void bqueue_free(struct bqueue* bq);
+int bqueue_size(struct bqueue* bq);
+void bqueue_enqueue(struct bqueue* bq, void* val);
+void* bqueue_try_dequeue(struct bqueue* bq);
+void* bqueue_dequeue_wait(struct bqueue* bq, int timeout_ms);
+int bqueue_dequeue_batch(struct bqueue* bq, void** out, int max,
+  int timeout_ms);
+void bqueue_close(struct bqueue* bq);
+
+#endif
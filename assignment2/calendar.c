@@ -0,0 +1,411 @@
+/*
+ * This file contains an implementation of a calendar queue (R. Brown, 1988),
+ * a priority queue tuned for event lists, in which elements are mostly
+ * inserted a little way ahead of the one most recently removed.  LOWER
+ * priority values come out first, and elements with equal priority values
+ * come out in the order they were inserted, exactly as from pq.c.  See the
+ * documentation below for more information on the individual functions in
+ * this implementation.
+ *
+ * The queue works like a desk calendar: an array of buckets ("days"), each
+ * covering `width` consecutive priority values, with priority p going into
+ * bucket (p / width) % n_buckets whatever "year" it falls in.  Each bucket
+ * is a short sorted list.  Removal scans forward from the current day for
+ * an element that falls within the current year, which with the width set
+ * to a few times the average gap between elements finds one within a
+ * bucket or two.  The number of buckets is doubled or halved as the queue
+ * grows and shrinks, re-estimating the width from the gaps between the
+ * first few elements each time, so both insertion and removal stay O(1)
+ * amortized however many elements are queued.  If a whole year goes by
+ * without an element (e.g. after a long gap), the earliest element is found
+ * by checking the head of every bucket instead.
+ *
+ * Widths are kept to powers of two, so that finding a bucket is a shift and
+ * a mask.  Nodes are carved out of slabs and recycled through a free list,
+ * so steady-state operation doesn't allocate.
+ */
+
+#include <stdlib.h>
+#include <limits.h>
+#include <assert.h>
+
+#include "calendar.h"
+
+#define CALENDAR_MIN_BUCKETS 16
+#define CALENDAR_SLAB 1024
+
+/*
+ * Number of elements sampled to estimate the bucket width on a resize.
+ */
+#define CALENDAR_SAMPLE 25
+
+/*
+ * A single element of the queue.
+ */
+struct calendar_node {
+  void* value;
+  int priority;
+  struct calendar_node* next;
+};
+
+/*
+ * Node slabs are chained together so they can all be freed at once.
+ */
+struct calendar_slab {
+  struct calendar_slab* next;
+  struct calendar_node nodes[CALENDAR_SLAB];
+};
+
+/*
+ * This is the structure that represents a calendar queue.  Each bucket's
+ * list is sorted by priority (ties in insertion order), and `tails` points
+ * at the last node of each, so the common case of inserting behind every
+ * element already in a bucket is O(1).  `cur` is the bucket that removal
+ * scans from, and `top` is the (offset) priority at which the current
+ * year's slot in that bucket ends.  No element has a priority before that
+ * slot's start.  `resizing` suppresses nested resizes while the queue is
+ * sampled.
+ */
+struct calendar {
+  struct calendar_node** buckets;
+  struct calendar_node** tails;
+  int n_buckets;
+  int shift;
+  int size;
+  int cur;
+  long long top;
+  int resizing;
+  struct calendar_node* free_list;
+  struct calendar_slab* slabs;
+};
+
+/*
+ * Auxilliary function to map a priority to a non-negative key in the same
+ * order, so that negative priorities work too.
+ */
+long long _calendar_key(int priority) {
+  return (long long)priority - INT_MIN;
+}
+
+/*
+ * Auxilliary function returning the bucket a priority falls in.
+ */
+int _calendar_bucket(struct calendar* cal, int priority) {
+  return (int)((_calendar_key(priority) >> cal->shift) &
+    (cal->n_buckets - 1));
+}
+
+/*
+ * Auxilliary function to make the bucket holding `priority` the current one.
+ */
+void _calendar_seek(struct calendar* cal, int priority) {
+  cal->cur = _calendar_bucket(cal, priority);
+  cal->top = ((_calendar_key(priority) >> cal->shift) + 1) << cal->shift;
+}
+
+/*
+ * Auxilliary function to link a node into its bucket's sorted list, behind
+ * any nodes with the same priority.
+ */
+void _calendar_link(struct calendar* cal, struct calendar_node* node) {
+  int b = _calendar_bucket(cal, node->priority);
+  struct calendar_node* tail = cal->tails[b];
+
+  if (!tail || tail->priority <= node->priority) {
+    node->next = NULL;
+    if (tail) {
+      tail->next = node;
+    } else {
+      cal->buckets[b] = node;
+    }
+    cal->tails[b] = node;
+  } else if (cal->buckets[b]->priority > node->priority) {
+    node->next = cal->buckets[b];
+    cal->buckets[b] = node;
+  } else {
+    struct calendar_node* p = cal->buckets[b];
+    while (p->next->priority <= node->priority) {
+      p = p->next;
+    }
+    node->next = p->next;
+    p->next = node;
+  }
+}
+
+/*
+ * Auxilliary function to find the bucket holding the first element of a
+ * non-empty queue, making it the current bucket.
+ */
+int _calendar_locate(struct calendar* cal) {
+  int mask = cal->n_buckets - 1;
+  int b = cal->cur;
+  long long top = cal->top;
+
+  for (int i = 0; i < cal->n_buckets; i++) {
+    struct calendar_node* head = cal->buckets[b];
+    if (head && _calendar_key(head->priority) < top) {
+      cal->cur = b;
+      cal->top = top;
+      return b;
+    }
+    b = (b + 1) & mask;
+    top += 1LL << cal->shift;
+  }
+
+  /*
+   * Nothing is due this year, so find the earliest element directly.
+   */
+  int best = -1;
+  for (b = 0; b < cal->n_buckets; b++) {
+    if (cal->buckets[b] && (best < 0 ||
+        cal->buckets[b]->priority < cal->buckets[best]->priority)) {
+      best = b;
+    }
+  }
+  _calendar_seek(cal, cal->buckets[best]->priority);
+  return best;
+}
+
+/*
+ * Auxilliary function to unlink the first node of a non-empty queue.
+ */
+struct calendar_node* _calendar_unlink_first(struct calendar* cal) {
+  int b = _calendar_locate(cal);
+  struct calendar_node* node = cal->buckets[b];
+  cal->buckets[b] = node->next;
+  if (!node->next) {
+    cal->tails[b] = NULL;
+  }
+  cal->size--;
+  return node;
+}
+
+/*
+ * Auxilliary function to allocate and clear the bucket arrays.
+ */
+void _calendar_alloc_buckets(struct calendar* cal, int n_buckets) {
+  cal->n_buckets = n_buckets;
+  cal->buckets = calloc(n_buckets, sizeof(struct calendar_node*));
+  cal->tails = calloc(n_buckets, sizeof(struct calendar_node*));
+  assert(cal->buckets && cal->tails);
+}
+
+/*
+ * Auxilliary function to rebuild the queue with `n_buckets` buckets.  The
+ * first few elements are taken out to estimate the new width: three times
+ * their average gap, ignoring gaps over twice the average, rounded to a
+ * power of two.  Then every element is relinked into the new buckets, the
+ * sampled ones first so that ties keep their order.
+ */
+void _calendar_resize(struct calendar* cal, int n_buckets) {
+  struct calendar_node* sample[CALENDAR_SAMPLE];
+  int k = cal->size < CALENDAR_SAMPLE ? cal->size : CALENDAR_SAMPLE;
+
+  cal->resizing = 1;
+  for (int i = 0; i < k; i++) {
+    sample[i] = _calendar_unlink_first(cal);
+  }
+  if (k >= 2) {
+    long long span = _calendar_key(sample[k - 1]->priority) -
+      _calendar_key(sample[0]->priority);
+    long long sum = 0;
+    int n = 0;
+    for (int i = 1; i < k; i++) {
+      long long gap = (long long)sample[i]->priority - sample[i - 1]->priority;
+      if (gap * (k - 1) <= 2 * span) {
+        sum += gap;
+        n++;
+      }
+    }
+    long long width = n > 0 ? 3 * sum / n : 1;
+    cal->shift = 0;
+    while ((2LL << cal->shift) <= width && cal->shift < 32) {
+      cal->shift++;
+    }
+  }
+
+  struct calendar_node** old = cal->buckets;
+  int old_n = cal->n_buckets;
+  free(cal->tails);
+  _calendar_alloc_buckets(cal, n_buckets);
+  for (int i = 0; i < k; i++) {
+    _calendar_link(cal, sample[i]);
+  }
+  for (int b = 0; b < old_n; b++) {
+    struct calendar_node* node = old[b];
+    while (node) {
+      struct calendar_node* next = node->next;
+      _calendar_link(cal, node);
+      node = next;
+    }
+  }
+  free(old);
+
+  cal->size += k;
+  if (k > 0) {
+    _calendar_seek(cal, sample[0]->priority);
+  } else {
+    cal->cur = 0;
+    cal->top = 1LL << cal->shift;
+  }
+  cal->resizing = 0;
+}
+
+/*
+ * This function allocates and initializes an empty calendar queue and
+ * returns a pointer to it.
+ */
+struct calendar* calendar_create() {
+  struct calendar* cal = malloc(sizeof(struct calendar));
+  assert(cal);
+  _calendar_alloc_buckets(cal, CALENDAR_MIN_BUCKETS);
+  cal->shift = 0;
+  cal->size = 0;
+  cal->cur = 0;
+  cal->top = 1;
+  cal->resizing = 0;
+  cal->free_list = NULL;
+  cal->slabs = NULL;
+  return cal;
+}
+
+/*
+ * This function frees the memory allocated to a given calendar queue.  Note
+ * that this function DOES NOT free the individual elements stored in the
+ * queue.  That is the responsibility of the caller.
+ *
+ * Params:
+ *   cal - the calendar queue to be destroyed.  May not be NULL.
+ */
+void calendar_free(struct calendar* cal) {
+  assert(cal);
+  struct calendar_slab* next, * slab = cal->slabs;
+  while (slab) {
+    next = slab->next;
+    free(slab);
+    slab = next;
+  }
+  free(cal->buckets);
+  free(cal->tails);
+  free(cal);
+}
+
+/*
+ * This function returns 1 if the specified calendar queue is empty and 0
+ * otherwise.
+ */
+int calendar_isempty(struct calendar* cal) {
+  assert(cal);
+  return cal->size == 0;
+}
+
+/*
+ * This function returns the number of elements in a calendar queue.
+ */
+int calendar_size(struct calendar* cal) {
+  assert(cal);
+  return cal->size;
+}
+
+/*
+ * This function inserts a given element into a calendar queue with a
+ * specified priority value.  This is O(1) amortized when priorities are
+ * spread roughly evenly ahead of the last one removed, as event times are.
+ * An element may be inserted with any priority, including one before the
+ * last one removed; the queue then just moves back to it.
+ *
+ * Params:
+ *   cal - the calendar queue into which to insert an element.  May not be
+ *     NULL.
+ *   value - the value to be inserted into cal.
+ *   priority - the priority value to be assigned to the newly-inserted
+ *     element.  LOWER priority values correspond to elements with HIGHER
+ *     priority.
+ */
+void calendar_insert(struct calendar* cal, void* value, int priority) {
+  assert(cal);
+  if (!cal->resizing && cal->size + 1 > 2 * cal->n_buckets) {
+    _calendar_resize(cal, 2 * cal->n_buckets);
+  }
+
+  struct calendar_node* node = cal->free_list;
+  if (node) {
+    cal->free_list = node->next;
+  } else {
+    struct calendar_slab* slab = malloc(sizeof(struct calendar_slab));
+    assert(slab);
+    slab->next = cal->slabs;
+    cal->slabs = slab;
+    for (int i = CALENDAR_SLAB - 1; i > 0; i--) {
+      slab->nodes[i].next = cal->free_list;
+      cal->free_list = &slab->nodes[i];
+    }
+    node = &slab->nodes[0];
+  }
+  node->value = value;
+  node->priority = priority;
+  _calendar_link(cal, node);
+  cal->size++;
+
+  if (_calendar_key(priority) < cal->top - (1LL << cal->shift)) {
+    _calendar_seek(cal, priority);
+  }
+}
+
+/*
+ * This function returns the value of the first item in a calendar queue,
+ * i.e. the item with LOWEST priority value.
+ *
+ * Params:
+ *   cal - the calendar queue from which to fetch a value.  May not be NULL.
+ *
+ * Return:
+ *   This function returns the value of the first item in cal, or NULL if
+ *   cal is empty.
+ */
+void* calendar_first(struct calendar* cal) {
+  assert(cal);
+  return cal->size > 0 ? cal->buckets[_calendar_locate(cal)]->value : NULL;
+}
+
+/*
+ * This function returns the priority value of the first item in a calendar
+ * queue, i.e. the item with LOWEST priority value.
+ *
+ * Params:
+ *   cal - the calendar queue from which to fetch a priority value.  May not
+ *     be NULL or empty.
+ */
+int calendar_first_priority(struct calendar* cal) {
+  assert(cal && cal->size > 0);
+  return cal->buckets[_calendar_locate(cal)]->priority;
+}
+
+/*
+ * This function returns the value of the first item in a calendar queue,
+ * i.e. the item with LOWEST priority value, and then removes that item from
+ * the queue.  This is O(1) amortized.
+ *
+ * Params:
+ *   cal - the calendar queue from which to remove a value.  May not be NULL.
+ *
+ * Return:
+ *   This function returns the value of the first item in cal, or NULL if
+ *   cal is empty.
+ */
+void* calendar_remove_first(struct calendar* cal) {
+  assert(cal);
+  if (cal->size == 0) {
+    return NULL;
+  }
+  struct calendar_node* node = _calendar_unlink_first(cal);
+  void* value = node->value;
+  node->next = cal->free_list;
+  cal->free_list = node;
+
+  if (!cal->resizing && cal->n_buckets > CALENDAR_MIN_BUCKETS &&
+      cal->size < cal->n_buckets / 2) {
+    _calendar_resize(cal, cal->n_buckets / 2);
+  }
+  return value;
+}
@@ -0,0 +1,31 @@
+/*
+ * This file contains the definition of the interface for a calendar queue, a
+ * priority queue with O(1) amortized insertion and removal for event lists
+ * whose priorities are times.  It has the same interface as the binary heap
+ * in pq.h, so either can be used as a simulation's event list.  You can find
+ * descriptions of the calendar queue functions, including their parameters
+ * and their return values, in calendar.c.
+ */
+
+#ifndef __CALENDAR_H
+#define __CALENDAR_H
+
+/*
+ * Structure used to represent a calendar queue.
+ */
+struct calendar;
+
+/*
+ * Calendar queue interface function prototypes.  Refer to calendar.c for
+ * documentation about each of these functions.
+ */
+struct calendar* calendar_create();
+void calendar_free(struct calendar* cal);
+int calendar_isempty(struct calendar* cal);
+int calendar_size(struct calendar* cal);
+void calendar_insert(struct calendar* cal, void* value, int priority);
+void* calendar_first(struct calendar* cal);
+int calendar_first_priority(struct calendar* cal);
+void* calendar_remove_first(struct calendar* cal);
+
+#endif
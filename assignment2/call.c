@@ -0,0 +1,42 @@
+/*
+ * This file contains the functions for creating and printing the call
+ * records used by the call center programs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "call.h"
+
+/*
+ * Function to fill in an already-allocated call object.
+ */
+void init_call(struct call* c, int id, char* name, char* reason) {
+    c->id = id;
+    strncpy(c->name, name, sizeof(c->name) - 1);
+    c->name[sizeof(c->name) - 1] = '\0';
+    strncpy(c->reason, reason, sizeof(c->reason) - 1);
+    c->reason[sizeof(c->reason) - 1] = '\0';
+    c->received_at = 0;
+}
+
+/*
+ * Function to create a new call object.
+ */
+struct call* create_call(int id, char* name, char* reason) {
+    struct call* new_call = malloc(sizeof(struct call));
+    init_call(new_call, id, name, reason);
+    return new_call;
+}
+
+/*
+ * Function to print call details.
+ */
+void print_call(struct call* c) {
+    if (c) {
+        printf("Call ID: %d\n", c->id);
+        printf("Caller Name: %s\n", c->name);
+        printf("Call Reason: %s\n", c->reason);
+    }
+}
@@ -0,0 +1,30 @@
+/*
+ * This file contains the definition of the call record shared by the call
+ * center programs, along with the functions used to create and print calls.
+ * You can find descriptions of these functions in call.c.
+ */
+
+#ifndef __CALL_H
+#define __CALL_H
+
+/*
+ * Struct to represent a call in the call center.  `received_at` is the
+ * wall-clock time the call was received, in microseconds (see metrics.c),
+ * or 0 if it isn't known.
+ */
+struct call {
+    int id;
+    char name[50];
+    char reason[100];
+    long long received_at;
+};
+
+/*
+ * Call function prototypes.  Refer to call.c for documentation about each of
+ * these functions.
+ */
+void init_call(struct call* c, int id, char* name, char* reason);
+struct call* create_call(int id, char* name, char* reason);
+void print_call(struct call* c);
+
+#endif
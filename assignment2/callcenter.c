@@ -1,48 +1,107 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
 
-#include "queue.h"
-#include "stack.h"
+#include "call.h"
+#include "callpool.h"
+#include "engine.h"
+#include "replay.h"
+#include "router.h"
+#include "server.h"
+#include "journal.h"
+#include "snapshot.h"
+#include "metrics.h"
+#include "callq.h"
+#include "ring.h"
+#include "bqueue.h"
+#include "dynarray.h"
 
+/*
+ * Number of call records the call pool allocates at a time.
+ */
+#define CALL_POOL_SLAB 1024
 
 /*
- * Struct to represent a call in the call center.
+ * Default number of answered calls kept in the history.
  */
-struct call {
-    int id;
-    char name[50];
-    char reason[100];
+#define HISTORY_CAPACITY 1000
+
+/*
+ * Context for evicting calls from the answered-call history.  Evicted calls
+ * go back to `pool`; if `archive` isn't NULL, a copy of each one is first
+ * queued there for the archiver thread to write to `archive_file`.
+ *
+ * Audit snapshots share the records in the history rather than copying
+ * them.  `evicted` counts the calls evicted so far and `audited` the calls
+ * pushed into the history up to the latest audit snapshot.  Since calls are
+ * evicted in the order they were pushed, an evicted call is held by a
+ * snapshot exactly when fewer than `audited` calls were evicted before it.
+ * Such a record isn't released; it's freed with the pool at exit.
+ */
+struct history_ctx {
+    struct call_pool* pool;
+    struct bqueue* archive;
+    FILE* archive_file;
+    pthread_t archiver;
+    long evicted;
+    long audited;
 };
 
 /*
- * Function to create a new call object.
+ * Function to evict a call from the answered-call history.  The copy handed
+ * to the archiver is malloc()'d rather than taken from the pool, since the
+ * pool isn't thread-safe.
  */
-struct call* create_call(int id, char* name, char* reason) {
-    struct call* new_call = malloc(sizeof(struct call));
-    new_call->id = id;
-    strncpy(new_call->name, name, sizeof(new_call->name) - 1);
-    new_call->name[sizeof(new_call->name) - 1] = '\0';
-    strncpy(new_call->reason, reason, sizeof(new_call->reason) - 1);
-    new_call->reason[sizeof(new_call->reason) - 1] = '\0';
-    return new_call;
+void evict_answered_call(void* ctx, void* val) {
+    struct history_ctx* hctx = ctx;
+    struct call* c = val;
+
+    if (hctx->archive) {
+        struct call* copy = malloc(sizeof(struct call));
+        assert(copy);
+        *copy = *c;
+        bqueue_enqueue(hctx->archive, copy);
+    }
+    if (hctx->evicted++ < hctx->audited) {
+        return;
+    }
+    call_pool_release(hctx->pool, c);
 }
 
 /*
- * Function to print call details.
+ * Archiver thread: appends every call evicted from the answered-call history
+ * to the archive file, one "id|name|reason" line per call, until the archive
+ * queue is closed and drained.
  */
-void print_call(struct call* c) {
-    if (c) {
-        printf("Call ID: %d\n", c->id);
-        printf("Caller Name: %s\n", c->name);
-        printf("Call Reason: %s\n", c->reason);
+void* archiver_thread(void* arg) {
+    struct history_ctx* hctx = arg;
+    FILE* out = hctx->archive_file;
+    struct call* batch[64];
+    int n;
+
+    while ((n = bqueue_dequeue_batch(hctx->archive, (void**)batch, 64,
+            -1)) > 0) {
+        for (int i = 0; i < n; i++) {
+            fprintf(out, "%d|%s|%s\n", batch[i]->id, batch[i]->name,
+                batch[i]->reason);
+            free(batch[i]);
+        }
+        fflush(out);
     }
+    return NULL;
 }
 
 /*
  * Function to receive a new call and add it to the queue.
  */
-void receive_call(struct queue* q, int* call_id) {
+void receive_call(struct callq* q, struct call_pool* pool, int* call_id,
+        struct journal* j, struct metrics_shard* m) {
     char name[50], reason[100];
 
     printf("Enter caller's name: ");
@@ -51,22 +110,47 @@ void receive_call(struct queue* q, int* call_id) {
     printf("Enter call reason: ");
     scanf(" %[^\n]", reason);
 
-    struct call* new_call = create_call((*call_id)++, name, reason);
-    queue_enqueue(q, new_call);
-    printf("Call received and added to the queue.\n");
+    struct call* new_call = call_pool_create_call(pool, (*call_id)++, name,
+        reason);
+    new_call->received_at = metrics_now_us();
+    callq_enqueue(q, new_call);
+    if (j) {
+        journal_receive(j, new_call);
+        journal_commit(j);
+    }
+    if (m) {
+        metrics_count(m, METRICS_RECEIVED, 1);
+        metrics_record(m, METRICS_QUEUE_DEPTH, callq_size(q));
+    }
+    printf("Call received and added to the queue (call ID %d).\n",
+        new_call->id);
 }
 
 /*
  * Function to answer a call (move from queue to stack).
  */
-void answer_call(struct queue* q, struct stack* s) {
-    if (queue_isempty(q)) {
+void answer_call(struct callq* q, struct ring* history, struct journal* j,
+        struct metrics_shard* m) {
+    if (callq_isempty(q)) {
         printf("No calls in queue.\n");
         return;
     }
 
-    struct call* answered_call = queue_dequeue(q);
-    stack_push(s, answered_call);
+    struct call* answered_call = callq_dequeue(q);
+    if (j) {
+        journal_answer(j, answered_call->id);
+        journal_commit(j);
+    }
+    ring_push(history, answered_call);
+    if (m) {
+        metrics_count(m, METRICS_ANSWERED, 1);
+        if (answered_call->received_at) {
+            metrics_record(m, METRICS_WAIT_US,
+                metrics_now_us() - answered_call->received_at);
+        }
+        metrics_record(m, METRICS_QUEUE_DEPTH, callq_size(q));
+        metrics_record(m, METRICS_HISTORY_DEPTH, ring_size(history));
+    }
     printf("Call answered:\n");
     print_call(answered_call);
 }
@@ -74,49 +158,439 @@ void answer_call(struct queue* q, struct stack* s) {
 /*
  * Function to display the last answered call.
  */
-void display_answered_calls(struct stack* s) {
-    if (stack_isempty(s)) {
+void display_answered_calls(struct ring* history) {
+    struct call* last_call = ring_newest(history);
+    if (!last_call) {
         printf("No calls have been answered yet.\n");
         return;
     }
 
-    struct call* last_call = stack_top(s);
     printf("Last answered call:\n");
     print_call(last_call);
 }
 
+/*
+ * Function to display the most recently answered calls, newest first.  The
+ * history keeps them contiguous, so this reads them straight out of it.
+ */
+void display_last_answered_calls(struct ring* history) {
+    int k, n;
+
+    printf("Enter number of calls (1-%d): ", ring_capacity(history));
+    if (scanf("%d", &k) != 1 || k < 1) {
+        printf("Invalid number of calls.\n");
+        return;
+    }
+
+    struct call** calls = (struct call**)ring_last_k(history, k, &n);
+    if (n == 0) {
+        printf("No calls have been answered yet.\n");
+        return;
+    }
+    printf("Last %d answered calls:\n", n);
+    for (int i = n - 1; i >= 0; i--) {
+        print_call(calls[i]);
+    }
+}
+
 /*
  * Function to display the next call in queue.
  */
-void display_waiting_calls(struct queue* q) {
-    if (queue_isempty(q)) {
+void display_waiting_calls(struct callq* q) {
+    if (callq_isempty(q)) {
         printf("No calls are waiting.\n");
         return;
     }
 
-    struct call* next_call = queue_front(q);
+    struct call* next_call = callq_front(q);
     printf("Next call to be answered:\n");
     print_call(next_call);
 }
 
 /*
- * Function to free all allocated memory before exiting.
+ * Function to cancel a waiting call whose caller hung up.
+ */
+void cancel_call(struct callq* q, struct journal* j,
+        struct metrics_shard* m) {
+    int id;
+
+    printf("Enter call ID: ");
+    if (scanf("%d", &id) != 1) {
+        printf("Invalid call ID.\n");
+        return;
+    }
+
+    if (callq_cancel(q, id)) {
+        if (j) {
+            journal_cancel(j, id);
+            journal_commit(j);
+        }
+        if (m) {
+            metrics_count(m, METRICS_CANCELLED, 1);
+        }
+        printf("Call %d cancelled.\n", id);
+    } else {
+        printf("Call %d is not waiting.\n", id);
+    }
+}
+
+/*
+ * Function to save the waiting and answered calls and the call ID counter to
+ * a state snapshot that the call center can be restarted from.
  */
-void cleanup(struct queue* q, struct stack* s) {
-    while (!queue_isempty(q)) {
-        free(queue_dequeue(q));
+void save_snapshot(struct callq* q, struct ring* history, int call_id,
+        char* path) {
+    if (!path) {
+        printf("No snapshot file was given (use -s).\n");
+        return;
     }
-    while (!stack_isempty(s)) {
-        free(stack_pop(s));
+    if (snapshot_save(path, q, history, call_id) == 0) {
+        printf("Saved %d waiting and %d answered calls to %s.\n",
+            callq_size(q), ring_size(history), path);
+    } else {
+        printf("Couldn't save snapshot to %s.\n", path);
     }
-    queue_free(q);
-    stack_free(s);
 }
 
-int main() {
-    struct queue* call_queue = queue_create();
-    struct stack* answered_stack = stack_create();
+/*
+ * Function to take a point-in-time audit snapshot of the answered calls.
+ * The snapshot shares the history's call records, which are kept from being
+ * released when they're evicted (see struct history_ctx), so it only costs
+ * a pointer per call.
+ */
+void take_audit_snapshot(struct ring* history, struct history_ctx* hctx,
+        struct dynarray* snapshots) {
+    int n;
+    void** calls = ring_last_k(history, ring_size(history), &n);
+    struct ring* snapshot = ring_create(n > 0 ? n : 1, NULL, NULL);
+
+    ring_push_many(snapshot, calls, n);
+    hctx->audited = hctx->evicted + n;
+    dynarray_insert(snapshots, snapshot);
+    printf("Audit snapshot #%d taken (%d answered calls).\n",
+        dynarray_size(snapshots), n);
+}
+
+/*
+ * Function to display every call in an audit snapshot, most recent first.
+ */
+void display_audit_snapshot(struct dynarray* snapshots) {
+    int n;
+
+    if (dynarray_size(snapshots) == 0) {
+        printf("No audit snapshots have been taken yet.\n");
+        return;
+    }
+
+    printf("Enter snapshot number (1-%d): ", dynarray_size(snapshots));
+    if (scanf("%d", &n) != 1 || n < 1 || n > dynarray_size(snapshots)) {
+        printf("Invalid snapshot number.\n");
+        return;
+    }
+
+    struct ring* snapshot = dynarray_get(snapshots, n - 1);
+    int size;
+    struct call** calls = (struct call**)ring_last_k(snapshot,
+        ring_size(snapshot), &size);
+    printf("Audit snapshot #%d (%d answered calls):\n", n, size);
+    for (int i = size - 1; i >= 0; i--) {
+        print_call(calls[i]);
+    }
+}
+
+/*
+ * Function to free all allocated memory before exiting.  Every call record,
+ * waiting, answered or held by an audit snapshot, comes from the call pool,
+ * so they're all released at once when the pool is freed, after the
+ * structures holding them.  Freeing the history evicts the calls still in
+ * it, so when archiving, they're archived too before the archiver is
+ * stopped.  Freeing the metrics (if any) dumps them one last time.  This is
+ * also used to bail out when the state can't be recovered at startup.
+ */
+void cleanup(struct callq* q, struct ring* history, struct dynarray* snapshots,
+        struct history_ctx* hctx, struct journal* j, struct metrics* m) {
+    if (j) {
+        journal_close(j);
+    }
+    for (int i = 0; i < dynarray_size(snapshots); i++) {
+        ring_free(dynarray_get(snapshots, i));
+    }
+    callq_free(q);
+    ring_free(history);
+    dynarray_free(snapshots);
+    if (hctx->archive) {
+        bqueue_close(hctx->archive);
+        pthread_join(hctx->archiver, NULL);
+        bqueue_free(hctx->archive);
+        fclose(hctx->archive_file);
+    }
+    call_pool_free(hctx->pool);
+    if (m) {
+        metrics_free(m);
+    }
+}
+
+/*
+ * Function to print command line usage.
+ */
+void usage(char* prog) {
+    fprintf(stderr, "Usage: %s [-d spill_dir] [-m high_water] [-H history]"
+        " [-a archive_file] [-j journal | -s snapshot]\n", prog);
+    fprintf(stderr, "       %s -f trace_file [-p] [-S skills]\n", prog);
+    fprintf(stderr, "       %s -l socket_path [-j journal] [-W sla_seconds]"
+        " [-T abandon_seconds]\n", prog);
+    fprintf(stderr, "       %s -A agents [-P producers] [-t seconds]"
+        " [-r rate] [-w service_us] [-q max_depth]\n", prog);
+    fprintf(stderr, "Any mode but -f also takes [-M metrics_path"
+        " [-I interval_ms]].\n");
+}
+
+/*
+ * Usage: ./callcenter [-d spill_dir] [-m high_water] [-H history]
+ *                     [-a archive_file] [-j journal | -s snapshot]
+ *        ./callcenter -f trace_file [-p] [-S skills]
+ *        ./callcenter -l socket_path [-j journal] [-W sla_seconds]
+ *                     [-T abandon_seconds]
+ *        ./callcenter -A agents [-P producers] [-t seconds] [-r rate]
+ *                     [-w service_us] [-q max_depth]
+ *
+ * Any mode but -f also takes [-M metrics_path [-I interval_ms]].
+ *
+ * With -d, waiting calls beyond the high-water mark (default 100000) are
+ * spilled to segment files in spill_dir instead of being kept in memory.
+ *
+ * Only the last -H answered calls (default 1000) are kept; older ones are
+ * released, or with -a, first appended to archive_file by a background
+ * thread.
+ *
+ * With -j, every received, answered and cancelled call is recorded in a
+ * journal file before it's acknowledged, and on startup the waiting and
+ * answered calls are recovered from it (see journal.c).
+ *
+ * With -s, the waiting and answered calls are restored at startup from the
+ * snapshot file (if it exists), which is much faster than replaying a
+ * journal, and saved back to it on quit or on demand (see snapshot.c).
+ * Calls received since the last save are lost on a crash, so -s can't be
+ * combined with -j.
+ *
+ * With -f, the interactive menu is replaced by a replay of the call events
+ * in trace_file ("-" for stdin), either as fast as possible or, with -p, at
+ * the pace they were recorded (see replay.c).  With -S, the replayed calls
+ * are routed by skill and customer tier into that many per-skill priority
+ * queues (see router.c) instead of going through one FIFO.
+ *
+ * With -l, the interactive menu is replaced by a server that takes call
+ * events from any number of clients over a Unix domain socket at
+ * socket_path, until interrupted (see server.c and callclient.c).  With -W,
+ * every call still waiting after sla_seconds is reported as an SLA breach,
+ * and with -T, every call still waiting after abandon_seconds is cancelled
+ * as abandoned.
+ *
+ * With -A, the interactive menu is replaced by the multithreaded engine (see
+ * engine.c): -P producer threads generate calls (at -r calls/s each, or as
+ * fast as possible) for -t seconds while -A agent threads answer them,
+ * spending -w microseconds on each.
+ *
+ * With -M, counters of calls received, answered and cancelled and
+ * histograms of waiting times and of queue and history depth are kept, and
+ * dumped as plain text every -I milliseconds (default 1000) to
+ * metrics_path, or served to any client of a Unix domain socket if
+ * metrics_path is "unix:socket_path" (see metrics.c).
+ */
+int main(int argc, char** argv) {
+    char* spill_dir = NULL;
+    int high_water = 100000;
+    int history_cap = HISTORY_CAPACITY;
+    char* archive = NULL;
+    char* journal_path = NULL;
+    char* snapshot_path = NULL;
+    int use_engine = 0;
+    char* trace = NULL;
+    int paced = 0;
+    int n_skills = 0;
+    char* socket_path = NULL;
+    char* metrics_path = NULL;
+    int metrics_interval = 1000;
+    double sla_s = 0;
+    double abandon_s = 0;
+    struct engine_config cfg;
+    int opt;
+
+    engine_default_config(&cfg);
+    while ((opt = getopt(argc, argv,
+            "d:m:H:a:j:s:f:pS:l:A:P:t:r:w:q:M:I:W:T:")) != -1) {
+        switch (opt) {
+        case 'd':
+            spill_dir = optarg;
+            break;
+        case 'm':
+            high_water = atoi(optarg);
+            break;
+        case 'H':
+            history_cap = atoi(optarg);
+            break;
+        case 'a':
+            archive = optarg;
+            break;
+        case 'j':
+            journal_path = optarg;
+            break;
+        case 's':
+            snapshot_path = optarg;
+            break;
+        case 'f':
+            trace = optarg;
+            break;
+        case 'p':
+            paced = 1;
+            break;
+        case 'S':
+            n_skills = atoi(optarg);
+            if (n_skills < 1 || n_skills > ROUTER_MAX_SKILLS) {
+                fprintf(stderr, "Number of skills must be between 1 and %d.\n",
+                    ROUTER_MAX_SKILLS);
+                return 1;
+            }
+            break;
+        case 'l':
+            socket_path = optarg;
+            break;
+        case 'A':
+            use_engine = 1;
+            cfg.agents = atoi(optarg);
+            break;
+        case 'P':
+            cfg.producers = atoi(optarg);
+            break;
+        case 't':
+            cfg.seconds = atoi(optarg);
+            break;
+        case 'r':
+            cfg.rate = atoi(optarg);
+            break;
+        case 'w':
+            cfg.service_us = atoi(optarg);
+            break;
+        case 'q':
+            cfg.max_depth = atoi(optarg);
+            break;
+        case 'M':
+            metrics_path = optarg;
+            break;
+        case 'I':
+            metrics_interval = atoi(optarg);
+            break;
+        case 'W':
+            sla_s = atof(optarg);
+            break;
+        case 'T':
+            abandon_s = atof(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (trace) {
+        return replay_trace(trace, paced, n_skills);
+    }
+    if (high_water < 1) {
+        fprintf(stderr, "High-water mark must be positive.\n");
+        return 1;
+    }
+    if (history_cap < 1) {
+        fprintf(stderr, "History capacity must be positive.\n");
+        return 1;
+    }
+    if (journal_path && snapshot_path) {
+        fprintf(stderr, "A journal and a snapshot can't be used together.\n");
+        return 1;
+    }
+    if (metrics_interval < 1) {
+        fprintf(stderr, "Metrics interval must be positive.\n");
+        return 1;
+    }
+    if (sla_s < 0 || sla_s > 1e6 || abandon_s < 0 || abandon_s > 1e6) {
+        fprintf(stderr, "SLA and abandonment times must be between 0 and"
+            " 1000000 seconds.\n");
+        return 1;
+    }
+
+    struct metrics* metrics = NULL;
+    if (metrics_path) {
+        metrics = metrics_create();
+        if (metrics_start(metrics, metrics_path, metrics_interval) < 0) {
+            metrics_free(metrics);
+            return 1;
+        }
+    }
+    if (socket_path || use_engine) {
+        cfg.metrics = metrics;
+        int status = socket_path ?
+            server_run(socket_path, journal_path, metrics,
+                (int)(sla_s * 1000), (int)(abandon_s * 1000)) :
+            engine_run(&cfg);
+        if (metrics) {
+            metrics_free(metrics);
+        }
+        return status;
+    }
+
+    struct call_pool* pool = call_pool_create(CALL_POOL_SLAB);
+    struct callq* call_queue = callq_create(spill_dir, high_water, pool);
+    struct history_ctx hctx = { .pool = pool };
+    if (archive) {
+        hctx.archive_file = fopen(archive, "a");
+        if (!hctx.archive_file) {
+            perror(archive);
+            callq_free(call_queue);
+            call_pool_free(pool);
+            if (metrics) {
+                metrics_free(metrics);
+            }
+            return 1;
+        }
+        hctx.archive = bqueue_create();
+        pthread_create(&hctx.archiver, NULL, archiver_thread, &hctx);
+    }
+    struct ring* history = ring_create(history_cap, evict_answered_call,
+        &hctx);
+    struct dynarray* snapshots = dynarray_create();
+    struct journal* journal = NULL;
+    struct metrics_shard* shard = metrics ? metrics_shard_create(metrics) :
+        NULL;
     int call_id = 1;
+
+    if (journal_path) {
+        journal = journal_open(journal_path, history_cap);
+        if (journal) {
+            call_id = journal_load(journal, call_queue, history, pool);
+        }
+        if (call_id < 0 || !journal) {
+            fprintf(stderr, "Couldn't recover from journal %s.\n",
+                journal_path);
+            cleanup(call_queue, history, snapshots, &hctx, journal, metrics);
+            return 1;
+        }
+        printf("Recovered %d waiting and %d answered calls from %s.\n",
+            callq_size(call_queue), ring_size(history), journal_path);
+    }
+    if (snapshot_path && access(snapshot_path, F_OK) == 0) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        call_id = snapshot_restore(snapshot_path, call_queue, history, pool);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        if (call_id < 0) {
+            fprintf(stderr, "Couldn't restore from snapshot %s.\n",
+                snapshot_path);
+            cleanup(call_queue, history, snapshots, &hctx, journal, metrics);
+            return 1;
+        }
+        printf("Restored %d waiting and %d answered calls from %s in %.1f"
+            " ms.\n", callq_size(call_queue), ring_size(history),
+            snapshot_path, (end.tv_sec - start.tv_sec) * 1e3 +
+            (end.tv_nsec - start.tv_nsec) / 1e6);
+    }
     int choice;
 
     while (1) {
@@ -126,26 +600,49 @@ int main() {
         printf("3. Display answered calls\n");
         printf("4. Display waiting calls\n");
         printf("5. Quit\n");
+        printf("6. Take audit snapshot of answered calls\n");
+        printf("7. Display audit snapshot\n");
+        printf("8. Cancel a waiting call\n");
+        printf("9. Display last answered calls\n");
+        printf("10. Save state snapshot\n");
         printf("Enter your choice: ");
         scanf("%d", &choice);
 
         switch (choice) {
         case 1:
-            receive_call(call_queue, &call_id);
+            receive_call(call_queue, pool, &call_id, journal, shard);
             break;
         case 2:
-            answer_call(call_queue, answered_stack);
+            answer_call(call_queue, history, journal, shard);
             break;
         case 3:
-            display_answered_calls(answered_stack);
+            display_answered_calls(history);
             break;
         case 4:
             display_waiting_calls(call_queue);
             break;
         case 5:
-            cleanup(call_queue, answered_stack);
+            if (snapshot_path) {
+                save_snapshot(call_queue, history, call_id, snapshot_path);
+            }
+            cleanup(call_queue, history, snapshots, &hctx, journal, metrics);
             printf("Exiting program. Goodbye!\n");
             return 0;
+        case 6:
+            take_audit_snapshot(history, &hctx, snapshots);
+            break;
+        case 7:
+            display_audit_snapshot(snapshots);
+            break;
+        case 8:
+            cancel_call(call_queue, journal, shard);
+            break;
+        case 9:
+            display_last_answered_calls(history);
+            break;
+        case 10:
+            save_snapshot(call_queue, history, call_id, snapshot_path);
+            break;
         default:
             printf("Invalid choice. Please try again.\n");
         }
@@ -0,0 +1,288 @@
+/*
+ * This file contains a client for the call center's socket front end (see
+ * server.c), standing in for a telephony system.  It opens several
+ * connections to a running `callcenter -l socket_path`, pushes calls into it
+ * over all of them in batches, optionally answers every call, and reports
+ * how many events/s the server took along with the server's counters.
+ *
+ * Usage: ./callclient [options]
+ *   -s path       socket path (default callcenter.sock)
+ *   -n calls      number of calls to push (default 100000)
+ *   -c conns      number of connections to spread them over (default 4)
+ *   -b batch      frames per write (default 256)
+ *   -r            ask for (and wait for) a reply to every call, instead of
+ *                 streaming them with FRAME_NOREPLY
+ *   -A            answer every waiting call afterwards
+ *   -C ms         schedule the calls as callbacks due in ms milliseconds
+ *                 instead of pushing them straight in
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "server.h"
+
+/*
+ * Function returning the current monotonic time in seconds.
+ */
+double client_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Function to write a whole buffer to a blocking socket.
+ */
+int client_write_all(int fd, const char* buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/*
+ * Function to read exactly `len` bytes from a blocking socket.
+ */
+int client_read_all(int fd, char* buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = read(fd, buf, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/*
+ * Function to read one reply frame into `payload` (which must hold
+ * FRAME_MAX_PAYLOAD bytes).  Returns the frame type, or -1 on error.
+ */
+int client_read_frame(int fd, char* payload) {
+    struct frame_header hdr;
+    if (client_read_all(fd, (char*)&hdr, sizeof(hdr)) < 0 ||
+            hdr.len > FRAME_MAX_PAYLOAD ||
+            client_read_all(fd, payload, hdr.len) < 0) {
+        return -1;
+    }
+    return hdr.type;
+}
+
+/*
+ * Function to append a request frame to a buffer.  Returns the new length of
+ * the buffer.
+ */
+size_t client_frame(char* buf, size_t len, int type, int flags,
+        const void* payload, int payload_len) {
+    struct frame_header hdr = { (uint16_t)payload_len, (uint8_t)type,
+        (uint8_t)flags };
+    memcpy(buf + len, &hdr, sizeof(hdr));
+    if (payload_len > 0) {
+        memcpy(buf + len + sizeof(hdr), payload, payload_len);
+    }
+    return len + sizeof(hdr) + payload_len;
+}
+
+/*
+ * Function to connect to the server's socket.
+ */
+int client_connect(const char* path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        perror(path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+/*
+ * Function to ask the server for its counters and print them.
+ */
+int client_print_stats(int fd) {
+    char buf[FRAME_MAX_PAYLOAD];
+    uint32_t stats[4];
+
+    size_t len = client_frame(buf, 0, FRAME_STATS, 0, NULL, 0);
+    if (client_write_all(fd, buf, len) < 0 ||
+            client_read_frame(fd, buf) != FRAME_STATS_REPLY) {
+        fprintf(stderr, "Couldn't get server stats.\n");
+        return -1;
+    }
+    memcpy(stats, buf, sizeof(stats));
+    printf("  server: received %u, answered %u, cancelled %u, waiting %u\n",
+        stats[0], stats[1], stats[2], stats[3]);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    char* path = "callcenter.sock";
+    long n = 100000;
+    int n_conns = 4, batch = 256, replies = 0, answer = 0;
+    long callback_ms = -1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:n:c:b:rAC:")) != -1) {
+        switch (opt) {
+        case 's':
+            path = optarg;
+            break;
+        case 'n':
+            n = atol(optarg);
+            break;
+        case 'c':
+            n_conns = atoi(optarg);
+            break;
+        case 'b':
+            batch = atoi(optarg);
+            break;
+        case 'r':
+            replies = 1;
+            break;
+        case 'A':
+            answer = 1;
+            break;
+        case 'C':
+            callback_ms = atol(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-s path] [-n calls] [-c conns]"
+                " [-b batch] [-r] [-A] [-C callback_ms]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (n < 0 || n_conns < 1 || batch < 1 || callback_ms > UINT32_MAX) {
+        fprintf(stderr, "Bad option value.\n");
+        return 1;
+    }
+
+    int* fds = malloc(n_conns * sizeof(int));
+    for (int i = 0; i < n_conns; i++) {
+        fds[i] = client_connect(path);
+        if (fds[i] < 0) {
+            return 1;
+        }
+    }
+
+    /*
+     * Every call carries the same payload (after the delay, for callbacks);
+     * build a batch of its frames once.
+     */
+    int callback = callback_ms >= 0;
+    uint32_t delay = callback ? (uint32_t)callback_ms : 0;
+    char payload[sizeof(delay) + 2 + 12 + 40];
+    char* call = payload + sizeof(delay);
+    memcpy(payload, &delay, sizeof(delay));
+    call[0] = 12;
+    call[1] = 40;
+    memset(call + 2, 'n', 12);
+    memset(call + 14, 'r', 40);
+    char* buf = malloc((size_t)batch * (sizeof(struct frame_header) +
+        sizeof(payload)));
+    size_t len = 0;
+    for (int i = 0; i < batch; i++) {
+        len = client_frame(buf, len, callback ? FRAME_CALLBACK : FRAME_RECEIVE,
+            replies ? 0 : FRAME_NOREPLY, callback ? payload : call,
+            callback ? (int)sizeof(payload) : (int)sizeof(payload) - 4);
+    }
+    size_t frame_len = len / batch;
+    char reply[FRAME_MAX_PAYLOAD];
+
+    /*
+     * Push the calls round-robin over the connections, one batch at a time.
+     */
+    double start = client_now();
+    long sent = 0;
+    for (int c = 0; sent < n; c = (c + 1) % n_conns) {
+        long k = n - sent < batch ? n - sent : batch;
+        if (client_write_all(fds[c], buf, k * frame_len) < 0) {
+            perror("write");
+            return 1;
+        }
+        for (long i = 0; replies && i < k; i++) {
+            if (client_read_frame(fds[c], reply) !=
+                    (callback ? FRAME_SCHEDULED : FRAME_ACCEPTED)) {
+                fprintf(stderr, "Unexpected reply.\n");
+                return 1;
+            }
+        }
+        sent += k;
+    }
+
+    /*
+     * The stats request is answered after every earlier frame on the same
+     * connection, but the other connections may still be in flight, so wait
+     * for each of them with a stats round trip too.
+     */
+    for (int i = 0; i < n_conns; i++) {
+        len = client_frame(buf, 0, FRAME_STATS, 0, NULL, 0);
+        if (client_write_all(fds[i], buf, len) < 0 ||
+                client_read_frame(fds[i], reply) != FRAME_STATS_REPLY) {
+            fprintf(stderr, "Couldn't get server stats.\n");
+            return 1;
+        }
+    }
+    double elapsed = client_now() - start;
+    printf("%s %ld calls over %d connections in %.3fs (%.0f calls/s)%s.\n",
+        callback ? "Scheduled" : "Pushed", n, n_conns, elapsed,
+        elapsed > 0 ? n / elapsed : 0.0, replies ? " with replies" : "");
+
+    if (answer) {
+        len = 0;
+        for (int i = 0; i < batch; i++) {
+            len = client_frame(buf, len, FRAME_ANSWER, FRAME_NOREPLY, NULL, 0);
+        }
+        frame_len = len / batch;
+        start = client_now();
+        for (long done = 0; done < n; done += batch) {
+            long k = n - done < batch ? n - done : batch;
+            if (client_write_all(fds[0], buf, k * frame_len) < 0) {
+                perror("write");
+                return 1;
+            }
+        }
+        len = client_frame(buf, 0, FRAME_ANSWER, 0, NULL, 0);
+        client_write_all(fds[0], buf, len);
+        int type = client_read_frame(fds[0], reply);
+        elapsed = client_now() - start;
+        printf("Answered %ld calls in %.3fs (%.0f calls/s); one more answer"
+            " got %s.\n", n, elapsed, elapsed > 0 ? n / elapsed : 0.0,
+            type == FRAME_EMPTY ? "no call" : "a call");
+    }
+
+    int status = client_print_stats(fds[0]) < 0;
+    for (int i = 0; i < n_conns; i++) {
+        close(fds[i]);
+    }
+    free(fds);
+    free(buf);
+    return status;
+}
@@ -0,0 +1,204 @@
+/*
+ * This file contains an implementation of a pool of call records.  Calls are
+ * carved out of large slabs, each holding many struct call records, rather
+ * than being malloc()'d one at a time.  Released calls are threaded onto a
+ * free list through their own storage, so acquiring and releasing a call are
+ * both O(1) pointer swaps, and all calls are handed back to the system at
+ * once by freeing the slabs when the pool is destroyed.  See the
+ * documentation below for more information on the individual functions in
+ * this implementation.
+ *
+ * A pool is not thread-safe; each thread that creates calls should use its
+ * own pool, or the caller must serialize access.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "callpool.h"
+
+/*
+ * A released call's storage is reused to hold the free-list link.
+ */
+union pool_entry {
+    struct call call;
+    union pool_entry* next;
+};
+
+/*
+ * Slabs are chained together so they can all be freed at once.  The entries
+ * follow the header in the same allocation.
+ */
+struct pool_slab {
+    struct pool_slab* next;
+    union pool_entry entries[];
+};
+
+/*
+ * This is the structure that represents a call pool.  `fresh` and
+ * `fresh_left` describe the not-yet-used tail of the newest slab, which is
+ * handed out before any new slab is allocated.
+ */
+struct call_pool {
+    struct pool_slab* slabs;
+    union pool_entry* free_list;
+    union pool_entry* fresh;
+    int fresh_left;
+    int calls_per_slab;
+    int outstanding;
+};
+
+/*
+ * This function allocates and initializes a new, empty call pool and returns
+ * a pointer to it.  No slabs are allocated until the first call is acquired.
+ *
+ * Params:
+ *   calls_per_slab - the number of calls to allocate at a time.  Must be
+ *     positive.
+ */
+struct call_pool* call_pool_create(int calls_per_slab) {
+    assert(calls_per_slab > 0);
+    struct call_pool* pool = malloc(sizeof(struct call_pool));
+    assert(pool);
+    pool->slabs = NULL;
+    pool->free_list = NULL;
+    pool->fresh = NULL;
+    pool->fresh_left = 0;
+    pool->calls_per_slab = calls_per_slab;
+    pool->outstanding = 0;
+    return pool;
+}
+
+/*
+ * This function frees a call pool along with every call ever acquired from
+ * it, whether or not it was released.  No call from the pool may be used
+ * afterwards.
+ *
+ * Params:
+ *   pool - the pool to be destroyed.  May not be NULL.
+ */
+void call_pool_free(struct call_pool* pool) {
+    assert(pool);
+    struct pool_slab* next, * slab = pool->slabs;
+    while (slab) {
+        next = slab->next;
+        free(slab);
+        slab = next;
+    }
+    free(pool);
+}
+
+/*
+ * This function acquires an uninitialized call record from a pool.
+ *
+ * Params:
+ *   pool - the pool from which to acquire a call.  May not be NULL.
+ *
+ * Return:
+ *   This function returns a pointer to the call record, which remains valid
+ *   until it is released or the pool is freed.
+ */
+struct call* call_pool_acquire(struct call_pool* pool) {
+    assert(pool);
+    union pool_entry* entry = pool->free_list;
+    if (entry) {
+        pool->free_list = entry->next;
+    } else {
+        if (pool->fresh_left == 0) {
+            struct pool_slab* slab = malloc(sizeof(struct pool_slab) +
+                pool->calls_per_slab * sizeof(union pool_entry));
+            assert(slab);
+            slab->next = pool->slabs;
+            pool->slabs = slab;
+            pool->fresh = slab->entries;
+            pool->fresh_left = pool->calls_per_slab;
+        }
+        entry = pool->fresh++;
+        pool->fresh_left--;
+    }
+    pool->outstanding++;
+    return &entry->call;
+}
+
+/*
+ * This function acquires `n` call records from a pool at once and fills them
+ * in with copies of `n` existing records, e.g. ones read from a file.  All
+ * of them are carved out of one new slab sized to fit, so this costs a
+ * single allocation however many calls are loaded.  Each record can later be
+ * released individually like any other.
+ *
+ * Params:
+ *   pool - the pool from which to acquire the calls.  May not be NULL.
+ *   src - the records to copy.  May not be NULL unless `n` is 0.
+ *   n - the number of records to copy.
+ *   out - an array with room for `n` pointers, in which to store a pointer
+ *     to each new record, in the same order as `src`.
+ */
+void call_pool_load(struct call_pool* pool, const struct call* src, int n,
+        struct call** out) {
+    assert(pool);
+    assert(n >= 0);
+    if (n == 0) {
+        return;
+    }
+
+    struct pool_slab* slab = malloc(sizeof(struct pool_slab) +
+        n * sizeof(union pool_entry));
+    assert(slab);
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+    for (int i = 0; i < n; i++) {
+        slab->entries[i].call = src[i];
+        out[i] = &slab->entries[i].call;
+    }
+    pool->outstanding += n;
+}
+
+/*
+ * This function returns a call record to the pool it was acquired from, so
+ * that it can be handed out again.
+ *
+ * Params:
+ *   pool - the pool the call was acquired from.  May not be NULL.
+ *   c - the call to release.  May not be used after this call.
+ */
+void call_pool_release(struct call_pool* pool, struct call* c) {
+    assert(pool);
+    assert(c);
+    union pool_entry* entry = (union pool_entry*)c;
+    entry->next = pool->free_list;
+    pool->free_list = entry;
+    pool->outstanding--;
+}
+
+/*
+ * This function acquires a call record from a pool and fills it in, exactly
+ * like create_call() does for a malloc()'d record.
+ */
+struct call* call_pool_create_call(struct call_pool* pool, int id, char* name,
+        char* reason) {
+    struct call* c = call_pool_acquire(pool);
+    init_call(c, id, name, reason);
+    return c;
+}
+
+/*
+ * This function returns the number of calls acquired from a pool and not yet
+ * released.
+ */
+int call_pool_outstanding(struct call_pool* pool) {
+    assert(pool);
+    return pool->outstanding;
+}
+
+/*
+ * These functions adapt call_pool_acquire() and call_pool_release() to
+ * generic allocator hooks that take the pool as a void* context.
+ */
+void* call_pool_alloc_fn(void* pool) {
+    return call_pool_acquire(pool);
+}
+
+void call_pool_release_fn(void* pool, void* c) {
+    call_pool_release(pool, c);
+}
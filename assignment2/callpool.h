@@ -0,0 +1,37 @@
+/*
+ * This file contains the definition of the interface for a pool of call
+ * records.  You can find descriptions of the call pool functions, including
+ * their parameters and their return values, in callpool.c.
+ */
+
+#ifndef __CALLPOOL_H
+#define __CALLPOOL_H
+
+#include "call.h"
+
+/*
+ * Structure used to represent a call pool.
+ */
+struct call_pool;
+
+/*
+ * Call pool interface function prototypes.  Refer to callpool.c for
+ * documentation about each of these functions.
+ */
+struct call_pool* call_pool_create(int calls_per_slab);
+void call_pool_free(struct call_pool* pool);
+struct call* call_pool_acquire(struct call_pool* pool);
+void call_pool_load(struct call_pool* pool, const struct call* src, int n,
+    struct call** out);
+void call_pool_release(struct call_pool* pool, struct call* c);
+struct call* call_pool_create_call(struct call_pool* pool, int id, char* name,
+    char* reason);
+int call_pool_outstanding(struct call_pool* pool);
+
+/*
+ * Adapters matching the allocator hooks taken by spillq_set_allocator().
+ */
+void* call_pool_alloc_fn(void* pool);
+void call_pool_release_fn(void* pool, void* c);
+
+#endif
@@ -0,0 +1,269 @@
+/*
+ * This file contains an implementation of the call queue.  Waiting calls are
+ * kept in FIFO order in a spilling queue (see spillq.c), and the IDs of the
+ * calls that are still waiting are kept in a hash set (see idset.c) alongside
+ * it.  Cancelling a call (e.g. because the caller hung up) just removes its
+ * ID from the set, which leaves a tombstone in the FIFO: the record stays
+ * where it is until it reaches the front, at which point it's recognized as
+ * cancelled and released without being handed out.  Cancellation is
+ * therefore O(1) expected, and a burst of cancellations costs the FIFO
+ * nothing beyond skipping each tombstone once.  See the documentation below
+ * for more information on the individual functions in this implementation.
+ *
+ * The set holds IDs rather than pointers because a spilled record comes
+ * back from disk at a new address.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "callq.h"
+#include "spillq.h"
+#include "idset.h"
+
+/*
+ * This is the structure that represents a call queue.  `waiting` holds the
+ * IDs of the calls in `fifo` that haven't been cancelled.
+ */
+struct callq {
+    struct spillq* fifo;
+    struct call_pool* pool;
+    struct idset* waiting;
+};
+
+/*
+ * Auxilliary function to release the record of a call that left the queue
+ * without being answered.
+ */
+void _callq_release(struct callq* cq, struct call* c) {
+    if (cq->pool) {
+        call_pool_release(cq->pool, c);
+    } else {
+        free(c);
+    }
+}
+
+/*
+ * Auxilliary function to discard cancelled calls from the front of the
+ * FIFO, so that the front of the FIFO (if any) is a call that's still
+ * waiting.
+ */
+void _callq_skip_cancelled(struct callq* cq) {
+    while (!spillq_isempty(cq->fifo)) {
+        struct call* c = spillq_front(cq->fifo);
+        if (idset_contains(cq->waiting, c->id)) {
+            return;
+        }
+        _callq_release(cq, spillq_dequeue(cq->fifo));
+    }
+}
+
+/*
+ * This function allocates and initializes a new, empty call queue and
+ * returns a pointer to it.
+ *
+ * Params:
+ *   spill_dir - a directory for the queue to spill waiting calls to, as for
+ *     spillq_create(), or NULL to keep every waiting call in memory.
+ *   high_water - the number of calls kept in memory before spilling.
+ *   pool - the pool that every call enqueued was acquired from, or NULL if
+ *     calls are malloc()'d.
+ */
+struct callq* callq_create(const char* spill_dir, int high_water,
+        struct call_pool* pool) {
+    struct callq* cq = malloc(sizeof(struct callq));
+    assert(cq);
+    cq->fifo = spillq_create(spill_dir, sizeof(struct call), high_water);
+    if (pool) {
+        spillq_set_allocator(cq->fifo, call_pool_alloc_fn,
+            call_pool_release_fn, pool);
+    }
+    cq->pool = pool;
+    cq->waiting = idset_create();
+    return cq;
+}
+
+/*
+ * This function frees a call queue and releases every call record still in
+ * it, waiting or cancelled.
+ *
+ * Params:
+ *   cq - the call queue to be destroyed.  May not be NULL.
+ */
+void callq_free(struct callq* cq) {
+    assert(cq);
+    spillq_free(cq->fifo);
+    idset_free(cq->waiting);
+    free(cq);
+}
+
+/*
+ * This function returns 1 if no calls are waiting in a call queue and 0
+ * otherwise.  Cancelled calls don't count.
+ */
+int callq_isempty(struct callq* cq) {
+    assert(cq);
+    return idset_size(cq->waiting) == 0;
+}
+
+/*
+ * This function returns the number of calls waiting in a call queue, not
+ * counting cancelled calls.
+ */
+int callq_size(struct callq* cq) {
+    assert(cq);
+    return idset_size(cq->waiting);
+}
+
+/*
+ * This function adds a call to the back of a call queue.
+ *
+ * Params:
+ *   cq - the call queue.  May not be NULL.
+ *   c - the call to enqueue.  Its ID must be positive and must not belong
+ *     to any other call in the queue, including a cancelled one that hasn't
+ *     reached the front yet.  The queue takes ownership of the record until
+ *     it's dequeued.
+ */
+void callq_enqueue(struct callq* cq, struct call* c) {
+    assert(cq);
+    assert(c && c->id > 0);
+
+    int added = idset_add(cq->waiting, c->id);
+    assert(added);
+    (void)added;
+    spillq_enqueue(cq->fifo, c);
+}
+
+/*
+ * This function adds `n` calls to the back of a call queue at once, in
+ * order, as if by `n` calls to callq_enqueue().  The ID set is sized for all
+ * of them up front and the records are appended to the FIFO in bulk.
+ *
+ * Params:
+ *   cq - the call queue.  May not be NULL.
+ *   calls - the calls to enqueue, each as for callq_enqueue().  May not be
+ *     NULL unless `n` is 0.
+ *   n - the number of calls to enqueue.
+ */
+void callq_enqueue_many(struct callq* cq, struct call** calls, int n) {
+    assert(cq);
+    assert(n >= 0);
+
+    idset_reserve(cq->waiting, idset_size(cq->waiting) + n);
+    for (int i = 0; i < n; i++) {
+        assert(calls[i] && calls[i]->id > 0);
+        int added = idset_add(cq->waiting, calls[i]->id);
+        assert(added);
+        (void)added;
+    }
+    spillq_enqueue_many(cq->fifo, (void**)calls, n);
+}
+
+/*
+ * Context for walking the waiting calls with callq_foreach().
+ */
+struct callq_walk {
+    struct callq* cq;
+    void (*fn)(void* ctx, struct call* c);
+    void* ctx;
+};
+
+/*
+ * Auxilliary function to pass a record from the FIFO on to the walk's
+ * function, unless the call was cancelled.
+ */
+void _callq_walk_one(void* ctx, void* rec) {
+    struct callq_walk* walk = ctx;
+    struct call* c = rec;
+    if (idset_contains(walk->cq->waiting, c->id)) {
+        walk->fn(walk->ctx, c);
+    }
+}
+
+/*
+ * This function calls a function on every call waiting in a call queue, in
+ * the order they'd be answered, without removing any of them.  Cancelled
+ * calls are skipped.
+ *
+ * Params:
+ *   cq - the call queue.  May not be NULL.
+ *   fn - the function to call, with `ctx` and each waiting call.  It must
+ *     not modify the queue, and a call that was spilled to disk is only
+ *     valid for the duration of the call it's passed to.
+ *   ctx - an arbitrary pointer passed through unchanged to `fn`.
+ */
+void callq_foreach(struct callq* cq, void (*fn)(void* ctx, struct call* c),
+        void* ctx) {
+    assert(cq);
+    struct callq_walk walk = { cq, fn, ctx };
+    spillq_foreach(cq->fifo, _callq_walk_one, &walk);
+}
+
+/*
+ * This function returns the call at the front of a call queue without
+ * removing it, skipping over any cancelled calls.
+ *
+ * Params:
+ *   cq - the call queue.  May not be NULL.
+ *
+ * Return:
+ *   This function returns the call that has waited longest, or NULL if no
+ *   calls are waiting.
+ */
+struct call* callq_front(struct callq* cq) {
+    assert(cq);
+    _callq_skip_cancelled(cq);
+    return callq_isempty(cq) ? NULL : spillq_front(cq->fifo);
+}
+
+/*
+ * This function removes and returns the call at the front of a call queue,
+ * skipping over any cancelled calls.
+ *
+ * Params:
+ *   cq - the call queue.  May not be NULL.
+ *
+ * Return:
+ *   This function returns the call that has waited longest, or NULL if no
+ *   calls are waiting.  The caller takes ownership of the returned record.
+ */
+struct call* callq_dequeue(struct callq* cq) {
+    assert(cq);
+    _callq_skip_cancelled(cq);
+    if (callq_isempty(cq)) {
+        return NULL;
+    }
+    struct call* c = spillq_dequeue(cq->fifo);
+    idset_remove(cq->waiting, c->id);
+    return c;
+}
+
+/*
+ * This function returns 1 if the call with a given ID is waiting in a call
+ * queue and 0 otherwise.  This is O(1) expected.  Only the IDs of waiting
+ * calls are indexed, not their records, so a caller that needs per-call
+ * state (e.g. the server's timers) keeps it by ID itself.
+ */
+int callq_is_waiting(struct callq* cq, int id) {
+    assert(cq);
+    return idset_contains(cq->waiting, id);
+}
+
+/*
+ * This function cancels a waiting call, e.g. because the caller hung up.
+ * This is O(1) expected: the call's record is left in place and is released
+ * when it reaches the front of the queue.
+ *
+ * Params:
+ *   cq - the call queue.  May not be NULL.
+ *   id - the ID of the call to cancel.
+ *
+ * Return:
+ *   This function returns 1 if the call was cancelled or 0 if no call with
+ *   that ID was waiting.
+ */
+int callq_cancel(struct callq* cq, int id) {
+    assert(cq);
+    return idset_remove(cq->waiting, id);
+}
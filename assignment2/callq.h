@@ -0,0 +1,38 @@
+/*
+ * This file contains the definition of the interface for the call queue: a
+ * FIFO of waiting calls that also keeps the set of their IDs, so that a call
+ * can be checked for or cancelled by its ID.  You can find descriptions of
+ * the call queue functions, including their parameters and their return
+ * values, in callq.c.
+ */
+
+#ifndef __CALLQ_H
+#define __CALLQ_H
+
+#include "call.h"
+#include "callpool.h"
+
+/*
+ * Structure used to represent a call queue.
+ */
+struct callq;
+
+/*
+ * Call queue interface function prototypes.  Refer to callq.c for
+ * documentation about each of these functions.
+ */
+struct callq* callq_create(const char* spill_dir, int high_water,
+    struct call_pool* pool);
+void callq_free(struct callq* cq);
+int callq_isempty(struct callq* cq);
+int callq_size(struct callq* cq);
+void callq_enqueue(struct callq* cq, struct call* c);
+void callq_enqueue_many(struct callq* cq, struct call** calls, int n);
+struct call* callq_front(struct callq* cq);
+struct call* callq_dequeue(struct callq* cq);
+int callq_is_waiting(struct callq* cq, int id);
+int callq_cancel(struct callq* cq, int id);
+void callq_foreach(struct callq* cq, void (*fn)(void* ctx, struct call* c),
+    void* ctx);
+
+#endif
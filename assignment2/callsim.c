@@ -0,0 +1,519 @@
+/*
+ * This file contains a discrete-event simulator of the call center, for
+ * capacity planning: it simulates a day of traffic in seconds rather than
+ * replaying it in real time.  Calls arrive as a Poisson process and wait in
+ * the call queue for one of N agents, who answer them in FIFO order and
+ * take an exponentially-distributed time to serve each one.  Callers who
+ * are still waiting when their (exponentially-distributed) patience runs
+ * out hang up, and are cancelled out of the queue.  Answered calls go into
+ * the answered-call history, as in the call center itself.
+ *
+ * The simulation advances from one event to the next: an arrival, an agent
+ * finishing a call, or a caller hanging up.  Pending events are kept in an
+ * event list ordered by time, which is a calendar queue (see calendar.c) or,
+ * with `-e heap`, the binary heap in pq.c.  Both give equal-time events in
+ * the order they were scheduled, so a run gives exactly the same results
+ * with either, which `-c` checks.  Times are in whole milliseconds; arrival
+ * times are accumulated exactly and only rounded to the millisecond when
+ * scheduled, so that many calls can arrive in the same millisecond at high
+ * rates.
+ *
+ * With `-e coro` there's no event list.  Instead each agent is a coroutine
+ * (see coro.c), written as straight-line code that waits for a call, serves
+ * it and goes back for the next, and another coroutine places the calls;
+ * this takes a few hundred MB for 100,000 agents.  Rather than scheduling
+ * each caller's hang-up, an agent draws the caller's patience on reaching
+ * the call and, if the caller would have hung up by then, counts the call
+ * as abandoned and moves on.  Since the queue is FIFO, this gives the same
+ * results in distribution (though not the same random draws, so `-c` can't
+ * be used), except that the peak queue depth includes callers who have
+ * hung up but not yet been reached.
+ *
+ * Usage: ./callsim [options]
+ *   -N agents     number of agents answering calls (default 50)
+ *   -l rate       mean arrival rate in calls/s (default 10)
+ *   -S seconds    mean service time (default 4)
+ *   -P seconds    mean caller patience, or 0 if callers never hang up
+ *                 (default 60)
+ *   -T hours      length of the simulated day (default 24, at most 500)
+ *   -L seconds    service level target: the report gives the share of
+ *                 answered calls that waited at most this long (default 20)
+ *   -x seed       random seed (default 1)
+ *   -e list       event list: calendar or heap, or coro for coroutine agents
+ *                 (default calendar)
+ *   -c            cross-check: run with both event lists and compare
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <assert.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "call.h"
+#include "callpool.h"
+#include "callq.h"
+#include "ring.h"
+#include "calendar.h"
+#include "pq.h"
+#include "coro.h"
+
+/*
+ * Number of answered calls kept in the history; older ones are released.
+ */
+#define CALLSIM_HISTORY 1024
+
+/*
+ * Number of call records the call pool allocates at a time.
+ */
+#define CALLSIM_POOL_SLAB 4096
+
+/*
+ * Stack size of each coroutine with `-e coro`.  Agents only use the top
+ * few hundred bytes of it.
+ */
+#define CALLSIM_CORO_STACK 16384
+
+/*
+ * Event types.  An event is stored in the event list as its call ID shifted
+ * left two bits with its type in the low bits, so scheduling one doesn't
+ * allocate.
+ */
+enum { EVENT_ARRIVAL, EVENT_DEPARTURE, EVENT_ABANDON };
+
+/*
+ * Struct holding the simulator's configuration.
+ */
+struct callsim_config {
+    int agents;
+    double rate;
+    double service_mean;
+    double patience_mean;
+    double hours;
+    double target;
+    uint64_t seed;
+    int heap;
+    int coro;
+    int check;
+};
+
+/*
+ * Struct holding the results of a run.  `trace` is a hash of every event in
+ * the order it was processed, for cross-checking.
+ */
+struct callsim_result {
+    long offered;
+    long answered;
+    long abandoned;
+    long within_target;
+    long long wait_sum;
+    int wait_max;
+    int peak_depth;
+    long long busy_ms;
+    long events;
+    uint64_t trace;
+    double wall;
+};
+
+/*
+ * Per-run simulator state.  The fields after `pq` are only used with
+ * `-e coro`: `ringing` is where idle agents wait for a call, and `closed`
+ * is set once the last call of the day has been placed.
+ */
+struct callsim {
+    struct callsim_config cfg;
+    uint64_t rng;
+    struct calendar* cal;
+    struct pq* pq;
+    struct callsim_result* r;
+    struct call_pool* pool;
+    struct callq* queue;
+    struct ring* history;
+    struct coro_waitq* ringing;
+    int closed;
+};
+
+/*
+ * Function returning a uniformly-distributed double in (0, 1), using
+ * xorshift64* so that runs are reproducible across platforms.
+ */
+double callsim_uniform(struct callsim* s) {
+    s->rng ^= s->rng >> 12;
+    s->rng ^= s->rng << 25;
+    s->rng ^= s->rng >> 27;
+    uint64_t x = s->rng * 2685821657736338717ULL;
+    return ((x >> 11) + 0.5) / 9007199254740992.0;
+}
+
+/*
+ * Function returning an exponentially-distributed time with a given mean in
+ * seconds, in fractional milliseconds.
+ */
+double callsim_exp(struct callsim* s, double mean) {
+    return -1000 * mean * log(callsim_uniform(s));
+}
+
+/*
+ * Function returning an exponentially-distributed time with a given mean in
+ * seconds, rounded to whole milliseconds.
+ */
+int callsim_exp_ms(struct callsim* s, double mean) {
+    return (int)(callsim_exp(s, mean) + 0.5);
+}
+
+/*
+ * Function to schedule an event for call `id` at time `at`.
+ */
+void callsim_schedule(struct callsim* s, int type, int id, int at) {
+    void* event = (void*)(((uintptr_t)id << 2) | type);
+    if (s->cfg.heap) {
+        pq_insert(s->pq, event, at);
+    } else {
+        calendar_insert(s->cal, event, at);
+    }
+}
+
+/*
+ * Function to answer call `c` at time `now`: an agent serves it and the
+ * call goes into the history.
+ */
+void callsim_answer(struct callsim* s, struct callsim_result* r,
+        struct ring* history, struct call* c, int now) {
+    int wait = now - (int)c->received_at;
+    int service = callsim_exp_ms(s, s->cfg.service_mean);
+    r->answered++;
+    r->wait_sum += wait;
+    if (wait > r->wait_max) {
+        r->wait_max = wait;
+    }
+    if (wait <= (int)(s->cfg.target * 1000)) {
+        r->within_target++;
+    }
+    r->busy_ms += service;
+    callsim_schedule(s, EVENT_DEPARTURE, c->id, now + service);
+    ring_push(history, c);
+}
+
+/*
+ * Function to run one simulation with the configuration in `s->cfg`,
+ * filling in `r`.
+ */
+void callsim_run(struct callsim* s, struct callsim_result* r) {
+    int end = (int)(s->cfg.hours * 3600 * 1000);
+    int free_agents = s->cfg.agents;
+    int next_id = 1;
+    double arrival;
+
+    memset(r, 0, sizeof(struct callsim_result));
+    s->rng = s->cfg.seed * 0x9E3779B97F4A7C15ULL + 1;
+    s->cal = calendar_create();
+    s->pq = pq_create();
+    struct call_pool* pool = call_pool_create(CALLSIM_POOL_SLAB);
+    struct callq* queue = callq_create(NULL, 1, pool);
+    struct ring* history = ring_create(CALLSIM_HISTORY, call_pool_release_fn,
+        pool);
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    arrival = callsim_exp(s, 1.0 / s->cfg.rate);
+    callsim_schedule(s, EVENT_ARRIVAL, next_id, (int)(arrival + 0.5));
+    while (1) {
+        int now;
+        uintptr_t event;
+        if (s->cfg.heap) {
+            if (pq_isempty(s->pq)) {
+                break;
+            }
+            now = pq_first_priority(s->pq);
+            event = (uintptr_t)pq_remove_first(s->pq);
+        } else {
+            if (calendar_isempty(s->cal)) {
+                break;
+            }
+            now = calendar_first_priority(s->cal);
+            event = (uintptr_t)calendar_remove_first(s->cal);
+        }
+        int id = (int)(event >> 2);
+        r->events++;
+        r->trace = (r->trace ^ ((uint64_t)now << 32 ^ event)) *
+            0x100000001B3ULL;
+
+        switch (event & 3) {
+        case EVENT_ARRIVAL: {
+            struct call* c = call_pool_create_call(pool, id, "", "");
+            c->received_at = now;
+            r->offered++;
+            if (free_agents > 0) {
+                free_agents--;
+                callsim_answer(s, r, history, c, now);
+            } else {
+                callq_enqueue(queue, c);
+                if (callq_size(queue) > r->peak_depth) {
+                    r->peak_depth = callq_size(queue);
+                }
+                if (s->cfg.patience_mean > 0) {
+                    callsim_schedule(s, EVENT_ABANDON, id,
+                        now + callsim_exp_ms(s, s->cfg.patience_mean));
+                }
+            }
+            arrival += callsim_exp(s, 1.0 / s->cfg.rate);
+            int next = (int)(arrival + 0.5);
+            if (next < end) {
+                callsim_schedule(s, EVENT_ARRIVAL, ++next_id, next);
+            }
+            break;
+        }
+        case EVENT_DEPARTURE:
+            if (callq_isempty(queue)) {
+                free_agents++;
+            } else {
+                callsim_answer(s, r, history, callq_dequeue(queue), now);
+            }
+            break;
+        case EVENT_ABANDON:
+            /*
+             * The call may have been answered already, in which case the
+             * caller doesn't hang up after all.
+             */
+            if (callq_cancel(queue, id)) {
+                r->abandoned++;
+            }
+            break;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    r->wall = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+    ring_free(history);
+    callq_free(queue);
+    call_pool_free(pool);
+    calendar_free(s->cal);
+    pq_free(s->pq);
+}
+
+/*
+ * Coroutine that places the day's calls, waking an idle agent (if there is
+ * one) for each.
+ */
+void callsim_coro_caller(struct coro_sched* sched, void* arg) {
+    struct callsim* s = arg;
+    long long end = (long long)(s->cfg.hours * 3600 * 1000);
+    int next_id = 1;
+    double arrival = 0;
+
+    while (1) {
+        arrival += callsim_exp(s, 1.0 / s->cfg.rate);
+        coro_sleep(sched, (long long)(arrival + 0.5) - coro_now(sched));
+        if (coro_now(sched) >= end) {
+            break;
+        }
+        struct call* c = call_pool_create_call(s->pool, next_id++, "", "");
+        c->received_at = coro_now(sched);
+        s->r->offered++;
+        callq_enqueue(s->queue, c);
+        if (callq_size(s->queue) > s->r->peak_depth) {
+            s->r->peak_depth = callq_size(s->queue);
+        }
+        coro_wake_one(sched, s->ringing);
+    }
+    s->closed = 1;
+    coro_wake_all(sched, s->ringing);
+}
+
+/*
+ * Coroutine for one agent, who answers calls until the day is over and the
+ * queue is empty.
+ */
+void callsim_coro_agent(struct coro_sched* sched, void* arg) {
+    struct callsim* s = arg;
+    struct callsim_result* r = s->r;
+
+    while (1) {
+        while (callq_isempty(s->queue)) {
+            if (s->closed) {
+                return;
+            }
+            coro_wait(sched, s->ringing);
+        }
+        struct call* c = callq_dequeue(s->queue);
+        int wait = (int)(coro_now(sched) - c->received_at);
+        if (s->cfg.patience_mean > 0 &&
+                wait > callsim_exp_ms(s, s->cfg.patience_mean)) {
+            r->abandoned++;
+            call_pool_release(s->pool, c);
+            continue;
+        }
+
+        int service = callsim_exp_ms(s, s->cfg.service_mean);
+        r->answered++;
+        r->wait_sum += wait;
+        if (wait > r->wait_max) {
+            r->wait_max = wait;
+        }
+        if (wait <= (int)(s->cfg.target * 1000)) {
+            r->within_target++;
+        }
+        r->busy_ms += service;
+        ring_push(s->history, c);
+        coro_sleep(sched, service);
+    }
+}
+
+/*
+ * Function to run one simulation with coroutine agents, filling in `r`.
+ * `r->events` counts switches into coroutines.
+ */
+void callsim_run_coro(struct callsim* s, struct callsim_result* r) {
+    memset(r, 0, sizeof(struct callsim_result));
+    s->rng = s->cfg.seed * 0x9E3779B97F4A7C15ULL + 1;
+    s->r = r;
+    s->pool = call_pool_create(CALLSIM_POOL_SLAB);
+    s->queue = callq_create(NULL, 1, s->pool);
+    s->history = ring_create(CALLSIM_HISTORY, call_pool_release_fn, s->pool);
+    s->ringing = coro_waitq_create();
+    s->closed = 0;
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    struct coro_sched* sched = coro_sched_create(CALLSIM_CORO_STACK);
+    for (int i = 0; i < s->cfg.agents; i++) {
+        coro_spawn(sched, callsim_coro_agent, s);
+    }
+    coro_spawn(sched, callsim_coro_caller, s);
+    int stuck = coro_run(sched);
+    assert(stuck == 0);
+    r->events = coro_switches(sched);
+    coro_sched_free(sched);
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    r->wall = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+    coro_waitq_free(s->ringing);
+    ring_free(s->history);
+    callq_free(s->queue);
+    call_pool_free(s->pool);
+}
+
+/*
+ * Function to print the results of a run.
+ */
+void callsim_report(struct callsim* s, struct callsim_result* r) {
+    double span = s->cfg.hours * 3600;
+    printf("%.1fh of %.1f calls/s, service mean %.1fs, patience mean %.1fs,"
+        " %d agents (%s event list)\n", s->cfg.hours, s->cfg.rate,
+        s->cfg.service_mean, s->cfg.patience_mean, s->cfg.agents,
+        s->cfg.coro ? "coroutine agents, no" : s->cfg.heap ? "heap" :
+        "calendar");
+    printf("  calls:       %ld offered, %ld answered, %ld abandoned (%.2f%%)\n",
+        r->offered, r->answered, r->abandoned,
+        r->offered ? 100.0 * r->abandoned / r->offered : 0);
+    printf("  wait (s):    mean %.3f  max %.3f\n",
+        r->answered ? r->wait_sum / 1000.0 / r->answered : 0,
+        r->wait_max / 1000.0);
+    printf("  service level: %.2f%% answered within %.0fs\n",
+        r->answered ? 100.0 * r->within_target / r->answered : 0,
+        s->cfg.target);
+    printf("  agent utilization %.1f%%, peak queue depth %d\n",
+        100.0 * r->busy_ms / 1000 / (s->cfg.agents * span), r->peak_depth);
+    printf("  %ld %s in %.3fs wall: %.0f %s/s, %.0fx real time\n",
+        r->events, s->cfg.coro ? "switches" : "events", r->wall,
+        r->events / r->wall, s->cfg.coro ? "switches" : "events",
+        span / r->wall);
+}
+
+/*
+ * Function to parse command line options into `cfg`.  Returns 0 on success.
+ */
+int callsim_parse(int argc, char** argv, struct callsim_config* cfg) {
+    int opt;
+
+    cfg->agents = 50;
+    cfg->rate = 10;
+    cfg->service_mean = 4;
+    cfg->patience_mean = 60;
+    cfg->hours = 24;
+    cfg->target = 20;
+    cfg->seed = 1;
+    cfg->heap = 0;
+    cfg->coro = 0;
+    cfg->check = 0;
+
+    while ((opt = getopt(argc, argv, "N:l:S:P:T:L:x:e:c")) != -1) {
+        switch (opt) {
+        case 'N': cfg->agents = atoi(optarg); break;
+        case 'l': cfg->rate = atof(optarg); break;
+        case 'S': cfg->service_mean = atof(optarg); break;
+        case 'P': cfg->patience_mean = atof(optarg); break;
+        case 'T': cfg->hours = atof(optarg); break;
+        case 'L': cfg->target = atof(optarg); break;
+        case 'x': cfg->seed = strtoull(optarg, NULL, 10); break;
+        case 'c': cfg->check = 1; break;
+        case 'e':
+            cfg->heap = cfg->coro = 0;
+            if (strcmp(optarg, "heap") == 0) {
+                cfg->heap = 1;
+            } else if (strcmp(optarg, "coro") == 0) {
+                cfg->coro = 1;
+            } else if (strcmp(optarg, "calendar") != 0) {
+                return 1;
+            }
+            break;
+        default:
+            return 1;
+        }
+    }
+
+    /*
+     * Times are ints in milliseconds, so the day (plus the service and
+     * patience times of the last calls) must fit well within INT_MAX.  Call
+     * IDs are ints too, so the day's calls must also fit.
+     */
+    return cfg->agents < 1 || cfg->rate <= 0 ||
+        cfg->rate * cfg->hours * 3600 > 2e9 ||
+        cfg->service_mean <= 0 || cfg->patience_mean < 0 ||
+        cfg->hours <= 0 || cfg->hours > 500 || cfg->target < 0 ||
+        (cfg->coro && cfg->check);
+}
+
+int main(int argc, char** argv) {
+    struct callsim s;
+    struct callsim_result r;
+    if (callsim_parse(argc, argv, &s.cfg)) {
+        fprintf(stderr, "Usage: %s [-N agents] [-l rate] [-S seconds]"
+            " [-P seconds] [-T hours] [-L seconds] [-x seed]"
+            " [-e calendar|heap|coro] [-c]\n", argv[0]);
+        return 1;
+    }
+
+    if (s.cfg.coro) {
+        callsim_run_coro(&s, &r);
+        callsim_report(&s, &r);
+        return 0;
+    }
+    callsim_run(&s, &r);
+    callsim_report(&s, &r);
+    if (!s.cfg.check) {
+        return 0;
+    }
+
+    struct callsim_result other;
+    s.cfg.heap = !s.cfg.heap;
+    callsim_run(&s, &other);
+    callsim_report(&s, &other);
+    int same = r.events == other.events && r.trace == other.trace &&
+        r.answered == other.answered && r.abandoned == other.abandoned &&
+        r.wait_sum == other.wait_sum;
+    double heap_wall = s.cfg.heap ? other.wall : r.wall;
+    double calendar_wall = s.cfg.heap ? r.wall : other.wall;
+    printf("Cross-check: calendar and heap %s (calendar %.2fx faster)\n",
+        same ? "agree" : "DISAGREE", heap_wall / calendar_wall);
+    return !same;
+}
@@ -0,0 +1,514 @@
+/*
+ * This file contains an implementation of a cooperative coroutine
+ * scheduler, used to simulate the call center with one coroutine per agent.
+ * A coroutine is written as straight-line code that, rather than blocking,
+ * waits for something (e.g. a call to arrive) or sleeps for a while of
+ * simulated time, letting the other coroutines run.  See the documentation
+ * below for more information on the individual functions in this
+ * implementation.
+ *
+ * Coroutines run one at a time on the thread that calls coro_run(), which
+ * switches into each runnable coroutine in turn until it yields, waits or
+ * sleeps.  On x86-64 a switch just saves the callee-saved registers on one
+ * stack and pops them off another, which takes a few nanoseconds; elsewhere
+ * it's done with swapcontext(), which also saves the signal mask with a
+ * system call and takes a few hundred nanoseconds.  When
+ * none is runnable, the simulated clock jumps to the next sleeper's wakeup
+ * time, and sleepers are kept in a timing wheel (see timerwheel.c), so a
+ * sleep costs O(1) however many coroutines there are.
+ *
+ * Each coroutine has a small fixed-size stack, so coroutine code mustn't
+ * recurse deeply, keep large arrays on the stack or call anything that does
+ * (such as printf()).  Stacks are carved out of large mmap()'d slabs, and
+ * only the pages a coroutine actually touches are ever backed by memory, so
+ * 100,000 coroutines take a few hundred MB.  The coroutine's own state is
+ * kept at the top of its stack, in the pages the stack uses first.  One
+ * mapping per stack (let alone a guard page per stack) would run into the
+ * kernel's limit of 65530 mappings per process, so stacks have no guard
+ * pages, and overflowing one corrupts its neighbour.  The stacks of
+ * coroutines that have finished are reused.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include <unistd.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+
+#include "coro.h"
+#include "timerwheel.h"
+
+#define CORO_SLAB_STACKS 256
+#define CORO_MIN_STACK 8192
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define CORO_ASM_SWITCH
+#endif
+
+/*
+ * A suspended coroutine's (or the scheduler's) registers.  With the
+ * hand-written switch they're pushed on its own stack, so all that's kept
+ * is its stack pointer.
+ */
+#ifdef CORO_ASM_SWITCH
+typedef void* coro_ctx_t;
+#else
+typedef ucontext_t coro_ctx_t;
+#endif
+
+/*
+ * A single coroutine, which sits at the top of `stack`.  `next` links it
+ * into the run queue, a wait queue or the free list, whichever it's in.
+ */
+struct coro {
+  coro_ctx_t ctx;
+  char* stack;
+  void (*fn)(struct coro_sched* s, void* arg);
+  void* arg;
+  struct coro* next;
+  int done;
+};
+
+/*
+ * A FIFO queue of coroutines, linked through their `next` pointers.
+ */
+struct coro_waitq {
+  struct coro* head;
+  struct coro* tail;
+};
+
+/*
+ * This is the structure that represents a scheduler.  `main` is the context
+ * of coro_run(), which every coroutine switches back to, and `current` is
+ * the coroutine running, if any.  `slab` is the slab new stacks are carved
+ * from, `n_carved` of them so far.  Every slab is listed in `slabs`.
+ */
+struct coro_sched {
+  coro_ctx_t main;
+  struct coro* current;
+  struct coro_waitq runq;
+  struct coro* free_list;
+  struct timer_wheel* sleepers;
+  long long now;
+  long switches;
+  int live;
+  int stack_size;
+  char* slab;
+  int n_carved;
+  char** slabs;
+  int n_slabs;
+  int slabs_cap;
+};
+
+/*
+ * Auxilliary function to append a coroutine to a queue.
+ */
+void _coro_push(struct coro_waitq* q, struct coro* co) {
+  co->next = NULL;
+  if (q->tail) {
+    q->tail->next = co;
+  } else {
+    q->head = co;
+  }
+  q->tail = co;
+}
+
+/*
+ * Auxilliary function to remove the coroutine at the front of a queue, or
+ * return NULL if it's empty.
+ */
+struct coro* _coro_pop(struct coro_waitq* q) {
+  struct coro* co = q->head;
+  if (co) {
+    q->head = co->next;
+    if (!q->head) {
+      q->tail = NULL;
+    }
+  }
+  return co;
+}
+
+#ifdef CORO_ASM_SWITCH
+/*
+ * Auxilliary function, in assembly, that pushes the callee-saved registers,
+ * saves the stack pointer in `*save`, switches to the stack `to` and pops
+ * the registers saved there, returning to wherever that stack was switched
+ * away from.  A new coroutine's stack is set up to "return" into
+ * _coro_trampoline, which calls the function in %rbx with %r12 as its
+ * argument.
+ */
+void _coro_swap(void** save, void* to);
+void _coro_trampoline(void);
+
+__asm__(
+  ".text\n"
+  ".globl _coro_swap\n"
+  ".type _coro_swap, @function\n"
+  "_coro_swap:\n"
+  "  pushq %rbp\n"
+  "  pushq %rbx\n"
+  "  pushq %r12\n"
+  "  pushq %r13\n"
+  "  pushq %r14\n"
+  "  pushq %r15\n"
+  "  movq %rsp, (%rdi)\n"
+  "  movq %rsi, %rsp\n"
+  "  popq %r15\n"
+  "  popq %r14\n"
+  "  popq %r13\n"
+  "  popq %r12\n"
+  "  popq %rbx\n"
+  "  popq %rbp\n"
+  "  ret\n"
+  ".size _coro_swap, .-_coro_swap\n"
+  ".globl _coro_trampoline\n"
+  ".type _coro_trampoline, @function\n"
+  "_coro_trampoline:\n"
+  "  movq %r12, %rdi\n"
+  "  call *%rbx\n"
+  "  ud2\n"
+  ".size _coro_trampoline, .-_coro_trampoline\n"
+);
+#endif
+
+/*
+ * Auxilliary function to save the current registers in `from` and switch to
+ * the ones in `to`.  It returns when something switches back to `from`.
+ */
+void _coro_switch(coro_ctx_t* from, coro_ctx_t* to) {
+#ifdef CORO_ASM_SWITCH
+  _coro_swap(from, *to);
+#else
+  swapcontext(from, to);
+#endif
+}
+
+/*
+ * Auxilliary function to switch from the running coroutine back to the
+ * scheduler.  It returns when the coroutine is next resumed.
+ */
+void _coro_suspend(struct coro_sched* s) {
+  struct coro* co = s->current;
+  assert(co);
+  _coro_switch(&co->ctx, &s->main);
+}
+
+/*
+ * Auxilliary timer function that makes a sleeping coroutine runnable.
+ */
+void _coro_wake_sleeper(void* ctx, void* arg) {
+  struct coro_sched* s = ctx;
+  _coro_push(&s->runq, arg);
+}
+
+/*
+ * Auxilliary function that every coroutine starts in.  It never returns:
+ * the scheduler never switches back to a finished coroutine.
+ */
+void _coro_start(struct coro_sched* s) {
+  struct coro* co = s->current;
+  co->fn(s, co->arg);
+  co->done = 1;
+  _coro_suspend(s);
+}
+
+#ifndef CORO_ASM_SWITCH
+/*
+ * Auxilliary function to start a coroutine from makecontext(), which can
+ * only pass int arguments, so the scheduler's address comes in two halves.
+ */
+void _coro_entry(unsigned int hi, unsigned int lo) {
+  _coro_start((struct coro_sched*)(((uintptr_t)hi << 16 << 16) | lo));
+}
+#endif
+
+/*
+ * Auxilliary function to set up a coroutine's registers so that switching
+ * to it starts it on its own stack, which runs from `co->stack` up to `co`.
+ */
+void _coro_init_ctx(struct coro_sched* s, struct coro* co) {
+#ifdef CORO_ASM_SWITCH
+  /*
+   * Six registers for _coro_swap() to pop, %rbx and %r12 among them, and
+   * then the address to return to, placed so that the stack is 16-byte
+   * aligned, as the ABI requires, at the trampoline's call.
+   */
+  void** sp = (void**)co - 1;
+  *sp-- = (void*)_coro_trampoline;
+  *sp-- = NULL;
+  *sp-- = (void*)_coro_start;
+  *sp-- = s;
+  *sp-- = NULL;
+  *sp-- = NULL;
+  *sp = NULL;
+  co->ctx = sp;
+#else
+  getcontext(&co->ctx);
+  co->ctx.uc_stack.ss_sp = co->stack;
+  co->ctx.uc_stack.ss_size = (char*)co - co->stack;
+  co->ctx.uc_link = NULL;
+  uintptr_t addr = (uintptr_t)s;
+  makecontext(&co->ctx, (void (*)(void))_coro_entry, 2,
+    (unsigned int)(addr >> 16 >> 16), (unsigned int)addr);
+#endif
+}
+
+/*
+ * Auxilliary function to carve a new coroutine, with its stack below it,
+ * out of the current slab, mapping a new slab if need be.
+ */
+struct coro* _coro_carve(struct coro_sched* s) {
+  if (!s->slab || s->n_carved == CORO_SLAB_STACKS) {
+    s->slab = mmap(NULL, (size_t)s->stack_size * CORO_SLAB_STACKS,
+      PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+      -1, 0);
+    assert(s->slab != MAP_FAILED);
+    if (s->n_slabs == s->slabs_cap) {
+      s->slabs_cap = s->slabs_cap ? 2 * s->slabs_cap : 16;
+      s->slabs = realloc(s->slabs, s->slabs_cap * sizeof(char*));
+      assert(s->slabs);
+    }
+    s->slabs[s->n_slabs++] = s->slab;
+    s->n_carved = 0;
+  }
+  char* stack = s->slab + (size_t)s->stack_size * s->n_carved++;
+  size_t offset = (s->stack_size - sizeof(struct coro)) & ~(size_t)63;
+  struct coro* co = (struct coro*)(stack + offset);
+  co->stack = stack;
+  return co;
+}
+
+/*
+ * This function allocates and initializes a scheduler with no coroutines
+ * and its clock at 0, and returns a pointer to it.
+ *
+ * Params:
+ *   stack_size - the size of each coroutine's stack in bytes, which is
+ *     rounded up to a whole number of pages (and at least 8 KB).
+ */
+struct coro_sched* coro_sched_create(int stack_size) {
+  struct coro_sched* s = malloc(sizeof(struct coro_sched));
+  assert(s);
+  int page = (int)sysconf(_SC_PAGESIZE);
+  if (stack_size < CORO_MIN_STACK) {
+    stack_size = CORO_MIN_STACK;
+  }
+  s->stack_size = (stack_size + page - 1) / page * page;
+  s->current = NULL;
+  s->runq.head = s->runq.tail = NULL;
+  s->free_list = NULL;
+  s->sleepers = timer_wheel_create(0, _coro_wake_sleeper, s);
+  s->now = 0;
+  s->switches = 0;
+  s->live = 0;
+  s->slab = NULL;
+  s->n_carved = 0;
+  s->slabs = NULL;
+  s->n_slabs = s->slabs_cap = 0;
+  return s;
+}
+
+/*
+ * This function frees a scheduler along with every coroutine's stack.
+ * Coroutines that haven't finished are simply dropped.  It may not be
+ * called from a coroutine.
+ *
+ * Params:
+ *   s - the scheduler to be destroyed.  May not be NULL.
+ */
+void coro_sched_free(struct coro_sched* s) {
+  assert(s && !s->current);
+  for (int i = 0; i < s->n_slabs; i++) {
+    munmap(s->slabs[i], (size_t)s->stack_size * CORO_SLAB_STACKS);
+  }
+  free(s->slabs);
+  timer_wheel_free(s->sleepers);
+  free(s);
+}
+
+/*
+ * This function creates a coroutine, which becomes runnable straight away.
+ * It may be called from a coroutine or before coro_run().
+ *
+ * Params:
+ *   s - the scheduler to run the coroutine.  May not be NULL.
+ *   fn - the coroutine's code, called with the scheduler and `arg`.  The
+ *     coroutine finishes when it returns.
+ *   arg - an arbitrary pointer passed through unchanged to `fn`.
+ */
+void coro_spawn(struct coro_sched* s, void (*fn)(struct coro_sched* s,
+    void* arg), void* arg) {
+  assert(s && fn);
+  struct coro* co = s->free_list;
+  if (co) {
+    s->free_list = co->next;
+  } else {
+    co = _coro_carve(s);
+  }
+
+  _coro_init_ctx(s, co);
+  co->fn = fn;
+  co->arg = arg;
+  co->done = 0;
+  s->live++;
+  _coro_push(&s->runq, co);
+}
+
+/*
+ * This function runs coroutines until none is runnable or sleeping.  It may
+ * not be called from a coroutine.
+ *
+ * Params:
+ *   s - the scheduler.  May not be NULL.
+ *
+ * Return:
+ *   This function returns the number of coroutines left unfinished, all of
+ *   them waiting in wait queues.
+ */
+int coro_run(struct coro_sched* s) {
+  assert(s && !s->current);
+  while (1) {
+    struct coro* co = _coro_pop(&s->runq);
+    if (!co) {
+      long long next = timer_next(s->sleepers);
+      if (next < 0) {
+        break;
+      }
+      s->now = next;
+      timer_advance(s->sleepers, next);
+      continue;
+    }
+
+    s->current = co;
+    s->switches++;
+    _coro_switch(&s->main, &co->ctx);
+    s->current = NULL;
+    if (co->done) {
+      co->next = s->free_list;
+      s->free_list = co;
+      s->live--;
+    }
+  }
+  return s->live;
+}
+
+/*
+ * This function returns a scheduler's simulated clock, in ticks.
+ */
+long long coro_now(struct coro_sched* s) {
+  assert(s);
+  return s->now;
+}
+
+/*
+ * This function returns the number of times a scheduler has switched into
+ * a coroutine.
+ */
+long coro_switches(struct coro_sched* s) {
+  assert(s);
+  return s->switches;
+}
+
+/*
+ * This function lets the other runnable coroutines run before the calling
+ * coroutine carries on.
+ *
+ * Params:
+ *   s - the scheduler running the calling coroutine.  May not be NULL.
+ */
+void coro_yield(struct coro_sched* s) {
+  assert(s && s->current);
+  _coro_push(&s->runq, s->current);
+  _coro_suspend(s);
+}
+
+/*
+ * This function suspends the calling coroutine for a while of simulated
+ * time.  This is O(1).
+ *
+ * Params:
+ *   s - the scheduler running the calling coroutine.  May not be NULL.
+ *   ticks - how long to sleep.  The coroutine runs again once the clock has
+ *     reached the current time plus `ticks`.  If `ticks` is 0 or less, this
+ *     is the same as coro_yield(), and the clock doesn't move.
+ */
+void coro_sleep(struct coro_sched* s, long long ticks) {
+  assert(s && s->current);
+  if (ticks <= 0) {
+    coro_yield(s);
+    return;
+  }
+  timer_add(s->sleepers, s->now + ticks, s->current);
+  _coro_suspend(s);
+}
+
+/*
+ * This function allocates and initializes an empty wait queue and returns
+ * a pointer to it.
+ */
+struct coro_waitq* coro_waitq_create() {
+  struct coro_waitq* wq = malloc(sizeof(struct coro_waitq));
+  assert(wq);
+  wq->head = wq->tail = NULL;
+  return wq;
+}
+
+/*
+ * This function frees a wait queue.  Coroutines still waiting in it will
+ * never be woken.
+ */
+void coro_waitq_free(struct coro_waitq* wq) {
+  assert(wq);
+  free(wq);
+}
+
+/*
+ * This function suspends the calling coroutine in a wait queue until
+ * another coroutine wakes it.  Coroutines are woken in the order they
+ * started waiting.
+ *
+ * Params:
+ *   s - the scheduler running the calling coroutine.  May not be NULL.
+ *   wq - the wait queue to wait in.  May not be NULL.
+ */
+void coro_wait(struct coro_sched* s, struct coro_waitq* wq) {
+  assert(s && s->current && wq);
+  _coro_push(wq, s->current);
+  _coro_suspend(s);
+}
+
+/*
+ * This function makes the coroutine that has waited longest in a wait queue
+ * runnable again.
+ *
+ * Params:
+ *   s - the scheduler.  May not be NULL.
+ *   wq - the wait queue.  May not be NULL.
+ *
+ * Return:
+ *   This function returns 1 if a coroutine was woken or 0 if none was
+ *   waiting.
+ */
+int coro_wake_one(struct coro_sched* s, struct coro_waitq* wq) {
+  assert(s && wq);
+  struct coro* co = _coro_pop(wq);
+  if (co) {
+    _coro_push(&s->runq, co);
+  }
+  return co != NULL;
+}
+
+/*
+ * This function makes every coroutine in a wait queue runnable again, in
+ * the order they started waiting.  Returns the number woken.
+ */
+int coro_wake_all(struct coro_sched* s, struct coro_waitq* wq) {
+  int n = 0;
+  while (coro_wake_one(s, wq)) {
+    n++;
+  }
+  return n;
+}
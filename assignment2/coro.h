@@ -0,0 +1,37 @@
+/*
+ * This file contains the definition of the interface for a cooperative
+ * coroutine scheduler, which runs many lightweight coroutines on one thread
+ * against a simulated clock.  You can find descriptions of the coroutine
+ * functions, including their parameters and their return values, in coro.c.
+ */
+
+#ifndef __CORO_H
+#define __CORO_H
+
+/*
+ * Structures used to represent a scheduler and a queue of coroutines
+ * waiting for something.
+ */
+struct coro_sched;
+struct coro_waitq;
+
+/*
+ * Coroutine interface function prototypes.  Refer to coro.c for
+ * documentation about each of these functions.
+ */
+struct coro_sched* coro_sched_create(int stack_size);
+void coro_sched_free(struct coro_sched* s);
+void coro_spawn(struct coro_sched* s, void (*fn)(struct coro_sched* s,
+  void* arg), void* arg);
+int coro_run(struct coro_sched* s);
+long long coro_now(struct coro_sched* s);
+long coro_switches(struct coro_sched* s);
+void coro_yield(struct coro_sched* s);
+void coro_sleep(struct coro_sched* s, long long ticks);
+struct coro_waitq* coro_waitq_create();
+void coro_waitq_free(struct coro_waitq* wq);
+void coro_wait(struct coro_sched* s, struct coro_waitq* wq);
+int coro_wake_one(struct coro_sched* s, struct coro_waitq* wq);
+int coro_wake_all(struct coro_sched* s, struct coro_waitq* wq);
+
+#endif
@@ -5,6 +5,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include "dynarray.h"
@@ -114,6 +115,36 @@ void dynarray_insert(struct dynarray* da, void* val) {
   da->size++;
 }
 
+/*
+ * This function inserts `n` values at the end of a given dynamic array, in
+ * order.  The array is resized at most once and the values are copied in
+ * with a single memcpy(), so this is cheaper than `n` calls to
+ * dynarray_insert().
+ *
+ * Params:
+ *   da - the dynamic array into which to insert the elements.  May not be
+ *     NULL.
+ *   vals - the values to be inserted.  May not be NULL unless `n` is 0.
+ *   n - the number of values to insert.
+ */
+void dynarray_insert_many(struct dynarray* da, void** vals, int n) {
+  assert(da);
+  assert(n >= 0);
+  if (n == 0) {
+    return;
+  }
+
+  if (da->size + n > da->capacity) {
+    int new_capacity = 2 * da->capacity;
+    while (new_capacity < da->size + n) {
+      new_capacity *= 2;
+    }
+    _dynarray_resize(da, new_capacity);
+  }
+  memcpy(da->data + da->size, vals, n * sizeof(void*));
+  da->size += n;
+}
+
 /*
  * This function removes an element at a specified index from a dynamic array.
  * All existing elements following the specified index are moved forward to
@@ -140,6 +171,28 @@ void dynarray_remove(struct dynarray* da, int idx) {
   da->size--;
 }
 
+/*
+ * This function removes `n` consecutive elements starting at a specified index
+ * from a dynamic array.  All existing elements following the removed range
+ * are moved forward with a single memmove(), so removing a range costs the
+ * same as removing one element with dynarray_remove().
+ *
+ * Params:
+ *   da - the dynamic array from which to remove elements.  May not be NULL.
+ *   idx - the index of the first element to be removed.
+ *   n - the number of elements to be removed.  The range [idx, idx + n) must
+ *     lie between 0 (inclusive) and the number of elements stored in the array
+ *     (inclusive).
+ */
+void dynarray_remove_range(struct dynarray* da, int idx, int n) {
+  assert(da);
+  assert(idx >= 0 && n >= 0 && idx + n <= da->size);
+
+  memmove(da->data + idx, da->data + idx + n,
+    (da->size - idx - n) * sizeof(void*));
+  da->size -= n;
+}
+
 /*
  * This function returns the value of an existing element in a dynamic array.
  *
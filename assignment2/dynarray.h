@@ -22,7 +22,9 @@ struct dynarray* dynarray_create();
 void dynarray_free(struct dynarray* da);
 int dynarray_size(struct dynarray* da);
 void dynarray_insert(struct dynarray* da, void* val);
+void dynarray_insert_many(struct dynarray* da, void** vals, int n);
 void dynarray_remove(struct dynarray* da, int idx);
+void dynarray_remove_range(struct dynarray* da, int idx, int n);
 void* dynarray_get(struct dynarray* da, int idx);
 void dynarray_set(struct dynarray* da, int idx, void* val);
 
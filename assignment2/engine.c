@@ -0,0 +1,276 @@
+/*
+ * This file contains a multithreaded call center engine.  Producer threads
+ * generate calls into a shared blocking queue, agent threads take calls from
+ * it in batches and push them onto a shared history of answered calls, and
+ * the calling thread reports throughput and queue depth once per second.
+ * If the engine is given metrics (see metrics.c), each thread also records
+ * its own counts, the waiting time of every call and the queue and history
+ * depth into its own shard of them, once per batch.  See the documentation
+ * below for more information on the individual
+ * functions in this implementation.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "engine.h"
+#include "call.h"
+#include "bqueue.h"
+#include "stack.h"
+
+/*
+ * The most calls an agent takes per wakeup, and how many calls a producer
+ * generates between checks of the queue depth and publications of its
+ * counters.
+ */
+#define ENGINE_AGENT_BATCH 64
+#define ENGINE_PRODUCER_BATCH 64
+
+/*
+ * Struct holding the state shared by every engine thread.  The counters are
+ * only updated once per batch, so threads rarely touch the same cache line.
+ */
+struct engine {
+    struct engine_config cfg;
+    struct bqueue* queue;
+    pthread_mutex_t history_lock;
+    struct stack* history;
+    int stop;
+    int next_id;
+    long received;
+    long answered;
+};
+
+/*
+ * Function returning the current monotonic time in seconds.
+ */
+double engine_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Function to spin for roughly `us` microseconds, standing in for the time
+ * an agent spends on a call.
+ */
+void engine_busy_wait(int us) {
+    if (us > 0) {
+        double until = engine_now() + us / 1e6;
+        while (engine_now() < until);
+    }
+}
+
+/*
+ * Function to free every call in a stack, then the stack itself.
+ */
+void engine_free_history(struct stack* history) {
+    while (!stack_isempty(history)) {
+        free(stack_pop(history));
+    }
+    stack_free(history);
+}
+
+/*
+ * Producer thread: generates batches of calls until told to stop, pacing
+ * itself to the configured rate and backing off while the queue is full.
+ */
+void* engine_producer(void* arg) {
+    struct engine* e = arg;
+    double start = engine_now();
+    long made = 0;
+    char name[50], reason[100];
+    struct metrics_shard* shard = e->cfg.metrics ?
+        metrics_shard_create(e->cfg.metrics) : NULL;
+
+    while (!__atomic_load_n(&e->stop, __ATOMIC_RELAXED)) {
+        if (bqueue_size(e->queue) >= e->cfg.max_depth) {
+            sched_yield();
+            continue;
+        }
+
+        int first = __atomic_fetch_add(&e->next_id, ENGINE_PRODUCER_BATCH,
+            __ATOMIC_RELAXED);
+        __atomic_fetch_add(&e->received, ENGINE_PRODUCER_BATCH,
+            __ATOMIC_RELAXED);
+        long long now = shard ? metrics_now_us() : 0;
+        for (int i = 0; i < ENGINE_PRODUCER_BATCH; i++) {
+            snprintf(name, sizeof(name), "Caller %d", first + i);
+            snprintf(reason, sizeof(reason), "Generated call %d", first + i);
+            struct call* c = create_call(first + i, name, reason);
+            c->received_at = now;
+            bqueue_enqueue(e->queue, c);
+        }
+        made += ENGINE_PRODUCER_BATCH;
+        if (shard) {
+            metrics_count(shard, METRICS_RECEIVED, ENGINE_PRODUCER_BATCH);
+            metrics_record(shard, METRICS_QUEUE_DEPTH, bqueue_size(e->queue));
+        }
+
+        /*
+         * If we're ahead of schedule, sleep until the next batch is due.
+         */
+        if (e->cfg.rate > 0) {
+            double ahead = start + (double)made / e->cfg.rate - engine_now();
+            if (ahead > 0) {
+                struct timespec ts = { (time_t)ahead,
+                    (long)((ahead - (time_t)ahead) * 1e9) };
+                nanosleep(&ts, NULL);
+            }
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Agent thread: answers batches of calls until the queue is closed and
+ * drained.  Answered calls are pushed onto the shared history in one bulk
+ * copy per batch.  When the history reaches its cap, the agent swaps in a
+ * fresh one and frees the old calls outside the lock.
+ */
+void* engine_agent(void* arg) {
+    struct engine* e = arg;
+    void* calls[ENGINE_AGENT_BATCH];
+    int n;
+    struct metrics_shard* shard = e->cfg.metrics ?
+        metrics_shard_create(e->cfg.metrics) : NULL;
+
+    while ((n = bqueue_dequeue_batch(e->queue, calls, ENGINE_AGENT_BATCH,
+            -1)) > 0) {
+        if (shard) {
+            long long now = metrics_now_us();
+            for (int i = 0; i < n; i++) {
+                metrics_record(shard, METRICS_WAIT_US,
+                    now - ((struct call*)calls[i])->received_at);
+            }
+        }
+        for (int i = 0; i < n; i++) {
+            engine_busy_wait(e->cfg.service_us);
+        }
+
+        struct stack* retired = NULL;
+        pthread_mutex_lock(&e->history_lock);
+        if (stack_size(e->history) + n > e->cfg.history_cap) {
+            retired = e->history;
+            e->history = stack_create();
+        }
+        stack_push_many(e->history, calls, n);
+        int depth = stack_size(e->history);
+        pthread_mutex_unlock(&e->history_lock);
+
+        if (retired) {
+            engine_free_history(retired);
+        }
+        __atomic_fetch_add(&e->answered, n, __ATOMIC_RELAXED);
+        if (shard) {
+            metrics_count(shard, METRICS_ANSWERED, n);
+            metrics_record(shard, METRICS_HISTORY_DEPTH, depth);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * This function fills in a default engine configuration.
+ *
+ * Params:
+ *   cfg - the configuration to fill in.  May not be NULL.
+ */
+void engine_default_config(struct engine_config* cfg) {
+    cfg->producers = 1;
+    cfg->agents = 4;
+    cfg->seconds = 5;
+    cfg->rate = 0;
+    cfg->service_us = 0;
+    cfg->max_depth = 100000;
+    cfg->history_cap = 1000000;
+    cfg->metrics = NULL;
+}
+
+/*
+ * This function runs the engine: it starts the producer and agent threads,
+ * prints calls received and answered per second and the queue and history
+ * depth once per second for `cfg->seconds` seconds, then stops the
+ * producers, lets the agents drain the queue and prints a summary.
+ *
+ * Params:
+ *   cfg - the configuration for this run.  May not be NULL.
+ *
+ * Return:
+ *   This function returns 0 on success or 1 if the configuration is invalid.
+ */
+int engine_run(struct engine_config* cfg) {
+    if (cfg->producers < 1 || cfg->agents < 1 || cfg->seconds < 1 ||
+            cfg->max_depth < 1 || cfg->history_cap < 1) {
+        fprintf(stderr, "Invalid engine configuration.\n");
+        return 1;
+    }
+
+    struct engine e;
+    memset(&e, 0, sizeof(e));
+    e.cfg = *cfg;
+    e.queue = bqueue_create();
+    e.history = stack_create();
+    e.next_id = 1;
+    pthread_mutex_init(&e.history_lock, NULL);
+
+    pthread_t* producers = malloc(cfg->producers * sizeof(pthread_t));
+    pthread_t* agents = malloc(cfg->agents * sizeof(pthread_t));
+    for (int i = 0; i < cfg->agents; i++) {
+        pthread_create(&agents[i], NULL, engine_agent, &e);
+    }
+    double start = engine_now();
+    for (int i = 0; i < cfg->producers; i++) {
+        pthread_create(&producers[i], NULL, engine_producer, &e);
+    }
+
+    printf("%4s %12s %12s %10s %10s\n", "sec", "received/s", "answered/s",
+        "depth", "history");
+    long last_received = 0, last_answered = 0;
+    for (int sec = 1; sec <= cfg->seconds; sec++) {
+        struct timespec ts = { 1, 0 };
+        nanosleep(&ts, NULL);
+
+        long received = __atomic_load_n(&e.received, __ATOMIC_RELAXED);
+        long answered = __atomic_load_n(&e.answered, __ATOMIC_RELAXED);
+        pthread_mutex_lock(&e.history_lock);
+        int history = stack_size(e.history);
+        pthread_mutex_unlock(&e.history_lock);
+        printf("%4d %12ld %12ld %10d %10d\n", sec, received - last_received,
+            answered - last_answered, bqueue_size(e.queue), history);
+        fflush(stdout);
+        last_received = received;
+        last_answered = answered;
+    }
+
+    /*
+     * Stop the producers, then close the queue so the agents exit once
+     * they've answered everything still waiting.
+     */
+    __atomic_store_n(&e.stop, 1, __ATOMIC_RELAXED);
+    for (int i = 0; i < cfg->producers; i++) {
+        pthread_join(producers[i], NULL);
+    }
+    bqueue_close(e.queue);
+    for (int i = 0; i < cfg->agents; i++) {
+        pthread_join(agents[i], NULL);
+    }
+    double elapsed = engine_now() - start;
+
+    printf("Total: %ld calls received, %ld answered in %.2fs (%.0f calls/s)"
+        " with %d producer(s) and %d agent(s).\n", e.received, e.answered,
+        elapsed, e.answered / elapsed, cfg->producers, cfg->agents);
+
+    engine_free_history(e.history);
+    bqueue_free(e.queue);
+    pthread_mutex_destroy(&e.history_lock);
+    free(producers);
+    free(agents);
+    return 0;
+}
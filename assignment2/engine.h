@@ -0,0 +1,33 @@
+/*
+ * This file contains the definition of the interface for the multithreaded
+ * call center engine.  You can find descriptions of the engine functions,
+ * including their parameters and their return values, in engine.c.
+ */
+
+#ifndef __ENGINE_H
+#define __ENGINE_H
+
+#include "metrics.h"
+
+/*
+ * Structure used to configure an engine run.
+ */
+struct engine_config {
+    int producers;      /* Number of threads generating calls. */
+    int agents;         /* Number of threads answering calls. */
+    int seconds;        /* How long to generate calls for. */
+    int rate;           /* Calls/s per producer, or 0 for as fast as possible. */
+    int service_us;     /* Busy-work per answered call, in microseconds. */
+    int max_depth;      /* Producers back off while the queue is this deep. */
+    int history_cap;    /* Answered calls kept before the history rotates. */
+    struct metrics* metrics;    /* Metrics to update, or NULL. */
+};
+
+/*
+ * Engine interface function prototypes.  Refer to engine.c for documentation
+ * about each of these functions.
+ */
+void engine_default_config(struct engine_config* cfg);
+int engine_run(struct engine_config* cfg);
+
+#endif
@@ -0,0 +1,198 @@
+/*
+ * This file contains an implementation of a hash map from positive integer
+ * IDs to pointers, used to keep per-call state outside of struct call.  It's
+ * laid out like the ID set in idset.c: an open-addressing table with linear
+ * probing and Fibonacci hashing, in which an ID of 0 marks an empty slot,
+ * kept at most half full.  See the documentation below for more information
+ * on the individual functions in this implementation.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "idmap.h"
+
+#define IDMAP_INIT_CAPACITY 64
+
+/*
+ * This is the structure that represents one slot of the table.
+ */
+struct idmap_slot {
+  int id;
+  void* val;
+};
+
+/*
+ * This is the structure that represents an ID map.  `capacity` is a power
+ * of two, 1 << `capacity_log2`.
+ */
+struct idmap {
+  struct idmap_slot* slots;
+  int capacity;
+  int capacity_log2;
+  int size;
+};
+
+/*
+ * Auxilliary function to hash an ID to a slot, by Fibonacci hashing as in
+ * idset.c.
+ */
+int _idmap_home(struct idmap* map, int id) {
+  return (int)(((unsigned int)id * 2654435761u) >> (32 - map->capacity_log2));
+}
+
+/*
+ * Auxilliary function to find the slot holding `id`, or the empty slot where
+ * it would go.
+ */
+int _idmap_find(struct idmap* map, int id) {
+  int i = _idmap_home(map, id);
+  while (map->slots[i].id != 0 && map->slots[i].id != id) {
+    i = (i + 1) & (map->capacity - 1);
+  }
+  return i;
+}
+
+/*
+ * Auxilliary function to resize the table to `capacity` slots (a power of
+ * two) and rehash every entry into it.
+ */
+void _idmap_resize(struct idmap* map, int capacity) {
+  struct idmap_slot* old = map->slots;
+  int old_capacity = map->capacity;
+
+  map->capacity = capacity;
+  map->capacity_log2 = __builtin_ctz(capacity);
+  map->slots = calloc(map->capacity, sizeof(struct idmap_slot));
+  assert(map->slots);
+  for (int i = 0; i < old_capacity; i++) {
+    if (old[i].id != 0) {
+      map->slots[_idmap_find(map, old[i].id)] = old[i];
+    }
+  }
+  free(old);
+}
+
+/*
+ * This function allocates and initializes a new, empty ID map and returns a
+ * pointer to it.
+ */
+struct idmap* idmap_create() {
+  struct idmap* map = malloc(sizeof(struct idmap));
+  assert(map);
+  map->capacity = IDMAP_INIT_CAPACITY;
+  map->capacity_log2 = __builtin_ctz(IDMAP_INIT_CAPACITY);
+  map->slots = calloc(map->capacity, sizeof(struct idmap_slot));
+  assert(map->slots);
+  map->size = 0;
+  return map;
+}
+
+/*
+ * This function frees the memory associated with an ID map.  The values in
+ * the map aren't freed.
+ *
+ * Params:
+ *   map - the ID map to be destroyed.  May not be NULL.
+ */
+void idmap_free(struct idmap* map) {
+  assert(map);
+  free(map->slots);
+  free(map);
+}
+
+/*
+ * This function returns the number of entries in an ID map.
+ */
+int idmap_size(struct idmap* map) {
+  assert(map);
+  return map->size;
+}
+
+/*
+ * This function returns the value stored under a given ID in an ID map, or
+ * NULL if there isn't one.  This is O(1) expected.
+ */
+void* idmap_get(struct idmap* map, int id) {
+  assert(map);
+  if (id <= 0) {
+    return NULL;
+  }
+  int i = _idmap_find(map, id);
+  return map->slots[i].id == id ? map->slots[i].val : NULL;
+}
+
+/*
+ * This function stores a value under an ID in an ID map, replacing any value
+ * already stored under it.  This is O(1) expected (amortized over the
+ * occasional doubling of the table).
+ *
+ * Params:
+ *   map - the ID map.  May not be NULL.
+ *   id - the ID.  Must be positive.
+ *   val - the value to store.
+ *
+ * Return:
+ *   This function returns 1 if the ID was added or 0 if it was already in
+ *   the map and its value was replaced.
+ */
+int idmap_put(struct idmap* map, int id, void* val) {
+  assert(map);
+  assert(id > 0);
+  if (2 * (map->size + 1) > map->capacity) {
+    _idmap_resize(map, 2 * map->capacity);
+  }
+  int i = _idmap_find(map, id);
+  int added = map->slots[i].id != id;
+  map->slots[i].id = id;
+  map->slots[i].val = val;
+  map->size += added;
+  return added;
+}
+
+/*
+ * This function removes an ID from an ID map.  This is O(1) expected.  As in
+ * idset_remove(), later entries of the same probe run are shifted back into
+ * the hole rather than leaving a tombstone.
+ *
+ * Params:
+ *   map - the ID map.  May not be NULL.
+ *   id - the ID to remove.
+ *
+ * Return:
+ *   This function returns the value that was stored under the ID, or NULL if
+ *   it wasn't in the map.
+ */
+void* idmap_remove(struct idmap* map, int id) {
+  assert(map);
+  if (id <= 0) {
+    return NULL;
+  }
+  int i = _idmap_find(map, id);
+  if (map->slots[i].id != id) {
+    return NULL;
+  }
+  void* val = map->slots[i].val;
+
+  int mask = map->capacity - 1;
+  int j = i;
+  while (1) {
+    j = (j + 1) & mask;
+    if (map->slots[j].id == 0) {
+      break;
+    }
+    /*
+     * The entry at j may move into the hole at i only if its home slot is
+     * not in the cyclic range (i, j].
+     */
+    int home = _idmap_home(map, map->slots[j].id);
+    if (((j - home) & mask) >= ((j - i) & mask)) {
+      map->slots[i] = map->slots[j];
+      i = j;
+    }
+  }
+  map->slots[i].id = 0;
+  map->slots[i].val = NULL;
+  map->size--;
+  return val;
+}
@@ -0,0 +1,26 @@
+/*
+ * This file contains the definition of the interface for a hash map from
+ * positive integer IDs to pointers.  You can find descriptions of the ID map
+ * functions, including their parameters and their return values, in idmap.c.
+ */
+
+#ifndef __IDMAP_H
+#define __IDMAP_H
+
+/*
+ * Structure used to represent an ID map.
+ */
+struct idmap;
+
+/*
+ * ID map interface function prototypes.  Refer to idmap.c for documentation
+ * about each of these functions.
+ */
+struct idmap* idmap_create();
+void idmap_free(struct idmap* map);
+int idmap_size(struct idmap* map);
+void* idmap_get(struct idmap* map, int id);
+int idmap_put(struct idmap* map, int id, void* val);
+void* idmap_remove(struct idmap* map, int id);
+
+#endif
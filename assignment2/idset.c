@@ -0,0 +1,205 @@
+/*
+ * This file contains an implementation of a hash set of positive integer IDs,
+ * used to keep track of which calls are still waiting in the queues that
+ * cancel calls lazily.  It's an open-addressing table with linear probing,
+ * in which 0 marks an empty slot, and it's kept at most half full.  See the
+ * documentation below for more information on the individual functions in
+ * this implementation.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "idset.h"
+
+#define IDSET_INIT_CAPACITY 64
+
+/*
+ * This is the structure that represents an ID set.  `capacity` is a power
+ * of two, 1 << `capacity_log2`.
+ */
+struct idset {
+  int* slots;
+  int capacity;
+  int capacity_log2;
+  int size;
+};
+
+/*
+ * Auxilliary function to hash an ID to a slot, by Fibonacci hashing: the ID
+ * is multiplied by 2^32 divided by the golden ratio and the top bits of the
+ * product are taken, which depend on every bit of the ID.  This spreads out
+ * runs of consecutive IDs and IDs that differ only in their high bits (e.g.
+ * every 1024th ID) alike, so neither forms long probe sequences.
+ */
+int _idset_home(struct idset* set, int id) {
+  return (int)(((unsigned int)id * 2654435761u) >> (32 - set->capacity_log2));
+}
+
+/*
+ * Auxilliary function to find the slot holding `id`, or the empty slot where
+ * it would go.
+ */
+int _idset_find(struct idset* set, int id) {
+  int i = _idset_home(set, id);
+  while (set->slots[i] != 0 && set->slots[i] != id) {
+    i = (i + 1) & (set->capacity - 1);
+  }
+  return i;
+}
+
+/*
+ * Auxilliary function to resize the table to `capacity` slots (a power of
+ * two) and rehash every ID into it.
+ */
+void _idset_resize(struct idset* set, int capacity) {
+  int* old = set->slots;
+  int old_capacity = set->capacity;
+
+  set->capacity = capacity;
+  set->capacity_log2 = __builtin_ctz(capacity);
+  set->slots = calloc(set->capacity, sizeof(int));
+  assert(set->slots);
+  for (int i = 0; i < old_capacity; i++) {
+    if (old[i] != 0) {
+      set->slots[_idset_find(set, old[i])] = old[i];
+    }
+  }
+  free(old);
+}
+
+/*
+ * This function allocates and initializes a new, empty ID set and returns a
+ * pointer to it.
+ */
+struct idset* idset_create() {
+  struct idset* set = malloc(sizeof(struct idset));
+  assert(set);
+  set->capacity = IDSET_INIT_CAPACITY;
+  set->capacity_log2 = __builtin_ctz(IDSET_INIT_CAPACITY);
+  set->slots = calloc(set->capacity, sizeof(int));
+  assert(set->slots);
+  set->size = 0;
+  return set;
+}
+
+/*
+ * This function frees the memory associated with an ID set.
+ *
+ * Params:
+ *   set - the ID set to be destroyed.  May not be NULL.
+ */
+void idset_free(struct idset* set) {
+  assert(set);
+  free(set->slots);
+  free(set);
+}
+
+/*
+ * This function makes room in an ID set for at least `n` IDs in total, so
+ * that adding them doesn't grow (and rehash) the table more than once.
+ *
+ * Params:
+ *   set - the ID set.  May not be NULL.
+ *   n - the number of IDs the set should be able to hold.
+ */
+void idset_reserve(struct idset* set, int n) {
+  assert(set);
+  int capacity = set->capacity;
+  while (2 * n > capacity) {
+    capacity *= 2;
+  }
+  if (capacity > set->capacity) {
+    _idset_resize(set, capacity);
+  }
+}
+
+/*
+ * This function returns the number of IDs in an ID set.
+ */
+int idset_size(struct idset* set) {
+  assert(set);
+  return set->size;
+}
+
+/*
+ * This function returns 1 if an ID set contains a given ID and 0 otherwise.
+ * This is O(1) expected.
+ */
+int idset_contains(struct idset* set, int id) {
+  assert(set);
+  return id > 0 && set->slots[_idset_find(set, id)] == id;
+}
+
+/*
+ * This function adds an ID to an ID set.  This is O(1) expected (amortized
+ * over the occasional doubling of the table).
+ *
+ * Params:
+ *   set - the ID set.  May not be NULL.
+ *   id - the ID to add.  Must be positive.
+ *
+ * Return:
+ *   This function returns 1 if the ID was added or 0 if it was already in
+ *   the set.
+ */
+int idset_add(struct idset* set, int id) {
+  assert(set);
+  assert(id > 0);
+  if (2 * (set->size + 1) > set->capacity) {
+    _idset_resize(set, 2 * set->capacity);
+  }
+  int i = _idset_find(set, id);
+  if (set->slots[i] == id) {
+    return 0;
+  }
+  set->slots[i] = id;
+  set->size++;
+  return 1;
+}
+
+/*
+ * This function removes an ID from an ID set.  This is O(1) expected.
+ * Rather than leaving a tombstone in the table, later entries of the same
+ * probe run are shifted back into the hole, so lookups never slow down no
+ * matter how many IDs are removed.
+ *
+ * Params:
+ *   set - the ID set.  May not be NULL.
+ *   id - the ID to remove.
+ *
+ * Return:
+ *   This function returns 1 if the ID was removed or 0 if it wasn't in the
+ *   set.
+ */
+int idset_remove(struct idset* set, int id) {
+  assert(set);
+  if (id <= 0) {
+    return 0;
+  }
+  int i = _idset_find(set, id);
+  if (set->slots[i] != id) {
+    return 0;
+  }
+
+  int mask = set->capacity - 1;
+  int j = i;
+  while (1) {
+    j = (j + 1) & mask;
+    if (set->slots[j] == 0) {
+      break;
+    }
+    /*
+     * The entry at j may move into the hole at i only if its home slot is
+     * not in the cyclic range (i, j].
+     */
+    int home = _idset_home(set, set->slots[j]);
+    if (((j - home) & mask) >= ((j - i) & mask)) {
+      set->slots[i] = set->slots[j];
+      i = j;
+    }
+  }
+  set->slots[i] = 0;
+  set->size--;
+  return 1;
+}
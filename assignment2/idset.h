@@ -0,0 +1,27 @@
+/*
+ * This file contains the definition of the interface for a hash set of
+ * positive integer IDs.  You can find descriptions of the ID set functions,
+ * including their parameters and their return values, in idset.c.
+ */
+
+#ifndef __IDSET_H
+#define __IDSET_H
+
+/*
+ * Structure used to represent an ID set.
+ */
+struct idset;
+
+/*
+ * ID set interface function prototypes.  Refer to idset.c for documentation
+ * about each of these functions.
+ */
+struct idset* idset_create();
+void idset_free(struct idset* set);
+void idset_reserve(struct idset* set, int n);
+int idset_size(struct idset* set);
+int idset_contains(struct idset* set, int id);
+int idset_add(struct idset* set, int id);
+int idset_remove(struct idset* set, int id);
+
+#endif
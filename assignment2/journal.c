@@ -0,0 +1,482 @@
+/*
+ * This file contains an implementation of the call journal, an append-only
+ * write-ahead log of the events that change the call center's state: calls
+ * being received, answered and cancelled.  Replaying the journal in order
+ * into an empty call queue and answered-call history rebuilds the state the
+ * call center was in when the last event was committed.  See the
+ * documentation below for more information on the individual functions in
+ * this implementation.
+ *
+ * Each record is a 6-byte header (CRC-32 of the rest of the record, record
+ * type, payload length) followed by the payload:
+ *
+ *   JOURNAL_RECEIVE  uint32 call ID, uint8 name length, uint8 reason length,
+ *                    then the name and reason bytes
+ *   JOURNAL_ANSWER   uint32 ID of the call answered
+ *   JOURNAL_CANCEL   uint32 ID of the call cancelled
+ *   JOURNAL_NEXT_ID  uint32 next call ID to assign (written by compaction)
+ *
+ * Records are appended to an in-memory buffer and only written out, followed
+ * by a single fdatasync(), when the journal is committed (or the buffer
+ * fills).  A caller that commits once per batch of events, before
+ * acknowledging any of them, gets durable events for one disk flush per
+ * batch rather than per call (group commit).  A crash can leave a partially
+ * written batch at the end of the file; since every record is checksummed,
+ * loading stops at the first incomplete or corrupt record, and the
+ * compaction that loading starts with drops everything from there on.
+ *
+ * The journal would grow forever, so it's periodically compacted: the
+ * journal is replayed into scratch structures and the live state (the next
+ * call ID, the answered calls still in the history and the calls still
+ * waiting) is written to a new file as a minimal sequence of records, which
+ * then atomically replaces the old one.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <libgen.h>
+
+#include "journal.h"
+
+#define JOURNAL_RECEIVE 'R'
+#define JOURNAL_ANSWER 'A'
+#define JOURNAL_CANCEL 'C'
+#define JOURNAL_NEXT_ID 'S'
+
+#define JOURNAL_HEADER_SIZE 6
+#define JOURNAL_MAX_PAYLOAD 255
+
+/*
+ * Size of the group commit buffer.  Records are committed automatically
+ * when it fills.
+ */
+#define JOURNAL_BUF_SIZE (256 * 1024)
+
+/*
+ * The journal is compacted on commit once it's at least this big and at
+ * least JOURNAL_COMPACT_RATIO times as big as it was after the last
+ * compaction, so compaction costs amortized O(1) per record.
+ */
+#define JOURNAL_COMPACT_MIN (4L * 1024 * 1024)
+#define JOURNAL_COMPACT_RATIO 4
+
+/*
+ * This is the structure that represents an open journal.  `size` is the
+ * number of bytes committed to the file, and `compacted_size` its size
+ * after the last compaction.
+ */
+struct journal {
+    char* path;
+    int fd;
+    int history_cap;
+    long size;
+    long compacted_size;
+    int compacting;
+    int buf_len;
+    unsigned char buf[JOURNAL_BUF_SIZE];
+};
+
+/*
+ * Auxilliary function to compute the CRC-32 (IEEE) of a buffer, continuing
+ * from a previous CRC value (0 to start).
+ */
+uint32_t _journal_crc32(uint32_t crc, const unsigned char* data, size_t len) {
+    static uint32_t table[256];
+    static int table_ready = 0;
+
+    if (!table_ready) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[i] = c;
+        }
+        table_ready = 1;
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/*
+ * Auxilliary function to write a whole buffer to a file descriptor.
+ */
+int _journal_write_all(int fd, const unsigned char* buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/*
+ * Auxilliary function to write out and flush the group commit buffer,
+ * without considering compaction.
+ */
+void _journal_flush(struct journal* j) {
+    if (j->buf_len == 0) {
+        return;
+    }
+    if (_journal_write_all(j->fd, j->buf, j->buf_len) < 0 ||
+            fdatasync(j->fd) < 0) {
+        perror(j->path);
+        abort();
+    }
+    j->size += j->buf_len;
+    j->buf_len = 0;
+}
+
+/*
+ * Auxilliary function to append a record to the group commit buffer.
+ */
+void _journal_append(struct journal* j, int type, const unsigned char* payload,
+        int len) {
+    assert(len <= JOURNAL_MAX_PAYLOAD);
+    if (j->buf_len + JOURNAL_HEADER_SIZE + len > JOURNAL_BUF_SIZE) {
+        journal_commit(j);
+    }
+
+    unsigned char* rec = j->buf + j->buf_len;
+    rec[4] = type;
+    rec[5] = len;
+    memcpy(rec + JOURNAL_HEADER_SIZE, payload, len);
+    uint32_t crc = _journal_crc32(0, rec + 4, 2 + len);
+    memcpy(rec, &crc, 4);
+    j->buf_len += JOURNAL_HEADER_SIZE + len;
+}
+
+/*
+ * Auxilliary function to append a record whose payload is a single ID.
+ */
+void _journal_append_id(struct journal* j, int type, int id) {
+    uint32_t word = id;
+    _journal_append(j, type, (unsigned char*)&word, sizeof(word));
+}
+
+/*
+ * Auxilliary function to replay the journal file into a call queue and
+ * history.  Stops at the end of the file or at the first record that's
+ * incomplete, corrupt or inconsistent with the state rebuilt so far.
+ * Returns the next call ID to assign, or -1 if the file couldn't be read.
+ */
+int _journal_replay(struct journal* j, struct callq* queue,
+        struct ring* history, struct call_pool* pool) {
+    FILE* in = fopen(j->path, "rb");
+    if (!in) {
+        perror(j->path);
+        return -1;
+    }
+
+    unsigned char rec[JOURNAL_HEADER_SIZE + JOURNAL_MAX_PAYLOAD];
+    int next_id = 1;
+    while (fread(rec, 1, JOURNAL_HEADER_SIZE, in) == JOURNAL_HEADER_SIZE) {
+        int len = rec[5];
+        if (fread(rec + JOURNAL_HEADER_SIZE, 1, len, in) != (size_t)len) {
+            break;
+        }
+        uint32_t crc;
+        memcpy(&crc, rec, 4);
+        if (crc != _journal_crc32(0, rec + 4, 2 + len) || len < 4) {
+            break;
+        }
+
+        unsigned char* payload = rec + JOURNAL_HEADER_SIZE;
+        uint32_t id;
+        memcpy(&id, payload, 4);
+        if (rec[4] == JOURNAL_RECEIVE) {
+            if (len < 6 || len != 6 + payload[4] + payload[5] ||
+                    payload[4] >= (int)sizeof(((struct call*)0)->name) ||
+                    payload[5] >= (int)sizeof(((struct call*)0)->reason) ||
+                    (int)id <= 0 || callq_is_waiting(queue, id)) {
+                break;
+            }
+            struct call* c = call_pool_acquire(pool);
+            c->id = id;
+            memcpy(c->name, payload + 6, payload[4]);
+            c->name[payload[4]] = '\0';
+            memcpy(c->reason, payload + 6 + payload[4], payload[5]);
+            c->reason[payload[5]] = '\0';
+            callq_enqueue(queue, c);
+        } else if (rec[4] == JOURNAL_ANSWER) {
+            struct call* front = callq_front(queue);
+            if (!front || front->id != (int)id) {
+                break;
+            }
+            ring_push(history, callq_dequeue(queue));
+        } else if (rec[4] == JOURNAL_CANCEL) {
+            callq_cancel(queue, id);
+        } else if (rec[4] != JOURNAL_NEXT_ID) {
+            break;
+        }
+        if ((int)id >= next_id) {
+            next_id = rec[4] == JOURNAL_NEXT_ID ? (int)id : (int)id + 1;
+        }
+    }
+    fclose(in);
+    return next_id;
+}
+
+/*
+ * This function opens a journal for appending, creating the journal file if
+ * it doesn't exist.  Call journal_load() next to recover its contents.
+ *
+ * Params:
+ *   path - the journal file.
+ *   history_cap - the capacity of the answered-call history the journal is
+ *     loaded into.  Compaction keeps only this many answered calls.
+ *
+ * Return:
+ *   This function returns the journal, or NULL if the file couldn't be
+ *   opened.
+ */
+struct journal* journal_open(const char* path, int history_cap) {
+    assert(history_cap > 0);
+    int fd = open(path, O_WRONLY | O_APPEND | O_CREAT, 0644);
+    if (fd < 0) {
+        perror(path);
+        return NULL;
+    }
+
+    struct journal* j = malloc(sizeof(struct journal));
+    assert(j);
+    j->path = malloc(strlen(path) + 1);
+    strcpy(j->path, path);
+    j->fd = fd;
+    j->history_cap = history_cap;
+    j->size = lseek(fd, 0, SEEK_END);
+    j->compacted_size = j->size;
+    j->compacting = 0;
+    j->buf_len = 0;
+    return j;
+}
+
+/*
+ * This function commits any pending records and closes a journal.
+ *
+ * Params:
+ *   j - the journal to close.  May not be NULL.
+ */
+void journal_close(struct journal* j) {
+    assert(j);
+    _journal_flush(j);
+    close(j->fd);
+    free(j->path);
+    free(j);
+}
+
+/*
+ * This function recovers the state recorded in a journal: calls still
+ * waiting are enqueued, in order, and the most recently answered calls are
+ * pushed onto the history.  The journal is compacted first, so only live
+ * calls are replayed, and anything after the last intact record (e.g. a
+ * batch torn by a crash) is discarded.
+ *
+ * Params:
+ *   j - the journal.  May not be NULL.
+ *   queue - an empty call queue to enqueue waiting calls into.
+ *   history - an empty history to push answered calls onto, with at least
+ *     the capacity the journal was opened with.
+ *   pool - the pool to acquire call records from.
+ *
+ * Return:
+ *   This function returns the next call ID to assign, or -1 if the journal
+ *   couldn't be read.
+ */
+int journal_load(struct journal* j, struct callq* queue, struct ring* history,
+        struct call_pool* pool) {
+    assert(j && queue && history && pool);
+    if (journal_compact(j) < 0) {
+        return -1;
+    }
+    return _journal_replay(j, queue, history, pool);
+}
+
+/*
+ * This function records that a call was received.  Like every journal_*()
+ * event function, this only buffers the record; it isn't durable until the
+ * journal is committed.
+ *
+ * Params:
+ *   j - the journal.  May not be NULL.
+ *   c - the call.
+ */
+void journal_receive(struct journal* j, struct call* c) {
+    assert(j && c);
+    unsigned char payload[6 + sizeof(c->name) + sizeof(c->reason)];
+    uint32_t id = c->id;
+    int name_len = strlen(c->name), reason_len = strlen(c->reason);
+
+    memcpy(payload, &id, 4);
+    payload[4] = name_len;
+    payload[5] = reason_len;
+    memcpy(payload + 6, c->name, name_len);
+    memcpy(payload + 6 + name_len, c->reason, reason_len);
+    _journal_append(j, JOURNAL_RECEIVE, payload, 6 + name_len + reason_len);
+}
+
+/*
+ * This function records that the call at the front of the queue was
+ * answered.
+ *
+ * Params:
+ *   j - the journal.  May not be NULL.
+ *   id - the ID of the call answered.
+ */
+void journal_answer(struct journal* j, int id) {
+    assert(j);
+    _journal_append_id(j, JOURNAL_ANSWER, id);
+}
+
+/*
+ * This function records that a waiting call was cancelled.
+ *
+ * Params:
+ *   j - the journal.  May not be NULL.
+ *   id - the ID of the call cancelled.
+ */
+void journal_cancel(struct journal* j, int id) {
+    assert(j);
+    _journal_append_id(j, JOURNAL_CANCEL, id);
+}
+
+/*
+ * This function makes every record appended so far durable, with a single
+ * write and fdatasync() for the whole batch, and compacts the journal if it
+ * has grown enough since it was last compacted.  An I/O error here aborts
+ * the program, since the caller can't safely carry on without durability.
+ *
+ * Params:
+ *   j - the journal.  May not be NULL.
+ */
+void journal_commit(struct journal* j) {
+    assert(j);
+    _journal_flush(j);
+    if (!j->compacting && j->size >= JOURNAL_COMPACT_MIN &&
+            j->size >= JOURNAL_COMPACT_RATIO * j->compacted_size) {
+        if (journal_compact(j) < 0) {
+            abort();
+        }
+    }
+}
+
+/*
+ * This function compacts a journal, replacing it with the shortest journal
+ * that recovers the same state.  The new journal is written to a temporary
+ * file and renamed over the old one, so a crash at any point leaves one or
+ * the other intact.
+ *
+ * Params:
+ *   j - the journal.  May not be NULL.
+ *
+ * Return:
+ *   This function returns 0 on success or -1 on error, in which case the
+ *   journal is unchanged.
+ */
+int journal_compact(struct journal* j) {
+    assert(j);
+    _journal_flush(j);
+
+    struct call_pool* pool = call_pool_create(1024);
+    struct callq* queue = callq_create(NULL, 1, pool);
+    struct ring* history = ring_create(j->history_cap, call_pool_release_fn,
+        pool);
+    int next_id = _journal_replay(j, queue, history, pool);
+
+    char* tmp = malloc(strlen(j->path) + 5);
+    sprintf(tmp, "%s.tmp", j->path);
+    int fd = next_id < 0 ? -1 :
+        open(tmp, O_WRONLY | O_APPEND | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        if (next_id >= 0) {
+            perror(tmp);
+        }
+        free(tmp);
+        callq_free(queue);
+        ring_free(history);
+        call_pool_free(pool);
+        return -1;
+    }
+
+    /*
+     * Write the live state through the usual buffer, pointed at the new
+     * file.  Answered calls are written as a receive immediately followed by
+     * an answer, before any waiting call, so replaying them leaves exactly
+     * the same queue and history.
+     */
+    int old_fd = j->fd;
+    long old_size = j->size;
+    j->fd = fd;
+    j->size = 0;
+    j->compacting = 1;
+
+    _journal_append_id(j, JOURNAL_NEXT_ID, next_id);
+    int n;
+    struct call** answered = (struct call**)ring_last_k(history,
+        ring_size(history), &n);
+    for (int i = 0; i < n; i++) {
+        journal_receive(j, answered[i]);
+        journal_answer(j, answered[i]->id);
+    }
+    struct call* c;
+    while ((c = callq_dequeue(queue)) != NULL) {
+        journal_receive(j, c);
+        call_pool_release(pool, c);
+    }
+    _journal_flush(j);
+    j->compacting = 0;
+
+    /*
+     * Make the rename itself durable by syncing the directory.
+     */
+    int status = rename(tmp, j->path);
+    if (status == 0) {
+        char* dir_path = malloc(strlen(j->path) + 1);
+        strcpy(dir_path, j->path);
+        int dir_fd = open(dirname(dir_path), O_RDONLY);
+        if (dir_fd >= 0) {
+            fsync(dir_fd);
+            close(dir_fd);
+        }
+        free(dir_path);
+        close(old_fd);
+        j->compacted_size = j->size;
+    } else {
+        perror(j->path);
+        close(fd);
+        unlink(tmp);
+        j->fd = old_fd;
+        j->size = old_size;
+    }
+
+    free(tmp);
+    callq_free(queue);
+    ring_free(history);
+    call_pool_free(pool);
+    return status == 0 ? 0 : -1;
+}
+
+/*
+ * This function returns the number of bytes committed to a journal's file.
+ */
+long journal_size(struct journal* j) {
+    assert(j);
+    return j->size;
+}
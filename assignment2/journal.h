@@ -0,0 +1,37 @@
+/*
+ * This file contains the definition of the interface for the call journal, a
+ * write-ahead log of call events that lets the call center recover its
+ * waiting and answered calls after a crash.  You can find descriptions of
+ * the journal functions, including their parameters and their return
+ * values, in journal.c.
+ */
+
+#ifndef __JOURNAL_H
+#define __JOURNAL_H
+
+#include "call.h"
+#include "callpool.h"
+#include "callq.h"
+#include "ring.h"
+
+/*
+ * Structure used to represent an open journal.
+ */
+struct journal;
+
+/*
+ * Journal interface function prototypes.  Refer to journal.c for
+ * documentation about each of these functions.
+ */
+struct journal* journal_open(const char* path, int history_cap);
+void journal_close(struct journal* j);
+int journal_load(struct journal* j, struct callq* queue, struct ring* history,
+    struct call_pool* pool);
+void journal_receive(struct journal* j, struct call* c);
+void journal_answer(struct journal* j, int id);
+void journal_cancel(struct journal* j, int id);
+void journal_commit(struct journal* j);
+int journal_compact(struct journal* j);
+long journal_size(struct journal* j);
+
+#endif
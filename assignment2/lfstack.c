@@ -0,0 +1,318 @@
+/*
+ * This file contains an implementation of a lock-free (Treiber) stack with an
+ * elimination-backoff array.  See the documentation below for more
+ * information on the individual functions in this implementation.
+ *
+ * Nodes are preallocated in a fixed-size pool and referred to by index rather
+ * than by pointer.  The stack head (and the head of the pool's free list) is a
+ * single 64-bit word holding a node index in its low 32 bits and a version tag
+ * in its high 32 bits.  Every successful compare-and-swap bumps the tag, so a
+ * thread that read the head, stalled, and then sees the "same" node index on
+ * top again (the ABA problem) will still fail its CAS.  Because nodes are never
+ * returned to the allocator while the stack is live, a stalled thread reading
+ * a node's `next` field after that node was popped reads stale but harmless
+ * data, which the tag check then rejects.
+ *
+ * When a CAS on the head fails because of contention, the thread backs off
+ * into an elimination array instead of immediately retrying: a pusher parks
+ * its node in a random slot for a short while, and a popper that finds a
+ * parked node takes it directly.  Such a push/pop pair cancels out without
+ * either thread touching the head.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "lfstack.h"
+
+/*
+ * Size of the elimination array and the number of iterations a pusher waits
+ * in it for a partner before withdrawing its offer.
+ */
+#define LFSTACK_ELIM_SLOTS 16
+#define LFSTACK_ELIM_SPINS 64
+
+/*
+ * Assumed size of a cache line, used to keep the heads and the elimination
+ * slots from sharing lines with one another.
+ */
+#define LFSTACK_CACHE_LINE 64
+
+/*
+ * Helpers to pack/unpack a tagged head word.  Index 0 is reserved to mean
+ * "no node", so node i is stored as i + 1.
+ */
+#define TAG(word) ((uint32_t)((word) >> 32))
+#define REF(word) ((uint32_t)(word))
+#define PACK(tag, ref) (((uint64_t)(tag) << 32) | (uint32_t)(ref))
+
+/*
+ * This structure is used to represent a single node in the stack's pool.
+ */
+struct lf_node {
+  void* val;
+  uint32_t next;
+};
+
+/*
+ * A cache-line-sized wrapper around a single tagged word.
+ */
+struct lf_word {
+  uint64_t word;
+  char pad[LFSTACK_CACHE_LINE - sizeof(uint64_t)];
+};
+
+/*
+ * This structure is used to represent an entire lock-free stack.  `top` is
+ * the tagged head of the stack itself and `free` is the tagged head of the
+ * list of unused pool nodes.  Each elimination slot holds a tagged word whose
+ * reference is either 0 (empty) or a node offered by a waiting pusher.
+ */
+struct lfstack {
+  struct lf_word top;
+  struct lf_word free;
+  struct lf_word elim[LFSTACK_ELIM_SLOTS];
+  struct lf_node* nodes;
+  int capacity;
+};
+
+/*
+ * Per-thread state for choosing elimination slots.
+ */
+static __thread uint32_t _lf_seed;
+
+/*
+ * Auxilliary function returning a random elimination slot for the calling
+ * thread.
+ */
+int _lf_random_slot() {
+  if (_lf_seed == 0) {
+    _lf_seed = (uint32_t)(uintptr_t)&_lf_seed | 1;
+  }
+  _lf_seed ^= _lf_seed << 13;
+  _lf_seed ^= _lf_seed >> 17;
+  _lf_seed ^= _lf_seed << 5;
+  return _lf_seed % LFSTACK_ELIM_SLOTS;
+}
+
+/*
+ * Auxilliary function that makes a single attempt to push node `ref` onto the
+ * tagged list headed at `head`.  Returns 1 on success or 0 if the CAS lost a
+ * race with another thread.
+ */
+int _lf_try_push(struct lfstack* stack, uint64_t* head, uint32_t ref) {
+  uint64_t old = __atomic_load_n(head, __ATOMIC_ACQUIRE);
+  __atomic_store_n(&stack->nodes[ref - 1].next, REF(old), __ATOMIC_RELAXED);
+  return __atomic_compare_exchange_n(head, &old, PACK(TAG(old) + 1, ref), 0,
+    __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+}
+
+/*
+ * Auxilliary function that makes a single attempt to pop a node from the
+ * tagged list headed at `head`.  On success, stores the popped node's
+ * reference in `ref` (0 if the list was empty) and returns 1.  Returns 0 if
+ * the CAS lost a race with another thread.
+ */
+int _lf_try_pop(struct lfstack* stack, uint64_t* head, uint32_t* ref) {
+  uint64_t old = __atomic_load_n(head, __ATOMIC_ACQUIRE);
+  if (REF(old) == 0) {
+    *ref = 0;
+    return 1;
+  }
+  uint32_t next = __atomic_load_n(&stack->nodes[REF(old) - 1].next,
+    __ATOMIC_RELAXED);
+  if (__atomic_compare_exchange_n(head, &old, PACK(TAG(old) + 1, next), 0,
+      __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+    *ref = REF(old);
+    return 1;
+  }
+  return 0;
+}
+
+/*
+ * Auxilliary functions to move nodes in and out of the pool's free list.
+ * The free list sees far less contention than the stack top, so these simply
+ * retry without elimination.
+ */
+uint32_t _lf_alloc_node(struct lfstack* stack) {
+  uint32_t ref;
+  while (!_lf_try_pop(stack, &stack->free.word, &ref));
+  return ref;
+}
+
+void _lf_release_node(struct lfstack* stack, uint32_t ref) {
+  while (!_lf_try_push(stack, &stack->free.word, ref));
+}
+
+/*
+ * Auxilliary function in which a pusher whose CAS on the head failed offers
+ * node `ref` in the elimination array.  Returns 1 if a popper took the node
+ * (so the push is complete) or 0 if the offer was withdrawn unclaimed.
+ */
+int _lf_eliminate_push(struct lfstack* stack, uint32_t ref) {
+  uint64_t* slot = &stack->elim[_lf_random_slot()].word;
+  uint64_t old = __atomic_load_n(slot, __ATOMIC_RELAXED);
+  if (REF(old) != 0) {
+    return 0;
+  }
+  uint64_t offer = PACK(TAG(old) + 1, ref);
+  if (!__atomic_compare_exchange_n(slot, &old, offer, 0, __ATOMIC_RELEASE,
+      __ATOMIC_RELAXED)) {
+    return 0;
+  }
+
+  for (int i = 0; i < LFSTACK_ELIM_SPINS; i++) {
+    if (__atomic_load_n(slot, __ATOMIC_RELAXED) != offer) {
+      return 1;
+    }
+  }
+
+  /*
+   * Try to withdraw the offer.  If that fails, a popper claimed the node
+   * between our last check and now.  Any later reuse of the slot carries a
+   * newer tag, so the withdrawal can't mistake another offer for ours.
+   */
+  return !__atomic_compare_exchange_n(slot, &offer, PACK(TAG(offer) + 1, 0),
+    0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+/*
+ * Auxilliary function in which a popper whose CAS on the head failed looks
+ * for a pusher's offer in the elimination array.  Returns the claimed node's
+ * reference, or 0 if no offer was claimed.
+ */
+uint32_t _lf_eliminate_pop(struct lfstack* stack) {
+  uint64_t* slot = &stack->elim[_lf_random_slot()].word;
+  uint64_t old = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+  if (REF(old) == 0) {
+    return 0;
+  }
+  if (__atomic_compare_exchange_n(slot, &old, PACK(TAG(old) + 1, 0), 0,
+      __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+    return REF(old);
+  }
+  return 0;
+}
+
+/*
+ * This function allocates and initializes a new, empty lock-free stack and
+ * returns a pointer to it.  All node storage is allocated up front.
+ *
+ * Params:
+ *   capacity - the maximum number of values the stack can hold at once.
+ *     Must be positive.
+ */
+struct lfstack* lfstack_create(int capacity) {
+  assert(capacity > 0);
+
+  struct lfstack* stack = malloc(sizeof(struct lfstack));
+  assert(stack);
+  stack->nodes = malloc(capacity * sizeof(struct lf_node));
+  assert(stack->nodes);
+  stack->capacity = capacity;
+
+  /*
+   * Thread every node onto the free list: node i links to node i + 1.
+   */
+  for (int i = 0; i < capacity; i++) {
+    stack->nodes[i].val = NULL;
+    stack->nodes[i].next = i + 1 < capacity ? i + 2 : 0;
+  }
+  stack->free.word = PACK(0, 1);
+  stack->top.word = PACK(0, 0);
+  for (int i = 0; i < LFSTACK_ELIM_SLOTS; i++) {
+    stack->elim[i].word = PACK(0, 0);
+  }
+
+  return stack;
+}
+
+/*
+ * This function frees the memory associated with a lock-free stack.  It must
+ * not be called while any other thread is still using the stack.  Freeing
+ * any memory associated with values still stored in the stack is the
+ * responsibility of the caller.
+ *
+ * Params:
+ *   stack - the stack to be destroyed.  May not be NULL.
+ */
+void lfstack_free(struct lfstack* stack) {
+  assert(stack);
+  free(stack->nodes);
+  free(stack);
+}
+
+/*
+ * This function returns 1 if a given lock-free stack is empty and 0
+ * otherwise.  With other threads active the answer may be stale by the time
+ * the caller acts on it.
+ *
+ * Params:
+ *   stack - the stack whose emptiness is being questioned.  May not be NULL.
+ */
+int lfstack_isempty(struct lfstack* stack) {
+  assert(stack);
+  return REF(__atomic_load_n(&stack->top.word, __ATOMIC_ACQUIRE)) == 0;
+}
+
+/*
+ * This function pushes a new value onto a given lock-free stack.  It may be
+ * called concurrently with any number of other pushes and pops.
+ *
+ * Params:
+ *   stack - the stack onto which a value is to be pushed.  May not be NULL.
+ *   val - the value to be pushed.  May not be NULL, since NULL is what
+ *     lfstack_pop() returns for an empty stack.
+ *
+ * Return:
+ *   This function returns 1 if the value was pushed, or 0 if the stack was
+ *   already holding `capacity` values.
+ */
+int lfstack_push(struct lfstack* stack, void* val) {
+  assert(stack);
+  assert(val);
+
+  uint32_t ref = _lf_alloc_node(stack);
+  if (ref == 0) {
+    return 0;
+  }
+  stack->nodes[ref - 1].val = val;
+
+  while (!_lf_try_push(stack, &stack->top.word, ref)) {
+    if (_lf_eliminate_push(stack, ref)) {
+      return 1;
+    }
+  }
+  return 1;
+}
+
+/*
+ * This function pops a value from a given lock-free stack and returns the
+ * popped value.  It may be called concurrently with any number of other
+ * pushes and pops.
+ *
+ * Params:
+ *   stack - the stack from which a value is to be popped.  May not be NULL.
+ *
+ * Return:
+ *   This function returns the value that was popped, or NULL if the stack
+ *   was empty.
+ */
+void* lfstack_pop(struct lfstack* stack) {
+  assert(stack);
+
+  uint32_t ref;
+  while (!_lf_try_pop(stack, &stack->top.word, &ref)) {
+    if ((ref = _lf_eliminate_pop(stack)) != 0) {
+      break;
+    }
+  }
+  if (ref == 0) {
+    return NULL;
+  }
+
+  void* val = stack->nodes[ref - 1].val;
+  _lf_release_node(stack, ref);
+  return val;
+}
@@ -123,6 +123,95 @@ void list_remove(struct list* list, void* val, int (*cmp)(void* a, void* b)) {
   }
 }
 
+/*
+ * This function removes every element of a given linked list for which a
+ * predicate function returns a non-zero value.  All matching nodes are
+ * unlinked in a single pass through the list, so purging k matching elements
+ * from a list of n elements costs O(n) rather than the O(n*k) it would cost to
+ * call list_remove() once per element.
+ *
+ * Params:
+ *   list - the linked list from which to remove elements.  May not be NULL.
+ *   pred - pointer to a function that is passed each value stored in the list
+ *     along with `ctx`.  It should return a non-zero value if the value is to
+ *     be removed and 0 otherwise.  May not be NULL.
+ *   ctx - an arbitrary pointer passed through unchanged to `pred`.  May be
+ *     NULL.
+ *   free_fn - pointer to a function used to free each removed value.  If this
+ *     is NULL, freeing the removed values is the responsibility of the caller.
+ *
+ * Return:
+ *   This function returns the number of elements removed from `list`.
+ */
+int list_remove_if(struct list* list, int (*pred)(void* val, void* ctx),
+    void* ctx, void (*free_fn)(void* val)) {
+  assert(list);
+  assert(pred);
+
+  /*
+   * Walk the list with a pointer to the link that points at the current node
+   * (either list->head or the previous node's next field), so a matching node
+   * can be unlinked without special-casing the head.
+   */
+  int removed = 0;
+  struct node** link = &list->head;
+  while (*link) {
+    struct node* curr = *link;
+    if (pred(curr->val, ctx)) {
+      *link = curr->next;
+      if (free_fn) {
+        free_fn(curr->val);
+      }
+      free(curr);
+      removed++;
+    } else {
+      link = &curr->next;
+    }
+  }
+
+  return removed;
+}
+
+/*
+ * Auxilliary structure and predicate used to adapt list_remove_all()'s
+ * equality comparison to the predicate interface of list_remove_if().
+ */
+struct _list_match {
+  void* val;
+  int (*cmp)(void* a, void* b);
+};
+
+int _list_matches(void* val, void* ctx) {
+  struct _list_match* match = ctx;
+  return match->cmp(match->val, val) == 0;
+}
+
+/*
+ * This function removes *every* instance of a specified value from a given
+ * linked list in a single pass, unlike list_remove(), which removes only the
+ * first instance.  Freeing any memory associated with the removed values is
+ * the responsibility of the caller.
+ *
+ * Params:
+ *   list - the linked list from which to remove elements.  May not be NULL.
+ *   val - the value to be removed.  Note that this parameter has type void*,
+ *     which means that a pointer of any type can be passed.
+ *   cmp - pointer to a function that can be passed two void* values from
+ *     to compare them for equality, as described above.  If the two values
+ *     passed are to be considered equal, this function should return 0.
+ *     Otherwise, it should return a non-zero value.
+ *
+ * Return:
+ *   This function returns the number of elements removed from `list`.
+ */
+int list_remove_all(struct list* list, void* val, int (*cmp)(void* a, void* b)) {
+  assert(list);
+  assert(cmp);
+
+  struct _list_match match = { val, cmp };
+  return list_remove_if(list, _list_matches, &match, NULL);
+}
+
 /*
  * This returns the position (i.e. the 0-based "index") of the first instance
  * of a specified value within a given linked list (i.e. the one nearest to the
@@ -22,6 +22,9 @@ struct list* list_create();
 void list_free(struct list* list);
 void list_insert(struct list* list, void* val);
 void list_remove(struct list* list, void* val, int (*cmp)(void* a, void* b));
+int list_remove_if(struct list* list, int (*pred)(void* val, void* ctx),
+  void* ctx, void (*free_fn)(void* val));
+int list_remove_all(struct list* list, void* val, int (*cmp)(void* a, void* b));
 int list_position(struct list* list, void* val, int (*cmp)(void* a, void* b));
 void list_reverse(struct list* list);
 
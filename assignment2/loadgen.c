@@ -0,0 +1,489 @@
+/*
+ * This file contains a synthetic load generator and benchmark for the call
+ * center.  It generates a stream of calls with Poisson or bursty arrivals and
+ * exponential, constant or lognormal service times, with caller names and
+ * call reasons of configurable length.  The calls are then either written out
+ * as a trace for `callcenter -f` (see replay.c) or driven in-process through
+ * the call queue and answered-call stack, with N agents answering calls in
+ * FIFO order.  In-process runs report how many calls/s the queue and stack
+ * sustain in wall-clock time, together with the mean and tail waiting time
+ * and the peak queue depth in simulated time.
+ *
+ * With `-q mlfq`, waiting calls are instead scheduled by the multi-level
+ * feedback queue in mlfq.c.  Each call starts in a level according to its
+ * service time: level 0 for calls taking at most half the mean, and one
+ * level further down for each doubling after that.  (The generator knows
+ * each call's service time in advance, which stands in for predicting it
+ * from the call's reason.)  Calls are promoted a level for every `-A` ms
+ * they wait.  Waits are also broken down by these service classes, for
+ * comparison with FIFO.
+ *
+ * Usage: ./loadgen [options]
+ *   -n calls      number of calls to generate (default 1000000)
+ *   -l rate       mean arrival rate in calls/s (default 1000)
+ *   -a process    arrival process: poisson or bursty (default poisson)
+ *   -b factor     bursty only: ratio of busy to quiet arrival rate
+ *                 (default 10)
+ *   -B seconds    bursty only: mean length of each busy/quiet period
+ *                 (default 1)
+ *   -s dist       service times: exp, const or lognormal (default exp)
+ *   -S ms         mean service time in milliseconds (default 5)
+ *   -N agents     number of agents answering calls (default 6)
+ *   -L length     caller name length (default 12, at most 49)
+ *   -R length     call reason length (default 40, at most 99)
+ *   -x seed       random seed (default 1)
+ *   -o file       write a replay trace to file instead of running in-process
+ *   -q sched      how waiting calls are scheduled: fifo or mlfq (default
+ *                 fifo); mlfq can't be used with -o
+ *   -A ms         mlfq only: wait before a call is promoted a level, or 0 to
+ *                 never promote calls (default 50)
+ *   -j threads    threads used to sort the waits for the report, with
+ *                 psort.c (default 1, i.e. qsort())
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "call.h"
+#include "callpool.h"
+#include "queue.h"
+#include "stack.h"
+#include "mlfq.h"
+#include "wspool.h"
+#include "psort.h"
+
+/*
+ * Answered calls are freed whenever the history reaches this many, so that
+ * long runs don't hold every call in memory.
+ */
+#define LOADGEN_HISTORY_CAP 65536
+
+/*
+ * Number of call records the call pool allocates at a time.
+ */
+#define LOADGEN_POOL_SLAB 4096
+
+#define LOADGEN_PI 3.14159265358979323846
+
+/*
+ * Number of service classes, which are also the levels with `-q mlfq`.
+ */
+#define LOADGEN_CLASSES 4
+
+/*
+ * Struct holding the load generator's configuration.
+ */
+struct loadgen_config {
+    long calls;
+    double rate;
+    int bursty;
+    double burst_factor;
+    double burst_period;
+    int service_dist;
+    double service_mean;
+    int agents;
+    int name_len;
+    int reason_len;
+    uint64_t seed;
+    char* trace_path;
+    int mlfq;
+    double age;
+    int threads;
+};
+
+enum { SERVICE_EXP, SERVICE_CONST, SERVICE_LOGNORMAL };
+
+/*
+ * Per-run generator state: the random number generator and, for bursty
+ * arrivals, the current period's rate and end time.
+ */
+struct loadgen {
+    struct loadgen_config cfg;
+    uint64_t rng;
+    int busy;
+    double period_end;
+    double now;
+};
+
+/*
+ * Function returning a uniformly-distributed double in (0, 1), using
+ * xorshift64* so that runs are reproducible across platforms.
+ */
+double loadgen_uniform(struct loadgen* g) {
+    g->rng ^= g->rng >> 12;
+    g->rng ^= g->rng << 25;
+    g->rng ^= g->rng >> 27;
+    uint64_t x = g->rng * 2685821657736338717ULL;
+    return ((x >> 11) + 0.5) / 9007199254740992.0;
+}
+
+/*
+ * Function returning an exponentially-distributed value with a given mean.
+ */
+double loadgen_exp(struct loadgen* g, double mean) {
+    return -mean * log(loadgen_uniform(g));
+}
+
+/*
+ * Function returning a service time drawn from the configured distribution.
+ * The lognormal distribution has sigma 1 and is scaled to the same mean.
+ */
+double loadgen_service(struct loadgen* g) {
+    double mean = g->cfg.service_mean;
+    switch (g->cfg.service_dist) {
+    case SERVICE_CONST:
+        return mean;
+    case SERVICE_LOGNORMAL: {
+        double z = sqrt(-2 * log(loadgen_uniform(g))) *
+            cos(2 * LOADGEN_PI * loadgen_uniform(g));
+        return exp(log(mean) - 0.5 + z);
+    }
+    default:
+        return loadgen_exp(g, mean);
+    }
+}
+
+/*
+ * Function returning the time of the next arrival.  Bursty arrivals follow a
+ * two-state Markov-modulated Poisson process whose busy rate is
+ * `burst_factor` times its quiet rate, with the two rates chosen so that the
+ * long-run mean is still `rate`.  Because exponential gaps are memoryless, an
+ * arrival that would fall past the end of the current period can simply be
+ * redrawn from the period boundary at the new rate.
+ */
+double loadgen_next_arrival(struct loadgen* g) {
+    if (!g->cfg.bursty) {
+        g->now += loadgen_exp(g, 1.0 / g->cfg.rate);
+        return g->now;
+    }
+
+    double b = g->cfg.burst_factor;
+    while (1) {
+        double rate = 2 * g->cfg.rate * (g->busy ? b : 1) / (b + 1);
+        double next = g->now + loadgen_exp(g, 1.0 / rate);
+        if (next < g->period_end) {
+            g->now = next;
+            return next;
+        }
+        g->now = g->period_end;
+        g->busy = !g->busy;
+        g->period_end += loadgen_exp(g, g->cfg.burst_period);
+    }
+}
+
+/*
+ * Function returning the service class of a call taking `service` seconds:
+ * 0 up to half the mean, then one more for each doubling.
+ */
+int loadgen_class(struct loadgen* g, double service) {
+    int class = 0;
+    double limit = g->cfg.service_mean / 2;
+    while (class < LOADGEN_CLASSES - 1 && service > limit) {
+        class++;
+        limit *= 2;
+    }
+    return class;
+}
+
+/*
+ * Function to fill `buf` with a random string of exactly `len` letters.
+ */
+void loadgen_string(struct loadgen* g, char* buf, int len) {
+    for (int i = 0; i < len; i++) {
+        buf[i] = 'a' + (int)(loadgen_uniform(g) * 26);
+    }
+    buf[len] = '\0';
+}
+
+/*
+ * Min-heap of agent free times, so the next agent to become free is found in
+ * O(log N).
+ */
+void loadgen_sift_down(double* heap, int n, int i) {
+    while (1) {
+        int min = i, l = 2 * i + 1, r = 2 * i + 2;
+        if (l < n && heap[l] < heap[min]) {
+            min = l;
+        }
+        if (r < n && heap[r] < heap[min]) {
+            min = r;
+        }
+        if (min == i) {
+            return;
+        }
+        double tmp = heap[i];
+        heap[i] = heap[min];
+        heap[min] = tmp;
+        i = min;
+    }
+}
+
+int loadgen_cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Function to parse command line options into `cfg`.  Returns 0 on success.
+ */
+int loadgen_parse(int argc, char** argv, struct loadgen_config* cfg) {
+    int opt;
+
+    cfg->calls = 1000000;
+    cfg->rate = 1000;
+    cfg->bursty = 0;
+    cfg->burst_factor = 10;
+    cfg->burst_period = 1;
+    cfg->service_dist = SERVICE_EXP;
+    cfg->service_mean = 0.005;
+    cfg->agents = 6;
+    cfg->name_len = 12;
+    cfg->reason_len = 40;
+    cfg->seed = 1;
+    cfg->trace_path = NULL;
+    cfg->mlfq = 0;
+    cfg->age = 0.05;
+    cfg->threads = 1;
+
+    while ((opt = getopt(argc, argv, "n:l:a:b:B:s:S:N:L:R:x:o:q:A:j:")) != -1) {
+        switch (opt) {
+        case 'n': cfg->calls = atol(optarg); break;
+        case 'l': cfg->rate = atof(optarg); break;
+        case 'b': cfg->burst_factor = atof(optarg); break;
+        case 'B': cfg->burst_period = atof(optarg); break;
+        case 'S': cfg->service_mean = atof(optarg) / 1000.0; break;
+        case 'N': cfg->agents = atoi(optarg); break;
+        case 'L': cfg->name_len = atoi(optarg); break;
+        case 'R': cfg->reason_len = atoi(optarg); break;
+        case 'x': cfg->seed = strtoull(optarg, NULL, 10); break;
+        case 'o': cfg->trace_path = optarg; break;
+        case 'A': cfg->age = atof(optarg) / 1000.0; break;
+        case 'j': cfg->threads = atoi(optarg); break;
+        case 'q':
+            if (strcmp(optarg, "fifo") == 0) {
+                cfg->mlfq = 0;
+            } else if (strcmp(optarg, "mlfq") == 0) {
+                cfg->mlfq = 1;
+            } else {
+                return 1;
+            }
+            break;
+        case 'a':
+            if (strcmp(optarg, "poisson") == 0) {
+                cfg->bursty = 0;
+            } else if (strcmp(optarg, "bursty") == 0) {
+                cfg->bursty = 1;
+            } else {
+                return 1;
+            }
+            break;
+        case 's':
+            if (strcmp(optarg, "exp") == 0) {
+                cfg->service_dist = SERVICE_EXP;
+            } else if (strcmp(optarg, "const") == 0) {
+                cfg->service_dist = SERVICE_CONST;
+            } else if (strcmp(optarg, "lognormal") == 0) {
+                cfg->service_dist = SERVICE_LOGNORMAL;
+            } else {
+                return 1;
+            }
+            break;
+        default:
+            return 1;
+        }
+    }
+
+    int max_name = (int)sizeof(((struct call*)0)->name) - 1;
+    int max_reason = (int)sizeof(((struct call*)0)->reason) - 1;
+    return cfg->calls < 1 || cfg->rate <= 0 || cfg->burst_factor < 1 ||
+        cfg->burst_period <= 0 || cfg->service_mean <= 0 ||
+        cfg->agents < 1 || cfg->name_len < 0 || cfg->name_len > max_name ||
+        cfg->reason_len < 0 || cfg->reason_len > max_reason ||
+        cfg->age < 0 || cfg->threads < 1 || (cfg->mlfq && cfg->trace_path);
+}
+
+int main(int argc, char** argv) {
+    struct loadgen g;
+    if (loadgen_parse(argc, argv, &g.cfg)) {
+        fprintf(stderr, "Usage: %s [-n calls] [-l rate] [-a poisson|bursty]"
+            " [-b factor] [-B seconds] [-s exp|const|lognormal] [-S ms]"
+            " [-N agents] [-L name_len] [-R reason_len] [-x seed]"
+            " [-o trace_file] [-q fifo|mlfq] [-A ms] [-j threads]\n",
+            argv[0]);
+        return 1;
+    }
+    g.rng = g.cfg.seed * 0x9E3779B97F4A7C15ULL + 1;
+    g.busy = 0;
+    g.now = 0;
+    g.period_end = loadgen_exp(&g, g.cfg.burst_period);
+
+    long n = g.cfg.calls;
+    int agents = g.cfg.agents;
+    FILE* trace = NULL;
+    if (g.cfg.trace_path) {
+        trace = fopen(g.cfg.trace_path, "w");
+        if (!trace) {
+            perror(g.cfg.trace_path);
+            return 1;
+        }
+    }
+
+    /*
+     * Arrival and service times, indexed by call ID, and the wait of each
+     * answered call, along with the number and total wait of answered calls
+     * in each service class.
+     */
+    double* arrival = malloc((n + 1) * sizeof(double));
+    double* service = malloc((n + 1) * sizeof(double));
+    double* waits = malloc(n * sizeof(double));
+    double* free_at = calloc(agents, sizeof(double));
+    long class_calls[LOADGEN_CLASSES] = { 0 };
+    double class_wait[LOADGEN_CLASSES] = { 0 };
+    char name[50], reason[100];
+
+    struct call_pool* pool = call_pool_create(LOADGEN_POOL_SLAB);
+    struct queue* queue = queue_create();
+    struct mlfq* mlfq = mlfq_create(LOADGEN_CLASSES,
+        (long long)(g.cfg.age * 1e6));
+    struct stack* answered = stack_create();
+    void* retired[LOADGEN_HISTORY_CAP];
+    long n_waits = 0;
+    int peak_depth = 0;
+    double busy_time = 0;
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    /*
+     * Calls are generated in arrival order.  Before each arrival, every
+     * waiting call that an agent can pick up by then is answered: the next
+     * call in the queue goes to the agent that becomes free first, starting
+     * when both are ready.  Answer times therefore never decrease, and a
+     * trace can be written in a single pass.  Unless the queue was empty,
+     * every waiting call has arrived by the time the agent is free, so with
+     * `-q mlfq` the agent picks from all of them.  The MLFQ keeps time in
+     * microseconds.
+     */
+    double last_arrival = 0;
+    for (long id = 1; id <= n + 1; id++) {
+        double t = id <= n ? loadgen_next_arrival(&g) : INFINITY;
+        while (!(g.cfg.mlfq ? mlfq_isempty(mlfq) : queue_isempty(queue)) &&
+                free_at[0] <= t) {
+            struct call* c;
+            if (g.cfg.mlfq) {
+                c = mlfq_dequeue(mlfq, (long long)(fmax(free_at[0],
+                    last_arrival) * 1e6));
+            } else {
+                c = queue_dequeue(queue);
+            }
+            double start = fmax(free_at[0], arrival[c->id]);
+            int class = loadgen_class(&g, service[c->id]);
+            waits[n_waits++] = start - arrival[c->id];
+            class_calls[class]++;
+            class_wait[class] += start - arrival[c->id];
+            busy_time += service[c->id];
+            free_at[0] = start + service[c->id];
+            loadgen_sift_down(free_at, agents, 0);
+            if (trace) {
+                fprintf(trace, "%lld A\n", (long long)(start * 1e6));
+            }
+
+            stack_push(answered, c);
+            if (stack_size(answered) == LOADGEN_HISTORY_CAP) {
+                int k = stack_pop_many(answered, retired, LOADGEN_HISTORY_CAP);
+                for (int i = 0; i < k; i++) {
+                    call_pool_release(pool, retired[i]);
+                }
+            }
+        }
+        if (id > n) {
+            break;
+        }
+
+        arrival[id] = last_arrival = t;
+        service[id] = loadgen_service(&g);
+        loadgen_string(&g, name, g.cfg.name_len);
+        loadgen_string(&g, reason, g.cfg.reason_len);
+        struct call* c = call_pool_create_call(pool, (int)id, name, reason);
+        if (g.cfg.mlfq) {
+            mlfq_enqueue(mlfq, c, loadgen_class(&g, service[id]),
+                (long long)(t * 1e6));
+        } else {
+            queue_enqueue(queue, c);
+        }
+        int depth = g.cfg.mlfq ? mlfq_size(mlfq) : queue_size(queue);
+        if (depth > peak_depth) {
+            peak_depth = depth;
+        }
+        if (trace) {
+            fprintf(trace, "%lld R %s|%s\n", (long long)(t * 1e6), name,
+                reason);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double wall = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+    if (trace) {
+        fclose(trace);
+        printf("Wrote %ld calls to %s.\n", n, g.cfg.trace_path);
+    } else {
+        double sum = 0, makespan = 0;
+        for (long i = 0; i < n_waits; i++) {
+            sum += waits[i];
+        }
+        for (int i = 0; i < agents; i++) {
+            makespan = fmax(makespan, free_at[i]);
+        }
+        if (g.cfg.threads > 1) {
+            struct wspool* sorter = wspool_create(g.cfg.threads);
+            psort(sorter, waits, n_waits, sizeof(double), loadgen_cmp_double);
+            wspool_free(sorter);
+        } else {
+            qsort(waits, n_waits, sizeof(double), loadgen_cmp_double);
+        }
+        printf("%ld calls, %s arrivals at %.0f calls/s, %s service mean"
+            " %.2fms, %d agents\n", n, g.cfg.bursty ? "bursty" : "Poisson",
+            g.cfg.rate, g.cfg.service_dist == SERVICE_EXP ? "exp" :
+            g.cfg.service_dist == SERVICE_CONST ? "const" : "lognormal",
+            g.cfg.service_mean * 1000, agents);
+        printf("  throughput: %.0f calls/s (%.3fs wall)\n", n / wall, wall);
+        printf("  simulated:  %.1fs, agent utilization %.1f%%\n", makespan,
+            100 * busy_time / (agents * makespan));
+        printf("  wait (ms):  mean %.3f  p99 %.3f  max %.3f\n",
+            1000 * sum / n_waits,
+            1000 * waits[(long)(0.99 * (n_waits - 1) + 0.5)],
+            1000 * waits[n_waits - 1]);
+        printf("  peak queue depth: %d\n", peak_depth);
+        printf("  scheduling: %s", g.cfg.mlfq ? "mlfq" : "fifo");
+        if (g.cfg.mlfq) {
+            printf(" (%d levels, promoted every %.1fms, %ld promotions)",
+                LOADGEN_CLASSES, g.cfg.age * 1000, mlfq_promotions(mlfq));
+        }
+        printf("\n  mean wait by service class (ms):");
+        for (int i = 0; i < LOADGEN_CLASSES; i++) {
+            int last = i == LOADGEN_CLASSES - 1;
+            printf("  %s%.1fx: %.3f", last ? ">" : "<=",
+                0.5 * (1 << (last ? i - 1 : i)), class_calls[i] ?
+                1000 * class_wait[i] / class_calls[i] : 0);
+        }
+        printf("\n");
+    }
+
+    stack_free(answered);
+    queue_free(queue);
+    mlfq_free(mlfq);
+    call_pool_free(pool);
+    free(arrival);
+    free(service);
+    free(waits);
+    free(free_at);
+    return 0;
+}
@@ -0,0 +1,577 @@
+/*
+ * This file contains an implementation of the call center's live metrics.
+ * See the documentation below for more information on the individual
+ * functions in this implementation.
+ *
+ * Every thread that updates metrics gets its own shard, holding its own
+ * counters and histograms, and is the only thread that ever writes to it.
+ * An update is then a plain load and store to memory no other thread
+ * writes, with no locks and no atomic read-modify-write instructions, so
+ * updating metrics costs the hot path next to nothing.  Readers sum the
+ * shards; the loads and stores are relaxed atomics, so a reader sees every
+ * value whole, if not all from the same instant.
+ *
+ * Histograms are HDR-style: values below METRICS_SUB_BUCKETS get a bucket
+ * each, and every power of two above that is split into METRICS_SUB_BUCKETS
+ * / 2 equal buckets, so any value is recorded to within 1 / 16 of itself
+ * (about 6%) in under a thousand fixed buckets, whatever its magnitude.
+ *
+ * A dump thread started by metrics_start() writes all of the metrics out as
+ * plain text every interval, either by atomically replacing a file or, if
+ * the path starts with "unix:", to every client that connects to a Unix
+ * domain socket at the rest of the path.  The format is one metric per
+ * line:
+ *
+ *   <name> <value>
+ *   <histogram> count=<n> mean=<x> p50=<x> p90=<x> p99=<x> p99.9=<x> max=<x>
+ *
+ * The per-second rates cover the last interval.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "metrics.h"
+
+#define METRICS_SUB_BITS 5
+#define METRICS_SUB_BUCKETS (1 << METRICS_SUB_BITS)
+#define METRICS_BUCKETS ((64 - METRICS_SUB_BITS + 1) * METRICS_SUB_BUCKETS / 2)
+
+#define METRICS_SOCKET_PREFIX "unix:"
+
+static const char* metrics_counter_names[METRICS_COUNTERS] = {
+    "received", "answered", "cancelled"
+};
+static const char* metrics_histogram_names[METRICS_HISTOGRAMS] = {
+    "wait_us", "queue_depth", "history_depth"
+};
+
+/*
+ * Structure holding one histogram.
+ */
+struct metrics_histogram {
+    long count;
+    long long sum;
+    long long max;
+    long buckets[METRICS_BUCKETS];
+};
+
+/*
+ * Structure holding one thread's metrics.  Shards are allocated on cache
+ * line boundaries and chained together so they can be summed.
+ */
+struct metrics_shard {
+    long counters[METRICS_COUNTERS];
+    struct metrics_histogram hists[METRICS_HISTOGRAMS];
+    struct metrics_shard* next;
+};
+
+/*
+ * This is the structure that represents a set of metrics.  `lock` protects
+ * the list of shards (but not their contents) and the state used to work
+ * out rates: the counter totals and the time at the last tick of the dump
+ * thread, and the rates over the interval that ended there.
+ */
+struct metrics {
+    pthread_mutex_t lock;
+    struct metrics_shard* shards;
+    long long start_us;
+    long long last_us;
+    long last_totals[METRICS_COUNTERS];
+    double rates[METRICS_COUNTERS];
+    char* path;
+    int interval_ms;
+    int listen_fd;
+    int stop_pipe[2];
+    int running;
+    pthread_t dumper;
+};
+
+/*
+ * Auxilliary function to add to a value that only the calling thread ever
+ * writes, while other threads may be reading it.
+ */
+void _metrics_add(long* p, long n) {
+    __atomic_store_n(p, __atomic_load_n(p, __ATOMIC_RELAXED) + n,
+        __ATOMIC_RELAXED);
+}
+
+/*
+ * Auxilliary function returning the histogram bucket a value falls in.
+ */
+int _metrics_bucket(long long value) {
+    unsigned long long v = value < 0 ? 0 : (unsigned long long)value;
+    if (v < METRICS_SUB_BUCKETS) {
+        return (int)v;
+    }
+    int shift = 63 - __builtin_clzll(v) - (METRICS_SUB_BITS - 1);
+    return shift * (METRICS_SUB_BUCKETS / 2) + (int)(v >> shift);
+}
+
+/*
+ * Auxilliary function returning the highest value that falls in a bucket.
+ */
+long long _metrics_bucket_high(int bucket) {
+    if (bucket < METRICS_SUB_BUCKETS) {
+        return bucket;
+    }
+    int shift = bucket / (METRICS_SUB_BUCKETS / 2) - 1;
+    long long low = (long long)(bucket - shift * (METRICS_SUB_BUCKETS / 2)) <<
+        shift;
+    return low + (1LL << shift) - 1;
+}
+
+/*
+ * This function allocates and initializes a new set of metrics, with all
+ * counters and histograms empty, and returns a pointer to it.
+ */
+struct metrics* metrics_create() {
+    struct metrics* m = malloc(sizeof(struct metrics));
+    assert(m);
+    memset(m, 0, sizeof(struct metrics));
+    pthread_mutex_init(&m->lock, NULL);
+    m->start_us = m->last_us = metrics_now_us();
+    m->listen_fd = -1;
+    return m;
+}
+
+/*
+ * This function frees a set of metrics along with all of its shards,
+ * stopping the dump thread first if it's running.  No shard may be used
+ * afterwards.
+ *
+ * Params:
+ *   m - the metrics to be destroyed.  May not be NULL.
+ */
+void metrics_free(struct metrics* m) {
+    assert(m);
+    metrics_stop(m);
+    struct metrics_shard* next, * s = m->shards;
+    while (s) {
+        next = s->next;
+        free(s);
+        s = next;
+    }
+    pthread_mutex_destroy(&m->lock);
+    free(m);
+}
+
+/*
+ * This function creates a new, empty shard of a set of metrics, for one
+ * thread to record its updates in.
+ *
+ * Params:
+ *   m - the metrics.  May not be NULL.
+ *
+ * Return:
+ *   This function returns the new shard, which must only ever be updated by
+ *   one thread at a time.  It's freed along with the metrics.
+ */
+struct metrics_shard* metrics_shard_create(struct metrics* m) {
+    assert(m);
+    void* mem;
+    int err = posix_memalign(&mem, 64, sizeof(struct metrics_shard));
+    assert(err == 0);
+    (void)err;
+    struct metrics_shard* s = mem;
+    memset(s, 0, sizeof(struct metrics_shard));
+
+    pthread_mutex_lock(&m->lock);
+    s->next = m->shards;
+    m->shards = s;
+    pthread_mutex_unlock(&m->lock);
+    return s;
+}
+
+/*
+ * This function returns the current wall-clock time in microseconds, which
+ * is what calls are stamped with when they're received.  Wall-clock time is
+ * used so that waits stay meaningful across a restart.
+ */
+long long metrics_now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+/*
+ * This function adds to a counter.
+ *
+ * Params:
+ *   s - the calling thread's shard.  May not be NULL.
+ *   counter - the counter to add to, e.g. METRICS_RECEIVED.
+ *   n - the amount to add.
+ */
+void metrics_count(struct metrics_shard* s, int counter, long n) {
+    assert(s && counter >= 0 && counter < METRICS_COUNTERS);
+    _metrics_add(&s->counters[counter], n);
+}
+
+/*
+ * This function records a value in a histogram.  This is O(1).
+ *
+ * Params:
+ *   s - the calling thread's shard.  May not be NULL.
+ *   hist - the histogram to record the value in, e.g. METRICS_WAIT_US.
+ *   value - the value to record.  Negative values are recorded as 0.
+ */
+void metrics_record(struct metrics_shard* s, int hist, long long value) {
+    assert(s && hist >= 0 && hist < METRICS_HISTOGRAMS);
+    struct metrics_histogram* h = &s->hists[hist];
+    if (value < 0) {
+        value = 0;
+    }
+    _metrics_add(&h->buckets[_metrics_bucket(value)], 1);
+    _metrics_add(&h->count, 1);
+    __atomic_store_n(&h->sum, __atomic_load_n(&h->sum, __ATOMIC_RELAXED) +
+        value, __ATOMIC_RELAXED);
+    if (value > __atomic_load_n(&h->max, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&h->max, value, __ATOMIC_RELAXED);
+    }
+}
+
+/*
+ * Auxilliary function to sum a counter over every shard.  The caller must
+ * hold the lock.
+ */
+long _metrics_total(struct metrics* m, int counter) {
+    long total = 0;
+    for (struct metrics_shard* s = m->shards; s; s = s->next) {
+        total += __atomic_load_n(&s->counters[counter], __ATOMIC_RELAXED);
+    }
+    return total;
+}
+
+/*
+ * Auxilliary function to sum a histogram over every shard into `out`.  The
+ * caller must hold the lock.
+ */
+void _metrics_merge(struct metrics* m, int hist,
+        struct metrics_histogram* out) {
+    memset(out, 0, sizeof(struct metrics_histogram));
+    for (struct metrics_shard* s = m->shards; s; s = s->next) {
+        struct metrics_histogram* h = &s->hists[hist];
+        for (int i = 0; i < METRICS_BUCKETS; i++) {
+            long n = __atomic_load_n(&h->buckets[i], __ATOMIC_RELAXED);
+            out->buckets[i] += n;
+            out->count += n;
+        }
+        out->sum += __atomic_load_n(&h->sum, __ATOMIC_RELAXED);
+        long long max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+        if (max > out->max) {
+            out->max = max;
+        }
+    }
+}
+
+/*
+ * Auxilliary function returning the p-th percentile (0 <= p <= 100) of a
+ * merged histogram, as the highest value in the bucket it falls in (but no
+ * more than the largest value recorded).
+ */
+long long _metrics_histogram_percentile(struct metrics_histogram* h,
+        double p) {
+    if (h->count == 0) {
+        return 0;
+    }
+    long rank = (long)(p / 100.0 * h->count + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    long seen = 0;
+    for (int i = 0; i < METRICS_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            long long high = _metrics_bucket_high(i);
+            return high < h->max ? high : h->max;
+        }
+    }
+    return h->max;
+}
+
+/*
+ * This function returns the total of a counter over every thread.
+ */
+long metrics_total(struct metrics* m, int counter) {
+    assert(m && counter >= 0 && counter < METRICS_COUNTERS);
+    pthread_mutex_lock(&m->lock);
+    long total = _metrics_total(m, counter);
+    pthread_mutex_unlock(&m->lock);
+    return total;
+}
+
+/*
+ * This function returns the p-th percentile (0 <= p <= 100) of the values
+ * recorded in a histogram by every thread, to within the histogram's
+ * precision, or 0 if no values have been recorded.
+ */
+long long metrics_percentile(struct metrics* m, int hist, double p) {
+    assert(m && hist >= 0 && hist < METRICS_HISTOGRAMS);
+    struct metrics_histogram* merged = malloc(sizeof(struct
+        metrics_histogram));
+    assert(merged);
+    pthread_mutex_lock(&m->lock);
+    _metrics_merge(m, hist, merged);
+    pthread_mutex_unlock(&m->lock);
+    long long value = _metrics_histogram_percentile(merged, p);
+    free(merged);
+    return value;
+}
+
+/*
+ * Auxilliary function to work out the rate of each counter over the
+ * interval since the last tick.  The caller must hold the lock.
+ */
+void _metrics_tick(struct metrics* m) {
+    long long now = metrics_now_us();
+    double elapsed = (now - m->last_us) / 1e6;
+    for (int i = 0; i < METRICS_COUNTERS; i++) {
+        long total = _metrics_total(m, i);
+        m->rates[i] = elapsed > 0 ? (total - m->last_totals[i]) / elapsed : 0;
+        m->last_totals[i] = total;
+    }
+    m->last_us = now;
+}
+
+/*
+ * This function writes every metric to a stream in the plain text format
+ * described at the top of this file.
+ *
+ * Params:
+ *   m - the metrics.  May not be NULL.
+ *   out - the stream to write to.  May not be NULL.
+ */
+void metrics_write(struct metrics* m, FILE* out) {
+    assert(m && out);
+    struct metrics_histogram* merged = malloc(sizeof(struct
+        metrics_histogram));
+    assert(merged);
+
+    pthread_mutex_lock(&m->lock);
+    long long now = metrics_now_us();
+    fprintf(out, "time_us %lld\n", now);
+    fprintf(out, "uptime_s %.3f\n", (now - m->start_us) / 1e6);
+    for (int i = 0; i < METRICS_COUNTERS; i++) {
+        fprintf(out, "%s_total %ld\n", metrics_counter_names[i],
+            _metrics_total(m, i));
+    }
+    for (int i = 0; i < METRICS_COUNTERS; i++) {
+        fprintf(out, "%s_per_s %.1f\n", metrics_counter_names[i],
+            m->rates[i]);
+    }
+    for (int i = 0; i < METRICS_HISTOGRAMS; i++) {
+        _metrics_merge(m, i, merged);
+        fprintf(out, "%s count=%ld mean=%.1f p50=%lld p90=%lld p99=%lld"
+            " p99.9=%lld max=%lld\n", metrics_histogram_names[i],
+            merged->count, merged->count ?
+            (double)merged->sum / merged->count : 0.0,
+            _metrics_histogram_percentile(merged, 50),
+            _metrics_histogram_percentile(merged, 90),
+            _metrics_histogram_percentile(merged, 99),
+            _metrics_histogram_percentile(merged, 99.9), merged->max);
+    }
+    pthread_mutex_unlock(&m->lock);
+    free(merged);
+}
+
+/*
+ * Auxilliary function to replace the dump file with the current metrics.
+ * The metrics are written to a temporary file that's renamed over the dump
+ * file, so readers never see a partial dump.
+ */
+void _metrics_dump_file(struct metrics* m) {
+    char* tmp = malloc(strlen(m->path) + 5);
+    sprintf(tmp, "%s.tmp", m->path);
+    FILE* out = fopen(tmp, "w");
+    if (!out) {
+        perror(tmp);
+    } else {
+        metrics_write(m, out);
+        if (fclose(out) != 0 || rename(tmp, m->path) != 0) {
+            perror(m->path);
+            unlink(tmp);
+        }
+    }
+    free(tmp);
+}
+
+/*
+ * Auxilliary function to send the current metrics to one client of the
+ * dump socket, then hang up.
+ */
+void _metrics_dump_client(struct metrics* m, int fd) {
+    char* text;
+    size_t len;
+    FILE* out = open_memstream(&text, &len);
+    if (out) {
+        metrics_write(m, out);
+        fclose(out);
+        for (size_t off = 0; off < len; ) {
+            ssize_t n = write(fd, text + off, len - off);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            off += n;
+        }
+        free(text);
+    }
+    close(fd);
+}
+
+/*
+ * Dump thread: ticks every interval, dumping the metrics to the file (if
+ * dumping to a file), and serves any clients of the socket in between (if
+ * dumping to a socket), until it's told to stop through the stop pipe.
+ */
+void* _metrics_dumper(void* arg) {
+    struct metrics* m = arg;
+    long long next_tick = metrics_now_us() + m->interval_ms * 1000LL;
+
+    while (1) {
+        struct pollfd fds[2] = {
+            { m->stop_pipe[0], POLLIN, 0 },
+            { m->listen_fd, POLLIN, 0 }
+        };
+        long long wait_ms = (next_tick - metrics_now_us()) / 1000;
+        int ready = poll(fds, m->listen_fd >= 0 ? 2 : 1,
+            wait_ms > 0 ? (int)wait_ms : 0);
+        if (ready < 0 && errno != EINTR) {
+            perror("poll");
+            break;
+        }
+        if (ready > 0 && fds[0].revents) {
+            break;
+        }
+        if (ready > 0 && fds[1].revents) {
+            int fd = accept(m->listen_fd, NULL, NULL);
+            if (fd >= 0) {
+                _metrics_dump_client(m, fd);
+            }
+        }
+        if (metrics_now_us() >= next_tick) {
+            pthread_mutex_lock(&m->lock);
+            _metrics_tick(m);
+            pthread_mutex_unlock(&m->lock);
+            if (m->listen_fd < 0) {
+                _metrics_dump_file(m);
+            }
+            next_tick += m->interval_ms * 1000LL;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * This function starts a thread that dumps a set of metrics every interval.
+ *
+ * Params:
+ *   m - the metrics.  May not be NULL, and mustn't already be dumping.
+ *   path - a file to replace with the current metrics every interval, or
+ *     "unix:" followed by the path of a Unix domain socket to create, which
+ *     sends the current metrics to every client that connects and then
+ *     hangs up.  An existing socket at that path is replaced.
+ *   interval_ms - the dump interval in milliseconds, which is also the
+ *     interval over which rates are worked out.  Must be positive.
+ *
+ * Return:
+ *   This function returns 0 on success or -1 if the socket couldn't be set
+ *   up.
+ */
+int metrics_start(struct metrics* m, const char* path, int interval_ms) {
+    assert(m && path && !m->running);
+    assert(interval_ms > 0);
+
+    size_t prefix = strlen(METRICS_SOCKET_PREFIX);
+    if (strncmp(path, METRICS_SOCKET_PREFIX, prefix) == 0) {
+        struct sockaddr_un addr;
+        path += prefix;
+        if (strlen(path) >= sizeof(addr.sun_path)) {
+            fprintf(stderr, "%s: socket path too long\n", path);
+            return -1;
+        }
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, path);
+
+        m->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(path);
+        if (m->listen_fd < 0 || bind(m->listen_fd, (struct sockaddr*)&addr,
+                sizeof(addr)) < 0 || listen(m->listen_fd, 16) < 0) {
+            perror(path);
+            if (m->listen_fd >= 0) {
+                close(m->listen_fd);
+            }
+            m->listen_fd = -1;
+            return -1;
+        }
+    }
+
+    m->path = malloc(strlen(path) + 1);
+    strcpy(m->path, path);
+    m->interval_ms = interval_ms;
+    int err = pipe(m->stop_pipe);
+    assert(err == 0);
+    (void)err;
+
+    pthread_mutex_lock(&m->lock);
+    m->last_us = metrics_now_us();
+    for (int i = 0; i < METRICS_COUNTERS; i++) {
+        m->last_totals[i] = _metrics_total(m, i);
+    }
+    pthread_mutex_unlock(&m->lock);
+
+    m->running = 1;
+    pthread_create(&m->dumper, NULL, _metrics_dumper, m);
+    return 0;
+}
+
+/*
+ * This function stops a set of metrics' dump thread, if it's running.  When
+ * dumping to a file, the metrics are dumped one last time first, so the file
+ * ends up with the final totals; when dumping to a socket, the socket is
+ * removed.
+ *
+ * Params:
+ *   m - the metrics.  May not be NULL.
+ */
+void metrics_stop(struct metrics* m) {
+    assert(m);
+    if (!m->running) {
+        return;
+    }
+    char stop = 1;
+    ssize_t n = write(m->stop_pipe[1], &stop, 1);
+    (void)n;
+    pthread_join(m->dumper, NULL);
+    close(m->stop_pipe[0]);
+    close(m->stop_pipe[1]);
+
+    pthread_mutex_lock(&m->lock);
+    _metrics_tick(m);
+    pthread_mutex_unlock(&m->lock);
+    if (m->listen_fd >= 0) {
+        close(m->listen_fd);
+        unlink(m->path);
+        m->listen_fd = -1;
+    } else {
+        _metrics_dump_file(m);
+    }
+    free(m->path);
+    m->path = NULL;
+    m->running = 0;
+}
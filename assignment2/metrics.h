@@ -0,0 +1,55 @@
+/*
+ * This file contains the definition of the interface for the call center's
+ * live metrics: counters of calls received, answered and cancelled, and
+ * latency and depth histograms, which are periodically dumped as plain text.
+ * You can find descriptions of the metrics functions, including their
+ * parameters and their return values, in metrics.c.
+ */
+
+#ifndef __METRICS_H
+#define __METRICS_H
+
+#include <stdio.h>
+
+/*
+ * Counters, for use with metrics_count().
+ */
+#define METRICS_RECEIVED 0
+#define METRICS_ANSWERED 1
+#define METRICS_CANCELLED 2
+#define METRICS_COUNTERS 3
+
+/*
+ * Histograms, for use with metrics_record(): the time from a call being
+ * received to it being answered, in microseconds, and the number of calls
+ * waiting in the queue and held in the answered-call history.
+ */
+#define METRICS_WAIT_US 0
+#define METRICS_QUEUE_DEPTH 1
+#define METRICS_HISTORY_DEPTH 2
+#define METRICS_HISTOGRAMS 3
+
+/*
+ * Structure used to represent a set of metrics, and one thread's share of
+ * them.
+ */
+struct metrics;
+struct metrics_shard;
+
+/*
+ * Metrics interface function prototypes.  Refer to metrics.c for
+ * documentation about each of these functions.
+ */
+struct metrics* metrics_create();
+void metrics_free(struct metrics* m);
+struct metrics_shard* metrics_shard_create(struct metrics* m);
+long long metrics_now_us();
+void metrics_count(struct metrics_shard* s, int counter, long n);
+void metrics_record(struct metrics_shard* s, int hist, long long value);
+long metrics_total(struct metrics* m, int counter);
+long long metrics_percentile(struct metrics* m, int hist, double p);
+void metrics_write(struct metrics* m, FILE* out);
+int metrics_start(struct metrics* m, const char* path, int interval_ms);
+void metrics_stop(struct metrics* m);
+
+#endif
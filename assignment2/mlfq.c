@@ -0,0 +1,266 @@
+/*
+ * This file contains an implementation of a multi-level feedback queue for
+ * scheduling waiting calls.  Each call waits in one of several FIFO levels,
+ * level 0 being served first; the caller picks a call's starting level, e.g.
+ * from how long a call of its kind usually takes, so that short, simple
+ * calls aren't stuck behind long ones.  To keep the lower levels from
+ * starving, a call that has waited `age` ticks in a level is promoted to the
+ * back of the level above, and so on up to level 0, which bounds how long
+ * any call can be passed over.  See the documentation below for more
+ * information on the individual functions in this implementation.
+ *
+ * Each level is a queue from queue.c holding the calls in the order they
+ * reached that level, so the calls due for promotion are always at the
+ * front.  A bitmap has a bit set for each non-empty level, so the next call
+ * is found in O(1) with a count-trailing-zeros, however many levels there
+ * are, and aging only looks at the non-empty levels.  Each queued call is
+ * paired with the time it reached its level in a small node; nodes are
+ * carved out of slabs and recycled through a free list, so steady-state
+ * operation doesn't allocate beyond what queue.c does.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "mlfq.h"
+#include "queue.h"
+
+#define MLFQ_SLAB 1024
+
+/*
+ * A queued value, with the time it reached its current level.  `next`
+ * links free nodes.
+ */
+struct mlfq_node {
+  void* val;
+  long long since;
+  struct mlfq_node* next;
+};
+
+/*
+ * Node slabs are chained together so they can all be freed at once.
+ */
+struct mlfq_slab {
+  struct mlfq_slab* next;
+  struct mlfq_node nodes[MLFQ_SLAB];
+};
+
+/*
+ * This is the structure that represents a multi-level feedback queue.  Bit
+ * i of `nonempty` is set if level i has any values in it.
+ */
+struct mlfq {
+  struct queue* levels[MLFQ_MAX_LEVELS];
+  int n_levels;
+  long long age;
+  uint64_t nonempty;
+  int size;
+  long promotions;
+  struct mlfq_node* free_list;
+  struct mlfq_slab* slabs;
+};
+
+/*
+ * Auxilliary function to take a node from the free list, carving out a new
+ * slab if the list is empty.
+ */
+struct mlfq_node* _mlfq_node_alloc(struct mlfq* q) {
+  struct mlfq_node* node = q->free_list;
+  if (!node) {
+    struct mlfq_slab* slab = malloc(sizeof(struct mlfq_slab));
+    assert(slab);
+    slab->next = q->slabs;
+    q->slabs = slab;
+    for (int i = MLFQ_SLAB - 1; i > 0; i--) {
+      slab->nodes[i].next = q->free_list;
+      q->free_list = &slab->nodes[i];
+    }
+    node = &slab->nodes[0];
+  } else {
+    q->free_list = node->next;
+  }
+  return node;
+}
+
+/*
+ * Auxilliary function to append a node to a level.
+ */
+void _mlfq_push(struct mlfq* q, int level, struct mlfq_node* node) {
+  queue_enqueue(q->levels[level], node);
+  q->nonempty |= 1ULL << level;
+}
+
+/*
+ * Auxilliary function to remove the node at the front of a non-empty level.
+ */
+struct mlfq_node* _mlfq_pop(struct mlfq* q, int level) {
+  struct mlfq_node* node = queue_dequeue(q->levels[level]);
+  if (queue_isempty(q->levels[level])) {
+    q->nonempty &= ~(1ULL << level);
+  }
+  return node;
+}
+
+/*
+ * This function allocates and initializes a new, empty multi-level feedback
+ * queue and returns a pointer to it.
+ *
+ * Params:
+ *   levels - the number of levels, from 1 to MLFQ_MAX_LEVELS.
+ *   age - how long, in ticks, a value may wait in a level before it's
+ *     promoted to the level above, or 0 to never promote values.
+ */
+struct mlfq* mlfq_create(int levels, long long age) {
+  assert(levels >= 1 && levels <= MLFQ_MAX_LEVELS && age >= 0);
+  struct mlfq* q = malloc(sizeof(struct mlfq));
+  assert(q);
+  for (int i = 0; i < levels; i++) {
+    q->levels[i] = queue_create();
+  }
+  q->n_levels = levels;
+  q->age = age;
+  q->nonempty = 0;
+  q->size = 0;
+  q->promotions = 0;
+  q->free_list = NULL;
+  q->slabs = NULL;
+  return q;
+}
+
+/*
+ * This function frees the memory associated with a multi-level feedback
+ * queue.  Freeing any memory associated with values still stored in the
+ * queue is the responsibility of the caller.
+ *
+ * Params:
+ *   q - the queue to be destroyed.  May not be NULL.
+ */
+void mlfq_free(struct mlfq* q) {
+  assert(q);
+  for (int i = 0; i < q->n_levels; i++) {
+    queue_free(q->levels[i]);
+  }
+  struct mlfq_slab* next, * slab = q->slabs;
+  while (slab) {
+    next = slab->next;
+    free(slab);
+    slab = next;
+  }
+  free(q);
+}
+
+/*
+ * This function returns 1 if a multi-level feedback queue is empty or 0
+ * otherwise.
+ */
+int mlfq_isempty(struct mlfq* q) {
+  assert(q);
+  return q->nonempty == 0;
+}
+
+/*
+ * This function returns the number of values in a multi-level feedback
+ * queue.
+ */
+int mlfq_size(struct mlfq* q) {
+  assert(q);
+  return q->size;
+}
+
+/*
+ * This function returns the number of values in one level of a multi-level
+ * feedback queue.
+ */
+int mlfq_level_size(struct mlfq* q, int level) {
+  assert(q && level >= 0 && level < q->n_levels);
+  return queue_size(q->levels[level]);
+}
+
+/*
+ * This function returns the number of times a value has been promoted.
+ */
+long mlfq_promotions(struct mlfq* q) {
+  assert(q);
+  return q->promotions;
+}
+
+/*
+ * This function adds a value to the back of a level of a multi-level
+ * feedback queue.
+ *
+ * Params:
+ *   q - the queue into which to enqueue.  May not be NULL.
+ *   val - the value to be enqueued.
+ *   level - the level to add it to, from 0 (served first) to the number of
+ *     levels minus one.
+ *   now - the current time in ticks.  Times passed to a queue may never go
+ *     backwards.
+ */
+void mlfq_enqueue(struct mlfq* q, void* val, int level, long long now) {
+  assert(q && level >= 0 && level < q->n_levels);
+  struct mlfq_node* node = _mlfq_node_alloc(q);
+  node->val = val;
+  node->since = now;
+  _mlfq_push(q, level, node);
+  q->size++;
+}
+
+/*
+ * This function promotes every value that has waited `age` ticks in its
+ * level to the back of the level above.  A promoted value then waits
+ * another `age` ticks before it's promoted again.  mlfq_dequeue() calls this
+ * itself, so it only needs to be called to see the levels up to date.
+ *
+ * Params:
+ *   q - the queue.  May not be NULL.
+ *   now - the current time in ticks.
+ *
+ * Return:
+ *   This function returns the number of values promoted.
+ */
+int mlfq_age(struct mlfq* q, long long now) {
+  assert(q);
+  if (q->age == 0) {
+    return 0;
+  }
+  int promoted = 0;
+  uint64_t levels = q->nonempty & ~1ULL;
+  while (levels) {
+    int level = __builtin_ctzll(levels);
+    levels &= levels - 1;
+    struct queue* fifo = q->levels[level];
+    while (!queue_isempty(fifo) &&
+        ((struct mlfq_node*)queue_front(fifo))->since + q->age <= now) {
+      struct mlfq_node* node = _mlfq_pop(q, level);
+      node->since = now;
+      _mlfq_push(q, level - 1, node);
+      promoted++;
+    }
+  }
+  q->promotions += promoted;
+  return promoted;
+}
+
+/*
+ * This function ages a multi-level feedback queue (see mlfq_age()), then
+ * removes and returns the value at the front of the first non-empty level.
+ *
+ * Params:
+ *   q - the queue from which to dequeue.  May not be NULL, and may not be
+ *     empty.
+ *   now - the current time in ticks.
+ *
+ * Return:
+ *   This function returns the value that was dequeued.
+ */
+void* mlfq_dequeue(struct mlfq* q, long long now) {
+  assert(q && q->nonempty);
+  mlfq_age(q, now);
+  struct mlfq_node* node = _mlfq_pop(q, __builtin_ctzll(q->nonempty));
+  void* val = node->val;
+  node->next = q->free_list;
+  q->free_list = node;
+  q->size--;
+  return val;
+}
@@ -0,0 +1,36 @@
+/*
+ * This file contains the definition of the interface for a multi-level
+ * feedback queue, which hands out waiting calls by priority level while
+ * promoting those that have waited long.  You can find descriptions of the
+ * multi-level feedback queue functions, including their parameters and
+ * their return values, in mlfq.c.
+ */
+
+#ifndef __MLFQ_H
+#define __MLFQ_H
+
+/*
+ * The most levels a multi-level feedback queue can have.
+ */
+#define MLFQ_MAX_LEVELS 64
+
+/*
+ * Structure used to represent a multi-level feedback queue.
+ */
+struct mlfq;
+
+/*
+ * Multi-level feedback queue interface function prototypes.  Refer to
+ * mlfq.c for documentation about each of these functions.
+ */
+struct mlfq* mlfq_create(int levels, long long age);
+void mlfq_free(struct mlfq* q);
+int mlfq_isempty(struct mlfq* q);
+int mlfq_size(struct mlfq* q);
+int mlfq_level_size(struct mlfq* q, int level);
+long mlfq_promotions(struct mlfq* q);
+void mlfq_enqueue(struct mlfq* q, void* val, int level, long long now);
+int mlfq_age(struct mlfq* q, long long now);
+void* mlfq_dequeue(struct mlfq* q, long long now);
+
+#endif
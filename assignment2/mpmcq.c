@@ -0,0 +1,202 @@
+/*
+ * This file contains an implementation of a bounded, lock-free ring queue
+ * that any number of producer and consumer threads may use at once.  See the
+ * documentation below for more information on the individual functions in
+ * this implementation.
+ *
+ * Every slot carries a sequence number alongside its value.  A slot at
+ * position `pos` is ready to be written when its sequence equals `pos`, and
+ * ready to be read when its sequence equals `pos + 1`.  A producer claims a
+ * position by advancing `tail` with a compare-and-swap, writes the value and
+ * then publishes it by storing `pos + 1` into the slot's sequence; a consumer
+ * claims a position by advancing `head`, reads the value and then recycles
+ * the slot for the next lap by storing `pos + capacity`.  Contention is thus
+ * limited to one CAS on the shared index per operation, and producers and
+ * consumers only meet on the individual slots they hand off.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include <sched.h>
+
+#include "mpmcq.h"
+
+#define MPMCQ_CACHE_LINE 64
+
+/*
+ * This structure is used to represent a single slot in the ring.
+ */
+struct mpmcq_slot {
+  uint64_t seq;
+  void* val;
+};
+
+/*
+ * This is the structure that represents an MPMC ring queue.  The consumer and
+ * producer indices are kept on separate cache lines.
+ */
+struct mpmcq {
+  uint64_t head;
+  char pad0[MPMCQ_CACHE_LINE - sizeof(uint64_t)];
+  uint64_t tail;
+  char pad1[MPMCQ_CACHE_LINE - sizeof(uint64_t)];
+  uint64_t mask;
+  struct mpmcq_slot* slots;
+};
+
+/*
+ * This function allocates and initializes a new, empty MPMC ring queue and
+ * returns a pointer to it.
+ *
+ * Params:
+ *   capacity - the minimum number of values the queue must be able to hold.
+ *     It is rounded up to the next power of two.  Must be at least 2.
+ */
+struct mpmcq* mpmcq_create(int capacity) {
+  assert(capacity > 1);
+
+  uint64_t size = 1;
+  while (size < (uint64_t)capacity) {
+    size <<= 1;
+  }
+
+  struct mpmcq* queue;
+  int err = posix_memalign((void**)&queue, MPMCQ_CACHE_LINE,
+    sizeof(struct mpmcq));
+  assert(err == 0);
+  queue->head = queue->tail = 0;
+  queue->mask = size - 1;
+  queue->slots = malloc(size * sizeof(struct mpmcq_slot));
+  assert(queue->slots);
+  for (uint64_t i = 0; i < size; i++) {
+    queue->slots[i].seq = i;
+    queue->slots[i].val = NULL;
+  }
+  return queue;
+}
+
+/*
+ * This function frees the memory associated with an MPMC ring queue.  It must
+ * not be called while any other thread is still using the queue.  Freeing any
+ * memory associated with values still stored in the queue is the
+ * responsibility of the caller.
+ *
+ * Params:
+ *   queue - the queue to be destroyed.  May not be NULL.
+ */
+void mpmcq_free(struct mpmcq* queue) {
+  assert(queue);
+  free(queue->slots);
+  free(queue);
+}
+
+/*
+ * This function attempts to enqueue a value without waiting.  It may be
+ * called from any number of threads at once.
+ *
+ * Params:
+ *   queue - the queue into which to enqueue.  May not be NULL.
+ *   val - the value to be enqueued.
+ *
+ * Return:
+ *   This function returns 1 if the value was enqueued or 0 if the queue was
+ *   full.
+ */
+int mpmcq_try_enqueue(struct mpmcq* queue, void* val) {
+  uint64_t pos = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+  while (1) {
+    struct mpmcq_slot* slot = &queue->slots[pos & queue->mask];
+    uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    int64_t diff = (int64_t)(seq - pos);
+    if (diff == 0) {
+      /*
+       * The slot is free for this lap; try to claim the position.  On
+       * failure `pos` is reloaded with the current tail.
+       */
+      if (__atomic_compare_exchange_n(&queue->tail, &pos, pos + 1, 1,
+          __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        slot->val = val;
+        __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+        return 1;
+      }
+    } else if (diff < 0) {
+      /*
+       * The slot still holds a value from the previous lap: the queue is
+       * full.
+       */
+      return 0;
+    } else {
+      pos = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+/*
+ * This function attempts to dequeue a value without waiting.  It may be
+ * called from any number of threads at once.
+ *
+ * Params:
+ *   queue - the queue from which to dequeue.  May not be NULL.
+ *
+ * Return:
+ *   This function returns the value that was dequeued, or NULL if the queue
+ *   was empty.  Because of this, NULL values should not be enqueued.
+ */
+void* mpmcq_try_dequeue(struct mpmcq* queue) {
+  uint64_t pos = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+  while (1) {
+    struct mpmcq_slot* slot = &queue->slots[pos & queue->mask];
+    uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    int64_t diff = (int64_t)(seq - (pos + 1));
+    if (diff == 0) {
+      if (__atomic_compare_exchange_n(&queue->head, &pos, pos + 1, 1,
+          __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        void* val = slot->val;
+        __atomic_store_n(&slot->seq, pos + queue->mask + 1, __ATOMIC_RELEASE);
+        return val;
+      }
+    } else if (diff < 0) {
+      /*
+       * No producer has published this position yet: the queue is empty.
+       */
+      return NULL;
+    } else {
+      pos = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+/*
+ * This function enqueues a value, yielding the processor while the queue is
+ * full.
+ *
+ * Params:
+ *   queue - the queue into which to enqueue.  May not be NULL.
+ *   val - the value to be enqueued.
+ */
+void mpmcq_enqueue(struct mpmcq* queue, void* val) {
+  while (!mpmcq_try_enqueue(queue, val)) {
+    sched_yield();
+  }
+}
+
+/*
+ * This function dequeues a value, yielding the processor while the queue is
+ * empty.
+ *
+ * Params:
+ *   queue - the queue from which to dequeue.  May not be NULL.
+ *
+ * Return:
+ *   This function returns the value that was dequeued.
+ */
+void* mpmcq_dequeue(struct mpmcq* queue) {
+  void* val;
+  while ((val = mpmcq_try_dequeue(queue)) == NULL) {
+    sched_yield();
+  }
+  return val;
+}
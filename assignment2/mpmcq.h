@@ -0,0 +1,27 @@
+/*
+ * This file contains the definition of the interface for a bounded, lock-free
+ * multi-producer/multi-consumer ring queue.  You can find descriptions of
+ * the MPMC queue functions, including their parameters and their return
+ * values, in mpmcq.c.
+ */
+
+#ifndef __MPMCQ_H
+#define __MPMCQ_H
+
+/*
+ * Structure used to represent an MPMC ring queue.
+ */
+struct mpmcq;
+
+/*
+ * MPMC ring queue interface function prototypes.  Refer to mpmcq.c for
+ * documentation about each of these functions.
+ */
+struct mpmcq* mpmcq_create(int capacity);
+void mpmcq_free(struct mpmcq* queue);
+int mpmcq_try_enqueue(struct mpmcq* queue, void* val);
+void* mpmcq_try_dequeue(struct mpmcq* queue);
+void mpmcq_enqueue(struct mpmcq* queue, void* val);
+void* mpmcq_dequeue(struct mpmcq* queue);
+
+#endif
@@ -0,0 +1,226 @@
+/*
+ * This file contains an implementation of a priority queue as a binary
+ * min-heap.  LOWER priority values are assigned to elements with HIGHER
+ * priority, and elements with equal priority values come out in the order
+ * they were inserted.  See the documentation below for more information on
+ * the individual functions in this implementation.
+ *
+ * The heap nodes are stored by value in one array rather than as pointers to
+ * separately allocated nodes, so an insertion doesn't allocate (beyond the
+ * occasional doubling of the array) and sifting touches contiguous memory.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "pq.h"
+
+#define PQ_INIT_CAPACITY 16
+
+/*
+ * A single element of the heap.  `seq` is the element's insertion number,
+ * used to break ties between equal priority values.
+ */
+struct pq_node {
+  void* value;
+  int priority;
+  unsigned int seq;
+};
+
+/*
+ * This is the structure that represents a priority queue.
+ */
+struct pq {
+  struct pq_node* nodes;
+  int size;
+  int capacity;
+  unsigned int next_seq;
+};
+
+/*
+ * This function allocates and initializes an empty priority queue and
+ * returns a pointer to it.
+ */
+struct pq* pq_create() {
+  struct pq* pq = malloc(sizeof(struct pq));
+  assert(pq);
+  pq->nodes = malloc(PQ_INIT_CAPACITY * sizeof(struct pq_node));
+  assert(pq->nodes);
+  pq->size = 0;
+  pq->capacity = PQ_INIT_CAPACITY;
+  pq->next_seq = 0;
+  return pq;
+}
+
+/*
+ * This function frees the memory allocated to a given priority queue.  Note
+ * that this function DOES NOT free the individual elements stored in the
+ * priority queue.  That is the responsibility of the caller.
+ *
+ * Params:
+ *   pq - the priority queue to be destroyed.  May not be NULL.
+ */
+void pq_free(struct pq* pq) {
+  assert(pq);
+  free(pq->nodes);
+  free(pq);
+}
+
+/*
+ * This function returns 1 if the specified priority queue is empty and 0
+ * otherwise.
+ *
+ * Params:
+ *   pq - the priority queue whose emptiness is to be checked.  May not be
+ *     NULL.
+ */
+int pq_isempty(struct pq* pq) {
+  assert(pq);
+  return pq->size == 0;
+}
+
+/*
+ * This function returns the number of elements in a priority queue.
+ *
+ * Params:
+ *   pq - the priority queue whose size is being queried.  May not be NULL.
+ */
+int pq_size(struct pq* pq) {
+  assert(pq);
+  return pq->size;
+}
+
+/*
+ * Auxilliary function that returns 1 if node `a` should come out of the heap
+ * before node `b` and 0 otherwise.  Sequence numbers are compared by their
+ * signed difference so that they keep working after wrapping around.
+ */
+int _pq_before(struct pq_node* a, struct pq_node* b) {
+  if (a->priority != b->priority) {
+    return a->priority < b->priority;
+  }
+  return (int)(a->seq - b->seq) < 0;
+}
+
+/*
+ * Auxilliary function to move the node at `idx` up the heap until its parent
+ * comes before it.
+ */
+void _pq_sift_up(struct pq* pq, int idx) {
+  struct pq_node node = pq->nodes[idx];
+  while (idx > 0) {
+    int parent = (idx - 1) / 2;
+    if (!_pq_before(&node, &pq->nodes[parent])) {
+      break;
+    }
+    pq->nodes[idx] = pq->nodes[parent];
+    idx = parent;
+  }
+  pq->nodes[idx] = node;
+}
+
+/*
+ * Auxilliary function to move the node at `idx` down the heap until it comes
+ * before both of its children.
+ */
+void _pq_sift_down(struct pq* pq, int idx) {
+  struct pq_node node = pq->nodes[idx];
+  while (1) {
+    int child = 2 * idx + 1;
+    if (child >= pq->size) {
+      break;
+    }
+    if (child + 1 < pq->size &&
+        _pq_before(&pq->nodes[child + 1], &pq->nodes[child])) {
+      child++;
+    }
+    if (!_pq_before(&pq->nodes[child], &node)) {
+      break;
+    }
+    pq->nodes[idx] = pq->nodes[child];
+    idx = child;
+  }
+  pq->nodes[idx] = node;
+}
+
+/*
+ * This function inserts a given element into a priority queue with a
+ * specified priority value.  This is O(log n).
+ *
+ * Params:
+ *   pq - the priority queue into which to insert an element.  May not be
+ *     NULL.
+ *   value - the value to be inserted into pq.
+ *   priority - the priority value to be assigned to the newly-inserted
+ *     element.  LOWER priority values correspond to elements with HIGHER
+ *     priority.
+ */
+void pq_insert(struct pq* pq, void* value, int priority) {
+  assert(pq);
+  if (pq->size == pq->capacity) {
+    pq->capacity *= 2;
+    pq->nodes = realloc(pq->nodes, pq->capacity * sizeof(struct pq_node));
+    assert(pq->nodes);
+  }
+  struct pq_node* node = &pq->nodes[pq->size];
+  node->value = value;
+  node->priority = priority;
+  node->seq = pq->next_seq++;
+  pq->size++;
+  _pq_sift_up(pq, pq->size - 1);
+}
+
+/*
+ * This function returns the value of the first item in a priority queue,
+ * i.e. the item with LOWEST priority value.
+ *
+ * Params:
+ *   pq - the priority queue from which to fetch a value.  May not be NULL.
+ *
+ * Return:
+ *   This function returns the value of the first item in pq, or NULL if pq
+ *   is empty.
+ */
+void* pq_first(struct pq* pq) {
+  assert(pq);
+  return pq->size > 0 ? pq->nodes[0].value : NULL;
+}
+
+/*
+ * This function returns the priority value of the first item in a priority
+ * queue, i.e. the item with LOWEST priority value.
+ *
+ * Params:
+ *   pq - the priority queue from which to fetch a priority value.  May not
+ *     be NULL or empty.
+ */
+int pq_first_priority(struct pq* pq) {
+  assert(pq && pq->size > 0);
+  return pq->nodes[0].priority;
+}
+
+/*
+ * This function returns the value of the first item in a priority queue,
+ * i.e. the item with LOWEST priority value, and then removes that item from
+ * the queue.  This is O(log n).
+ *
+ * Params:
+ *   pq - the priority queue from which to remove a value.  May not be NULL.
+ *
+ * Return:
+ *   This function returns the value of the first item in pq, or NULL if pq
+ *   is empty.
+ */
+void* pq_remove_first(struct pq* pq) {
+  assert(pq);
+  if (pq->size == 0) {
+    return NULL;
+  }
+  void* value = pq->nodes[0].value;
+  pq->size--;
+  if (pq->size > 0) {
+    pq->nodes[0] = pq->nodes[pq->size];
+    _pq_sift_down(pq, 0);
+  }
+  return value;
+}
@@ -0,0 +1,116 @@
+/*
+ * This file contains an implementation of a parallel merge sort on top of
+ * the work-stealing thread pool in wspool.c.  The array is split in half
+ * recursively; one half is spawned as a task while the calling task sorts
+ * the other, and once both are sorted they're merged through a scratch
+ * buffer.  Pieces of PSORT_CUTOFF elements or fewer are sorted with qsort().
+ *
+ * The merges themselves are sequential, so the final merge of the whole
+ * array bounds the speedup; on a handful of cores that's a small part of
+ * the total.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "psort.h"
+
+#define PSORT_CUTOFF 4096
+
+/*
+ * One piece of the array to be sorted, with the matching piece of the
+ * scratch buffer.
+ */
+struct psort_job {
+  char* base;
+  char* tmp;
+  size_t n;
+  size_t size;
+  int (*cmp)(const void*, const void*);
+};
+
+/*
+ * Auxilliary function to merge the two sorted halves of a piece, the first
+ * `half` elements and the rest, back into the piece.
+ */
+void _psort_merge(struct psort_job* j, size_t half) {
+  char* left = j->base, * left_end = j->base + half * j->size;
+  char* right = left_end, * right_end = j->base + j->n * j->size;
+  char* out = j->tmp;
+
+  /*
+   * Nothing to do if the halves are already in order.
+   */
+  if (j->cmp(left_end - j->size, right) <= 0) {
+    return;
+  }
+  while (left < left_end && right < right_end) {
+    if (j->cmp(right, left) < 0) {
+      memcpy(out, right, j->size);
+      right += j->size;
+    } else {
+      memcpy(out, left, j->size);
+      left += j->size;
+    }
+    out += j->size;
+  }
+  memcpy(out, left, left_end - left);
+  out += left_end - left;
+  memcpy(j->base, j->tmp, out - j->tmp);
+}
+
+/*
+ * Auxilliary task to sort one piece of the array.
+ */
+void _psort_task(struct wspool* pool, void* arg) {
+  struct psort_job* j = arg;
+  if (j->n <= PSORT_CUTOFF) {
+    qsort(j->base, j->n, j->size, j->cmp);
+    return;
+  }
+
+  size_t half = j->n / 2;
+  struct psort_job left = *j, right = *j;
+  left.n = half;
+  right.base += half * j->size;
+  right.tmp += half * j->size;
+  right.n -= half;
+  wspool_spawn(pool, _psort_task, &left);
+  _psort_task(pool, &right);
+  wspool_sync(pool);
+  _psort_merge(j, half);
+}
+
+/*
+ * This function sorts an array in parallel on a thread pool, in the same
+ * way as qsort().  Like qsort(), the sort isn't stable.  It may not be
+ * called from a task running on the pool.
+ *
+ * Params:
+ *   pool - the thread pool to sort on.  May not be NULL.
+ *   base - the array to be sorted.
+ *   n - the number of elements in the array.
+ *   size - the size of each element, in bytes.
+ *   cmp - a function comparing two elements, returning a negative number,
+ *     zero or a positive number if the first is less than, equal to or
+ *     greater than the second.
+ */
+void psort(struct wspool* pool, void* base, size_t n, size_t size,
+    int (*cmp)(const void*, const void*)) {
+  assert(pool && cmp && size > 0);
+  if (n <= PSORT_CUTOFF) {
+    qsort(base, n, size, cmp);
+    return;
+  }
+
+  struct psort_job j;
+  j.base = base;
+  j.tmp = malloc(n * size);
+  assert(j.tmp);
+  j.n = n;
+  j.size = size;
+  j.cmp = cmp;
+  wspool_run(pool, _psort_task, &j);
+  free(j.tmp);
+}
@@ -0,0 +1,20 @@
+/*
+ * This file contains the definition of the interface for a parallel sort,
+ * which sorts an array on a work-stealing thread pool.  You can find a
+ * description of the function, including its parameters, in psort.c.
+ */
+
+#ifndef __PSORT_H
+#define __PSORT_H
+
+#include <stddef.h>
+
+#include "wspool.h"
+
+/*
+ * Parallel sort function prototype.  Refer to psort.c for documentation.
+ */
+void psort(struct wspool* pool, void* base, size_t n, size_t size,
+  int (*cmp)(const void*, const void*));
+
+#endif
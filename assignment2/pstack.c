@@ -0,0 +1,194 @@
+/*
+ * This file contains an implementation of a persistent stack.  The stack is
+ * an immutable singly-linked "cons" list: pushing creates a new node that
+ * points at the old top, and popping just moves a handle's top pointer down
+ * one node.  Because nodes are never modified after they're created, any
+ * number of handles can share a common tail, and taking a snapshot is simply
+ * a matter of creating another handle to the same top node.  See the
+ * documentation below for more information on the individual functions in
+ * this implementation.
+ *
+ * Nodes are reference-counted.  Each handle owns one reference to its top
+ * node and each node owns one reference to the node below it, so a node is
+ * freed exactly when no handle can reach it anymore.  The counts are updated
+ * atomically, so different handles (e.g. a live stack and a snapshot given to
+ * an auditing thread) may be used from different threads; a single handle
+ * must still not be used by two threads at once.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "pstack.h"
+
+/*
+ * This structure is used to represent a single node shared between versions.
+ */
+struct pnode {
+  void* val;
+  struct pnode* next;
+  int refs;
+  int depth;
+};
+
+/*
+ * This structure is used to represent one version of a persistent stack.
+ */
+struct pstack {
+  struct pnode* top;
+};
+
+/*
+ * Auxilliary functions to take and drop a reference to a node.  Dropping the
+ * last reference frees the node and drops its reference to the node below,
+ * which may in turn free that node, and so on.  This is done iteratively so
+ * that releasing a long, unshared history can't overflow the call stack.
+ */
+void _pnode_incref(struct pnode* node) {
+  if (node) {
+    __atomic_fetch_add(&node->refs, 1, __ATOMIC_RELAXED);
+  }
+}
+
+void _pnode_decref(struct pnode* node) {
+  while (node && __atomic_sub_fetch(&node->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+    struct pnode* next = node->next;
+    free(node);
+    node = next;
+  }
+}
+
+/*
+ * This function allocates and initializes a new, empty persistent stack and
+ * returns a pointer to it.
+ */
+struct pstack* pstack_create() {
+  struct pstack* stack = malloc(sizeof(struct pstack));
+  assert(stack);
+  stack->top = NULL;
+  return stack;
+}
+
+/*
+ * This function frees a single version of a persistent stack.  Nodes still
+ * shared with other versions are left intact.  Freeing any memory associated
+ * with the values stored in the stack is the responsibility of the caller.
+ *
+ * Params:
+ *   stack - the stack version to be destroyed.  May not be NULL.
+ */
+void pstack_free(struct pstack* stack) {
+  assert(stack);
+  _pnode_decref(stack->top);
+  free(stack);
+}
+
+/*
+ * This function returns 1 if a given version of a persistent stack is empty
+ * and 0 otherwise.
+ *
+ * Params:
+ *   stack - the stack whose emptiness is being questioned.  May not be NULL.
+ */
+int pstack_isempty(struct pstack* stack) {
+  assert(stack);
+  return stack->top == NULL;
+}
+
+/*
+ * This function returns the number of values in a given version of a
+ * persistent stack.  Each node records its depth, so this is O(1).
+ *
+ * Params:
+ *   stack - the stack whose size is being queried.  May not be NULL.
+ */
+int pstack_size(struct pstack* stack) {
+  assert(stack);
+  return stack->top ? stack->top->depth : 0;
+}
+
+/*
+ * This function pushes a new value onto a given version of a persistent
+ * stack.  Other versions, including snapshots of this one, are unaffected.
+ * This function has O(1) runtime complexity.
+ *
+ * Params:
+ *   stack - the stack onto which a value is to be pushed.  May not be NULL.
+ *   val - the value to be pushed.
+ */
+void pstack_push(struct pstack* stack, void* val) {
+  assert(stack);
+
+  /*
+   * The handle's reference to the old top is handed over to the new node.
+   */
+  struct pnode* node = malloc(sizeof(struct pnode));
+  assert(node);
+  node->val = val;
+  node->next = stack->top;
+  node->refs = 1;
+  node->depth = stack->top ? stack->top->depth + 1 : 1;
+  stack->top = node;
+}
+
+/*
+ * This function returns the value at the top of a given version of a
+ * persistent stack without removing it.
+ *
+ * Params:
+ *   stack - the stack from which to query the top value.  May not be NULL.
+ *
+ * Return:
+ *   This function returns the top value, or NULL if the stack is empty.
+ */
+void* pstack_top(struct pstack* stack) {
+  assert(stack);
+  return stack->top ? stack->top->val : NULL;
+}
+
+/*
+ * This function pops a value from a given version of a persistent stack and
+ * returns it.  Other versions still holding the popped node keep it.  This
+ * function has O(1) amortized runtime complexity.
+ *
+ * Params:
+ *   stack - the stack from which a value is to be popped.  May not be NULL.
+ *
+ * Return:
+ *   This function returns the value that was popped, or NULL if the stack
+ *   was empty.
+ */
+void* pstack_pop(struct pstack* stack) {
+  assert(stack);
+  struct pnode* old = stack->top;
+  if (!old) {
+    return NULL;
+  }
+
+  void* val = old->val;
+  stack->top = old->next;
+  _pnode_incref(stack->top);
+  _pnode_decref(old);
+  return val;
+}
+
+/*
+ * This function returns a new handle to a point-in-time copy of a given
+ * version of a persistent stack.  No values are copied: the new handle
+ * shares every node with `stack`, and later pushes and pops on either handle
+ * are invisible to the other.  This function has O(1) runtime complexity.
+ *
+ * Params:
+ *   stack - the stack to snapshot.  May not be NULL.
+ *
+ * Return:
+ *   This function returns the new handle, which must eventually be passed to
+ *   pstack_free().
+ */
+struct pstack* pstack_snapshot(struct pstack* stack) {
+  assert(stack);
+  struct pstack* snapshot = pstack_create();
+  snapshot->top = stack->top;
+  _pnode_incref(snapshot->top);
+  return snapshot;
+}
@@ -0,0 +1,31 @@
+/*
+ * This file contains the definition of the interface for a persistent stack,
+ * i.e. a stack whose versions can be snapshotted in O(1) and then modified
+ * independently.  You can find descriptions of the persistent stack
+ * functions, including their parameters and their return values, in
+ * pstack.c.
+ */
+
+#ifndef __PSTACK_H
+#define __PSTACK_H
+
+/*
+ * Structure used to represent a single version (handle) of a persistent
+ * stack.
+ */
+struct pstack;
+
+/*
+ * Persistent stack interface function prototypes.  Refer to pstack.c for
+ * documentation about each of these functions.
+ */
+struct pstack* pstack_create();
+void pstack_free(struct pstack* stack);
+int pstack_isempty(struct pstack* stack);
+int pstack_size(struct pstack* stack);
+void pstack_push(struct pstack* stack, void* val);
+void* pstack_top(struct pstack* stack);
+void* pstack_pop(struct pstack* stack);
+struct pstack* pstack_snapshot(struct pstack* stack);
+
+#endif
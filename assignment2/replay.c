@@ -0,0 +1,352 @@
+/*
+ * This file contains a non-interactive, batch mode for the call center that
+ * replays a trace of call events.  The trace is read into memory in one go,
+ * then every event is applied to the same queue and answered-call history that
+ * the interactive menu uses, without printing anything per call.  At the end,
+ * a summary of throughput and of the waiting time of answered calls is
+ * printed.  See the documentation below for more information on the
+ * individual functions in this implementation.
+ *
+ * A trace is a text file with one event per line:
+ *
+ *   <time_us> R <caller name>|<call reason>   receive a new call
+ *   <time_us> A                               answer the next waiting call
+ *   <time_us> Q                               look at the next waiting and
+ *                                             last answered calls
+ *   <time_us> C <call id>                     the caller hangs up; cancel
+ *                                             the call if it's still waiting
+ *
+ * Call IDs are assigned 1, 2, 3, ... in the order of the R events.
+ *
+ * When replaying with skill-based routing (see router.c), an R event may
+ * end with "|<skill>|<tier>" (both default to 0) and an A event may be
+ * followed by the answering agent's skill mask (default: every skill).
+ * Without routing, every call goes through one FIFO regardless of its skill
+ * and tier, but waiting times are still summarized per tier.
+ *
+ * Times are in microseconds and must not decrease.  Blank lines and lines
+ * starting with '#' are ignored.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+
+#include "replay.h"
+#include "call.h"
+#include "callpool.h"
+#include "callq.h"
+#include "router.h"
+#include "ring.h"
+
+/*
+ * Size of the chunks in which the trace is read.
+ */
+#define REPLAY_READ_CHUNK (1 << 20)
+
+/*
+ * Number of call records the call pool allocates at a time.
+ */
+#define REPLAY_POOL_SLAB 4096
+
+/*
+ * Number of answered calls kept in the history; older ones are released.
+ */
+#define REPLAY_HISTORY 1000
+
+/*
+ * Function returning the current monotonic time in microseconds.
+ */
+long long replay_now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+/*
+ * Function to read an entire file (or stdin, if `path` is "-") into a single
+ * NUL-terminated buffer.  Returns NULL if the file can't be read.
+ */
+char* replay_read_all(char* path, size_t* len) {
+    FILE* file = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return NULL;
+    }
+
+    size_t cap = REPLAY_READ_CHUNK, n = 0, got;
+    char* buf = malloc(cap + 1);
+    assert(buf);
+    while ((got = fread(buf + n, 1, cap - n, file)) > 0) {
+        n += got;
+        if (n == cap) {
+            cap *= 2;
+            char* bigger = realloc(buf, cap + 1);
+            assert(bigger);
+            buf = bigger;
+        }
+    }
+    if (file != stdin) {
+        fclose(file);
+    }
+    buf[n] = '\0';
+    *len = n;
+    return buf;
+}
+
+/*
+ * Comparison function for sorting waiting times with qsort().
+ */
+int replay_cmp_ll(const void* a, const void* b) {
+    long long x = *(const long long*)a, y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * Function returning the p-th percentile (0 <= p <= 100) of `n` sorted
+ * values.
+ */
+long long replay_percentile(long long* sorted, long n, double p) {
+    long idx = (long)(p / 100.0 * (n - 1) + 0.5);
+    return sorted[idx];
+}
+
+/*
+ * This function replays a call event trace through the call center and
+ * prints a summary of operations per second and of waiting-time percentiles.
+ * Waiting times are measured in trace time (from a call's R event to the A
+ * event that answered it), so they're the same whether or not the replay is
+ * paced.
+ *
+ * Params:
+ *   path - the trace file to replay, or "-" to read the trace from stdin.
+ *   paced - if non-zero, each event is applied no earlier than its recorded
+ *     time (relative to the first event).  Otherwise the trace is replayed as
+ *     fast as possible.
+ *   n_skills - if positive, calls are routed by skill and tier into this
+ *     many per-skill priority queues instead of going through one FIFO.
+ *
+ * Return:
+ *   This function returns 0 on success or 1 if the trace couldn't be read or
+ *   parsed.
+ */
+int replay_trace(char* path, int paced, int n_skills) {
+    size_t len;
+    char* trace = replay_read_all(path, &len);
+    if (!trace) {
+        return 1;
+    }
+
+    struct call_pool* pool = call_pool_create(REPLAY_POOL_SLAB);
+    struct callq* queue = NULL;
+    struct router* router = NULL;
+    if (n_skills > 0) {
+        router = router_create(n_skills, pool);
+    } else {
+        queue = callq_create(NULL, 1, pool);
+    }
+    struct ring* answered = ring_create(REPLAY_HISTORY, call_pool_release_fn,
+        pool);
+
+    /*
+     * Receive times and tiers, indexed by call ID, the waiting time of every
+     * answered call, and the total wait and number of answered calls for
+     * each tier.
+     */
+    long cap = 1024, n_waits = 0;
+    long long* received_at = malloc(cap * sizeof(long long));
+    long long* waits = malloc(cap * sizeof(long long));
+    char* tiers = malloc(cap);
+    long long tier_wait[ROUTER_TIERS] = { 0 };
+    long tier_answered[ROUTER_TIERS] = { 0 };
+
+    long n_receive = 0, n_answer = 0, n_query = 0, n_idle = 0, n_cancel = 0;
+    long n_stale = 0, lineno = 0;
+    long long first_ts = -1, last_ts = 0;
+    int call_id = 1, status = 0;
+    long long start = replay_now_us();
+
+    char* line = trace;
+    while (line < trace + len) {
+        char* end = strchr(line, '\n');
+        if (!end) {
+            end = trace + len;
+        }
+        *end = '\0';
+        lineno++;
+
+        char* p = line;
+        line = end + 1;
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+        if (*p == '\0' || *p == '#' || *p == '\r') {
+            continue;
+        }
+
+        char* rest;
+        long long ts = strtoll(p, &rest, 10);
+        while (*rest == ' ' || *rest == '\t') {
+            rest++;
+        }
+        if (rest == p || ts < last_ts || (*rest != 'R' && *rest != 'A' &&
+                *rest != 'Q' && *rest != 'C')) {
+            fprintf(stderr, "%s:%ld: malformed event\n", path, lineno);
+            status = 1;
+            break;
+        }
+        if (first_ts < 0) {
+            first_ts = ts;
+        }
+        last_ts = ts;
+
+        if (paced) {
+            long long due = start + (ts - first_ts);
+            long long now = replay_now_us();
+            if (due > now) {
+                struct timespec delay = { (due - now) / 1000000,
+                    (due - now) % 1000000 * 1000 };
+                nanosleep(&delay, NULL);
+            }
+        }
+
+        if (*rest == 'R') {
+            /*
+             * Split "name|reason", trimming the separator and any CR.
+             */
+            char* name = rest + 1;
+            while (*name == ' ') {
+                name++;
+            }
+            char* cr = strchr(name, '\r');
+            if (cr) {
+                *cr = '\0';
+            }
+            char* reason = strchr(name, '|');
+            if (reason) {
+                *reason++ = '\0';
+            } else {
+                reason = "";
+            }
+            int skill = 0, tier = 0;
+            char* route = strchr(reason, '|');
+            if (route) {
+                *route++ = '\0';
+                sscanf(route, "%d|%d", &skill, &tier);
+            }
+            if ((router && (skill < 0 || skill >= n_skills)) || tier < 0 ||
+                    tier >= ROUTER_TIERS) {
+                fprintf(stderr, "%s:%ld: bad skill or tier\n", path, lineno);
+                status = 1;
+                break;
+            }
+
+            if (call_id >= cap) {
+                cap *= 2;
+                received_at = realloc(received_at, cap * sizeof(long long));
+                waits = realloc(waits, cap * sizeof(long long));
+                tiers = realloc(tiers, cap);
+            }
+            received_at[call_id] = ts;
+            tiers[call_id] = tier;
+            struct call* c = call_pool_create_call(pool, call_id++, name,
+                reason);
+            if (router) {
+                router_route(router, c, skill, tier,
+                    (int)((ts - first_ts) / 1000));
+            } else {
+                callq_enqueue(queue, c);
+            }
+            n_receive++;
+        } else if (*rest == 'A') {
+            struct call* c;
+            if (router) {
+                char* mask_end;
+                long mask = strtol(rest + 1, &mask_end, 0);
+                c = router_next(router, mask_end == rest + 1 ?
+                    ROUTER_ALL_SKILLS : (int)mask);
+            } else {
+                c = callq_dequeue(queue);
+            }
+            if (!c) {
+                n_idle++;
+                continue;
+            }
+            ring_push(answered, c);
+            waits[n_waits++] = ts - received_at[c->id];
+            tier_wait[(int)tiers[c->id]] += ts - received_at[c->id];
+            tier_answered[(int)tiers[c->id]]++;
+            n_answer++;
+        } else if (*rest == 'C') {
+            int id = atoi(rest + 1);
+            if (router ? router_cancel(router, id) : callq_cancel(queue, id)) {
+                n_cancel++;
+            } else {
+                n_stale++;
+            }
+        } else {
+            void* volatile sink;
+            sink = router ? NULL : callq_front(queue);
+            sink = ring_newest(answered);
+            (void)sink;
+            n_query++;
+        }
+    }
+    double elapsed = (replay_now_us() - start) / 1e6;
+
+    if (status == 0) {
+        long events = n_receive + n_answer + n_query + n_idle + n_cancel +
+            n_stale;
+        printf("Replayed %ld events in %.3fs (%.0f ops/s)%s.\n", events,
+            elapsed, elapsed > 0 ? events / elapsed : 0.0,
+            paced ? " at recorded pace" : "");
+        printf("  received %ld, answered %ld, queries %ld, answers with no"
+            " call waiting %ld, still waiting %d\n", n_receive, n_answer,
+            n_query, n_idle, router ? router_size(router) : callq_size(queue));
+        printf("  cancelled %ld, cancels of calls no longer waiting %ld\n",
+            n_cancel, n_stale);
+        if (n_waits > 0) {
+            double sum = 0;
+            for (long i = 0; i < n_waits; i++) {
+                sum += waits[i];
+            }
+            qsort(waits, n_waits, sizeof(long long), replay_cmp_ll);
+            printf("  wait (ms): mean %.3f  p50 %.3f  p90 %.3f  p99 %.3f"
+                "  p99.9 %.3f  max %.3f\n", sum / n_waits / 1000.0,
+                replay_percentile(waits, n_waits, 50) / 1000.0,
+                replay_percentile(waits, n_waits, 90) / 1000.0,
+                replay_percentile(waits, n_waits, 99) / 1000.0,
+                replay_percentile(waits, n_waits, 99.9) / 1000.0,
+                waits[n_waits - 1] / 1000.0);
+        }
+        if (tier_answered[ROUTER_TIER_PRIORITY] > 0 ||
+                tier_answered[ROUTER_TIER_VIP] > 0) {
+            static const char* tier_names[ROUTER_TIERS] = { "standard",
+                "priority", "VIP" };
+            for (int t = 0; t < ROUTER_TIERS; t++) {
+                if (tier_answered[t] > 0) {
+                    printf("  %s: answered %ld, mean wait (ms) %.3f\n",
+                        tier_names[t], tier_answered[t],
+                        tier_wait[t] / (double)tier_answered[t] / 1000.0);
+                }
+            }
+        }
+    }
+
+    if (router) {
+        router_free(router);
+    } else {
+        callq_free(queue);
+    }
+    ring_free(answered);
+    call_pool_free(pool);
+    free(received_at);
+    free(waits);
+    free(tiers);
+    free(trace);
+    return status;
+}
@@ -0,0 +1,17 @@
+/*
+ * This file contains the definition of the interface for replaying call
+ * event traces through the call center.  You can find descriptions of the
+ * replay functions, including their parameters and their return values, in
+ * replay.c.
+ */
+
+#ifndef __REPLAY_H
+#define __REPLAY_H
+
+/*
+ * Replay interface function prototypes.  Refer to replay.c for documentation
+ * about each of these functions.
+ */
+int replay_trace(char* path, int paced, int n_skills);
+
+#endif
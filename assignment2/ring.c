@@ -0,0 +1,214 @@
+/*
+ * This file contains an implementation of a bounded ring buffer that keeps
+ * the `capacity` most recently pushed values and overwrites the oldest one
+ * when full.  See the documentation below for more information on the
+ * individual functions in this implementation.
+ *
+ * The values are stored in a mirrored array of 2 * capacity slots: every
+ * value is written both at its position `pos` and at `pos + capacity`.  That
+ * costs one extra store per push, but it means the k most recent values
+ * always sit next to each other, ending just before `pos + capacity`, so
+ * ring_last_k() can hand out a pointer straight into the array instead of
+ * copying around the wrap point.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "ring.h"
+
+/*
+ * This is the structure that represents a ring buffer.  `pos` is the slot
+ * the next value will be written to, which (once the ring is full) also
+ * holds the oldest value.  Values pushed out of a full ring, and values left
+ * in it when it's freed, are passed to `evict_fn` (if not NULL) along with
+ * `ctx`.
+ */
+struct ring {
+  void** data;
+  int capacity;
+  int size;
+  int pos;
+  void (*evict_fn)(void* ctx, void* val);
+  void* ctx;
+};
+
+/*
+ * This function allocates and initializes a new, empty ring buffer and
+ * returns a pointer to it.
+ *
+ * Params:
+ *   capacity - the number of values the ring holds.  Must be positive.
+ *   evict_fn - a function that's handed each value the ring overwrites or
+ *     still holds when it's freed, e.g. to release or archive it, or NULL.
+ *   ctx - a pointer passed as the first argument to every call to evict_fn.
+ */
+struct ring* ring_create(int capacity, void (*evict_fn)(void*, void*),
+    void* ctx) {
+  assert(capacity > 0);
+  struct ring* ring = malloc(sizeof(struct ring));
+  assert(ring);
+  ring->data = malloc(2 * capacity * sizeof(void*));
+  assert(ring->data);
+  ring->capacity = capacity;
+  ring->size = 0;
+  ring->pos = 0;
+  ring->evict_fn = evict_fn;
+  ring->ctx = ctx;
+  return ring;
+}
+
+/*
+ * This function frees the memory associated with a ring buffer, passing each
+ * value still in it to the ring's evict function, oldest first.
+ *
+ * Params:
+ *   ring - the ring buffer to be destroyed.  May not be NULL.
+ */
+void ring_free(struct ring* ring) {
+  assert(ring);
+  if (ring->evict_fn) {
+    int n;
+    void** vals = ring_last_k(ring, ring->size, &n);
+    for (int i = 0; i < n; i++) {
+      ring->evict_fn(ring->ctx, vals[i]);
+    }
+  }
+  free(ring->data);
+  free(ring);
+}
+
+/*
+ * This function returns the number of values in a ring buffer, which is
+ * never more than its capacity.
+ */
+int ring_size(struct ring* ring) {
+  assert(ring);
+  return ring->size;
+}
+
+/*
+ * This function returns the capacity of a ring buffer.
+ */
+int ring_capacity(struct ring* ring) {
+  assert(ring);
+  return ring->capacity;
+}
+
+/*
+ * This function pushes a value into a ring buffer.  If the ring is full, the
+ * oldest value is removed to make room and passed to the ring's evict
+ * function.
+ *
+ * Params:
+ *   ring - the ring buffer.  May not be NULL.
+ *   val - the value to push.
+ */
+void ring_push(struct ring* ring, void* val) {
+  assert(ring);
+  if (ring->size == ring->capacity) {
+    if (ring->evict_fn) {
+      ring->evict_fn(ring->ctx, ring->data[ring->pos]);
+    }
+  } else {
+    ring->size++;
+  }
+  ring->data[ring->pos] = val;
+  ring->data[ring->pos + ring->capacity] = val;
+  ring->pos++;
+  if (ring->pos == ring->capacity) {
+    ring->pos = 0;
+  }
+}
+
+/*
+ * This function pushes `n` values into a ring buffer at once, oldest first,
+ * with the same result as `n` calls to ring_push(): values pushed out of the
+ * ring, including any of `vals` beyond the last `capacity`, are passed to
+ * the ring's evict function, oldest first.  The values that stay are copied
+ * in with a few memcpy()s.
+ *
+ * Params:
+ *   ring - the ring buffer.  May not be NULL.
+ *   vals - the values to push.  May not be NULL unless `n` is 0.
+ *   n - the number of values to push.
+ */
+void ring_push_many(struct ring* ring, void** vals, int n) {
+  assert(ring);
+  assert(n >= 0);
+
+  int overflow = ring->size + n - ring->capacity;
+  if (overflow > 0 && ring->evict_fn) {
+    int k, old = overflow < ring->size ? overflow : ring->size;
+    void** oldest = ring_last_k(ring, ring->size, &k);
+    for (int i = 0; i < old; i++) {
+      ring->evict_fn(ring->ctx, oldest[i]);
+    }
+    for (int i = 0; i < overflow - old; i++) {
+      ring->evict_fn(ring->ctx, vals[i]);
+    }
+  }
+  if (n > ring->capacity) {
+    vals += n - ring->capacity;
+    n = ring->capacity;
+  }
+
+  /*
+   * Copy the values in up to the end of the array's first half, then wrap
+   * around for the rest, and mirror each piece into the other half.
+   */
+  int first = ring->capacity - ring->pos < n ? ring->capacity - ring->pos : n;
+  if (first > 0) {
+    memcpy(ring->data + ring->pos, vals, first * sizeof(void*));
+    memcpy(ring->data + ring->pos + ring->capacity, vals,
+      first * sizeof(void*));
+  }
+  if (n > first) {
+    memcpy(ring->data, vals + first, (n - first) * sizeof(void*));
+    memcpy(ring->data + ring->capacity, vals + first,
+      (n - first) * sizeof(void*));
+  }
+  ring->pos = (ring->pos + n) % ring->capacity;
+  ring->size = ring->size + n < ring->capacity ? ring->size + n :
+    ring->capacity;
+}
+
+/*
+ * This function returns the most recently pushed value in a ring buffer, or
+ * NULL if the ring is empty.
+ */
+void* ring_newest(struct ring* ring) {
+  assert(ring);
+  if (ring->size == 0) {
+    return NULL;
+  }
+  return ring->data[ring->pos + ring->capacity - 1];
+}
+
+/*
+ * This function returns the most recently pushed values in a ring buffer as
+ * a contiguous array, without copying them.
+ *
+ * Params:
+ *   ring - the ring buffer.  May not be NULL.
+ *   k - the number of values wanted.
+ *   n - a location in which to store the number of values actually
+ *     returned, which is the smaller of k and the size of the ring.
+ *
+ * Return:
+ *   This function returns a pointer to the first of n values, ordered from
+ *   oldest to newest.  The array belongs to the ring and is only valid until
+ *   the next push.
+ */
+void** ring_last_k(struct ring* ring, int k, int* n) {
+  assert(ring && n);
+  if (k > ring->size) {
+    k = ring->size;
+  }
+  if (k < 0) {
+    k = 0;
+  }
+  *n = k;
+  return ring->data + ring->pos + ring->capacity - k;
+}
@@ -0,0 +1,30 @@
+/*
+ * This file contains the definition of the interface for a bounded ring
+ * buffer that overwrites its oldest value when full.  You can find
+ * descriptions of the ring buffer functions, including their parameters and
+ * their return values, in ring.c.
+ */
+
+#ifndef __RING_H
+#define __RING_H
+
+/*
+ * Structure used to represent a ring buffer.
+ */
+struct ring;
+
+/*
+ * Ring buffer interface function prototypes.  Refer to ring.c for
+ * documentation about each of these functions.
+ */
+struct ring* ring_create(int capacity, void (*evict_fn)(void*, void*),
+  void* ctx);
+void ring_free(struct ring* ring);
+int ring_size(struct ring* ring);
+int ring_capacity(struct ring* ring);
+void ring_push(struct ring* ring, void* val);
+void ring_push_many(struct ring* ring, void** vals, int n);
+void* ring_newest(struct ring* ring);
+void** ring_last_k(struct ring* ring, int k, int* n);
+
+#endif
@@ -0,0 +1,223 @@
+/*
+ * This file contains an implementation of the skill-based call router.  Each
+ * skill (billing, technical support, ...) has its own priority queue of
+ * waiting calls (see pq.c), and an agent takes the best call from any of the
+ * queues for the skills they have.  See the documentation below for more
+ * information on the individual functions in this implementation.
+ *
+ * A call's urgency is the time it has waited plus a head start given by its
+ * customer tier, and the most urgent call is answered first.  Since every
+ * waiting call's wait grows at the same rate, ordering by urgency is the
+ * same as ordering by (arrival time - tier weight), which never changes once
+ * the call is queued.  So that's used directly as the call's priority value,
+ * and routing a call or taking the next one is a single O(log n) heap
+ * operation (plus a peek at the head of each eligible queue) no matter how
+ * many calls are waiting.
+ *
+ * Calls are cancelled the same way as in the call queue (see callq.c): the
+ * IDs of waiting calls are kept in an ID set, and a cancelled call is left in
+ * its heap until it reaches the top, where it's released and skipped.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "router.h"
+#include "pq.h"
+#include "idset.h"
+
+/*
+ * Default head start, in milliseconds, for each customer tier.
+ */
+#define ROUTER_PRIORITY_WEIGHT_MS 30000
+#define ROUTER_VIP_WEIGHT_MS 120000
+
+/*
+ * This is the structure that represents a router.  `waiting` holds the IDs
+ * of the queued calls that haven't been cancelled.
+ */
+struct router {
+    struct pq* queues[ROUTER_MAX_SKILLS];
+    int n_skills;
+    int tier_weight_ms[ROUTER_TIERS];
+    struct idset* waiting;
+    struct call_pool* pool;
+};
+
+/*
+ * Auxilliary function to release the record of a call that left the router
+ * without being answered.
+ */
+void _router_release(struct router* r, struct call* c) {
+    if (r->pool) {
+        call_pool_release(r->pool, c);
+    } else {
+        free(c);
+    }
+}
+
+/*
+ * Auxilliary function to discard cancelled calls from the top of a skill's
+ * queue, so that the top of the queue (if any) is a call that's still
+ * waiting.
+ */
+void _router_skip_cancelled(struct router* r, struct pq* queue) {
+    while (!pq_isempty(queue)) {
+        struct call* c = pq_first(queue);
+        if (idset_contains(r->waiting, c->id)) {
+            return;
+        }
+        _router_release(r, pq_remove_first(queue));
+    }
+}
+
+/*
+ * This function allocates and initializes a new router with no waiting calls
+ * and returns a pointer to it.
+ *
+ * Params:
+ *   n_skills - the number of skills, numbered 0 to n_skills - 1.  Must be
+ *     between 1 and ROUTER_MAX_SKILLS.
+ *   pool - the pool that every call routed was acquired from, or NULL if
+ *     calls are malloc()'d.
+ */
+struct router* router_create(int n_skills, struct call_pool* pool) {
+    assert(n_skills > 0 && n_skills <= ROUTER_MAX_SKILLS);
+    struct router* r = malloc(sizeof(struct router));
+    assert(r);
+    for (int i = 0; i < n_skills; i++) {
+        r->queues[i] = pq_create();
+    }
+    r->n_skills = n_skills;
+    r->tier_weight_ms[ROUTER_TIER_STANDARD] = 0;
+    r->tier_weight_ms[ROUTER_TIER_PRIORITY] = ROUTER_PRIORITY_WEIGHT_MS;
+    r->tier_weight_ms[ROUTER_TIER_VIP] = ROUTER_VIP_WEIGHT_MS;
+    r->waiting = idset_create();
+    r->pool = pool;
+    return r;
+}
+
+/*
+ * This function frees a router and releases every call record still in it,
+ * waiting or cancelled.
+ *
+ * Params:
+ *   r - the router to be destroyed.  May not be NULL.
+ */
+void router_free(struct router* r) {
+    assert(r);
+    for (int i = 0; i < r->n_skills; i++) {
+        while (!pq_isempty(r->queues[i])) {
+            _router_release(r, pq_remove_first(r->queues[i]));
+        }
+        pq_free(r->queues[i]);
+    }
+    idset_free(r->waiting);
+    free(r);
+}
+
+/*
+ * This function sets the head start given to calls from a customer tier.
+ * It only affects calls routed afterwards.
+ *
+ * Params:
+ *   r - the router.  May not be NULL.
+ *   tier - the customer tier, one of the ROUTER_TIER_* values.
+ *   weight_ms - the head start in milliseconds.
+ */
+void router_set_tier_weight(struct router* r, int tier, int weight_ms) {
+    assert(r);
+    assert(tier >= 0 && tier < ROUTER_TIERS);
+    r->tier_weight_ms[tier] = weight_ms;
+}
+
+/*
+ * This function returns the number of calls waiting in a router, not
+ * counting cancelled calls.
+ */
+int router_size(struct router* r) {
+    assert(r);
+    return idset_size(r->waiting);
+}
+
+/*
+ * This function queues a call for agents with a given skill.  This is
+ * O(log n).
+ *
+ * Params:
+ *   r - the router.  May not be NULL.
+ *   c - the call.  Its ID must be positive and must not belong to any other
+ *     call in the router, including a cancelled one.  The router takes
+ *     ownership of the record until it's handed out by router_next().
+ *   skill - the skill needed to answer the call.
+ *   tier - the caller's customer tier, one of the ROUTER_TIER_* values.
+ *   arrival_ms - the time the call arrived, in milliseconds since some fixed
+ *     starting point that's the same for every call.
+ */
+void router_route(struct router* r, struct call* c, int skill, int tier,
+        int arrival_ms) {
+    assert(r);
+    assert(c && c->id > 0);
+    assert(skill >= 0 && skill < r->n_skills);
+    assert(tier >= 0 && tier < ROUTER_TIERS);
+
+    int added = idset_add(r->waiting, c->id);
+    assert(added);
+    (void)added;
+    pq_insert(r->queues[skill], c, arrival_ms - r->tier_weight_ms[tier]);
+}
+
+/*
+ * This function removes and returns the most urgent call that an agent can
+ * answer.  This is O(k + log n) for an agent with k skills.
+ *
+ * Params:
+ *   r - the router.  May not be NULL.
+ *   skill_mask - the agent's skills, with bit i set if the agent has skill
+ *     i.  ROUTER_ALL_SKILLS matches every skill.
+ *
+ * Return:
+ *   This function returns the call, or NULL if no call the agent can answer
+ *   is waiting.  The caller takes ownership of the returned record.
+ */
+struct call* router_next(struct router* r, int skill_mask) {
+    assert(r);
+    struct pq* best = NULL;
+    for (int i = 0; i < r->n_skills; i++) {
+        if (!(skill_mask & (1 << i))) {
+            continue;
+        }
+        _router_skip_cancelled(r, r->queues[i]);
+        if (pq_isempty(r->queues[i])) {
+            continue;
+        }
+        if (!best ||
+                pq_first_priority(r->queues[i]) < pq_first_priority(best)) {
+            best = r->queues[i];
+        }
+    }
+    if (!best) {
+        return NULL;
+    }
+    struct call* c = pq_remove_first(best);
+    idset_remove(r->waiting, c->id);
+    return c;
+}
+
+/*
+ * This function cancels a waiting call, e.g. because the caller hung up.
+ * This is O(1) expected: the call's record is left in its queue and is
+ * released when it reaches the top.
+ *
+ * Params:
+ *   r - the router.  May not be NULL.
+ *   id - the ID of the call to cancel.
+ *
+ * Return:
+ *   This function returns 1 if the call was cancelled or 0 if no call with
+ *   that ID was waiting.
+ */
+int router_cancel(struct router* r, int id) {
+    assert(r);
+    return idset_remove(r->waiting, id);
+}
@@ -0,0 +1,51 @@
+/*
+ * This file contains the definition of the interface for the skill-based
+ * call router, which keeps waiting calls in one priority queue per skill.
+ * You can find descriptions of the router functions, including their
+ * parameters and their return values, in router.c.
+ */
+
+#ifndef __ROUTER_H
+#define __ROUTER_H
+
+#include "call.h"
+#include "callpool.h"
+
+/*
+ * Maximum number of skills, so that an agent's skills fit in an int mask.
+ */
+#define ROUTER_MAX_SKILLS 16
+
+/*
+ * Customer tiers.  Calls from higher tiers are answered as if they had been
+ * waiting longer than they have.
+ */
+#define ROUTER_TIER_STANDARD 0
+#define ROUTER_TIER_PRIORITY 1
+#define ROUTER_TIER_VIP 2
+#define ROUTER_TIERS 3
+
+/*
+ * Skill mask matching every skill.
+ */
+#define ROUTER_ALL_SKILLS (~0)
+
+/*
+ * Structure used to represent a router.
+ */
+struct router;
+
+/*
+ * Router interface function prototypes.  Refer to router.c for
+ * documentation about each of these functions.
+ */
+struct router* router_create(int n_skills, struct call_pool* pool);
+void router_free(struct router* r);
+void router_set_tier_weight(struct router* r, int tier, int weight_ms);
+int router_size(struct router* r);
+void router_route(struct router* r, struct call* c, int skill, int tier,
+    int arrival_ms);
+struct call* router_next(struct router* r, int skill_mask);
+int router_cancel(struct router* r, int id);
+
+#endif
@@ -0,0 +1,784 @@
+/*
+ * This file contains the call center's Unix domain socket front end.  Clients
+ * connect to a socket and send call events as binary frames (see server.h),
+ * which are applied directly to the same kind of call queue and answered-call
+ * history that the interactive menu uses.  See the documentation below for
+ * more information on the individual functions in this implementation.
+ *
+ * Everything runs on one thread around an edge-triggered epoll loop.  Every
+ * socket is non-blocking.  When a connection becomes readable, it's read in
+ * large chunks until the kernel has nothing more, and every complete frame in
+ * each chunk is handled before the next read, so a client streaming calls
+ * costs a system call per chunk rather than per call.  Replies are collected
+ * in a per-connection output buffer and written once per chunk.  A client
+ * that doesn't read its replies stops being read from once its output buffer
+ * fills, until the buffer drains.
+ *
+ * With metrics (see metrics.c), the clock is read once per chunk too: every
+ * call received in a chunk is stamped with the time it was read, every call
+ * answered in it has its wait measured up to then, and the queue and
+ * history depth are recorded once the chunk has been handled.
+ *
+ * Timers are kept in a timing wheel (see timerwheel.c) in milliseconds, on a
+ * monotonic clock read once per chunk and once per pass of the event loop,
+ * which sleeps until the next timer is due.  Each call can have an SLA
+ * timer, which reports that it has waited too long, and an abandonment
+ * timer, which cancels it as if the caller had hung up.  Both are set when
+ * the call is received and cancelled when it's answered or cancelled.  Their
+ * handles are kept by the server in a map from call IDs (see idmap.c), not
+ * in the calls' records, so struct call stays the same size everywhere it's
+ * stored or shared.  Scheduled callbacks are calls held
+ * in a timer until they're due to be received.  They aren't journaled until
+ * then, so a callback still pending when the server stops is lost.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <assert.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+
+#include "server.h"
+#include "call.h"
+#include "callpool.h"
+#include "callq.h"
+#include "ring.h"
+#include "journal.h"
+#include "metrics.h"
+#include "timerwheel.h"
+#include "idmap.h"
+
+#define SERVER_MAX_EVENTS 64
+#define SERVER_LISTEN_BACKLOG 128
+
+/*
+ * Size of each connection's input buffer, i.e. the most read per system
+ * call, and the amount of unsent output at which a connection stops being
+ * read from.
+ */
+#define SERVER_READ_CHUNK 65536
+#define SERVER_OUT_LIMIT (1 << 20)
+
+#define SERVER_POOL_SLAB 4096
+#define SERVER_HISTORY 1000
+
+/*
+ * Kinds of timer, stored in the low bits of each timer's argument: a call ID
+ * shifted left two bits, or for a callback, the pending call's record.  The
+ * SLA and abandonment kinds also index the handles in a call's timers
+ * record below.
+ */
+#define SERVER_TIMER_SLA 0
+#define SERVER_TIMER_ABANDON 1
+#define SERVER_TIMER_CALLBACK 2
+
+/*
+ * Structure holding the handles of a waiting call's SLA and abandonment
+ * timers, kept in the server's `call_timers` map under the call's ID.
+ * Records no longer in use are kept in a free list, linked by `next`, to be
+ * reused.
+ */
+struct call_timers {
+    long long handles[2];
+    struct call_timers* next;
+};
+
+/*
+ * Structure holding the state of one client connection.  `in` holds bytes
+ * read but not yet handled (at most one partial frame between reads), and
+ * `out` holds replies not yet written.  `eof` is set once the client has
+ * shut down its end; the connection is closed when its replies are sent.
+ * Open connections are kept in a doubly-linked list so they can be closed
+ * at shutdown.
+ */
+struct conn {
+    struct conn* prev;
+    struct conn* next;
+    int fd;
+    int eof;
+    int in_len;
+    char in[SERVER_READ_CHUNK];
+    char* out;
+    int out_len;
+    int out_cap;
+};
+
+/*
+ * Structure holding the state of the server.
+ */
+struct server {
+    int epfd;
+    int listen_fd;
+    struct call_pool* pool;
+    struct callq* queue;
+    struct ring* history;
+    struct journal* journal;
+    struct metrics_shard* metrics;
+    long long now_us;
+    struct timer_wheel* timers;
+    struct idmap* call_timers;
+    struct call_timers* free_timers;
+    long long now_ms;
+    int sla_ms;
+    int abandon_ms;
+    struct conn* conns;
+    int next_id;
+    unsigned long received;
+    unsigned long answered;
+    unsigned long cancelled;
+    unsigned long abandoned;
+    unsigned long sla_breaches;
+    int callbacks;
+};
+
+/*
+ * Set by the signal handler to stop the event loop.
+ */
+volatile sig_atomic_t server_stop = 0;
+
+void server_handle_signal(int sig) {
+    server_stop = 1;
+}
+
+/*
+ * Function to put a file descriptor into non-blocking mode.
+ */
+int server_set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags < 0 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+/*
+ * Function returning the current monotonic time in milliseconds.
+ */
+long long server_now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+/*
+ * Function to set a waiting call's SLA and abandonment timers.  A disabled
+ * timer's handle is set to 0, which cancels nothing.  Nothing is recorded if
+ * both are disabled.
+ */
+void server_set_timers(struct server* srv, struct call* c) {
+    if (srv->sla_ms <= 0 && srv->abandon_ms <= 0) {
+        return;
+    }
+    struct call_timers* t = srv->free_timers;
+    if (t) {
+        srv->free_timers = t->next;
+    } else {
+        t = malloc(sizeof(struct call_timers));
+        assert(t);
+    }
+
+    uintptr_t id = (uintptr_t)c->id << 2;
+    t->handles[SERVER_TIMER_SLA] = srv->sla_ms <= 0 ? 0 :
+        timer_add(srv->timers, srv->now_ms + srv->sla_ms,
+            (void*)(id | SERVER_TIMER_SLA));
+    t->handles[SERVER_TIMER_ABANDON] = srv->abandon_ms <= 0 ? 0 :
+        timer_add(srv->timers, srv->now_ms + srv->abandon_ms,
+            (void*)(id | SERVER_TIMER_ABANDON));
+    idmap_put(srv->call_timers, c->id, t);
+}
+
+/*
+ * Function to cancel the timers of a call that's no longer waiting, because
+ * it was answered or cancelled, and put its timers record on the free list.
+ */
+void server_clear_timers(struct server* srv, int id) {
+    struct call_timers* t = idmap_remove(srv->call_timers, id);
+    if (t) {
+        timer_cancel(srv->timers, t->handles[SERVER_TIMER_SLA]);
+        timer_cancel(srv->timers, t->handles[SERVER_TIMER_ABANDON]);
+        t->next = srv->free_timers;
+        srv->free_timers = t;
+    }
+}
+
+/*
+ * Function to receive a call: queue it, journal it and set its timers.
+ */
+void server_receive(struct server* srv, struct call* c) {
+    c->received_at = srv->now_us;
+    callq_enqueue(srv->queue, c);
+    if (srv->journal) {
+        journal_receive(srv->journal, c);
+    }
+    server_set_timers(srv, c);
+    srv->received++;
+    if (srv->metrics) {
+        metrics_count(srv->metrics, METRICS_RECEIVED, 1);
+    }
+}
+
+/*
+ * Function to cancel a waiting call, because its caller hung up or gave up
+ * waiting.  Returns 1 if the call was cancelled or 0 if it wasn't waiting.
+ */
+int server_cancel(struct server* srv, int id) {
+    if (!callq_cancel(srv->queue, id)) {
+        return 0;
+    }
+    server_clear_timers(srv, id);
+    srv->cancelled++;
+    if (srv->metrics) {
+        metrics_count(srv->metrics, METRICS_CANCELLED, 1);
+    }
+    if (srv->journal) {
+        journal_cancel(srv->journal, id);
+    }
+    return 1;
+}
+
+/*
+ * Timer function for the server's timing wheel.  See the SERVER_TIMER_*
+ * kinds above.
+ */
+void server_fire_timer(void* ctx, void* arg) {
+    struct server* srv = ctx;
+    uintptr_t bits = (uintptr_t)arg;
+    int id = (int)(bits >> 2);
+
+    switch (bits & 3) {
+    case SERVER_TIMER_SLA:
+        if (callq_is_waiting(srv->queue, id)) {
+            srv->sla_breaches++;
+            fprintf(stderr, "SLA breach: call %d has waited over %dms.\n", id,
+                srv->sla_ms);
+        }
+        break;
+    case SERVER_TIMER_ABANDON:
+        srv->abandoned += server_cancel(srv, id);
+        break;
+    case SERVER_TIMER_CALLBACK: {
+        struct call* c = (struct call*)(bits & ~(uintptr_t)3);
+        c->id = srv->next_id++;
+        srv->callbacks--;
+        server_receive(srv, c);
+        break;
+    }
+    }
+}
+
+/*
+ * Function to set the timers of a call recovered from the journal.
+ */
+void server_set_recovered_timers(void* ctx, struct call* c) {
+    server_set_timers(ctx, c);
+}
+
+/*
+ * Function to parse a call's name and reason from a request payload, as
+ * described for FRAME_RECEIVE.  Overlong strings are truncated.  Returns 0
+ * on success or -1 if the payload is malformed.
+ */
+int server_parse_call(const unsigned char* payload, int len, char* name,
+        char* reason) {
+    int max_name = sizeof(((struct call*)0)->name) - 1;
+    int max_reason = sizeof(((struct call*)0)->reason) - 1;
+    if (len < 2 || len != 2 + payload[0] + payload[1]) {
+        return -1;
+    }
+    int name_len = payload[0] < max_name ? payload[0] : max_name;
+    int reason_len = payload[1] < max_reason ? payload[1] : max_reason;
+    memcpy(name, payload + 2, name_len);
+    name[name_len] = '\0';
+    memcpy(reason, payload + 2 + payload[0], reason_len);
+    reason[reason_len] = '\0';
+    return 0;
+}
+
+/*
+ * Function to append a reply frame to a connection's output buffer.
+ */
+void server_reply(struct conn* conn, int type, const void* payload,
+        int len) {
+    struct frame_header hdr = { (uint16_t)len, (uint8_t)type, 0 };
+    int need = conn->out_len + (int)sizeof(hdr) + len;
+
+    if (need > conn->out_cap) {
+        while (conn->out_cap < need) {
+            conn->out_cap = conn->out_cap ? 2 * conn->out_cap : 4096;
+        }
+        conn->out = realloc(conn->out, conn->out_cap);
+        assert(conn->out);
+    }
+    memcpy(conn->out + conn->out_len, &hdr, sizeof(hdr));
+    if (len > 0) {
+        memcpy(conn->out + conn->out_len + sizeof(hdr), payload, len);
+    }
+    conn->out_len = need;
+}
+
+/*
+ * Function to handle one request frame.  Returns 0 on success or -1 if the
+ * request was malformed.
+ */
+int server_handle_frame(struct server* srv, struct conn* conn,
+        struct frame_header* hdr, const unsigned char* payload) {
+    int reply = !(hdr->flags & FRAME_NOREPLY);
+    uint32_t words[4];
+    char name[sizeof(((struct call*)0)->name)];
+    char reason[sizeof(((struct call*)0)->reason)];
+
+    switch (hdr->type) {
+    case FRAME_RECEIVE: {
+        if (server_parse_call(payload, hdr->len, name, reason) < 0) {
+            return -1;
+        }
+        struct call* c = call_pool_create_call(srv->pool, srv->next_id++,
+            name, reason);
+        words[0] = c->id;
+        server_receive(srv, c);
+        if (reply) {
+            server_reply(conn, FRAME_ACCEPTED, words, sizeof(uint32_t));
+        }
+        return 0;
+    }
+    case FRAME_CALLBACK: {
+        if (hdr->len < (int)sizeof(uint32_t) ||
+                server_parse_call(payload + sizeof(uint32_t),
+                    hdr->len - sizeof(uint32_t), name, reason) < 0) {
+            return -1;
+        }
+        memcpy(&words[0], payload, sizeof(uint32_t));
+        struct call* c = call_pool_create_call(srv->pool, 0, name, reason);
+        timer_add(srv->timers, srv->now_ms + words[0],
+            (void*)((uintptr_t)c | SERVER_TIMER_CALLBACK));
+        srv->callbacks++;
+        if (reply) {
+            server_reply(conn, FRAME_SCHEDULED, NULL, 0);
+        }
+        return 0;
+    }
+    case FRAME_ANSWER: {
+        struct call* c = callq_dequeue(srv->queue);
+        if (c) {
+            server_clear_timers(srv, c->id);
+            if (srv->journal) {
+                journal_answer(srv->journal, c->id);
+            }
+            ring_push(srv->history, c);
+            srv->answered++;
+            if (srv->metrics) {
+                metrics_count(srv->metrics, METRICS_ANSWERED, 1);
+                if (c->received_at) {
+                    metrics_record(srv->metrics, METRICS_WAIT_US,
+                        srv->now_us - c->received_at);
+                }
+            }
+        }
+        if (!reply) {
+            return 0;
+        }
+        if (!c) {
+            server_reply(conn, FRAME_EMPTY, NULL, 0);
+            return 0;
+        }
+        unsigned char buf[4 + 2 + sizeof(name) + sizeof(reason)];
+        uint32_t id = c->id;
+        int name_len = strlen(c->name), reason_len = strlen(c->reason);
+        memcpy(buf, &id, 4);
+        buf[4] = name_len;
+        buf[5] = reason_len;
+        memcpy(buf + 6, c->name, name_len);
+        memcpy(buf + 6 + name_len, c->reason, reason_len);
+        server_reply(conn, FRAME_CALL, buf, 6 + name_len + reason_len);
+        return 0;
+    }
+    case FRAME_CANCEL:
+        if (hdr->len != sizeof(uint32_t)) {
+            return -1;
+        }
+        memcpy(&words[0], payload, sizeof(uint32_t));
+        words[1] = server_cancel(srv, (int)words[0]);
+        if (reply) {
+            server_reply(conn, FRAME_CANCELLED, words, 2 * sizeof(uint32_t));
+        }
+        return 0;
+    case FRAME_STATS:
+        words[0] = srv->received;
+        words[1] = srv->answered;
+        words[2] = srv->cancelled;
+        words[3] = callq_size(srv->queue);
+        if (reply) {
+            server_reply(conn, FRAME_STATS_REPLY, words, sizeof(words));
+        }
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+/*
+ * Function to write as much of a connection's pending output as the socket
+ * will take.  When journaling, the events handled so far are committed
+ * first (as one group), so that no reply is sent for an event that isn't
+ * durable yet.
+ * Returns 0 on success or -1 if the connection is broken.
+ */
+int server_flush(struct server* srv, struct conn* conn) {
+    int off = 0;
+    if (srv->journal) {
+        journal_commit(srv->journal);
+    }
+    while (off < conn->out_len) {
+        ssize_t n = write(conn->fd, conn->out + off, conn->out_len - off);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return -1;
+        }
+        off += n;
+    }
+    if (off > 0) {
+        memmove(conn->out, conn->out + off, conn->out_len - off);
+        conn->out_len -= off;
+    }
+    return 0;
+}
+
+/*
+ * Function to service a connection after epoll reports activity on it:
+ * reads and handles requests until the socket is drained (or the output
+ * buffer fills), then writes out the replies.  Returns 0 if the connection
+ * should stay open or -1 if it should be closed.
+ */
+int server_service(struct server* srv, struct conn* conn) {
+    while (!conn->eof) {
+        if (server_flush(srv, conn) < 0) {
+            return -1;
+        }
+        if (conn->out_len >= SERVER_OUT_LIMIT) {
+            return 0;
+        }
+
+        ssize_t n = read(conn->fd, conn->in + conn->in_len,
+            sizeof(conn->in) - conn->in_len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            conn->eof = 1;
+            break;
+        }
+        conn->in_len += n;
+        srv->now_ms = server_now_ms();
+        if (srv->metrics) {
+            srv->now_us = metrics_now_us();
+        }
+
+        /*
+         * Handle every complete frame in the buffer and keep the partial one
+         * (if any) for the next read.
+         */
+        int off = 0;
+        while (conn->in_len - off >= (int)sizeof(struct frame_header)) {
+            struct frame_header hdr;
+            memcpy(&hdr, conn->in + off, sizeof(hdr));
+            if (hdr.len > FRAME_MAX_PAYLOAD) {
+                server_reply(conn, FRAME_ERROR, NULL, 0);
+                server_flush(srv, conn);
+                return -1;
+            }
+            if (conn->in_len - off < (int)sizeof(hdr) + hdr.len) {
+                break;
+            }
+            if (server_handle_frame(srv, conn, &hdr,
+                    (unsigned char*)conn->in + off + sizeof(hdr)) < 0) {
+                server_reply(conn, FRAME_ERROR, NULL, 0);
+                server_flush(srv, conn);
+                return -1;
+            }
+            off += sizeof(hdr) + hdr.len;
+        }
+        memmove(conn->in, conn->in + off, conn->in_len - off);
+        conn->in_len -= off;
+        if (srv->metrics) {
+            metrics_record(srv->metrics, METRICS_QUEUE_DEPTH,
+                callq_size(srv->queue));
+            metrics_record(srv->metrics, METRICS_HISTORY_DEPTH,
+                ring_size(srv->history));
+        }
+    }
+
+    if (server_flush(srv, conn) < 0) {
+        return -1;
+    }
+    return conn->eof && conn->out_len == 0 ? -1 : 0;
+}
+
+/*
+ * Function to accept every pending connection on the listening socket.
+ */
+void server_accept(struct server* srv) {
+    while (1) {
+        int fd = accept(srv->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                perror("accept");
+            }
+            return;
+        }
+        if (server_set_nonblocking(fd) < 0) {
+            close(fd);
+            continue;
+        }
+
+        struct conn* conn = malloc(sizeof(struct conn));
+        assert(conn);
+        conn->fd = fd;
+        conn->eof = 0;
+        conn->in_len = 0;
+        conn->out = NULL;
+        conn->out_len = 0;
+        conn->out_cap = 0;
+        conn->prev = NULL;
+        conn->next = srv->conns;
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.ptr = conn;
+        if (epoll_ctl(srv->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            perror("epoll_ctl");
+            close(fd);
+            free(conn);
+            continue;
+        }
+        if (srv->conns) {
+            srv->conns->prev = conn;
+        }
+        srv->conns = conn;
+    }
+}
+
+/*
+ * Function to close a connection and free its state.
+ */
+void server_close(struct server* srv, struct conn* conn) {
+    epoll_ctl(srv->epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    if (conn->prev) {
+        conn->prev->next = conn->next;
+    } else {
+        srv->conns = conn->next;
+    }
+    if (conn->next) {
+        conn->next->prev = conn->prev;
+    }
+    free(conn->out);
+    free(conn);
+}
+
+/*
+ * Function to put a waiting call's timers record on the free list, so that
+ * it's freed with the rest at shutdown.
+ */
+void server_release_timers(void* ctx, struct call* c) {
+    server_clear_timers(ctx, c->id);
+}
+
+/*
+ * Function to free the call center state held by the server, committing and
+ * closing the journal (if any) first.
+ */
+void server_free_state(struct server* srv) {
+    if (srv->journal) {
+        journal_close(srv->journal);
+    }
+    callq_foreach(srv->queue, server_release_timers, srv);
+    while (srv->free_timers) {
+        struct call_timers* t = srv->free_timers;
+        srv->free_timers = t->next;
+        free(t);
+    }
+    idmap_free(srv->call_timers);
+    callq_free(srv->queue);
+    ring_free(srv->history);
+    timer_wheel_free(srv->timers);
+    call_pool_free(srv->pool);
+}
+
+/*
+ * This function runs the call center as a server on a Unix domain socket
+ * until it's interrupted (SIGINT or SIGTERM), then prints a summary.
+ * Connections still open at that point are dropped.
+ *
+ * Params:
+ *   path - the filesystem path to create the socket at.  An existing socket
+ *     at that path is replaced.
+ *   journal_path - a journal file to recover the call center's state from
+ *     and to record every event in (see journal.c), or NULL.  Events are
+ *     committed in groups, once per chunk of requests read from a client.
+ *   metrics - metrics to update as calls are handled, or NULL.
+ *   sla_ms - how long a call may wait before an SLA breach is reported on
+ *     stderr, in milliseconds, or 0 for no limit.
+ *   abandon_ms - how long a call may wait before it's cancelled as
+ *     abandoned, in milliseconds, or 0 for no limit.
+ *
+ * Return:
+ *   This function returns 0 on a clean shutdown or 1 if the socket or the
+ *   journal couldn't be set up.
+ */
+int server_run(const char* path, const char* journal_path,
+        struct metrics* metrics, int sla_ms, int abandon_ms) {
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "%s: socket path too long\n", path);
+        return 1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    struct server srv;
+    srv.pool = call_pool_create(SERVER_POOL_SLAB);
+    srv.queue = callq_create(NULL, 1, srv.pool);
+    srv.history = ring_create(SERVER_HISTORY, call_pool_release_fn, srv.pool);
+    srv.journal = NULL;
+    srv.metrics = metrics ? metrics_shard_create(metrics) : NULL;
+    srv.now_us = 0;
+    srv.now_ms = server_now_ms();
+    srv.timers = timer_wheel_create(srv.now_ms, server_fire_timer, &srv);
+    srv.call_timers = idmap_create();
+    srv.free_timers = NULL;
+    srv.sla_ms = sla_ms;
+    srv.abandon_ms = abandon_ms;
+    srv.conns = NULL;
+    srv.next_id = 1;
+    srv.received = srv.answered = srv.cancelled = 0;
+    srv.abandoned = srv.sla_breaches = 0;
+    srv.callbacks = 0;
+
+    if (journal_path) {
+        srv.journal = journal_open(journal_path, SERVER_HISTORY);
+        if (!srv.journal || (srv.next_id = journal_load(srv.journal,
+                srv.queue, srv.history, srv.pool)) < 0) {
+            fprintf(stderr, "Couldn't recover from journal %s.\n",
+                journal_path);
+            server_free_state(&srv);
+            return 1;
+        }
+        printf("Recovered %d waiting and %d answered calls from %s.\n",
+            callq_size(srv.queue), ring_size(srv.history), journal_path);
+
+        /*
+         * How long recovered calls had already waited isn't known, so their
+         * timers start from now.
+         */
+        callq_foreach(srv.queue, server_set_recovered_timers, &srv);
+    }
+
+    srv.listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (srv.listen_fd < 0) {
+        perror("socket");
+        server_free_state(&srv);
+        return 1;
+    }
+    unlink(path);
+    if (bind(srv.listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+            listen(srv.listen_fd, SERVER_LISTEN_BACKLOG) < 0 ||
+            server_set_nonblocking(srv.listen_fd) < 0) {
+        perror(path);
+        close(srv.listen_fd);
+        server_free_state(&srv);
+        return 1;
+    }
+
+    srv.epfd = epoll_create1(0);
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    epoll_ctl(srv.epfd, EPOLL_CTL_ADD, srv.listen_fd, &ev);
+
+    /*
+     * Install the handlers without SA_RESTART so that a signal interrupts
+     * epoll_wait().  Clients going away mid-write mustn't kill the server.
+     */
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = server_handle_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    printf("Listening on %s.\n", path);
+    fflush(stdout);
+
+    struct epoll_event events[SERVER_MAX_EVENTS];
+    while (!server_stop) {
+        /*
+         * Fire the timers that are due, then sleep until the next one is (or
+         * until a client needs servicing).
+         */
+        srv.now_ms = server_now_ms();
+        if (srv.metrics) {
+            srv.now_us = metrics_now_us();
+        }
+        if (timer_advance(srv.timers, srv.now_ms) > 0 && srv.journal) {
+            journal_commit(srv.journal);
+        }
+        long long next = timer_next(srv.timers);
+        int timeout = next < 0 ? -1 : next - srv.now_ms > 1000000 ? 1000000 :
+            (int)(next - srv.now_ms);
+
+        int n = epoll_wait(srv.epfd, events, SERVER_MAX_EVENTS, timeout);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            struct conn* conn = events[i].data.ptr;
+            if (!conn) {
+                server_accept(&srv);
+            } else if (server_service(&srv, conn) < 0) {
+                server_close(&srv, conn);
+            }
+        }
+    }
+
+    printf("Shutting down: received %lu, answered %lu, cancelled %lu"
+        " (%lu abandoned), still waiting %d, SLA breaches %lu, callbacks"
+        " pending %d.\n", srv.received, srv.answered, srv.cancelled,
+        srv.abandoned, callq_size(srv.queue), srv.sla_breaches,
+        srv.callbacks);
+
+    while (srv.conns) {
+        server_close(&srv, srv.conns);
+    }
+    close(srv.epfd);
+    close(srv.listen_fd);
+    unlink(path);
+    server_free_state(&srv);
+    return 0;
+}
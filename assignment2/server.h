@@ -0,0 +1,90 @@
+/*
+ * This file contains the definition of the interface for the call center's
+ * Unix domain socket front end, including the binary framing its clients
+ * speak.  You can find descriptions of the server functions, including their
+ * parameters and their return values, in server.c.
+ */
+
+#ifndef __SERVER_H
+#define __SERVER_H
+
+#include <stdint.h>
+
+#include "metrics.h"
+
+/*
+ * Every message, in either direction, is a frame: a 4-byte header followed
+ * by `len` bytes of payload.  All integers are in host byte order, since
+ * both ends are on the same machine.
+ */
+struct frame_header {
+    uint16_t len;       /* Payload length in bytes. */
+    uint8_t type;       /* One of the FRAME_* types below. */
+    uint8_t flags;      /* FRAME_NOREPLY or 0. */
+};
+
+/*
+ * Largest payload a frame may carry.
+ */
+#define FRAME_MAX_PAYLOAD 1024
+
+/*
+ * Requests from clients.
+ *
+ *   FRAME_RECEIVE - a new call.  Payload: uint8 name length, uint8 reason
+ *                   length, then the name and reason bytes (no NULs).
+ *                   Replied to with FRAME_ACCEPTED.
+ *   FRAME_ANSWER  - answer the next waiting call.  No payload.  Replied to
+ *                   with FRAME_CALL, or FRAME_EMPTY if no call is waiting.
+ *   FRAME_CANCEL  - the caller hung up.  Payload: uint32 call ID.  Replied
+ *                   to with FRAME_CANCELLED.
+ *   FRAME_STATS   - query counters.  No payload.  Replied to with
+ *                   FRAME_STATS_REPLY.
+ *   FRAME_CALLBACK - schedule a call back to a caller: the call is received
+ *                   after a delay.  Payload: uint32 delay in milliseconds,
+ *                   then the call as in FRAME_RECEIVE.  Replied to with
+ *                   FRAME_SCHEDULED.
+ *
+ * A request with FRAME_NOREPLY set in its flags isn't replied to, which lets
+ * a client stream calls in without reading anything back.
+ */
+#define FRAME_RECEIVE 1
+#define FRAME_ANSWER 2
+#define FRAME_CANCEL 3
+#define FRAME_STATS 4
+#define FRAME_CALLBACK 5
+
+/*
+ * Replies from the server.
+ *
+ *   FRAME_ACCEPTED    - Payload: uint32 ID assigned to the call.
+ *   FRAME_CALL        - Payload: uint32 call ID, then the name and reason
+ *                       as in FRAME_RECEIVE.
+ *   FRAME_EMPTY       - No payload.
+ *   FRAME_CANCELLED   - Payload: uint32 call ID, uint32 1 if the call was
+ *                       cancelled or 0 if it wasn't waiting.
+ *   FRAME_STATS_REPLY - Payload: uint32 calls received, answered,
+ *                       cancelled and still waiting, in that order.
+ *   FRAME_ERROR       - The request was malformed.  No payload.  The server
+ *                       closes the connection after sending it.
+ *   FRAME_SCHEDULED   - No payload.  The call's ID is assigned when it's
+ *                       received.
+ */
+#define FRAME_ACCEPTED 101
+#define FRAME_CALL 102
+#define FRAME_EMPTY 103
+#define FRAME_CANCELLED 104
+#define FRAME_STATS_REPLY 105
+#define FRAME_ERROR 106
+#define FRAME_SCHEDULED 107
+
+#define FRAME_NOREPLY 0x01
+
+/*
+ * Server interface function prototypes.  Refer to server.c for
+ * documentation about each of these functions.
+ */
+int server_run(const char* path, const char* journal_path,
+    struct metrics* metrics, int sla_ms, int abandon_ms);
+
+#endif
@@ -0,0 +1,477 @@
+/*
+ * This file contains an implementation of a shared-memory call queue: a
+ * bounded ring of call records in a named POSIX shared-memory segment, so
+ * that separate processes on the same machine (e.g. intake processes taking
+ * calls and agent processes answering them) can share one queue without a
+ * socket in between.  See the documentation below for more information on
+ * the individual functions in this implementation.
+ *
+ * The ring works like the one in mpmcq.c: every slot carries a sequence
+ * number, a producer claims a position by advancing `tail` with a
+ * compare-and-swap and publishes the slot by bumping its sequence, and a
+ * consumer claims a position by advancing `head` and recycles the slot for
+ * the next lap.  The difference is that a slot holds the call record itself
+ * rather than a pointer to it, since a pointer into one process's heap means
+ * nothing in another.  shmq_claim_enqueue() and shmq_claim_dequeue() hand
+ * out a pointer to the record in its slot, so a call can be written straight
+ * into the ring and read straight out of it without being copied; the
+ * record must then be handed back with shmq_publish() or shmq_release().
+ * shmq_try_enqueue() and shmq_try_dequeue() do all of this with one copy in
+ * or out.
+ *
+ * The head and tail indices and the slots are 64-bit lock-free atomics,
+ * which work across processes just as across threads.  Slots are padded to
+ * a whole number of cache lines, so that processes working on neighbouring
+ * slots don't contend.  Nothing in the segment is a pointer, so each process
+ * may map it at a different address.
+ *
+ * A process that dies between claiming a slot and handing it back leaves
+ * the slot claimed for good, and the queue stalls once the other processes
+ * get around to that position, so such a queue must be unlinked and created
+ * afresh.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "shmq.h"
+
+#define SHMQ_CACHE_LINE 64
+
+/*
+ * Marks a segment as a fully initialized queue.  It's written last by
+ * shmq_create(), so shmq_open() can tell when a segment is ready.
+ */
+#define SHMQ_MAGIC 0x51514d53
+
+/*
+ * How many times, a millisecond apart, shmq_open() checks whether a
+ * segment that's still being created is ready.
+ */
+#define SHMQ_OPEN_TRIES 1000
+
+/*
+ * This structure sits at the start of the segment.  `call_size` guards
+ * against processes built with different call records sharing a queue.  The
+ * consumer and producer indices are kept on separate cache lines.
+ */
+struct shmq_header {
+    uint32_t magic;
+    uint32_t call_size;
+    uint64_t capacity;
+    char pad0[SHMQ_CACHE_LINE - 2 * sizeof(uint32_t) - sizeof(uint64_t)];
+    uint64_t head;
+    char pad1[SHMQ_CACHE_LINE - sizeof(uint64_t)];
+    uint64_t tail;
+    char pad2[SHMQ_CACHE_LINE - sizeof(uint64_t)];
+};
+
+/*
+ * This structure is used to represent a single slot in the ring, which
+ * takes up SHMQ_SLOT_SIZE bytes.
+ */
+struct shmq_slot {
+    uint64_t seq;
+    struct call call;
+};
+
+#define SHMQ_SLOT_SIZE ((sizeof(struct shmq_slot) + SHMQ_CACHE_LINE - 1) / \
+    SHMQ_CACHE_LINE * SHMQ_CACHE_LINE)
+
+/*
+ * This is the structure that represents one process's handle on a queue.
+ * `mask` is a private copy of the capacity minus one, so that a corrupted
+ * segment can't make this process index outside its mapping.
+ */
+struct shmq {
+    struct shmq_header* hdr;
+    char* slots;
+    uint64_t mask;
+    size_t size;
+};
+
+/*
+ * Auxilliary function returning the size in bytes of a segment holding
+ * `capacity` slots.
+ */
+size_t _shmq_segment_size(uint64_t capacity) {
+    return sizeof(struct shmq_header) + capacity * SHMQ_SLOT_SIZE;
+}
+
+/*
+ * Auxilliary function returning the slot for position `pos`.
+ */
+struct shmq_slot* _shmq_slot(struct shmq* q, uint64_t pos) {
+    return (struct shmq_slot*)(q->slots + (pos & q->mask) * SHMQ_SLOT_SIZE);
+}
+
+/*
+ * Auxilliary function returning the slot holding a record handed out by
+ * shmq_claim_enqueue() or shmq_claim_dequeue().
+ */
+struct shmq_slot* _shmq_slot_of(struct shmq* q, struct call* c) {
+    char* slot = (char*)c - offsetof(struct shmq_slot, call);
+    assert(slot >= q->slots && (size_t)(slot - q->slots) % SHMQ_SLOT_SIZE ==
+        0 && (uint64_t)(slot - q->slots) / SHMQ_SLOT_SIZE <= q->mask);
+    return (struct shmq_slot*)slot;
+}
+
+/*
+ * Auxilliary function to map a segment of `size` bytes and wrap it in a
+ * handle.  Returns NULL on failure.
+ */
+struct shmq* _shmq_map(int fd, size_t size, const char* name) {
+    void* mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mem == MAP_FAILED) {
+        perror(name);
+        return NULL;
+    }
+    struct shmq* q = malloc(sizeof(struct shmq));
+    assert(q);
+    q->hdr = mem;
+    q->slots = (char*)mem + sizeof(struct shmq_header);
+    q->size = size;
+    q->mask = 0;
+    return q;
+}
+
+/*
+ * This function creates a new, empty queue in a shared-memory segment and
+ * returns a handle on it.  Other processes can then attach to the queue with
+ * shmq_open().
+ *
+ * Params:
+ *   name - the name of the segment, e.g. "/callcenter", as for shm_open().
+ *     There must not already be a segment with this name.
+ *   capacity - the minimum number of calls the queue must be able to hold.
+ *     It is rounded up to the next power of two.  Must be at least 2.
+ *
+ * Return:
+ *   This function returns a handle on the queue, or NULL (after printing an
+ *   error) if the segment couldn't be created.
+ */
+struct shmq* shmq_create(const char* name, int capacity) {
+    assert(name && capacity > 1);
+    uint64_t size = 1;
+    while (size < (uint64_t)capacity) {
+        size <<= 1;
+    }
+
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        perror(name);
+        return NULL;
+    }
+    if (ftruncate(fd, _shmq_segment_size(size)) < 0) {
+        perror(name);
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+    struct shmq* q = _shmq_map(fd, _shmq_segment_size(size), name);
+    close(fd);
+    if (!q) {
+        shm_unlink(name);
+        return NULL;
+    }
+
+    q->mask = size - 1;
+    q->hdr->call_size = sizeof(struct call);
+    q->hdr->capacity = size;
+    q->hdr->head = q->hdr->tail = 0;
+    for (uint64_t i = 0; i < size; i++) {
+        _shmq_slot(q, i)->seq = i;
+    }
+    __atomic_store_n(&q->hdr->magic, SHMQ_MAGIC, __ATOMIC_RELEASE);
+    return q;
+}
+
+/*
+ * This function attaches to a queue created (possibly by another process)
+ * with shmq_create(), waiting up to a second for the creator to finish
+ * setting it up.
+ *
+ * Params:
+ *   name - the name of the queue's segment.
+ *
+ * Return:
+ *   This function returns a handle on the queue, or NULL (after printing an
+ *   error) if there's no such queue.
+ */
+struct shmq* shmq_open(const char* name) {
+    assert(name);
+    struct timespec ms = { 0, 1000000 };
+    struct stat st;
+
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        perror(name);
+        return NULL;
+    }
+    int tries = 0;
+    while (1) {
+        if (fstat(fd, &st) < 0) {
+            perror(name);
+            close(fd);
+            return NULL;
+        }
+        if ((size_t)st.st_size >= sizeof(struct shmq_header) ||
+                ++tries == SHMQ_OPEN_TRIES) {
+            break;
+        }
+        nanosleep(&ms, NULL);
+    }
+    if ((size_t)st.st_size < sizeof(struct shmq_header)) {
+        fprintf(stderr, "%s: not a call queue\n", name);
+        close(fd);
+        return NULL;
+    }
+    struct shmq* q = _shmq_map(fd, st.st_size, name);
+    close(fd);
+    if (!q) {
+        return NULL;
+    }
+
+    while (__atomic_load_n(&q->hdr->magic, __ATOMIC_ACQUIRE) != SHMQ_MAGIC &&
+            ++tries < SHMQ_OPEN_TRIES) {
+        nanosleep(&ms, NULL);
+    }
+    uint64_t capacity = q->hdr->capacity;
+    if (q->hdr->magic != SHMQ_MAGIC || q->hdr->call_size !=
+            sizeof(struct call) || capacity < 2 ||
+            (capacity & (capacity - 1)) != 0 ||
+            _shmq_segment_size(capacity) != q->size) {
+        fprintf(stderr, "%s: not a call queue, or from a different build\n",
+            name);
+        shmq_close(q);
+        return NULL;
+    }
+    q->mask = capacity - 1;
+    return q;
+}
+
+/*
+ * This function detaches from a queue, which carries on existing for other
+ * processes (and for later shmq_open() calls) until it's unlinked.  Any
+ * record claimed through this handle must have been handed back first.
+ *
+ * Params:
+ *   q - the handle to be closed.  May not be NULL.
+ */
+void shmq_close(struct shmq* q) {
+    assert(q);
+    munmap(q->hdr, q->size);
+    free(q);
+}
+
+/*
+ * This function removes a queue's name, so that no more processes can open
+ * it.  Processes that have it open can carry on using it, and the memory is
+ * freed once they've all closed it.
+ *
+ * Params:
+ *   name - the name of the queue's segment.
+ *
+ * Return:
+ *   This function returns 0 on success or -1 if there was no such queue.
+ */
+int shmq_unlink(const char* name) {
+    assert(name);
+    return shm_unlink(name);
+}
+
+/*
+ * This function returns the number of calls a queue can hold.
+ */
+int shmq_capacity(struct shmq* q) {
+    assert(q);
+    return (int)(q->mask + 1);
+}
+
+/*
+ * This function returns the number of calls in a queue.  Since other
+ * processes may be using the queue at the same time, this is only a
+ * snapshot, and it counts calls that are still being written or read.
+ */
+int shmq_size(struct shmq* q) {
+    assert(q);
+    uint64_t head = __atomic_load_n(&q->hdr->head, __ATOMIC_ACQUIRE);
+    uint64_t tail = __atomic_load_n(&q->hdr->tail, __ATOMIC_ACQUIRE);
+    return tail > head ? (int)(tail - head) : 0;
+}
+
+/*
+ * This function claims the next free slot in a queue, without waiting, and
+ * returns the call record in it for the caller to fill in directly.  The
+ * call isn't visible to consumers until it's handed to shmq_publish().
+ * Calls are dequeued in the order their slots were claimed.
+ *
+ * Params:
+ *   q - the queue into which to enqueue.  May not be NULL.
+ *
+ * Return:
+ *   This function returns the record to fill in, or NULL if the queue was
+ *   full.
+ */
+struct call* shmq_claim_enqueue(struct shmq* q) {
+    assert(q);
+    uint64_t pos = __atomic_load_n(&q->hdr->tail, __ATOMIC_RELAXED);
+    while (1) {
+        struct shmq_slot* slot = _shmq_slot(q, pos);
+        uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        int64_t diff = (int64_t)(seq - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&q->hdr->tail, &pos, pos + 1, 1,
+                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                return &slot->call;
+            }
+        } else if (diff < 0) {
+            return NULL;
+        } else {
+            pos = __atomic_load_n(&q->hdr->tail, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/*
+ * This function makes a call claimed with shmq_claim_enqueue() and filled
+ * in visible to consumers.  The record mustn't be touched afterwards.
+ *
+ * Params:
+ *   q - the queue.  May not be NULL.
+ *   c - the record returned by shmq_claim_enqueue().
+ */
+void shmq_publish(struct shmq* q, struct call* c) {
+    assert(q && c);
+    struct shmq_slot* slot = _shmq_slot_of(q, c);
+    __atomic_store_n(&slot->seq, slot->seq + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * This function claims the call at the front of a queue, without waiting,
+ * and returns the record in its slot for the caller to read directly.  The
+ * slot can't be reused until the record is handed to shmq_release().
+ *
+ * Params:
+ *   q - the queue from which to dequeue.  May not be NULL.
+ *
+ * Return:
+ *   This function returns the call's record, or NULL if the queue was empty
+ *   (or the call at the front is still being written).
+ */
+struct call* shmq_claim_dequeue(struct shmq* q) {
+    assert(q);
+    uint64_t pos = __atomic_load_n(&q->hdr->head, __ATOMIC_RELAXED);
+    while (1) {
+        struct shmq_slot* slot = _shmq_slot(q, pos);
+        uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        int64_t diff = (int64_t)(seq - (pos + 1));
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&q->hdr->head, &pos, pos + 1, 1,
+                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                return &slot->call;
+            }
+        } else if (diff < 0) {
+            return NULL;
+        } else {
+            pos = __atomic_load_n(&q->hdr->head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/*
+ * This function hands the slot of a call claimed with shmq_claim_dequeue()
+ * back to the producers.  The record mustn't be touched afterwards.
+ *
+ * Params:
+ *   q - the queue.  May not be NULL.
+ *   c - the record returned by shmq_claim_dequeue().
+ */
+void shmq_release(struct shmq* q, struct call* c) {
+    assert(q && c);
+    struct shmq_slot* slot = _shmq_slot_of(q, c);
+    __atomic_store_n(&slot->seq, slot->seq + q->mask, __ATOMIC_RELEASE);
+}
+
+/*
+ * This function attempts to enqueue a copy of a call without waiting.
+ *
+ * Params:
+ *   q - the queue into which to enqueue.  May not be NULL.
+ *   c - the call to be copied into the queue.  May not be NULL.
+ *
+ * Return:
+ *   This function returns 1 if the call was enqueued or 0 if the queue was
+ *   full.
+ */
+int shmq_try_enqueue(struct shmq* q, const struct call* c) {
+    assert(c);
+    struct call* rec = shmq_claim_enqueue(q);
+    if (!rec) {
+        return 0;
+    }
+    *rec = *c;
+    shmq_publish(q, rec);
+    return 1;
+}
+
+/*
+ * This function attempts to dequeue a call without waiting.
+ *
+ * Params:
+ *   q - the queue from which to dequeue.  May not be NULL.
+ *   c - where to copy the call.  May not be NULL.
+ *
+ * Return:
+ *   This function returns 1 if a call was dequeued or 0 if the queue was
+ *   empty.
+ */
+int shmq_try_dequeue(struct shmq* q, struct call* c) {
+    assert(c);
+    struct call* rec = shmq_claim_dequeue(q);
+    if (!rec) {
+        return 0;
+    }
+    *c = *rec;
+    shmq_release(q, rec);
+    return 1;
+}
+
+/*
+ * This function enqueues a copy of a call, yielding the processor while the
+ * queue is full.
+ *
+ * Params:
+ *   q - the queue into which to enqueue.  May not be NULL.
+ *   c - the call to be copied into the queue.  May not be NULL.
+ */
+void shmq_enqueue(struct shmq* q, const struct call* c) {
+    while (!shmq_try_enqueue(q, c)) {
+        sched_yield();
+    }
+}
+
+/*
+ * This function dequeues a call, yielding the processor while the queue is
+ * empty.
+ *
+ * Params:
+ *   q - the queue from which to dequeue.  May not be NULL.
+ *   c - where to copy the call.  May not be NULL.
+ */
+void shmq_dequeue(struct shmq* q, struct call* c) {
+    while (!shmq_try_dequeue(q, c)) {
+        sched_yield();
+    }
+}
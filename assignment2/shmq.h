@@ -0,0 +1,40 @@
+/*
+ * This file contains the definition of the interface for a shared-memory
+ * call queue, a bounded ring of call records in a POSIX shared-memory
+ * segment that any number of local processes can enqueue to and dequeue
+ * from at once.  You can find descriptions of the shared-memory queue
+ * functions, including their parameters and their return values, in
+ * shmq.c.
+ */
+
+#ifndef __SHMQ_H
+#define __SHMQ_H
+
+#include "call.h"
+
+/*
+ * Structure used to represent one process's handle on a shared-memory
+ * queue.
+ */
+struct shmq;
+
+/*
+ * Shared-memory queue interface function prototypes.  Refer to shmq.c for
+ * documentation about each of these functions.
+ */
+struct shmq* shmq_create(const char* name, int capacity);
+struct shmq* shmq_open(const char* name);
+void shmq_close(struct shmq* q);
+int shmq_unlink(const char* name);
+int shmq_capacity(struct shmq* q);
+int shmq_size(struct shmq* q);
+struct call* shmq_claim_enqueue(struct shmq* q);
+void shmq_publish(struct shmq* q, struct call* c);
+struct call* shmq_claim_dequeue(struct shmq* q);
+void shmq_release(struct shmq* q, struct call* c);
+int shmq_try_enqueue(struct shmq* q, const struct call* c);
+int shmq_try_dequeue(struct shmq* q, struct call* c);
+void shmq_enqueue(struct shmq* q, const struct call* c);
+void shmq_dequeue(struct shmq* q, struct call* c);
+
+#endif
@@ -0,0 +1,297 @@
+/*
+ * This file contains an implementation of a skip list: a sorted, singly-linked
+ * list in which each node also carries a randomly-chosen number of "express
+ * lane" links that skip over runs of nodes.  Searches start in the sparsest
+ * lane and drop down a lane whenever the next link would overshoot, which
+ * gives expected O(log n) get/insert/remove without any rebalancing.  See the
+ * documentation below for more information on the individual functions in
+ * this implementation.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "skiplist.h"
+
+/*
+ * The maximum number of levels a node may have, and the denominator of the
+ * probability with which a node is promoted to each additional level.  With
+ * a promotion probability of 1/4, 16 levels are enough for ~4 billion keys.
+ */
+#define SKIPLIST_MAX_LEVEL 16
+#define SKIPLIST_BRANCHING 4
+
+/*
+ * This structure is used to represent a single node in a skip list.  As in
+ * the linked list, each node stores a void* value and a link to the next
+ * node; a skip list node additionally stores its key and one `next` link per
+ * level it participates in (next[0] is the ordinary, fully-populated list).
+ */
+struct sl_node {
+  void* key;
+  void* val;
+  int level;
+  struct sl_node* next[];
+};
+
+/*
+ * This structure is used to represent an entire skip list.  The head node is
+ * a sentinel with the maximum number of levels whose key and value are never
+ * examined.
+ */
+struct skiplist {
+  struct sl_node* head;
+  int level;
+  int size;
+  unsigned int seed;
+  int (*cmp)(void* a, void* b);
+};
+
+/*
+ * Auxilliary function to allocate a node with `level` next links.
+ */
+struct sl_node* _sl_node_create(void* key, void* val, int level) {
+  struct sl_node* node = malloc(sizeof(struct sl_node) +
+    level * sizeof(struct sl_node*));
+  assert(node);
+  node->key = key;
+  node->val = val;
+  node->level = level;
+  for (int i = 0; i < level; i++) {
+    node->next[i] = NULL;
+  }
+  return node;
+}
+
+/*
+ * Auxilliary function to pick a random level for a new node.  Each skip list
+ * carries its own xorshift state rather than calling rand(), so that separate
+ * lists (e.g. one per thread) don't contend on or perturb a shared generator.
+ */
+int _sl_random_level(struct skiplist* sl) {
+  int level = 1;
+  while (level < SKIPLIST_MAX_LEVEL) {
+    sl->seed ^= sl->seed << 13;
+    sl->seed ^= sl->seed >> 17;
+    sl->seed ^= sl->seed << 5;
+    if (sl->seed % SKIPLIST_BRANCHING != 0) {
+      break;
+    }
+    level++;
+  }
+  return level;
+}
+
+/*
+ * Auxilliary function to find, at every level, the last node whose key is
+ * strictly less than `key`.  These are stored in `update` (which must have
+ * room for SKIPLIST_MAX_LEVEL entries) and are exactly the nodes whose links
+ * need to change when inserting or removing `key`.  Returns the level-0
+ * successor of those nodes, i.e. the first node with key >= `key` (or NULL).
+ */
+struct sl_node* _sl_find(struct skiplist* sl, void* key,
+    struct sl_node** update) {
+  struct sl_node* curr = sl->head;
+  for (int i = sl->level - 1; i >= 0; i--) {
+    while (curr->next[i] && sl->cmp(curr->next[i]->key, key) < 0) {
+      curr = curr->next[i];
+    }
+    if (update) {
+      update[i] = curr;
+    }
+  }
+  return curr->next[0];
+}
+
+/*
+ * This function allocates and initializes a new, empty skip list and returns
+ * a pointer to it.
+ *
+ * Params:
+ *   cmp - pointer to a function used to order keys.  It should return a
+ *     negative value if `a` sorts before `b`, 0 if they are equal, and a
+ *     positive value if `a` sorts after `b`.  May not be NULL.
+ */
+struct skiplist* skiplist_create(int (*cmp)(void* a, void* b)) {
+  assert(cmp);
+
+  struct skiplist* sl = malloc(sizeof(struct skiplist));
+  assert(sl);
+  sl->head = _sl_node_create(NULL, NULL, SKIPLIST_MAX_LEVEL);
+  sl->level = 1;
+  sl->size = 0;
+  sl->seed = 2463534242u;
+  sl->cmp = cmp;
+  return sl;
+}
+
+/*
+ * This function frees the memory associated with a skip list.  Freeing any
+ * memory associated with keys or values still stored in the skip list is the
+ * responsibility of the caller.
+ *
+ * Params:
+ *   sl - the skip list to be destroyed.  May not be NULL.
+ */
+void skiplist_free(struct skiplist* sl) {
+  assert(sl);
+
+  /*
+   * Every node appears in the level-0 list, so walking it frees them all.
+   */
+  struct sl_node* next, * curr = sl->head;
+  while (curr != NULL) {
+    next = curr->next[0];
+    free(curr);
+    curr = next;
+  }
+
+  free(sl);
+}
+
+/*
+ * This function returns the number of keys stored in a given skip list.
+ */
+int skiplist_size(struct skiplist* sl) {
+  assert(sl);
+  return sl->size;
+}
+
+/*
+ * This function returns the value associated with a given key in a skip
+ * list, or NULL if the key is not present.
+ *
+ * Params:
+ *   sl - the skip list to search.  May not be NULL.
+ *   key - the key to look up.
+ */
+void* skiplist_get(struct skiplist* sl, void* key) {
+  assert(sl);
+
+  struct sl_node* node = _sl_find(sl, key, NULL);
+  if (node && sl->cmp(node->key, key) == 0) {
+    return node->val;
+  }
+  return NULL;
+}
+
+/*
+ * This function inserts a key/value pair into a skip list.  If the key is
+ * already present, its value is replaced.
+ *
+ * Params:
+ *   sl - the skip list into which to insert.  May not be NULL.
+ *   key - the key to insert.  The skip list stores this pointer, so it must
+ *     remain valid for as long as the key is in the list.
+ *   val - the value to associate with `key`.
+ *
+ * Return:
+ *   This function returns the value previously associated with `key`, or
+ *   NULL if `key` was not already present.
+ */
+void* skiplist_insert(struct skiplist* sl, void* key, void* val) {
+  assert(sl);
+
+  struct sl_node* update[SKIPLIST_MAX_LEVEL];
+  struct sl_node* node = _sl_find(sl, key, update);
+  if (node && sl->cmp(node->key, key) == 0) {
+    void* old = node->val;
+    node->val = val;
+    return old;
+  }
+
+  /*
+   * If the new node is taller than any existing node, the head is its
+   * predecessor at every newly-used level.
+   */
+  int level = _sl_random_level(sl);
+  for (int i = sl->level; i < level; i++) {
+    update[i] = sl->head;
+  }
+  if (level > sl->level) {
+    sl->level = level;
+  }
+
+  node = _sl_node_create(key, val, level);
+  for (int i = 0; i < level; i++) {
+    node->next[i] = update[i]->next[i];
+    update[i]->next[i] = node;
+  }
+  sl->size++;
+  return NULL;
+}
+
+/*
+ * This function removes a key from a skip list.  Freeing any memory
+ * associated with the removed key and value is the responsibility of the
+ * caller.
+ *
+ * Params:
+ *   sl - the skip list from which to remove.  May not be NULL.
+ *   key - the key to remove.
+ *
+ * Return:
+ *   This function returns the value that was associated with `key`, or NULL
+ *   if `key` was not present.
+ */
+void* skiplist_remove(struct skiplist* sl, void* key) {
+  assert(sl);
+
+  struct sl_node* update[SKIPLIST_MAX_LEVEL];
+  struct sl_node* node = _sl_find(sl, key, update);
+  if (!node || sl->cmp(node->key, key) != 0) {
+    return NULL;
+  }
+
+  for (int i = 0; i < node->level; i++) {
+    update[i]->next[i] = node->next[i];
+  }
+
+  /*
+   * Drop any levels that are now empty so later searches don't start in
+   * them.
+   */
+  while (sl->level > 1 && sl->head->next[sl->level - 1] == NULL) {
+    sl->level--;
+  }
+
+  void* val = node->val;
+  free(node);
+  sl->size--;
+  return val;
+}
+
+/*
+ * This function visits, in ascending key order, every key/value pair in a
+ * skip list whose key lies in the inclusive range [lower, upper].  Locating
+ * the start of the range costs expected O(log n); each visited pair after
+ * that costs O(1).
+ *
+ * Params:
+ *   sl - the skip list to iterate over.  May not be NULL.
+ *   lower - the smallest key to visit.  If NULL, iteration starts at the
+ *     first key in the list.
+ *   upper - the largest key to visit.  If NULL, iteration continues to the
+ *     last key in the list.
+ *   visit - pointer to a function that is called with each key, its value
+ *     and `ctx`.  It must not insert into or remove from `sl`.  May not be
+ *     NULL.
+ *   ctx - an arbitrary pointer passed through unchanged to `visit`.
+ *
+ * Return:
+ *   This function returns the number of pairs visited.
+ */
+int skiplist_range_iter(struct skiplist* sl, void* lower, void* upper,
+    void (*visit)(void* key, void* val, void* ctx), void* ctx) {
+  assert(sl);
+  assert(visit);
+
+  struct sl_node* curr = lower ? _sl_find(sl, lower, NULL) : sl->head->next[0];
+  int n = 0;
+  while (curr && (!upper || sl->cmp(curr->key, upper) <= 0)) {
+    visit(curr->key, curr->val, ctx);
+    curr = curr->next[0];
+    n++;
+  }
+  return n;
+}
@@ -0,0 +1,30 @@
+/*
+ * This file contains the definition of the interface for a skip list, an
+ * ordered map with expected O(log n) lookup, insertion and removal.  You can
+ * find descriptions of the skip list functions, including their parameters
+ * and their return values, in skiplist.c.
+ */
+
+#ifndef __SKIPLIST_H
+#define __SKIPLIST_H
+
+/*
+ * Structure used to represent a skip list.  Like the linked list, only a
+ * forward declaration of the skip list structure is included here.
+ */
+struct skiplist;
+
+/*
+ * Skip list interface function prototypes.  Refer to skiplist.c for
+ * documentation about each of these functions.
+ */
+struct skiplist* skiplist_create(int (*cmp)(void* a, void* b));
+void skiplist_free(struct skiplist* sl);
+int skiplist_size(struct skiplist* sl);
+void* skiplist_get(struct skiplist* sl, void* key);
+void* skiplist_insert(struct skiplist* sl, void* key, void* val);
+void* skiplist_remove(struct skiplist* sl, void* key);
+int skiplist_range_iter(struct skiplist* sl, void* lower, void* upper,
+  void (*visit)(void* key, void* val, void* ctx), void* ctx);
+
+#endif
@@ -0,0 +1,262 @@
+/*
+ * This file contains an implementation of state snapshots.  A snapshot is a
+ * single contiguous binary image of everything needed to restart the call
+ * center where it left off: a fixed-size header, followed by the records of
+ * the waiting calls in the order they'd be answered, followed by the records
+ * of the answered calls in the history, oldest first.  Records are stored
+ * exactly as struct call is laid out in memory, so restoring a snapshot
+ * involves no parsing: the image is mmap()'d, and its records are copied
+ * straight into one slab of the call pool and handed to the queue and the
+ * history in bulk.  Restoring is therefore a few sequential passes over the
+ * image rather than one insert per record, which is what replaying a journal
+ * (see journal.c) costs.  See the documentation below for more information
+ * on the individual functions in this implementation.
+ *
+ * The image isn't portable between builds with a different struct call
+ * layout; the header records the record size so that a mismatch is caught.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "snapshot.h"
+
+#define SNAPSHOT_MAGIC "CCSNAP1\n"
+
+/*
+ * Size of the stdio buffer used to write a snapshot.
+ */
+#define SNAPSHOT_WRITE_BUFFER (1 << 20)
+
+/*
+ * The header at the start of every snapshot.  The records of the waiting
+ * calls and then of the answered calls immediately follow it.
+ */
+struct snapshot_header {
+    char magic[8];
+    uint32_t call_size;
+    uint32_t next_id;
+    uint32_t n_waiting;
+    uint32_t n_answered;
+};
+
+/*
+ * Context for writing the waiting calls with callq_foreach().
+ */
+struct snapshot_writer {
+    FILE* file;
+    int ok;
+};
+
+/*
+ * Auxilliary function to write one call record to a snapshot.
+ */
+void _snapshot_write_call(void* ctx, struct call* c) {
+    struct snapshot_writer* w = ctx;
+    if (w->ok) {
+        w->ok = fwrite(c, sizeof(struct call), 1, w->file) == 1;
+    }
+}
+
+/*
+ * This function saves the state of the call center to a snapshot.  The
+ * snapshot is written to a temporary file, synced, and renamed over `path`,
+ * so a crash at any point leaves either the old snapshot or the new one.
+ *
+ * Params:
+ *   path - the file to save the snapshot to.
+ *   queue - the calls waiting to be answered.  May not be NULL.
+ *   history - the answered calls.  May not be NULL.
+ *   next_id - the ID the next call received will get.
+ *
+ * Return:
+ *   This function returns 0 on success or -1 on error, in which case any
+ *   existing snapshot at `path` is left unchanged.
+ */
+int snapshot_save(const char* path, struct callq* queue, struct ring* history,
+        int next_id) {
+    assert(queue && history);
+
+    char* tmp = malloc(strlen(path) + 5);
+    sprintf(tmp, "%s.tmp", path);
+    FILE* file = fopen(tmp, "wb");
+    if (!file) {
+        perror(tmp);
+        free(tmp);
+        return -1;
+    }
+    setvbuf(file, NULL, _IOFBF, SNAPSHOT_WRITE_BUFFER);
+
+    int n_answered;
+    struct call** answered = (struct call**)ring_last_k(history,
+        ring_size(history), &n_answered);
+    struct snapshot_header hdr;
+    memcpy(hdr.magic, SNAPSHOT_MAGIC, sizeof(hdr.magic));
+    hdr.call_size = sizeof(struct call);
+    hdr.next_id = next_id;
+    hdr.n_waiting = callq_size(queue);
+    hdr.n_answered = n_answered;
+
+    struct snapshot_writer w = { file, 1 };
+    w.ok = fwrite(&hdr, sizeof(hdr), 1, file) == 1;
+    callq_foreach(queue, _snapshot_write_call, &w);
+    for (int i = 0; i < n_answered; i++) {
+        _snapshot_write_call(&w, answered[i]);
+    }
+    if (w.ok) {
+        w.ok = fflush(file) == 0 && fsync(fileno(file)) == 0;
+    }
+    if (fclose(file) != 0 || !w.ok || rename(tmp, path) != 0) {
+        perror(tmp);
+        unlink(tmp);
+        free(tmp);
+        return -1;
+    }
+
+    /*
+     * Make the rename itself durable by syncing the directory.
+     */
+    char* dir_path = malloc(strlen(path) + 1);
+    strcpy(dir_path, path);
+    int dir_fd = open(dirname(dir_path), O_RDONLY);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+    free(dir_path);
+    free(tmp);
+    return 0;
+}
+
+/*
+ * Auxilliary function to copy `n` records from a snapshot into the call
+ * pool and check them.  Returns a malloc()'d array of pointers to the new
+ * records, or NULL if any record is invalid.
+ */
+struct call** _snapshot_load_calls(struct call_pool* pool,
+        const struct call* src, int n, int next_id) {
+    struct call** calls = malloc((n > 0 ? n : 1) * sizeof(struct call*));
+    assert(calls);
+    call_pool_load(pool, src, n, calls);
+
+    int ok = 1;
+    for (int i = 0; i < n; i++) {
+        ok = ok && calls[i]->id > 0 && calls[i]->id < next_id;
+        calls[i]->name[sizeof(calls[i]->name) - 1] = '\0';
+        calls[i]->reason[sizeof(calls[i]->reason) - 1] = '\0';
+    }
+    if (!ok) {
+        for (int i = 0; i < n; i++) {
+            call_pool_release(pool, calls[i]);
+        }
+        free(calls);
+        return NULL;
+    }
+    return calls;
+}
+
+/*
+ * This function restores the state of the call center from a snapshot saved
+ * by snapshot_save().  The snapshot is mmap()'d and its records are loaded
+ * into a single slab of the call pool, then appended to the queue and the
+ * history in bulk.  If the snapshot holds more answered calls than the
+ * history can, only the most recent ones are restored.
+ *
+ * Params:
+ *   path - the snapshot file.
+ *   queue - an empty call queue to restore the waiting calls into.  May not
+ *     be NULL.
+ *   history - an empty history to restore the answered calls into.  May not
+ *     be NULL.
+ *   pool - the pool that the queue and history release calls to, which the
+ *     restored calls are acquired from.  May not be NULL.
+ *
+ * Return:
+ *   This function returns the ID the next call received should get, or -1 if
+ *   the snapshot couldn't be read or isn't valid, in which case nothing is
+ *   restored.
+ */
+int snapshot_restore(const char* path, struct callq* queue,
+        struct ring* history, struct call_pool* pool) {
+    assert(queue && history && pool);
+    assert(callq_isempty(queue) && ring_size(history) == 0);
+
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        perror(path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+
+    /*
+     * The mapping stays valid after the descriptor is closed.
+     */
+    size_t size = st.st_size;
+    void* image = size > 0 ?
+        mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (image == MAP_FAILED) {
+        fprintf(stderr, "%s: not a snapshot\n", path);
+        return -1;
+    }
+    posix_madvise(image, size, POSIX_MADV_SEQUENTIAL);
+
+    struct snapshot_header hdr;
+    int valid = size >= sizeof(hdr);
+    if (valid) {
+        memcpy(&hdr, image, sizeof(hdr));
+        valid = memcmp(hdr.magic, SNAPSHOT_MAGIC, sizeof(hdr.magic)) == 0 &&
+            hdr.call_size == sizeof(struct call) && hdr.next_id >= 1 &&
+            hdr.next_id <= INT32_MAX && size == sizeof(hdr) +
+            ((uint64_t)hdr.n_waiting + hdr.n_answered) * sizeof(struct call);
+    }
+
+    struct call** waiting = NULL, ** answered = NULL;
+    int n_waiting = 0, n_answered = 0;
+    if (valid) {
+        const struct call* records = (const struct call*)((char*)image +
+            sizeof(hdr));
+        n_waiting = hdr.n_waiting;
+        n_answered = hdr.n_answered;
+        if (n_answered > ring_capacity(history)) {
+            n_answered = ring_capacity(history);
+        }
+        waiting = _snapshot_load_calls(pool, records, n_waiting, hdr.next_id);
+        answered = _snapshot_load_calls(pool, records + hdr.n_waiting +
+            (hdr.n_answered - n_answered), n_answered, hdr.next_id);
+        valid = waiting && answered;
+    }
+    munmap(image, size);
+
+    if (!valid) {
+        for (int i = 0; waiting && i < n_waiting; i++) {
+            call_pool_release(pool, waiting[i]);
+        }
+        for (int i = 0; answered && i < n_answered; i++) {
+            call_pool_release(pool, answered[i]);
+        }
+        free(waiting);
+        free(answered);
+        fprintf(stderr, "%s: not a valid snapshot\n", path);
+        return -1;
+    }
+
+    callq_enqueue_many(queue, waiting, n_waiting);
+    ring_push_many(history, (void**)answered, n_answered);
+    free(waiting);
+    free(answered);
+    return hdr.next_id;
+}
@@ -0,0 +1,25 @@
+/*
+ * This file contains the definition of the interface for state snapshots, a
+ * binary image of the call center's waiting and answered calls that it can
+ * be restarted from.  You can find descriptions of the snapshot functions,
+ * including their parameters and their return values, in snapshot.c.
+ */
+
+#ifndef __SNAPSHOT_H
+#define __SNAPSHOT_H
+
+#include "call.h"
+#include "callpool.h"
+#include "callq.h"
+#include "ring.h"
+
+/*
+ * Snapshot interface function prototypes.  Refer to snapshot.c for
+ * documentation about each of these functions.
+ */
+int snapshot_save(const char* path, struct callq* queue, struct ring* history,
+    int next_id);
+int snapshot_restore(const char* path, struct callq* queue,
+    struct ring* history, struct call_pool* pool);
+
+#endif
@@ -0,0 +1,457 @@
+/*
+ * This file contains an implementation of a FIFO queue of fixed-size records
+ * that keeps a bounded number of records in memory and spills the rest to
+ * disk.  See the documentation below for more information on the individual
+ * functions in this implementation.
+ *
+ * The queue is made of three parts, in FIFO order:
+ *
+ *   head     - an in-memory queue.c queue that dequeues are served from.
+ *   segments - zero or more append-only segment files in `dir`, each holding
+ *              exactly `seg_records` records, numbered first_seg..next_seg-1.
+ *              Segment file names start with the process ID and a number
+ *              unique to the queue within the process, so any number of
+ *              queues can share a directory.
+ *   tail     - an in-memory queue.c queue collecting the newest records.
+ *
+ * While nothing is spilled and the head holds fewer than `high_water`
+ * records, enqueues go straight to the head and the queue behaves exactly
+ * like queue.c.  Past that, enqueues go to the tail, and whenever the tail
+ * fills a segment's worth of records they are written out sequentially and
+ * freed.  When the head drains, the oldest segment is read back into it (or,
+ * with no segments left, the tail becomes the head).  At most about
+ * high_water + 2 * seg_records records are ever in memory, and all disk I/O
+ * is whole-segment sequential reads and writes.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+
+#include "spillq.h"
+#include "queue.h"
+
+/*
+ * Upper bound on the number of records per segment file.
+ */
+#define SPILLQ_MAX_SEG_RECORDS 4096
+
+/*
+ * Number of spilling queues created so far by this process, used to give
+ * each one its own segment file names.
+ */
+static int _spillq_count;
+
+/*
+ * This is the structure that represents a spilling queue.  `dir` is NULL if
+ * the queue was created without a spill directory, in which case it never
+ * spills.  Records are allocated and released through `alloc_fn` and
+ * `release_fn`, which default to malloc() and free().
+ */
+struct spillq {
+  struct queue* head;
+  struct queue* tail;
+  char* dir;
+  long pid;
+  int id;
+  int elem_size;
+  int high_water;
+  int seg_records;
+  int first_seg;
+  int next_seg;
+  int size;
+  void* (*alloc_fn)(void* ctx);
+  void (*release_fn)(void* ctx, void* rec);
+  void* alloc_ctx;
+};
+
+/*
+ * Default allocator hooks, which allocate records with malloc().
+ */
+void* _spillq_malloc(void* ctx) {
+  struct spillq* sq = ctx;
+  return malloc(sq->elem_size);
+}
+
+void _spillq_free(void* ctx, void* rec) {
+  free(rec);
+}
+
+/*
+ * Auxilliary function to build the path of segment number `seg`.
+ */
+void _spillq_seg_path(struct spillq* sq, int seg, char* path, size_t len) {
+  snprintf(path, len, "%s/spill-%ld-%d-%010d.seg", sq->dir, sq->pid, sq->id,
+    seg);
+}
+
+/*
+ * Struct passed to _spillq_write_record() while a segment is written: the
+ * segment file, how many records are still to go into it and whether every
+ * write so far has succeeded.
+ */
+struct spillq_writer {
+  FILE* file;
+  int elem_size;
+  int left;
+  int ok;
+};
+
+/*
+ * Auxilliary function to write one record to a segment file, called on each
+ * record in the tail from the front until the segment is full.
+ */
+void _spillq_write_record(void* ctx, void* rec) {
+  struct spillq_writer* writer = ctx;
+  if (writer->left > 0 && writer->ok) {
+    writer->ok = fwrite(rec, writer->elem_size, 1, writer->file) == 1;
+    writer->left--;
+  }
+}
+
+/*
+ * Auxilliary function to write a segment's worth of records from the front
+ * of the tail to a new segment file and free them.  The records are only
+ * dequeued once the segment has been written, so if it can't be, they are
+ * simply left in the tail, in order, and an I/O failure costs memory rather
+ * than data.  Returns 1 if the segment was written or 0 if not.
+ */
+int _spillq_spill_tail(struct spillq* sq) {
+  char path[4096];
+  _spillq_seg_path(sq, sq->next_seg, path, sizeof(path));
+
+  FILE* file = fopen(path, "wb");
+  if (!file) {
+    perror(path);
+    return 0;
+  }
+
+  struct spillq_writer writer = { file, sq->elem_size, sq->seg_records, 1 };
+  queue_foreach(sq->tail, _spillq_write_record, &writer);
+  if (fclose(file) != 0 || !writer.ok) {
+    perror(path);
+    remove(path);
+    return 0;
+  }
+
+  void* records[SPILLQ_MAX_SEG_RECORDS];
+  int n = queue_dequeue_many(sq->tail, records, sq->seg_records);
+  for (int i = 0; i < n; i++) {
+    sq->release_fn(sq->alloc_ctx, records[i]);
+  }
+  sq->next_seg++;
+  return 1;
+}
+
+/*
+ * Auxilliary function to report a segment file that can't be read back and
+ * abort.  The records in it can't be recovered, and carrying on would hand
+ * out the wrong records (or garbage), so there's no way to continue.
+ */
+void _spillq_read_failed(const char* path, FILE* file) {
+  if (file && !ferror(file)) {
+    fprintf(stderr, "%s: segment file is truncated\n", path);
+  } else {
+    perror(path);
+  }
+  abort();
+}
+
+/*
+ * Auxilliary function to refill an empty head, either by reading back the
+ * oldest segment file or, if nothing is on disk, by promoting the tail.
+ */
+void _spillq_refill_head(struct spillq* sq) {
+  if (sq->first_seg < sq->next_seg) {
+    char path[4096];
+    _spillq_seg_path(sq, sq->first_seg, path, sizeof(path));
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+      _spillq_read_failed(path, file);
+    }
+    for (int i = 0; i < sq->seg_records; i++) {
+      void* record = sq->alloc_fn(sq->alloc_ctx);
+      assert(record);
+      if (fread(record, sq->elem_size, 1, file) != 1) {
+        _spillq_read_failed(path, file);
+      }
+      queue_enqueue(sq->head, record);
+    }
+    fclose(file);
+    remove(path);
+    sq->first_seg++;
+  } else {
+    struct queue* temp = sq->head;
+    sq->head = sq->tail;
+    sq->tail = temp;
+  }
+}
+
+/*
+ * This function allocates and initializes a new, empty spilling queue and
+ * returns a pointer to it.
+ *
+ * Params:
+ *   dir - an existing directory in which to create segment files.  If NULL,
+ *     the queue never spills and keeps every record in memory.
+ *   elem_size - the size in bytes of each record.  Must be positive.
+ *   high_water - the number of records the queue keeps in memory before it
+ *     starts spilling.  Must be positive.
+ */
+struct spillq* spillq_create(const char* dir, int elem_size, int high_water) {
+  assert(elem_size > 0);
+  assert(high_water > 0);
+
+  struct spillq* sq = malloc(sizeof(struct spillq));
+  assert(sq);
+  sq->head = queue_create();
+  sq->tail = queue_create();
+  sq->dir = NULL;
+  if (dir) {
+    sq->dir = malloc(strlen(dir) + 1);
+    assert(sq->dir);
+    strcpy(sq->dir, dir);
+  }
+  sq->pid = (long)getpid();
+  sq->id = __atomic_fetch_add(&_spillq_count, 1, __ATOMIC_RELAXED);
+  sq->elem_size = elem_size;
+  sq->high_water = high_water;
+
+  /*
+   * Segments are a quarter of the high-water mark (within limits), so a
+   * spilled queue holds at most 1.5x the high-water mark in memory.
+   */
+  sq->seg_records = high_water / 4;
+  if (sq->seg_records < 1) {
+    sq->seg_records = 1;
+  } else if (sq->seg_records > SPILLQ_MAX_SEG_RECORDS) {
+    sq->seg_records = SPILLQ_MAX_SEG_RECORDS;
+  }
+  sq->first_seg = sq->next_seg = 0;
+  sq->size = 0;
+  sq->alloc_fn = _spillq_malloc;
+  sq->release_fn = _spillq_free;
+  sq->alloc_ctx = sq;
+  return sq;
+}
+
+/*
+ * This function frees the memory associated with a spilling queue, releases
+ * any records still in memory and removes any segment files still on disk.
+ *
+ * Params:
+ *   sq - the spilling queue to be destroyed.  May not be NULL.
+ */
+void spillq_free(struct spillq* sq) {
+  assert(sq);
+  while (!queue_isempty(sq->head)) {
+    sq->release_fn(sq->alloc_ctx, queue_dequeue(sq->head));
+  }
+  while (!queue_isempty(sq->tail)) {
+    sq->release_fn(sq->alloc_ctx, queue_dequeue(sq->tail));
+  }
+  for (int seg = sq->first_seg; seg < sq->next_seg; seg++) {
+    char path[4096];
+    _spillq_seg_path(sq, seg, path, sizeof(path));
+    remove(path);
+  }
+  queue_free(sq->head);
+  queue_free(sq->tail);
+  free(sq->dir);
+  free(sq);
+}
+
+/*
+ * This function replaces the functions a spilling queue uses to allocate
+ * records read back from disk and to release records once they've been
+ * written to disk (or when the queue is freed).  It must be called before
+ * the first record is enqueued.
+ *
+ * Params:
+ *   sq - the spilling queue to configure.  May not be NULL.
+ *   alloc_fn - returns a new record of at least `elem_size` bytes.  May not
+ *     be NULL.
+ *   release_fn - releases a record obtained from `alloc_fn`.  May not be
+ *     NULL.
+ *   ctx - an arbitrary pointer passed through unchanged to both functions.
+ */
+void spillq_set_allocator(struct spillq* sq, void* (*alloc_fn)(void* ctx),
+    void (*release_fn)(void* ctx, void* rec), void* ctx) {
+  assert(sq);
+  assert(alloc_fn && release_fn);
+  assert(sq->size == 0);
+  sq->alloc_fn = alloc_fn;
+  sq->release_fn = release_fn;
+  sq->alloc_ctx = ctx;
+}
+
+/*
+ * This function returns 1 if a given spilling queue is empty and 0
+ * otherwise.
+ */
+int spillq_isempty(struct spillq* sq) {
+  assert(sq);
+  return sq->size == 0;
+}
+
+/*
+ * This function returns the total number of records in a given spilling
+ * queue, in memory and on disk.
+ */
+int spillq_size(struct spillq* sq) {
+  assert(sq);
+  return sq->size;
+}
+
+/*
+ * This function returns the number of records in a given spilling queue that
+ * are currently on disk rather than in memory.
+ */
+int spillq_spilled(struct spillq* sq) {
+  assert(sq);
+  return (sq->next_seg - sq->first_seg) * sq->seg_records;
+}
+
+/*
+ * This function enqueues a record into a spilling queue.
+ *
+ * Params:
+ *   sq - the spilling queue into which to enqueue.  May not be NULL.
+ *   val - a record of `elem_size` bytes obtained from the queue's allocator
+ *     (malloc() unless spillq_set_allocator() was called).  The queue takes
+ *     ownership of the record: if it's spilled, it is released here and a
+ *     new copy is allocated when it's read back, so the pointer later
+ *     returned by spillq_dequeue() may differ from `val`.
+ */
+void spillq_enqueue(struct spillq* sq, void* val) {
+  assert(sq);
+  assert(val);
+
+  if (!sq->dir || (sq->first_seg == sq->next_seg &&
+      queue_isempty(sq->tail) && queue_size(sq->head) < sq->high_water)) {
+    queue_enqueue(sq->head, val);
+  } else {
+    queue_enqueue(sq->tail, val);
+
+    /*
+     * After a failed spill the tail can hold more than a segment's worth,
+     * so write out as many full segments as it has.
+     */
+    while (queue_size(sq->tail) >= sq->seg_records) {
+      if (!_spillq_spill_tail(sq)) {
+        break;
+      }
+    }
+  }
+  sq->size++;
+}
+
+/*
+ * This function enqueues `n` records into a spilling queue at once, in
+ * order, as if by `n` calls to spillq_enqueue().  Records that go straight
+ * to the in-memory head are appended in one bulk copy; any that would spill
+ * are enqueued one at a time.
+ *
+ * Params:
+ *   sq - the spilling queue into which to enqueue.  May not be NULL.
+ *   vals - the records to enqueue, as for spillq_enqueue().  May not be NULL
+ *     unless `n` is 0.
+ *   n - the number of records to enqueue.
+ */
+void spillq_enqueue_many(struct spillq* sq, void** vals, int n) {
+  assert(sq);
+  assert(n >= 0);
+
+  int direct = n;
+  if (sq->dir) {
+    direct = 0;
+    if (sq->first_seg == sq->next_seg && queue_isempty(sq->tail)) {
+      direct = sq->high_water - queue_size(sq->head);
+      direct = direct < 0 ? 0 : direct > n ? n : direct;
+    }
+  }
+  queue_enqueue_many(sq->head, vals, direct);
+  sq->size += direct;
+  for (int i = direct; i < n; i++) {
+    spillq_enqueue(sq, vals[i]);
+  }
+}
+
+/*
+ * This function calls a function on every record in a spilling queue, from
+ * the front to the back, without removing any of them.  Spilled segments are
+ * read back one at a time into a scratch buffer, so a record on disk is only
+ * valid for the duration of the call it's passed to.  If a segment can't be
+ * read back, this prints an error and aborts the program.
+ *
+ * Params:
+ *   sq - the spilling queue to walk.  May not be NULL.
+ *   fn - the function to call, with `ctx` and each record.  It must not
+ *     modify the queue.
+ *   ctx - an arbitrary pointer passed through unchanged to `fn`.
+ */
+void spillq_foreach(struct spillq* sq, void (*fn)(void* ctx, void* rec),
+    void* ctx) {
+  assert(sq);
+  queue_foreach(sq->head, fn, ctx);
+
+  if (sq->first_seg < sq->next_seg) {
+    char* buf = malloc((size_t)sq->seg_records * sq->elem_size);
+    assert(buf);
+    for (int seg = sq->first_seg; seg < sq->next_seg; seg++) {
+      char path[4096];
+      _spillq_seg_path(sq, seg, path, sizeof(path));
+      FILE* file = fopen(path, "rb");
+      if (!file || fread(buf, sq->elem_size, sq->seg_records, file) !=
+          (size_t)sq->seg_records) {
+        _spillq_read_failed(path, file);
+      }
+      fclose(file);
+      for (int i = 0; i < sq->seg_records; i++) {
+        fn(ctx, buf + (size_t)i * sq->elem_size);
+      }
+    }
+    free(buf);
+  }
+
+  queue_foreach(sq->tail, fn, ctx);
+}
+
+/*
+ * This function returns the record at the front of a given spilling queue
+ * without removing it.  This may read a segment back from disk; if the
+ * segment can't be read, this prints an error and aborts the program.
+ *
+ * Params:
+ *   sq - the spilling queue from which to query the front record.  May not
+ *     be NULL or empty.
+ */
+void* spillq_front(struct spillq* sq) {
+  assert(sq);
+  assert(sq->size > 0);
+  if (queue_isempty(sq->head)) {
+    _spillq_refill_head(sq);
+  }
+  return queue_front(sq->head);
+}
+
+/*
+ * This function dequeues a record from a given spilling queue and returns
+ * it.  The caller takes ownership of the returned record and must release it
+ * with the queue's allocator (free() by default).  Like spillq_front(), this
+ * may read a segment back from disk, and aborts if it can't.
+ *
+ * Params:
+ *   sq - the spilling queue from which to dequeue.  May not be NULL or
+ *     empty.
+ */
+void* spillq_dequeue(struct spillq* sq) {
+  void* val = spillq_front(sq);
+  queue_dequeue(sq->head);
+  sq->size--;
+  return val;
+}
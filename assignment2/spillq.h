@@ -0,0 +1,34 @@
+/*
+ * This file contains the definition of the interface for a queue that spills
+ * to disk once it holds more than a configured number of records in memory.
+ * You can find descriptions of the spilling queue functions, including their
+ * parameters and their return values, in spillq.c.
+ */
+
+#ifndef __SPILLQ_H
+#define __SPILLQ_H
+
+/*
+ * Structure used to represent a spilling queue.
+ */
+struct spillq;
+
+/*
+ * Spilling queue interface function prototypes.  Refer to spillq.c for
+ * documentation about each of these functions.
+ */
+struct spillq* spillq_create(const char* dir, int elem_size, int high_water);
+void spillq_free(struct spillq* sq);
+void spillq_set_allocator(struct spillq* sq, void* (*alloc_fn)(void* ctx),
+  void (*release_fn)(void* ctx, void* rec), void* ctx);
+int spillq_isempty(struct spillq* sq);
+int spillq_size(struct spillq* sq);
+int spillq_spilled(struct spillq* sq);
+void spillq_enqueue(struct spillq* sq, void* val);
+void spillq_enqueue_many(struct spillq* sq, void** vals, int n);
+void spillq_foreach(struct spillq* sq, void (*fn)(void* ctx, void* rec),
+  void* ctx);
+void* spillq_front(struct spillq* sq);
+void* spillq_dequeue(struct spillq* sq);
+
+#endif
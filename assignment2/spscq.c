@@ -0,0 +1,176 @@
+/*
+ * This file contains an implementation of a bounded, lock-free ring queue
+ * for exactly one producer thread and exactly one consumer thread.  See the
+ * documentation below for more information on the individual functions in
+ * this implementation.
+ *
+ * The producer owns `tail` and the consumer owns `head`; each only ever
+ * writes its own index, so no compare-and-swap is needed, just a release
+ * store to publish an index and an acquire load to read the other side's.
+ * The two indices live on separate cache lines so the producer and consumer
+ * don't invalidate each other's line on every operation.  Each side also
+ * keeps a private cached copy of the other side's index and only re-reads
+ * the shared one when the cached copy says the ring is full (or empty).
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include <sched.h>
+
+#include "spscq.h"
+
+#define SPSCQ_CACHE_LINE 64
+
+/*
+ * This is the structure that represents an SPSC ring queue.  Indices count
+ * up forever and are reduced modulo the (power of two) capacity with `mask`
+ * when used to address `slots`.
+ */
+struct spscq {
+  /*
+   * Consumer-owned line.
+   */
+  uint64_t head;
+  uint64_t cached_tail;
+  char pad0[SPSCQ_CACHE_LINE - 2 * sizeof(uint64_t)];
+
+  /*
+   * Producer-owned line.
+   */
+  uint64_t tail;
+  uint64_t cached_head;
+  char pad1[SPSCQ_CACHE_LINE - 2 * sizeof(uint64_t)];
+
+  /*
+   * Read-only after creation.
+   */
+  uint64_t mask;
+  void** slots;
+};
+
+/*
+ * This function allocates and initializes a new, empty SPSC ring queue and
+ * returns a pointer to it.
+ *
+ * Params:
+ *   capacity - the minimum number of values the queue must be able to hold.
+ *     It is rounded up to the next power of two.  Must be positive.
+ */
+struct spscq* spscq_create(int capacity) {
+  assert(capacity > 0);
+
+  uint64_t size = 1;
+  while (size < (uint64_t)capacity) {
+    size <<= 1;
+  }
+
+  struct spscq* queue;
+  int err = posix_memalign((void**)&queue, SPSCQ_CACHE_LINE,
+    sizeof(struct spscq));
+  assert(err == 0);
+  queue->head = queue->cached_tail = 0;
+  queue->tail = queue->cached_head = 0;
+  queue->mask = size - 1;
+  queue->slots = malloc(size * sizeof(void*));
+  assert(queue->slots);
+  return queue;
+}
+
+/*
+ * This function frees the memory associated with an SPSC ring queue.  It must
+ * not be called while either thread is still using the queue.  Freeing any
+ * memory associated with values still stored in the queue is the
+ * responsibility of the caller.
+ *
+ * Params:
+ *   queue - the queue to be destroyed.  May not be NULL.
+ */
+void spscq_free(struct spscq* queue) {
+  assert(queue);
+  free(queue->slots);
+  free(queue);
+}
+
+/*
+ * This function attempts to enqueue a value without waiting.  It may only be
+ * called from the queue's single producer thread.
+ *
+ * Params:
+ *   queue - the queue into which to enqueue.  May not be NULL.
+ *   val - the value to be enqueued.
+ *
+ * Return:
+ *   This function returns 1 if the value was enqueued or 0 if the queue was
+ *   full.
+ */
+int spscq_try_enqueue(struct spscq* queue, void* val) {
+  uint64_t tail = queue->tail;
+  if (tail - queue->cached_head > queue->mask) {
+    queue->cached_head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+    if (tail - queue->cached_head > queue->mask) {
+      return 0;
+    }
+  }
+  queue->slots[tail & queue->mask] = val;
+  __atomic_store_n(&queue->tail, tail + 1, __ATOMIC_RELEASE);
+  return 1;
+}
+
+/*
+ * This function attempts to dequeue a value without waiting.  It may only be
+ * called from the queue's single consumer thread.
+ *
+ * Params:
+ *   queue - the queue from which to dequeue.  May not be NULL.
+ *
+ * Return:
+ *   This function returns the value that was dequeued, or NULL if the queue
+ *   was empty.  Because of this, NULL values should not be enqueued.
+ */
+void* spscq_try_dequeue(struct spscq* queue) {
+  uint64_t head = queue->head;
+  if (head == queue->cached_tail) {
+    queue->cached_tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+    if (head == queue->cached_tail) {
+      return NULL;
+    }
+  }
+  void* val = queue->slots[head & queue->mask];
+  __atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+  return val;
+}
+
+/*
+ * This function enqueues a value, yielding the processor while the queue is
+ * full.  It may only be called from the queue's single producer thread.
+ *
+ * Params:
+ *   queue - the queue into which to enqueue.  May not be NULL.
+ *   val - the value to be enqueued.
+ */
+void spscq_enqueue(struct spscq* queue, void* val) {
+  while (!spscq_try_enqueue(queue, val)) {
+    sched_yield();
+  }
+}
+
+/*
+ * This function dequeues a value, yielding the processor while the queue is
+ * empty.  It may only be called from the queue's single consumer thread.
+ *
+ * Params:
+ *   queue - the queue from which to dequeue.  May not be NULL.
+ *
+ * Return:
+ *   This function returns the value that was dequeued.
+ */
+void* spscq_dequeue(struct spscq* queue) {
+  void* val;
+  while ((val = spscq_try_dequeue(queue)) == NULL) {
+    sched_yield();
+  }
+  return val;
+}
@@ -0,0 +1,27 @@
+/*
+ * This file contains the definition of the interface for a bounded, lock-free
+ * single-producer/single-consumer ring queue.  You can find descriptions of
+ * the SPSC queue functions, including their parameters and their return
+ * values, in spscq.c.
+ */
+
+#ifndef __SPSCQ_H
+#define __SPSCQ_H
+
+/*
+ * Structure used to represent an SPSC ring queue.
+ */
+struct spscq;
+
+/*
+ * SPSC ring queue interface function prototypes.  Refer to spscq.c for
+ * documentation about each of these functions.
+ */
+struct spscq* spscq_create(int capacity);
+void spscq_free(struct spscq* queue);
+int spscq_try_enqueue(struct spscq* queue, void* val);
+void* spscq_try_dequeue(struct spscq* queue);
+void spscq_enqueue(struct spscq* queue, void* val);
+void* spscq_dequeue(struct spscq* queue);
+
+#endif
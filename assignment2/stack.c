@@ -10,31 +10,80 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include "stack.h"
-#include "list.h"
+
+#define STACK_INIT_CAPACITY 16
 
 /*
- * This is the structure that will be used to represent a stack.  This
- * structure specifically contains a single field representing a linked list
- * that should be used as the underlying data storage for the stack.
- *
- * You should not modify this structure.
+ * This is the structure that will be used to represent a stack.  Values are
+ * stored in a contiguous array with the top of the stack at data[size - 1],
+ * so pushing and popping never allocate or free individual nodes.  A stack
+ * created with stack_create() doubles its array when full; one created with
+ * stack_create_fixed() preallocates its array once and never grows.
  */
 struct stack {
-  struct list* list;
+  void** data;
+  int size;
+  int capacity;
+  int fixed;
 };
 
 /*
- * This function should allocate and initialize a new, empty stack and return
- * a pointer to it.
+ * Auxilliary function to allocate a stack with a given initial capacity.
  */
-struct stack* stack_create() {
+struct stack* _stack_create(int capacity, int fixed) {
 	struct stack* stack = malloc(sizeof(struct stack));
-	stack->list = list_create();
+	assert(stack);
+	stack->data = malloc(capacity * sizeof(void*));
+	assert(stack->data);
+	stack->size = 0;
+	stack->capacity = capacity;
+	stack->fixed = fixed;
 	return stack;
 }
 
+/*
+ * Auxilliary function to make sure a growable stack has room for at least
+ * `needed` values, doubling its capacity as many times as necessary.
+ */
+void _stack_reserve(struct stack* stack, int needed) {
+	if (needed <= stack->capacity) {
+		return;
+	}
+	int capacity = stack->capacity;
+	while (capacity < needed) {
+		capacity *= 2;
+	}
+	void** data = realloc(stack->data, capacity * sizeof(void*));
+	assert(data);
+	stack->data = data;
+	stack->capacity = capacity;
+}
+
+/*
+ * This function should allocate and initialize a new, empty stack and return
+ * a pointer to it.  The stack grows as needed.
+ */
+struct stack* stack_create() {
+	return _stack_create(STACK_INIT_CAPACITY, 0);
+}
+
+/*
+ * This function allocates and initializes a new, empty stack that can hold
+ * at most `capacity` values.  All storage is allocated up front and the
+ * stack never reallocates, so pushes have a strict O(1) bound.
+ *
+ * Params:
+ *   capacity - the maximum number of values the stack may hold.  Must be
+ *     positive.
+ */
+struct stack* stack_create_fixed(int capacity) {
+	assert(capacity > 0);
+	return _stack_create(capacity, 1);
+}
+
 /*
  * This function should free the memory associated with a stack.  While this
  * function should up all memory used in the stack itself, it should not free
@@ -46,7 +95,7 @@ struct stack* stack_create() {
  */
 void stack_free(struct stack* stack) {
 	assert(stack);
-	list_free(stack->list);
+	free(stack->data);
 	free(stack);
 }
 
@@ -60,7 +109,19 @@ void stack_free(struct stack* stack) {
  */
 int stack_isempty(struct stack* stack) {
 	assert(stack);
-	return list_isempty(stack->list);
+	return stack->size == 0;
+}
+
+/*
+ * This function returns the number of values currently stored in a given
+ * stack.  This function has O(1) runtime complexity.
+ *
+ * Params:
+ *   stack - the stack whose size is being queried.  May not be NULL.
+ */
+int stack_size(struct stack* stack) {
+	assert(stack);
+	return stack->size;
 }
 
 /*
@@ -70,12 +131,18 @@ int stack_isempty(struct stack* stack) {
  *
  * Params:
  *   stack - the stack onto which a value is to be pushed.  May not be NULL.
+ *     If the stack was created with stack_create_fixed(), it may not be full.
  *   val - the value to be pushed.  Note that this parameter has type void*,
  *     which means that a pointer of any type can be passed.
  */
 void stack_push(struct stack* stack, void* val) {
 	assert(stack);
-	list_insert(stack->list, val);
+	if (stack->fixed) {
+		assert(stack->size < stack->capacity);
+	} else {
+		_stack_reserve(stack, stack->size + 1);
+	}
+	stack->data[stack->size++] = val;
 }
 
 /*
@@ -85,10 +152,13 @@ void stack_push(struct stack* stack, void* val) {
  *
  * Params:
  *   stack - the stack from which to query the top value.  May not be NULL.
+ *
+ * Return:
+ *   This function returns the top value, or NULL if the stack is empty.
  */
 void* stack_top(struct stack* stack) {
 	assert(stack);
-	return list_head_value(stack->list);
+	return stack->size > 0 ? stack->data[stack->size - 1] : NULL;
 }
 
 /*
@@ -99,11 +169,71 @@ void* stack_top(struct stack* stack) {
  *   stack - the stack from which a value is to be popped.  May not be NULL.
  *
  * Return:
- *   This function should return the value that was popped.
+ *   This function should return the value that was popped, or NULL if the
+ *   stack is empty.
  */
 void* stack_pop(struct stack* stack) {
 	assert(stack);
-	void* val = list_head_value(stack->list);
-	list_remove_head(stack->list);
-	return val;
+	return stack->size > 0 ? stack->data[--stack->size] : NULL;
+}
+
+/*
+ * This function pushes an array of values onto a given stack with a single
+ * copy.  The values are pushed in array order, so vals[n - 1] ends up on top,
+ * exactly as if stack_push() had been called on each value in turn.
+ *
+ * Params:
+ *   stack - the stack onto which values are to be pushed.  May not be NULL.
+ *   vals - the values to be pushed.  May not be NULL unless `n` is 0.
+ *   n - the number of values in `vals`.
+ *
+ * Return:
+ *   This function returns the number of values pushed.  This is always `n`
+ *   for a growable stack; for a fixed-capacity stack it is however many of
+ *   the first values in `vals` fit.
+ */
+int stack_push_many(struct stack* stack, void** vals, int n) {
+	assert(stack);
+	assert(n >= 0);
+	if (stack->fixed) {
+		if (n > stack->capacity - stack->size) {
+			n = stack->capacity - stack->size;
+		}
+	} else {
+		_stack_reserve(stack, stack->size + n);
+	}
+	if (n > 0) {
+		memcpy(stack->data + stack->size, vals, n * sizeof(void*));
+		stack->size += n;
+	}
+	return n;
+}
+
+/*
+ * This function pops up to `n` values from a given stack with a single copy.
+ * The popped values are stored in `out` in the order they were pushed, so
+ * out[k - 1] holds the former top of the stack and passing `out` straight
+ * back to stack_push_many() restores the stack.
+ *
+ * Params:
+ *   stack - the stack from which values are to be popped.  May not be NULL.
+ *   out - an array with room for at least `n` values.  May not be NULL
+ *     unless `n` is 0.
+ *   n - the maximum number of values to pop.
+ *
+ * Return:
+ *   This function returns the number of values popped, k, which is less than
+ *   `n` only if the stack held fewer than `n` values.
+ */
+int stack_pop_many(struct stack* stack, void** out, int n) {
+	assert(stack);
+	assert(n >= 0);
+	if (n > stack->size) {
+		n = stack->size;
+	}
+	stack->size -= n;
+	if (n > 0) {
+		memcpy(out, stack->data + stack->size, n * sizeof(void*));
+	}
+	return n;
 }
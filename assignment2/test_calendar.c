@@ -0,0 +1,121 @@
+/*
+ * This file contains executable code for testing the calendar queue
+ * implementation against the binary heap in pq.c, which should produce
+ * exactly the same sequence of values.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include "calendar.h"
+#include "pq.h"
+
+/*
+ * Removes `n` elements (or all of them, if `n` is -1) from both queues and
+ * returns the number of removals at which they disagreed.
+ */
+int drain(struct calendar* cal, struct pq* pq, int n) {
+  int mismatches = 0;
+  while (n-- != 0 && !pq_isempty(pq)) {
+    if (calendar_isempty(cal) ||
+        calendar_first_priority(cal) != pq_first_priority(pq) ||
+        calendar_first(cal) != pq_first(pq) ||
+        calendar_remove_first(cal) != pq_remove_first(pq)) {
+      mismatches++;
+    }
+  }
+  return mismatches;
+}
+
+/*
+ * Inserts the same element into both queues.
+ */
+void insert_both(struct calendar* cal, struct pq* pq, intptr_t value,
+    int priority) {
+  calendar_insert(cal, (void*)value, priority);
+  pq_insert(pq, (void*)value, priority);
+}
+
+int main(int argc, char** argv) {
+  struct calendar* cal;
+  struct pq* pq;
+  int i, now;
+  intptr_t v = 1;
+
+  srand(0);
+
+  cal = calendar_create();
+  pq = pq_create();
+  printf("== Empty queue: isempty, first (expect 1 0): %d %d\n",
+    calendar_isempty(cal), calendar_first(cal) != NULL);
+
+  /*
+   * Random priorities over the whole int range, including INT_MIN and
+   * INT_MAX.
+   */
+  insert_both(cal, pq, v++, INT_MAX);
+  insert_both(cal, pq, v++, INT_MIN);
+  for (i = 0; i < 10000; i++) {
+    insert_both(cal, pq, v++, (int)((unsigned)rand() * 2654435761u));
+  }
+  printf("== Size after random inserts (expect %d): %d\n", pq_size(pq),
+    calendar_size(cal));
+  printf("== Random priorities: mismatches (expect 0): %d\n",
+    drain(cal, pq, -1));
+
+  /*
+   * Many equal priorities come out in insertion order.
+   */
+  for (i = 0; i < 5000; i++) {
+    insert_both(cal, pq, v++, rand() % 8);
+  }
+  printf("== Ties: mismatches (expect 0): %d\n", drain(cal, pq, -1));
+
+  /*
+   * The hold model: remove the first element and schedule another a random
+   * time after it, as a simulation does, while the queue grows and shrinks.
+   */
+  now = 0;
+  for (i = 0; i < 1000; i++) {
+    insert_both(cal, pq, v++, now + rand() % 1000);
+  }
+  int mismatches = 0;
+  for (i = 0; i < 200000; i++) {
+    now = pq_first_priority(pq);
+    mismatches += drain(cal, pq, 1);
+    insert_both(cal, pq, v++, now + rand() % 1000);
+    if (i % 4 == 0 || i > 150000) {
+      insert_both(cal, pq, v++, now + rand() % 100000);
+    }
+    if (i > 100000 && i < 150000 && i % 2 == 0) {
+      mismatches += drain(cal, pq, 1);
+    }
+  }
+  printf("== Hold model: size, mismatches (expect %d 0): %d %d\n",
+    pq_size(pq), calendar_size(cal), mismatches);
+  printf("== Hold model drained: mismatches (expect 0): %d\n",
+    drain(cal, pq, -1));
+
+  /*
+   * Inserting before the last element removed, and after a long gap.
+   */
+  now = 1000000;
+  for (i = 0; i < 100; i++) {
+    insert_both(cal, pq, v++, now + i * 10);
+  }
+  mismatches = drain(cal, pq, 50);
+  for (i = 0; i < 100; i++) {
+    insert_both(cal, pq, v++, now - 5000 + rand() % 10000);
+  }
+  insert_both(cal, pq, v++, now + 2000000000);
+  insert_both(cal, pq, v++, -now);
+  mismatches += drain(cal, pq, -1);
+  printf("== Past and far-future inserts: mismatches, isempty (expect 0 1):"
+    " %d %d\n", mismatches, calendar_isempty(cal));
+
+  calendar_free(cal);
+  pq_free(pq);
+  return 0;
+}
@@ -0,0 +1,60 @@
+/*
+ * This file contains executable code for testing the call pool
+ * implementation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "callpool.h"
+
+int main(int argc, char** argv) {
+  int i, n = 100, slab = 16, errors = 0;
+  struct call** calls;
+  struct call_pool* pool;
+
+  calls = malloc(n * sizeof(struct call*));
+  pool = call_pool_create(slab);
+
+  /*
+   * Acquire more calls than fit in one slab and make sure each one keeps
+   * its own contents.
+   */
+  printf("== Acquiring %d calls from slabs of %d.\n", n, slab);
+  for (i = 0; i < n; i++) {
+    char name[50];
+    snprintf(name, sizeof(name), "Caller %d", i);
+    calls[i] = call_pool_create_call(pool, i, name, "Testing");
+  }
+  for (i = 0; i < n; i++) {
+    char name[50];
+    snprintf(name, sizeof(name), "Caller %d", i);
+    if (calls[i]->id != i || strcmp(calls[i]->name, name) != 0) {
+      errors++;
+    }
+  }
+  printf("== Content errors (expect 0): %d\n", errors);
+  printf("== Outstanding (expect %d): %d\n", n, call_pool_outstanding(pool));
+
+  /*
+   * Released calls should be handed out again, most recently released
+   * first, before any new slab is allocated.
+   */
+  call_pool_release(pool, calls[10]);
+  call_pool_release(pool, calls[20]);
+  printf("\n== Outstanding after 2 releases (expect %d): %d\n", n - 2,
+    call_pool_outstanding(pool));
+  struct call* a = call_pool_acquire(pool);
+  struct call* b = call_pool_acquire(pool);
+  printf("== Reused released records (expect 1)? %d\n",
+    a == calls[20] && b == calls[10]);
+
+  /*
+   * Freeing the pool releases every call at once, released or not.
+   */
+  call_pool_free(pool);
+  free(calls);
+
+  return 0;
+}
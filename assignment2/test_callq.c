@@ -0,0 +1,119 @@
+/*
+ * This file contains executable code for testing the call queue
+ * implementation.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "callq.h"
+
+int main(int argc, char** argv) {
+  int i, n = 1000, errors = 0, cancelled = 0;
+  struct call_pool* pool = call_pool_create(64);
+  struct callq* cq = callq_create(NULL, 100000, pool);
+
+  /*
+   * Enqueue calls with IDs 1..n, then cancel every third one.
+   */
+  printf("== Enqueueing %d calls.\n", n);
+  for (i = 1; i <= n; i++) {
+    callq_enqueue(cq, call_pool_create_call(pool, i, "Caller", "Testing"));
+  }
+  printf("== Size (expect %d): %d\n", n, callq_size(cq));
+
+  for (i = 3; i <= n; i += 3) {
+    cancelled += callq_cancel(cq, i);
+  }
+  printf("\n== Cancelled every third call (expect %d): %d\n", n / 3, cancelled);
+  printf("== Size (expect %d): %d\n", n - n / 3, callq_size(cq));
+  printf("== Call 9 waiting (expect 0)? %d\n", callq_is_waiting(cq, 9));
+  printf("== Call 10 waiting (expect 1)? %d\n", callq_is_waiting(cq, 10));
+  printf("== Cancel call 9 again (expect 0): %d\n", callq_cancel(cq, 9));
+  printf("== Cancel unknown call (expect 0): %d\n", callq_cancel(cq, n + 1));
+
+  /*
+   * Cancelling the front call should make the next live call the front.
+   */
+  callq_cancel(cq, 1);
+  callq_cancel(cq, 2);
+  printf("\n== Front after cancelling 1 and 2 (expect 4): %d\n",
+    callq_front(cq)->id);
+
+  /*
+   * Dequeueing should skip every cancelled call and keep FIFO order.
+   */
+  int prev = 0, count = 0;
+  struct call* c;
+  while ((c = callq_dequeue(cq)) != NULL) {
+    if (c->id <= prev || c->id % 3 == 0 || c->id <= 2) {
+      errors++;
+    }
+    prev = c->id;
+    count++;
+    call_pool_release(pool, c);
+  }
+  printf("== Dequeued (expect %d): %d\n", n - n / 3 - 2, count);
+  printf("== Order errors (expect 0): %d\n", errors);
+  printf("== Is empty (expect 1)? %d\n", callq_isempty(cq));
+  printf("== Outstanding records (expect 0): %d\n",
+    call_pool_outstanding(pool));
+
+  /*
+   * A call dequeued and answered is no longer waiting, so it can't be
+   * cancelled.
+   */
+  callq_enqueue(cq, call_pool_create_call(pool, n + 1, "Caller", "Testing"));
+  c = callq_dequeue(cq);
+  printf("\n== Cancel answered call (expect 0): %d\n", callq_cancel(cq, c->id));
+  call_pool_release(pool, c);
+
+  /*
+   * An abandonment storm: cancel everything but the last call.
+   */
+  for (i = n + 2; i <= 2 * n; i++) {
+    callq_enqueue(cq, call_pool_create_call(pool, i, "Caller", "Testing"));
+  }
+  for (i = n + 2; i < 2 * n; i++) {
+    callq_cancel(cq, i);
+  }
+  c = callq_dequeue(cq);
+  printf("\n== Survivor of storm (expect %d): %d\n", 2 * n, c->id);
+  printf("== Outstanding records (expect 1): %d\n",
+    call_pool_outstanding(pool));
+  call_pool_release(pool, c);
+
+  /*
+   * IDs that share their low bits (here every 4096th ID) mustn't pile up in
+   * one probe sequence of the ID set, which would make this run over ten
+   * times slower.
+   */
+  struct timespec t0, t1;
+  int stride = 4096, strided = 50000, waiting = 0;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for (i = 1; i <= strided; i++) {
+    callq_enqueue(cq, call_pool_create_call(pool, i * stride, "Caller",
+      "Testing"));
+  }
+  for (i = 1; i <= strided; i += 2) {
+    callq_cancel(cq, i * stride);
+  }
+  for (i = 1; i <= strided; i++) {
+    waiting += callq_is_waiting(cq, i * stride);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  printf("\n== Strided IDs still waiting (expect %d): %d\n", strided / 2,
+    waiting);
+  fprintf(stderr, "%d strided IDs: %.1f ms\n", strided,
+    (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6);
+  while ((c = callq_dequeue(cq)) != NULL) {
+    call_pool_release(pool, c);
+  }
+
+  callq_free(cq);
+  call_pool_free(pool);
+  return 0;
+}
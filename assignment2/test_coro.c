@@ -0,0 +1,175 @@
+/*
+ * This file contains executable code for testing the coroutine scheduler
+ * implementation.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "coro.h"
+
+#define STACK_SIZE 16384
+#define NUM_CORO 100000
+#define NUM_SLEEPS 10
+
+char trace[256];
+
+/*
+ * Appends a coroutine's name and the clock to the trace.
+ */
+void note(struct coro_sched* s, const char* name) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%s@%lld ", name, coro_now(s));
+  strcat(trace, buf);
+}
+
+void ping(struct coro_sched* s, void* arg) {
+  for (int i = 0; i < 3; i++) {
+    note(s, arg);
+    coro_yield(s);
+  }
+}
+
+void sleeper(struct coro_sched* s, void* arg) {
+  coro_sleep(s, 0);
+  note(s, arg);
+  coro_sleep(s, strlen(arg) * 10);
+  note(s, arg);
+  coro_sleep(s, 5);
+  note(s, arg);
+}
+
+/*
+ * A queue of "calls" for the waiting test: consumers wait for items, which
+ * a producer adds one at a time.
+ */
+struct line {
+  struct coro_waitq* not_empty;
+  int items;
+  int closed;
+  int taken;
+};
+
+struct line line;
+
+void consumer(struct coro_sched* s, void* arg) {
+  while (1) {
+    while (line.items == 0) {
+      if (line.closed) {
+        return;
+      }
+      coro_wait(s, line.not_empty);
+    }
+    line.items--;
+    line.taken++;
+    note(s, arg);
+    coro_sleep(s, 10);
+  }
+}
+
+void producer(struct coro_sched* s, void* arg) {
+  for (int i = 0; i < 4; i++) {
+    coro_sleep(s, 1);
+    line.items++;
+    coro_wake_one(s, line.not_empty);
+  }
+  coro_sleep(s, 100);
+  line.closed = 1;
+  coro_wake_all(s, line.not_empty);
+}
+
+void waiter(struct coro_sched* s, void* arg) {
+  coro_wait(s, arg);
+}
+
+/*
+ * Coroutine for the scale test: sleeps a pseudo-random number of ticks, a
+ * few times, and counts its wakeups.
+ */
+long wakeups;
+
+void agent(struct coro_sched* s, void* arg) {
+  unsigned long x = (unsigned long)arg * 2654435761u + 1;
+  for (int i = 0; i < NUM_SLEEPS; i++) {
+    x = x * 6364136223846793005u + 1442695040888963407u;
+    coro_sleep(s, (x >> 33) % 1000);
+    wakeups++;
+  }
+}
+
+void spawner(struct coro_sched* s, void* arg) {
+  for (long i = 0; i < NUM_CORO; i++) {
+    coro_spawn(s, agent, (void*)i);
+  }
+}
+
+int main(int argc, char** argv) {
+  struct coro_sched* s;
+
+  s = coro_sched_create(STACK_SIZE);
+  coro_spawn(s, ping, "a");
+  coro_spawn(s, ping, "b");
+  printf("== Run (expect 0 left): %d\n", coro_run(s));
+  printf("== Yields (expect a@0 b@0 a@0 b@0 a@0 b@0): %s\n", trace);
+
+  trace[0] = '\0';
+  coro_spawn(s, sleeper, "ccc");
+  coro_spawn(s, sleeper, "a");
+  coro_spawn(s, sleeper, "bb");
+  coro_run(s);
+  printf("== Sleeps (expect ccc@0 a@0 bb@0 a@10 a@15 bb@20 bb@25 ccc@30"
+    " ccc@35): %s\n", trace);
+  printf("== Clock (expect 35): %lld\n", coro_now(s));
+
+  trace[0] = '\0';
+  line.not_empty = coro_waitq_create();
+  coro_spawn(s, consumer, "x");
+  coro_spawn(s, consumer, "y");
+  coro_spawn(s, producer, NULL);
+  struct coro_waitq* never = coro_waitq_create();
+  coro_spawn(s, waiter, never);
+  printf("\n== Waiting: left waiting (expect 1): %d\n", coro_run(s));
+  printf("== Consumed (expect x@36 y@37 x@46 y@47): %s\n", trace);
+  printf("== Taken (expect 4): %d\n", line.taken);
+  coro_waitq_free(line.not_empty);
+  coro_waitq_free(never);
+  coro_sched_free(s);
+
+  /*
+   * A hundred thousand coroutines sleeping at random, spawned from another
+   * coroutine.
+   */
+  s = coro_sched_create(STACK_SIZE);
+  coro_spawn(s, spawner, NULL);
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  int left = coro_run(s);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  double wall = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+  printf("\n== %d coroutines: left, wakeups (expect 0 %d): %d %ld\n",
+    NUM_CORO, NUM_CORO * NUM_SLEEPS, left, wakeups);
+  fprintf(stderr, "   %ld switches in %.3fs: %.0f ns per wakeup\n",
+    coro_switches(s), wall, wall * 1e9 / coro_switches(s));
+
+  /*
+   * Finished coroutines' stacks are reused.
+   */
+  wakeups = 0;
+  long switches = coro_switches(s);
+  coro_spawn(s, spawner, NULL);
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  left = coro_run(s);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  wall = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+  switches = coro_switches(s) - switches;
+  printf("== Second round: left, wakeups (expect 0 %d): %d %ld\n",
+    NUM_CORO * NUM_SLEEPS, left, wakeups);
+  fprintf(stderr, "   %ld switches in %.3fs: %.0f ns per wakeup\n",
+    switches, wall, wall * 1e9 / switches);
+  coro_sched_free(s);
+  return 0;
+}
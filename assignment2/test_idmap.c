@@ -0,0 +1,58 @@
+/*
+ * This file contains executable code for testing the ID map implementation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "idmap.h"
+
+#define N_IDS 100000
+
+int vals[N_IDS + 1];
+
+int main(int argc, char** argv) {
+  struct idmap* map = idmap_create();
+  int i, wrong;
+
+  for (i = 1; i <= N_IDS; i++) {
+    vals[i] = i;
+    idmap_put(map, i, &vals[i]);
+  }
+  printf("== Size after adding (expect %d): %d\n", N_IDS, idmap_size(map));
+  for (wrong = 0, i = 1; i <= N_IDS; i++) {
+    wrong += idmap_get(map, i) != &vals[i];
+  }
+  printf("== IDs with the wrong value (expect 0): %d\n", wrong);
+  printf("== Missing IDs (expect 1 1 1): %d %d %d\n",
+    idmap_get(map, 0) == NULL, idmap_get(map, -5) == NULL,
+    idmap_get(map, N_IDS + 1) == NULL);
+
+  printf("== Replaced (expect 0): %d\n", idmap_put(map, 7, &vals[8]));
+  printf("== Replaced value (expect 8): %d\n", *(int*)idmap_get(map, 7));
+  idmap_put(map, 7, &vals[7]);
+
+  /*
+   * Removing every other ID hands back its value and leaves the rest
+   * reachable past the holes.
+   */
+  for (wrong = 0, i = 2; i <= N_IDS; i += 2) {
+    wrong += idmap_remove(map, i) != &vals[i];
+  }
+  printf("\n== Removed with the wrong value (expect 0): %d\n", wrong);
+  printf("== Removed twice (expect 1): %d\n", idmap_remove(map, 2) == NULL);
+  printf("== Size after removing (expect %d): %d\n", N_IDS / 2,
+    idmap_size(map));
+  for (wrong = 0, i = 1; i <= N_IDS; i++) {
+    wrong += idmap_get(map, i) != (i % 2 ? &vals[i] : NULL);
+  }
+  printf("== IDs with the wrong value (expect 0): %d\n", wrong);
+
+  for (i = 1; i <= N_IDS; i += 2) {
+    idmap_remove(map, i);
+  }
+  printf("== Size after removing everything (expect 0): %d\n",
+    idmap_size(map));
+  idmap_free(map);
+  return 0;
+}
@@ -0,0 +1,148 @@
+/*
+ * This file contains executable code for testing the call journal
+ * implementation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "journal.h"
+
+#define JOURNAL_PATH "test.journal"
+#define HISTORY 3
+
+/*
+ * The state recovered from a journal.
+ */
+struct state {
+  struct call_pool* pool;
+  struct callq* queue;
+  struct ring* history;
+  struct journal* journal;
+  int next_id;
+};
+
+void state_open(struct state* st) {
+  st->pool = call_pool_create(64);
+  st->queue = callq_create(NULL, 1, st->pool);
+  st->history = ring_create(HISTORY, call_pool_release_fn, st->pool);
+  st->journal = journal_open(JOURNAL_PATH, HISTORY);
+  st->next_id = journal_load(st->journal, st->queue, st->history, st->pool);
+}
+
+void state_close(struct state* st) {
+  journal_close(st->journal);
+  callq_free(st->queue);
+  ring_free(st->history);
+  call_pool_free(st->pool);
+}
+
+/*
+ * Prints the waiting calls (without disturbing them) and the history.
+ */
+void print_state(struct state* st) {
+  int n;
+  struct call** answered = (struct call**)ring_last_k(st->history, HISTORY,
+    &n);
+  printf("  - next ID %d, history:", st->next_id);
+  for (int i = 0; i < n; i++) {
+    printf(" %d", answered[i]->id);
+  }
+  printf(", waiting:");
+  struct callq* tmp = callq_create(NULL, 1, st->pool);
+  struct call* c;
+  while ((c = callq_dequeue(st->queue)) != NULL) {
+    printf(" %d", c->id);
+    callq_enqueue(tmp, c);
+  }
+  while ((c = callq_dequeue(tmp)) != NULL) {
+    callq_enqueue(st->queue, c);
+  }
+  callq_free(tmp);
+  printf("\n");
+}
+
+void receive(struct state* st) {
+  struct call* c = call_pool_create_call(st->pool, st->next_id++, "Caller",
+    "Testing");
+  callq_enqueue(st->queue, c);
+  journal_receive(st->journal, c);
+}
+
+void answer(struct state* st) {
+  struct call* c = callq_dequeue(st->queue);
+  journal_answer(st->journal, c->id);
+  ring_push(st->history, c);
+}
+
+int main(int argc, char** argv) {
+  struct state st;
+  int i;
+
+  remove(JOURNAL_PATH);
+  state_open(&st);
+  printf("== Empty journal: next ID (expect 1): %d\n", st.next_id);
+
+  /*
+   * Receive 10 calls, answer 5 of them and cancel one more.
+   */
+  for (i = 0; i < 10; i++) {
+    receive(&st);
+  }
+  for (i = 0; i < 5; i++) {
+    answer(&st);
+  }
+  callq_cancel(st.queue, 7);
+  journal_cancel(st.journal, 7);
+  journal_commit(st.journal);
+  printf("\n== Before restart (expect next ID 11, history 3 4 5, waiting 6 8"
+    " 9 10):\n");
+  print_state(&st);
+  state_close(&st);
+
+  state_open(&st);
+  printf("== After restart (expect the same):\n");
+  print_state(&st);
+
+  /*
+   * Records are committed when the journal is closed, and a torn record at
+   * the end of the file is ignored.
+   */
+  receive(&st);
+  answer(&st);
+  state_close(&st);
+  FILE* f = fopen(JOURNAL_PATH, "ab");
+  fwrite("\x12\x34\x56\x78R\x40partial", 1, 13, f);
+  fclose(f);
+  state_open(&st);
+  printf("\n== After torn write (expect next ID 12, history 4 5 6, waiting 8"
+    " 9 10 11):\n");
+  print_state(&st);
+
+  /*
+   * Compaction keeps the journal small no matter how many calls go through
+   * it.
+   */
+  for (i = 0; i < 200000; i++) {
+    receive(&st);
+    answer(&st);
+    if (i % 1000 == 999) {
+      journal_commit(st.journal);
+    }
+  }
+  journal_commit(st.journal);
+  printf("\n== Journal under 16 MB after 200000 more calls (expect 1)? %d\n",
+    journal_size(st.journal) < 16L * 1024 * 1024);
+  state_close(&st);
+
+  state_open(&st);
+  printf("== After restart (expect next ID 200012, history 200005 200006"
+    " 200007, waiting 200008 200009 200010 200011):\n");
+  print_state(&st);
+  printf("== Journal fully compacted on load (expect 1)? %d\n",
+    journal_size(st.journal) < 1024);
+  state_close(&st);
+
+  remove(JOURNAL_PATH);
+  return 0;
+}
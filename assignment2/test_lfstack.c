@@ -0,0 +1,105 @@
+/*
+ * This file contains executable code for testing the lock-free stack
+ * implementation, both from a single thread and from many threads at once.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "lfstack.h"
+
+#define N_THREADS 8
+#define N_PER_THREAD 100000
+
+/*
+ * Shared state for the concurrent test.  Each thread pushes its own range of
+ * values, popping as it goes, and records every value it pops in `seen`.
+ */
+struct lfstack* shared;
+int* test_data;
+int* seen;
+
+void* worker(void* arg) {
+  int t = *(int*)arg;
+  for (int i = 0; i < N_PER_THREAD; i++) {
+    while (!lfstack_push(shared, &test_data[t * N_PER_THREAD + i]));
+    if (i % 2 == 1) {
+      for (int j = 0; j < 2; j++) {
+        int* val = lfstack_pop(shared);
+        if (val) {
+          __atomic_fetch_add(&seen[*val], 1, __ATOMIC_RELAXED);
+        }
+      }
+    }
+  }
+  return NULL;
+}
+
+int main(int argc, char** argv) {
+  int i, n = 16, errors;
+  int total = N_THREADS * N_PER_THREAD;
+  struct lfstack* s;
+
+  test_data = malloc(total * sizeof(int));
+  seen = calloc(total, sizeof(int));
+  for (i = 0; i < total; i++) {
+    test_data[i] = i;
+  }
+
+  /*
+   * Single-threaded: the stack should behave exactly like stack.c.
+   */
+  s = lfstack_create(n);
+  printf("== Pushing %d values onto a stack of capacity %d.\n", n, n);
+  for (i = 0; i < n; i++) {
+    lfstack_push(s, &test_data[i]);
+  }
+  printf("== Push beyond capacity rejected (expect 0): %d\n",
+    lfstack_push(s, &test_data[n]));
+  errors = 0;
+  for (i = n - 1; i >= 0; i--) {
+    int* val = lfstack_pop(s);
+    if (!val || *val != i) {
+      errors++;
+    }
+  }
+  printf("== LIFO order errors (expect 0): %d\n", errors);
+  printf("== Is stack empty (expect 1)? %d\n", lfstack_isempty(s));
+  printf("== Pop from empty is NULL (expect 1)? %d\n", lfstack_pop(s) == NULL);
+  lfstack_free(s);
+
+  /*
+   * Concurrent: every pushed value must be popped exactly once, either by a
+   * worker or by the final drain below.
+   */
+  pthread_t threads[N_THREADS];
+  int ids[N_THREADS];
+  shared = lfstack_create(total);
+  printf("\n== %d threads each pushing %d values.\n", N_THREADS, N_PER_THREAD);
+  for (i = 0; i < N_THREADS; i++) {
+    ids[i] = i;
+    pthread_create(&threads[i], NULL, worker, &ids[i]);
+  }
+  for (i = 0; i < N_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  int* val;
+  while ((val = lfstack_pop(shared)) != NULL) {
+    seen[*val]++;
+  }
+
+  errors = 0;
+  for (i = 0; i < total; i++) {
+    if (seen[i] != 1) {
+      errors++;
+    }
+  }
+  printf("== Values lost or duplicated (expect 0): %d\n", errors);
+  lfstack_free(shared);
+
+  free(test_data);
+  free(seen);
+
+  return 0;
+}
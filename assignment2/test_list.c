@@ -0,0 +1,119 @@
+/*
+ * This file contains executable code for testing the linked list
+ * implementation, in particular list_remove_if() and list_remove_all().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "list.h"
+
+int frees;
+
+int cmp_int(void* a, void* b) {
+  return *(int*)a != *(int*)b;
+}
+
+int is_even(void* val, void* ctx) {
+  return *(int*)val % 2 == 0;
+}
+
+int at_least(void* val, void* ctx) {
+  return *(int*)val >= *(int*)ctx;
+}
+
+int always(void* val, void* ctx) {
+  return 1;
+}
+
+void count_free(void* val) {
+  frees++;
+  free(val);
+}
+
+/*
+ * Builds a list holding `vals[0]`..`vals[n - 1]` in that order from the
+ * head.  If `copy` is set, each value is a newly-allocated copy.
+ */
+struct list* build(int* vals, int n, int copy) {
+  struct list* list = list_create();
+  for (int i = n - 1; i >= 0; i--) {
+    int* val = &vals[i];
+    if (copy) {
+      val = malloc(sizeof(int));
+      *val = vals[i];
+    }
+    list_insert(list, val);
+  }
+  return list;
+}
+
+/*
+ * Prints the values in a list from the head, emptying it, and frees it.  If
+ * `copies` is set, the values are freed too.
+ */
+void print_and_free(struct list* list, int copies) {
+  while (!list_isempty(list)) {
+    int* val = list_head_value(list);
+    printf(" %d", *val);
+    list_remove_head(list);
+    if (copies) {
+      free(val);
+    }
+  }
+  printf("\n");
+  list_free(list);
+}
+
+int main(int argc, char** argv) {
+  int vals[] = { 0, 0, 1, 0, 2, 3, 0 };
+  int digits[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+  int zero = 0, seven = 7, eleven = 11;
+  struct list* list;
+
+  /*
+   * Every instance of a value is removed, at the head, in the middle and at
+   * the tail.
+   */
+  list = build(vals, 7, 0);
+  printf("== Removed all zeros (expect 4): %d\n",
+    list_remove_all(list, &zero, cmp_int));
+  printf("== Left (expect 1 2 3):");
+  print_and_free(list, 0);
+
+  list = build(vals, 7, 0);
+  printf("== Removed all elevens (expect 0): %d\n",
+    list_remove_all(list, &eleven, cmp_int));
+  printf("== Left (expect 0 0 1 0 2 3 0):");
+  print_and_free(list, 0);
+
+  /*
+   * Removed values are passed to free_fn.
+   */
+  list = build(digits, 10, 1);
+  frees = 0;
+  printf("\n== Removed even values (expect 5): %d\n",
+    list_remove_if(list, is_even, NULL, count_free));
+  printf("== Removed values at least 7 (expect 2): %d\n",
+    list_remove_if(list, at_least, &seven, count_free));
+  printf("== Values freed (expect 7): %d\n", frees);
+  printf("== Left (expect 1 3 5):");
+  print_and_free(list, 1);
+
+  /*
+   * Removing every element leaves an empty list that can be reused.
+   */
+  list = build(digits, 10, 1);
+  frees = 0;
+  printf("\n== Removed everything (expect 10): %d\n",
+    list_remove_if(list, always, NULL, count_free));
+  printf("== Values freed (expect 10): %d\n", frees);
+  printf("== Is empty (expect 1): %d\n", list_isempty(list));
+  printf("== Removed from empty list (expect 0): %d\n",
+    list_remove_if(list, always, NULL, count_free));
+  list_insert(list, &digits[4]);
+  printf("== Reused (expect 4):");
+  print_and_free(list, 0);
+
+  return 0;
+}
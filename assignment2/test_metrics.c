@@ -0,0 +1,124 @@
+/*
+ * This file contains executable code for testing the metrics
+ * implementation.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "metrics.h"
+
+#define METRICS_PATH "test.metrics"
+#define NUM_THREADS 4
+#define NUM_PER_THREAD 1000000
+
+struct metrics* m;
+
+/*
+ * Thread function that counts calls and records waits in its own shard.
+ */
+void* count_calls(void* arg) {
+  struct metrics_shard* s = metrics_shard_create(m);
+  for (int i = 0; i < NUM_PER_THREAD; i++) {
+    metrics_count(s, METRICS_RECEIVED, 1);
+    metrics_record(s, METRICS_QUEUE_DEPTH, i % 1000);
+  }
+  return NULL;
+}
+
+/*
+ * Returns 1 if `value` is within `pct` percent of `expected`.
+ */
+int within(long long value, long long expected, double pct) {
+  double diff = value > expected ? value - expected : expected - value;
+  return diff <= expected * pct / 100.0;
+}
+
+/*
+ * Returns 1 if a file contains a line starting with `prefix`.
+ */
+int file_has_line(const char* path, const char* prefix) {
+  char line[256];
+  int found = 0;
+  FILE* f = fopen(path, "r");
+  while (f && !found && fgets(line, sizeof(line), f)) {
+    found = strncmp(line, prefix, strlen(prefix)) == 0;
+  }
+  if (f) {
+    fclose(f);
+  }
+  return found;
+}
+
+int main(int argc, char** argv) {
+  int i;
+
+  m = metrics_create();
+  struct metrics_shard* s = metrics_shard_create(m);
+  printf("== Empty histogram p50 (expect 0): %lld\n",
+    metrics_percentile(m, METRICS_WAIT_US, 50));
+
+  /*
+   * Small values get a bucket each, so they're exact.
+   */
+  for (i = 1; i <= 20; i++) {
+    metrics_record(s, METRICS_HISTORY_DEPTH, i);
+  }
+  printf("== Small values: p50, p90, max (expect 10 18 20): %lld %lld %lld\n",
+    metrics_percentile(m, METRICS_HISTORY_DEPTH, 50),
+    metrics_percentile(m, METRICS_HISTORY_DEPTH, 90),
+    metrics_percentile(m, METRICS_HISTORY_DEPTH, 100));
+
+  /*
+   * Large values are recorded to within about 6%, however large.
+   */
+  for (i = 1; i <= 100000; i++) {
+    metrics_record(s, METRICS_WAIT_US, i);
+  }
+  metrics_record(s, METRICS_WAIT_US, 1LL << 40);
+  printf("== p50 within 7%% of 50000 (expect 1)? %d\n",
+    within(metrics_percentile(m, METRICS_WAIT_US, 50), 50000, 7));
+  printf("== p99 within 7%% of 99000 (expect 1)? %d\n",
+    within(metrics_percentile(m, METRICS_WAIT_US, 99), 99000, 7));
+  printf("== max (expect %lld): %lld\n", 1LL << 40,
+    metrics_percentile(m, METRICS_WAIT_US, 100));
+
+  /*
+   * Every thread's counts add up.
+   */
+  pthread_t threads[NUM_THREADS];
+  for (i = 0; i < NUM_THREADS; i++) {
+    pthread_create(&threads[i], NULL, count_calls, NULL);
+  }
+  for (i = 0; i < NUM_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  printf("\n== Received over %d threads (expect %d): %ld\n", NUM_THREADS,
+    NUM_THREADS * NUM_PER_THREAD, metrics_total(m, METRICS_RECEIVED));
+  printf("== Queue depth p50 within 7%% of 500 (expect 1)? %d\n",
+    within(metrics_percentile(m, METRICS_QUEUE_DEPTH, 50), 500, 7));
+
+  /*
+   * Dumping to a file leaves the final totals in it once stopped.
+   */
+  remove(METRICS_PATH);
+  metrics_start(m, METRICS_PATH, 20);
+  struct timespec ts = { 0, 50 * 1000000 };
+  nanosleep(&ts, NULL);
+  printf("\n== Dumped while running (expect 1)? %d\n",
+    file_has_line(METRICS_PATH, "received_total 4000000"));
+  metrics_count(s, METRICS_ANSWERED, 7);
+  metrics_stop(m);
+  printf("== Final dump has the last count (expect 1)? %d\n",
+    file_has_line(METRICS_PATH, "answered_total 7"));
+  printf("== Final dump has the wait histogram (expect 1)? %d\n",
+    file_has_line(METRICS_PATH, "wait_us count=100001"));
+
+  metrics_free(m);
+  remove(METRICS_PATH);
+  return 0;
+}
@@ -0,0 +1,170 @@
+/*
+ * This file contains executable code for testing the multi-level feedback
+ * queue implementation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mlfq.h"
+
+#define REF_MAX 10000
+
+/*
+ * A slow reference model of the queue: every value with its level, when it
+ * reached the level and the order in which it did.
+ */
+struct ref_entry {
+  long val;
+  int level;
+  long long since;
+  long order;
+};
+
+struct ref_entry ref[REF_MAX];
+int ref_n;
+long ref_order;
+
+/*
+ * Returns the index of the entry that reached `level` first, or -1.
+ */
+int ref_front(int level) {
+  int best = -1;
+  for (int i = 0; i < ref_n; i++) {
+    if (ref[i].level == level && (best < 0 || ref[i].order <
+        ref[best].order)) {
+      best = i;
+    }
+  }
+  return best;
+}
+
+void ref_age(int levels, long long age, long long now) {
+  for (int level = 1; level < levels; level++) {
+    int i;
+    while ((i = ref_front(level)) >= 0 && ref[i].since + age <= now) {
+      ref[i].level--;
+      ref[i].since = now;
+      ref[i].order = ref_order++;
+    }
+  }
+}
+
+long ref_dequeue(int levels, long long age, long long now) {
+  long val;
+  int i = -1;
+  if (age > 0) {
+    ref_age(levels, age, now);
+  }
+  for (int level = 0; i < 0; level++) {
+    i = ref_front(level);
+  }
+  val = ref[i].val;
+  ref[i] = ref[--ref_n];
+  return val;
+}
+
+/*
+ * Runs random enqueues and dequeues against both the queue and the model,
+ * returning the number of dequeues on which they disagree.
+ */
+int check_random(int levels, long long age, int ops) {
+  struct mlfq* q = mlfq_create(levels, age);
+  long long now = 0;
+  long next_val = 1;
+  int wrong = 0;
+
+  ref_n = 0;
+  for (int i = 0; i < ops; i++) {
+    now += rand() % 4;
+    if (ref_n < REF_MAX && (ref_n == 0 || rand() % 100 < 52)) {
+      int level = rand() % levels;
+      mlfq_enqueue(q, (void*)next_val, level, now);
+      ref[ref_n].val = next_val++;
+      ref[ref_n].level = level;
+      ref[ref_n].since = now;
+      ref[ref_n].order = ref_order++;
+      ref_n++;
+    } else {
+      long got = (long)mlfq_dequeue(q, now);
+      wrong += got != ref_dequeue(levels, age, now);
+    }
+  }
+  wrong += mlfq_size(q) != ref_n;
+  mlfq_free(q);
+  return wrong;
+}
+
+int main(int argc, char** argv) {
+  struct mlfq* q;
+  int i;
+
+  srand(0);
+
+  /*
+   * Without aging, levels are served strictly in order.
+   */
+  q = mlfq_create(3, 0);
+  printf("== Is empty (expect 1): %d\n", mlfq_isempty(q));
+  mlfq_enqueue(q, "a2", 2, 0);
+  mlfq_enqueue(q, "b0", 0, 0);
+  mlfq_enqueue(q, "c1", 1, 0);
+  mlfq_enqueue(q, "d0", 0, 0);
+  mlfq_enqueue(q, "e2", 2, 0);
+  printf("== Size (expect 5): %d\n", mlfq_size(q));
+  printf("== Level sizes (expect 2 1 2): %d %d %d\n", mlfq_level_size(q, 0),
+    mlfq_level_size(q, 1), mlfq_level_size(q, 2));
+  printf("== Dequeued (expect b0 d0 c1 a2 e2):");
+  while (!mlfq_isempty(q)) {
+    printf(" %s", (char*)mlfq_dequeue(q, 1000000));
+  }
+  printf("\n== Promotions (expect 0): %ld\n", mlfq_promotions(q));
+  mlfq_free(q);
+
+  /*
+   * A call in the bottom level is promoted a level every 10 ticks, joining
+   * the back of each level.
+   */
+  q = mlfq_create(3, 10);
+  mlfq_enqueue(q, "low", 2, 0);
+  mlfq_enqueue(q, "mid", 1, 5);
+  printf("\n== Promoted at 9 (expect 0): %d\n", mlfq_age(q, 9));
+  printf("== Promoted at 10 (expect 1): %d\n", mlfq_age(q, 10));
+  printf("== Level sizes (expect 0 2 0): %d %d %d\n", mlfq_level_size(q, 0),
+    mlfq_level_size(q, 1), mlfq_level_size(q, 2));
+  mlfq_enqueue(q, "top", 0, 12);
+  printf("== Promoted at 15 (expect 1): %d\n", mlfq_age(q, 15));
+  mlfq_enqueue(q, "top2", 0, 16);
+  printf("== Dequeued at 19, 19, 20, 20 (expect top mid top2 low):");
+  printf(" %s", (char*)mlfq_dequeue(q, 19));
+  printf(" %s", (char*)mlfq_dequeue(q, 19));
+  printf(" %s", (char*)mlfq_dequeue(q, 20));
+  printf(" %s\n", (char*)mlfq_dequeue(q, 20));
+  printf("== Promotions (expect 3): %ld\n", mlfq_promotions(q));
+  mlfq_free(q);
+
+  /*
+   * All 64 levels.
+   */
+  q = mlfq_create(MLFQ_MAX_LEVELS, 0);
+  for (i = MLFQ_MAX_LEVELS - 1; i >= 0; i--) {
+    mlfq_enqueue(q, (void*)(long)i, i, 0);
+  }
+  int in_order = 1;
+  for (i = 0; i < MLFQ_MAX_LEVELS; i++) {
+    in_order &= (long)mlfq_dequeue(q, 0) == i;
+  }
+  printf("\n== 64 levels in order (expect 1): %d\n", in_order);
+  mlfq_free(q);
+
+  /*
+   * Random runs checked against the model.
+   */
+  printf("== Random, no aging: wrong (expect 0): %d\n",
+    check_random(4, 0, 20000));
+  printf("== Random, aging every 20: wrong (expect 0): %d\n",
+    check_random(4, 20, 20000));
+  printf("== Random, 8 levels aging every 3: wrong (expect 0): %d\n",
+    check_random(8, 3, 20000));
+  return 0;
+}
@@ -0,0 +1,90 @@
+/*
+ * This file contains executable code for testing the persistent stack
+ * implementation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pstack.h"
+
+/*
+ * Pops every value from a snapshot of `s` (leaving `s` itself untouched) and
+ * prints them from top to bottom.
+ */
+void print_pstack(const char* label, struct pstack* s) {
+  struct pstack* tmp = pstack_snapshot(s);
+  printf("  - %-10s (size %2d):", label, pstack_size(s));
+  while (!pstack_isempty(tmp)) {
+    printf(" %d", *(int*)pstack_pop(tmp));
+  }
+  printf("\n");
+  pstack_free(tmp);
+}
+
+int main(int argc, char** argv) {
+  int i, n = 8;
+  int* test_data;
+  struct pstack* s, * snap1, * snap2;
+
+  test_data = malloc(2 * n * sizeof(int));
+  for (i = 0; i < 2 * n; i++) {
+    test_data[i] = i;
+  }
+
+  /*
+   * Push some values, snapshot, and then modify the original.  The snapshot
+   * must keep seeing the values as they were.
+   */
+  s = pstack_create();
+  printf("== Pushing %d values, then taking snapshot 1.\n", n);
+  for (i = 0; i < n; i++) {
+    pstack_push(s, &test_data[i]);
+  }
+  snap1 = pstack_snapshot(s);
+
+  printf("== Popping 3 values from the original, pushing 2 new ones.\n");
+  for (i = 0; i < 3; i++) {
+    pstack_pop(s);
+  }
+  pstack_push(s, &test_data[n]);
+  pstack_push(s, &test_data[n + 1]);
+  print_pstack("original", s);
+  printf("    (expect 9 8 4 3 2 1 0)\n");
+  print_pstack("snapshot 1", snap1);
+  printf("    (expect 7 6 5 4 3 2 1 0)\n");
+
+  /*
+   * Modify the snapshot; the original must not change.
+   */
+  printf("\n== Taking snapshot 2 of snapshot 1, then pushing onto snapshot 1.\n");
+  snap2 = pstack_snapshot(snap1);
+  pstack_push(snap1, &test_data[n + 2]);
+  print_pstack("original", s);
+  printf("    (expect 9 8 4 3 2 1 0)\n");
+  print_pstack("snapshot 1", snap1);
+  printf("    (expect 10 7 6 5 4 3 2 1 0)\n");
+  print_pstack("snapshot 2", snap2);
+  printf("    (expect 7 6 5 4 3 2 1 0)\n");
+
+  /*
+   * Free versions in an arbitrary order; shared nodes must survive until the
+   * last version referring to them is gone.
+   */
+  printf("\n== Freeing the original, then draining snapshot 2.\n");
+  pstack_free(s);
+  i = 0;
+  while (!pstack_isempty(snap2)) {
+    pstack_pop(snap2);
+    i++;
+  }
+  printf("== Popped from snapshot 2 (expect %d): %d\n", n, i);
+  print_pstack("snapshot 1", snap1);
+  printf("    (expect 10 7 6 5 4 3 2 1 0)\n");
+
+  pstack_free(snap1);
+  pstack_free(snap2);
+  free(test_data);
+
+  return 0;
+}
@@ -0,0 +1,120 @@
+/*
+ * This file contains executable code for testing the ring buffer
+ * implementation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ring.h"
+
+/*
+ * Evict function that records the values it's handed, in order.
+ */
+int evicted[64];
+int n_evicted = 0;
+
+void record_evict(void* ctx, void* val) {
+  evicted[n_evicted++] = *(int*)val;
+}
+
+/*
+ * Prints the last k values of a ring, oldest first.
+ */
+void print_last_k(struct ring* ring, int k) {
+  int n;
+  void** vals = ring_last_k(ring, k, &n);
+  printf("  - last %d (got %d):", k, n);
+  for (int i = 0; i < n; i++) {
+    printf(" %d", *(int*)vals[i]);
+  }
+  printf("\n");
+}
+
+int main(int argc, char** argv) {
+  int i, n = 11, cap = 4;
+  int* test_data;
+  struct ring* ring;
+
+  test_data = malloc(n * sizeof(int));
+  for (i = 0; i < n; i++) {
+    test_data[i] = i;
+  }
+
+  ring = ring_create(cap, record_evict, NULL);
+  printf("== Newest of empty ring (expect 1)? %d\n",
+    ring_newest(ring) == NULL);
+  print_last_k(ring, 3);
+
+  printf("\n== Pushing 0..2 into a ring of capacity %d.\n", cap);
+  for (i = 0; i < 3; i++) {
+    ring_push(ring, &test_data[i]);
+  }
+  printf("== Size (expect 3): %d\n", ring_size(ring));
+  printf("== Evicted (expect 0): %d\n", n_evicted);
+  print_last_k(ring, 2);
+  print_last_k(ring, 10);
+
+  /*
+   * Keep pushing past capacity, checking the window at every wrap offset.
+   */
+  printf("\n== Pushing 3..%d; the oldest values should be evicted.\n", n - 1);
+  for (i = 3; i < n; i++) {
+    ring_push(ring, &test_data[i]);
+    print_last_k(ring, cap);
+  }
+  printf("== Size (expect %d): %d\n", cap, ring_size(ring));
+  printf("== Newest (expect %d): %d\n", n - 1, *(int*)ring_newest(ring));
+  printf("== Evicted (expect %d):", n - cap);
+  for (i = 0; i < n_evicted; i++) {
+    printf(" %d", evicted[i]);
+  }
+  printf("\n");
+
+  /*
+   * Freeing the ring hands over whatever it still holds, oldest first.
+   */
+  n_evicted = 0;
+  ring_free(ring);
+  printf("\n== Evicted on free (expect %d..%d):", n - cap, n - 1);
+  for (i = 0; i < n_evicted; i++) {
+    printf(" %d", evicted[i]);
+  }
+  printf("\n");
+
+  /*
+   * Bulk pushes should match pushing the same values one at a time,
+   * including across the wrap point and past capacity.
+   */
+  void* vals[11];
+  for (i = 0; i < n; i++) {
+    vals[i] = &test_data[i];
+  }
+  ring = ring_create(cap, record_evict, NULL);
+  n_evicted = 0;
+  printf("\n== Bulk pushing 0..2, then 3..5, into a ring of capacity %d.\n",
+    cap);
+  ring_push_many(ring, vals, 3);
+  ring_push_many(ring, vals + 3, 3);
+  print_last_k(ring, cap);
+  printf("== Evicted (expect 0 1):");
+  for (i = 0; i < n_evicted; i++) {
+    printf(" %d", evicted[i]);
+  }
+  printf("\n");
+
+  n_evicted = 0;
+  printf("\n== Bulk pushing 0..%d, more than the ring holds.\n", n - 1);
+  ring_push_many(ring, vals, n);
+  print_last_k(ring, cap);
+  printf("== Size (expect %d): %d\n", cap, ring_size(ring));
+  printf("== Evicted (expect 2..5 then 0..%d):", n - cap - 1);
+  for (i = 0; i < n_evicted; i++) {
+    printf(" %d", evicted[i]);
+  }
+  printf("\n");
+  ring_free(ring);
+
+  free(test_data);
+  return 0;
+}
@@ -0,0 +1,116 @@
+/*
+ * This file contains executable code for testing the skill-based call
+ * router.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "router.h"
+
+#define BILLING 0
+#define SUPPORT 1
+
+int main(int argc, char** argv) {
+  int i, errors = 0;
+  struct call_pool* pool = call_pool_create(64);
+  struct router* r = router_create(2, pool);
+  struct call* c;
+
+  /*
+   * With no tier weights in play, each skill's queue is plain FIFO.
+   */
+  printf("== Routing calls 1..6, alternating billing and support.\n");
+  for (i = 1; i <= 6; i++) {
+    router_route(r, call_pool_create_call(pool, i, "Caller", "Testing"),
+      i % 2 ? BILLING : SUPPORT, ROUTER_TIER_STANDARD, i);
+  }
+  printf("== Size (expect 6): %d\n", router_size(r));
+  c = router_next(r, 1 << SUPPORT);
+  printf("== Support agent gets (expect 2): %d\n", c->id);
+  call_pool_release(pool, c);
+  c = router_next(r, 1 << BILLING);
+  printf("== Billing agent gets (expect 1): %d\n", c->id);
+  call_pool_release(pool, c);
+  c = router_next(r, ROUTER_ALL_SKILLS);
+  printf("== Agent with both skills gets oldest (expect 3): %d\n", c->id);
+  call_pool_release(pool, c);
+
+  /*
+   * A VIP call jumps ahead of calls that arrived less than the VIP head
+   * start before it (6), but not of calls that arrived earlier than that
+   * (4).
+   */
+  router_set_tier_weight(r, ROUTER_TIER_VIP, 1000);
+  router_route(r, call_pool_create_call(pool, 7, "VIP", "Testing"), SUPPORT,
+    ROUTER_TIER_VIP, 1005);
+  router_route(r, call_pool_create_call(pool, 8, "Caller", "Testing"),
+    SUPPORT, ROUTER_TIER_STANDARD, 1006);
+  printf("\n== Routed VIP call 7 at 1005ms with a 1000ms head start.\n");
+  c = router_next(r, 1 << SUPPORT);
+  printf("== Support agent gets (expect 4): %d\n", c->id);
+  call_pool_release(pool, c);
+  c = router_next(r, 1 << SUPPORT);
+  printf("== Support agent gets (expect 7): %d\n", c->id);
+  call_pool_release(pool, c);
+  c = router_next(r, 1 << SUPPORT);
+  printf("== Support agent gets (expect 6): %d\n", c->id);
+  call_pool_release(pool, c);
+
+  /*
+   * Cancelled calls are skipped.
+   */
+  printf("\n== Cancel call 5 (expect 1): %d\n", router_cancel(r, 5));
+  printf("== Cancel call 5 again (expect 0): %d\n", router_cancel(r, 5));
+  printf("== Billing agent gets (expect none): %s\n",
+    router_next(r, 1 << BILLING) ? "a call" : "none");
+  c = router_next(r, ROUTER_ALL_SKILLS);
+  printf("== Agent with both skills gets (expect 8): %d\n", c->id);
+  call_pool_release(pool, c);
+  printf("== Size (expect 0): %d\n", router_size(r));
+  printf("== Outstanding records (expect 0): %d\n",
+    call_pool_outstanding(pool));
+
+  /*
+   * Many calls with random skills, tiers and cancellations should come out
+   * of each queue in priority order.
+   */
+  int n = 20000, prev[2] = { -1000000, -1000000 }, count = 0;
+  int* prio = malloc((n + 1) * sizeof(int));
+  router_set_tier_weight(r, ROUTER_TIER_PRIORITY, 300);
+  router_set_tier_weight(r, ROUTER_TIER_VIP, 1200);
+  int weights[ROUTER_TIERS] = { 0, 300, 1200 };
+  int skill[n + 1];
+  srand(0);
+  for (i = 1; i <= n; i++) {
+    int tier = rand() % ROUTER_TIERS;
+    skill[i] = rand() % 2;
+    prio[i] = i - weights[tier];
+    router_route(r, call_pool_create_call(pool, 100 + i, "Caller", "Testing"),
+      skill[i], tier, i);
+  }
+  for (i = 1; i <= n; i += 7) {
+    router_cancel(r, 100 + i);
+  }
+  for (i = 0; i < 2; i++) {
+    while ((c = router_next(r, 1 << i)) != NULL) {
+      int id = c->id - 100;
+      if (skill[id] != i || prio[id] < prev[i] || (id - 1) % 7 == 0) {
+        errors++;
+      }
+      prev[i] = prio[id];
+      count++;
+      call_pool_release(pool, c);
+    }
+  }
+  printf("\n== Routed %d random calls, cancelled every 7th.\n", n);
+  printf("== Answered (expect %d): %d\n", n - (n + 6) / 7, count);
+  printf("== Order errors (expect 0): %d\n", errors);
+  printf("== Outstanding records (expect 0): %d\n",
+    call_pool_outstanding(pool));
+
+  free(prio);
+  router_free(r);
+  call_pool_free(pool);
+  return 0;
+}
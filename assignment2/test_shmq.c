@@ -0,0 +1,204 @@
+/*
+ * This file contains executable code for testing the shared-memory call
+ * queue implementation.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "shmq.h"
+
+#define NUM_PRODUCERS 3
+#define NUM_CONSUMERS 3
+#define CALLS_PER_PRODUCER 200000
+#define CAPACITY 1024
+
+char name[64];
+
+/*
+ * Fills in a call whose contents can be checked from its ID.
+ */
+void make_call(struct call* c, int id) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "caller %d", id);
+  init_call(c, id, buf, "billing");
+  c->received_at = id * 7LL;
+}
+
+int check_call(struct call* c) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "caller %d", c->id);
+  return strcmp(c->name, buf) == 0 && strcmp(c->reason, "billing") == 0 &&
+    c->received_at == c->id * 7LL;
+}
+
+/*
+ * Producer process: opens the queue by name and enqueues its calls, half
+ * copied in and half written straight into the ring.
+ */
+void producer(int p) {
+  struct shmq* q = shmq_open(name);
+  for (int i = 0; i < CALLS_PER_PRODUCER; i++) {
+    int id = p * CALLS_PER_PRODUCER + i + 1;
+    if (i % 2) {
+      struct call c;
+      make_call(&c, id);
+      shmq_enqueue(q, &c);
+    } else {
+      struct call* rec;
+      while ((rec = shmq_claim_enqueue(q)) == NULL) {
+        sched_yield();
+      }
+      make_call(rec, id);
+      shmq_publish(q, rec);
+    }
+  }
+  shmq_close(q);
+  exit(0);
+}
+
+/*
+ * Consumer process: dequeues calls until it gets one with ID 0, counting
+ * each call it sees in `seen` (which is shared with the parent), along with
+ * any call that's corrupt or out of its producer's order.
+ */
+void consumer(int* seen, int* bad) {
+  struct shmq* q = shmq_open(name);
+  int last[NUM_PRODUCERS] = { 0 };
+  while (1) {
+    struct call* rec;
+    while ((rec = shmq_claim_dequeue(q)) == NULL) {
+      sched_yield();
+    }
+    int id = rec->id;
+    if (id == 0) {
+      shmq_release(q, rec);
+      break;
+    }
+    int p = (id - 1) / CALLS_PER_PRODUCER;
+    if (!check_call(rec) || id <= last[p]) {
+      __atomic_add_fetch(bad, 1, __ATOMIC_RELAXED);
+    }
+    last[p] = id;
+    shmq_release(q, rec);
+    __atomic_add_fetch(&seen[id], 1, __ATOMIC_RELAXED);
+  }
+  shmq_close(q);
+  exit(0);
+}
+
+int main(int argc, char** argv) {
+  struct shmq *q, *other;
+  struct call c, *rec, *rec2;
+  int i, n;
+
+  snprintf(name, sizeof(name), "/test_shmq_%d", (int)getpid());
+
+  q = shmq_create(name, 5);
+  printf("== Capacity of 5 (expect 8): %d\n", shmq_capacity(q));
+  other = shmq_open(name);
+  printf("== Opened by name (expect 1): %d\n", other != NULL);
+
+  /*
+   * Filling the queue through one handle and emptying it through another,
+   * mapped at a different address.
+   */
+  for (i = 1, n = 0; i <= 10; i++) {
+    make_call(&c, i);
+    n += shmq_try_enqueue(q, &c);
+  }
+  printf("== Enqueued 10 (expect 8): %d\n", n);
+  printf("== Size (expect 8): %d %d\n", shmq_size(q), shmq_size(other));
+  printf("== Dequeued through the other handle (expect 1 2 3 4 5 6 7 8):");
+  while (shmq_try_dequeue(other, &c)) {
+    printf(" %d%s", c.id, check_call(&c) ? "" : "(corrupt)");
+  }
+  printf("\n== Dequeuing empty (expect 0): %d\n", shmq_try_dequeue(q, &c));
+
+  /*
+   * A call claimed first but published second holds up the one behind it.
+   */
+  rec = shmq_claim_enqueue(q);
+  rec2 = shmq_claim_enqueue(q);
+  make_call(rec2, 21);
+  shmq_publish(q, rec2);
+  printf("\n== Dequeuing behind an unpublished call (expect 1): %d\n",
+    shmq_claim_dequeue(other) == NULL);
+  make_call(rec, 20);
+  shmq_publish(q, rec);
+  rec = shmq_claim_dequeue(other);
+  rec2 = shmq_claim_dequeue(other);
+  printf("== Claimed in place (expect 20 21): %d %d\n", rec->id, rec2->id);
+  shmq_release(other, rec2);
+  shmq_release(other, rec);
+  printf("== Size after release (expect 0): %d\n", shmq_size(q));
+  shmq_close(other);
+
+  fprintf(stderr, "   (expect an error about the name existing)\n");
+  printf("== Creating again (expect 1): %d\n", shmq_create(name, 8) == NULL);
+  shmq_close(q);
+  shmq_unlink(name);
+  fprintf(stderr, "   (expect an error about the name not existing)\n");
+  printf("== Opening after unlink (expect 1): %d\n", shmq_open(name) == NULL);
+
+  /*
+   * Several producer and consumer processes sharing one queue.  Every call
+   * must come out exactly once, intact and, for each consumer, in the order
+   * its producer enqueued it.
+   */
+  int total = NUM_PRODUCERS * CALLS_PER_PRODUCER;
+  int* seen = mmap(NULL, (total + 2) * sizeof(int), PROT_READ | PROT_WRITE,
+    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  int* bad = &seen[total + 1];
+  q = shmq_create(name, CAPACITY);
+
+  fflush(stdout);
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  pid_t producers[NUM_PRODUCERS];
+  for (i = 0; i < NUM_CONSUMERS; i++) {
+    if (fork() == 0) {
+      consumer(seen, bad);
+    }
+  }
+  for (i = 0; i < NUM_PRODUCERS; i++) {
+    if ((producers[i] = fork()) == 0) {
+      producer(i);
+    }
+  }
+  for (i = 0; i < NUM_PRODUCERS; i++) {
+    waitpid(producers[i], NULL, 0);
+  }
+  make_call(&c, 0);
+  for (i = 0; i < NUM_CONSUMERS; i++) {
+    shmq_enqueue(q, &c);
+  }
+  while (wait(NULL) > 0) {
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  int missing = 0, duplicated = 0;
+  for (i = 1; i <= total; i++) {
+    missing += seen[i] == 0;
+    duplicated += seen[i] > 1;
+  }
+  printf("\n== %d processes, %d calls: missing, duplicated, bad"
+    " (expect 0 0 0): %d %d %d\n", NUM_PRODUCERS + NUM_CONSUMERS, total,
+    missing, duplicated, *bad);
+  printf("== Size at the end (expect 0): %d\n", shmq_size(q));
+  double wall = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+  fprintf(stderr, "   %.0f calls/s\n", total / wall);
+
+  shmq_close(q);
+  shmq_unlink(name);
+  munmap(seen, (total + 2) * sizeof(int));
+  return 0;
+}
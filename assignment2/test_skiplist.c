@@ -0,0 +1,113 @@
+/*
+ * This file contains executable code for testing the skip list
+ * implementation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "skiplist.h"
+
+/*
+ * Comparison function for integer keys stored as int*.
+ */
+int compare_ints(void* a, void* b) {
+  int x = *(int*)a, y = *(int*)b;
+  return (x > y) - (x < y);
+}
+
+/*
+ * Range visitor that prints each key and counts how many keys were out of
+ * order with respect to the previous one.
+ */
+void print_pair(void* key, void* val, void* ctx) {
+  int* prev = ctx;
+  printf("  - %4d -> %4d\n", *(int*)key, *(int*)val);
+  if (*(int*)key <= *prev) {
+    printf("  ! out of order after %d\n", *prev);
+  }
+  *prev = *(int*)key;
+}
+
+int main(int argc, char** argv) {
+  int i, n = 16, prev, errors;
+  int* keys;
+  int* vals;
+  struct skiplist* sl;
+
+  /*
+   * Create arrays of testing data.  Keys are inserted in a scrambled order so
+   * the list has to sort them.
+   */
+  keys = malloc(n * sizeof(int));
+  vals = malloc(n * sizeof(int));
+  for (i = 0; i < n; i++) {
+    keys[i] = (i * 7) % n;
+    vals[i] = keys[i] * keys[i];
+  }
+
+  sl = skiplist_create(compare_ints);
+  printf("== Inserting %d keys in scrambled order.\n", n);
+  for (i = 0; i < n; i++) {
+    skiplist_insert(sl, &keys[i], &vals[i]);
+  }
+  printf("== Size (expect %d): %d\n", n, skiplist_size(sl));
+
+  /*
+   * Look every key back up.
+   */
+  errors = 0;
+  for (i = 0; i < n; i++) {
+    int* val = skiplist_get(sl, &keys[i]);
+    if (!val || *val != keys[i] * keys[i]) {
+      errors++;
+    }
+  }
+  printf("== Lookup errors (expect 0): %d\n", errors);
+
+  /*
+   * Remove the even keys and make sure they're gone and the odd keys remain.
+   */
+  printf("\n== Removing even keys.\n");
+  for (i = 0; i < n; i++) {
+    if (keys[i] % 2 == 0) {
+      int* val = skiplist_remove(sl, &keys[i]);
+      if (!val || *val != keys[i] * keys[i]) {
+        printf("  ! remove(%d) returned the wrong value\n", keys[i]);
+      }
+    }
+  }
+  errors = 0;
+  for (i = 0; i < n; i++) {
+    int present = skiplist_get(sl, &keys[i]) != NULL;
+    if (present != (keys[i] % 2 == 1)) {
+      errors++;
+    }
+  }
+  printf("== Size (expect %d): %d\n", n / 2, skiplist_size(sl));
+  printf("== Membership errors (expect 0): %d\n", errors);
+
+  /*
+   * Iterate over a range of keys in order: key -> value.
+   */
+  int lower = 4, upper = 11;
+  prev = -1;
+  printf("\n== Keys in [%d, %d]: key -> value\n", lower, upper);
+  i = skiplist_range_iter(sl, &lower, &upper, print_pair, &prev);
+  printf("== Visited (expect 4): %d\n", i);
+
+  /*
+   * Replacing an existing key's value should return the old value and leave
+   * the size unchanged.
+   */
+  int replacement = -1;
+  int* old = skiplist_insert(sl, &keys[1], &replacement);
+  printf("\n== Replaced value (expect %d): %d\n", vals[1], old ? *old : -1);
+  printf("== Size (expect %d): %d\n", n / 2, skiplist_size(sl));
+
+  skiplist_free(sl);
+  free(keys);
+  free(vals);
+
+  return 0;
+}
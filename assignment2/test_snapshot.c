@@ -0,0 +1,169 @@
+/*
+ * This file contains executable code for testing the state snapshot
+ * implementation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "snapshot.h"
+
+#define SNAPSHOT_PATH "test.snap"
+
+/*
+ * The state saved to and restored from a snapshot.  The queue spills to the
+ * current directory past a small high-water mark, so snapshots are taken
+ * with part of the queue on disk.
+ */
+struct state {
+  struct call_pool* pool;
+  struct callq* queue;
+  struct ring* history;
+  int next_id;
+};
+
+void state_open(struct state* st, int high_water, int history_cap) {
+  st->pool = call_pool_create(64);
+  st->queue = callq_create(".", high_water, st->pool);
+  st->history = ring_create(history_cap, call_pool_release_fn, st->pool);
+  st->next_id = 1;
+}
+
+void state_close(struct state* st) {
+  callq_free(st->queue);
+  ring_free(st->history);
+  call_pool_free(st->pool);
+}
+
+/*
+ * Prints one waiting call's ID.
+ */
+void print_id(void* ctx, struct call* c) {
+  printf(" %d", c->id);
+}
+
+/*
+ * Prints the waiting calls (without disturbing them) and the history.
+ */
+void print_state(struct state* st) {
+  int n;
+  struct call** answered = (struct call**)ring_last_k(st->history,
+    ring_capacity(st->history), &n);
+  printf("  - next ID %d, history:", st->next_id);
+  for (int i = 0; i < n; i++) {
+    printf(" %d", answered[i]->id);
+  }
+  printf(", waiting:");
+  callq_foreach(st->queue, print_id, NULL);
+  printf("\n");
+}
+
+void receive(struct state* st) {
+  char name[50];
+  sprintf(name, "Caller %d", st->next_id);
+  struct call* c = call_pool_create_call(st->pool, st->next_id++, name,
+    "Testing");
+  callq_enqueue(st->queue, c);
+}
+
+int main(int argc, char** argv) {
+  struct state st, restored;
+  int i;
+
+  /*
+   * Receive 20 calls, answer 5 of them and cancel one more.
+   */
+  state_open(&st, 8, 3);
+  for (i = 0; i < 20; i++) {
+    receive(&st);
+  }
+  for (i = 0; i < 5; i++) {
+    ring_push(st.history, callq_dequeue(st.queue));
+  }
+  callq_cancel(st.queue, 7);
+  printf("== Saving (expect next ID 21, history 3 4 5, waiting 6 8..20):\n");
+  print_state(&st);
+  printf("== Saved (expect 0): %d\n", snapshot_save(SNAPSHOT_PATH, st.queue,
+    st.history, st.next_id));
+
+  state_open(&restored, 8, 3);
+  restored.next_id = snapshot_restore(SNAPSHOT_PATH, restored.queue,
+    restored.history, restored.pool);
+  printf("== Restored (expect the same):\n");
+  print_state(&restored);
+  printf("== Next call to answer (expect Caller 6): %s\n",
+    callq_front(restored.queue)->name);
+  printf("== Waiting and answered (expect 14 3): %d %d\n",
+    callq_size(restored.queue), ring_size(restored.history));
+
+  /*
+   * The restored queue is an ordinary queue: cancelling and answering work
+   * as before.
+   */
+  callq_cancel(restored.queue, 6);
+  ring_push(restored.history, callq_dequeue(restored.queue));
+  printf("== After cancelling 6 and answering one (expect history 4 5 8):\n");
+  print_state(&restored);
+  state_close(&restored);
+
+  /*
+   * A smaller history only gets the most recent answered calls.
+   */
+  state_open(&restored, 8, 2);
+  restored.next_id = snapshot_restore(SNAPSHOT_PATH, restored.queue,
+    restored.history, restored.pool);
+  printf("\n== Restored with a history of 2 (expect history 4 5):\n");
+  print_state(&restored);
+  state_close(&restored);
+  state_close(&st);
+
+  /*
+   * A snapshot whose size doesn't match its header is rejected and nothing
+   * is restored.
+   */
+  FILE* f = fopen(SNAPSHOT_PATH, "ab");
+  fputc('x', f);
+  fclose(f);
+  state_open(&restored, 8, 3);
+  printf("\n== Damaged snapshot rejected (expect -1): %d\n",
+    snapshot_restore(SNAPSHOT_PATH, restored.queue, restored.history,
+    restored.pool));
+  printf("== Nothing restored (expect 0 0 0): %d %d %d\n",
+    callq_size(restored.queue), ring_size(restored.history),
+    call_pool_outstanding(restored.pool));
+  state_close(&restored);
+
+  /*
+   * A large snapshot round-trips in order.
+   */
+  state_open(&st, 100000, 1000);
+  for (i = 0; i < 500000; i++) {
+    receive(&st);
+  }
+  for (i = 0; i < 2000; i++) {
+    ring_push(st.history, callq_dequeue(st.queue));
+  }
+  snapshot_save(SNAPSHOT_PATH, st.queue, st.history, st.next_id);
+  state_close(&st);
+
+  state_open(&restored, 100000, 1000);
+  restored.next_id = snapshot_restore(SNAPSHOT_PATH, restored.queue,
+    restored.history, restored.pool);
+  int in_order = 1;
+  for (i = 2001; i <= 500000; i++) {
+    struct call* c = callq_dequeue(restored.queue);
+    in_order = in_order && c->id == i;
+    call_pool_release(restored.pool, c);
+  }
+  printf("\n== Large snapshot: next ID (expect 500001): %d\n",
+    restored.next_id);
+  printf("== Newest answered (expect 2000): %d\n",
+    ((struct call*)ring_newest(restored.history))->id);
+  printf("== All 498000 waiting calls in order (expect 1)? %d\n",
+    in_order && callq_isempty(restored.queue));
+  state_close(&restored);
+
+  remove(SNAPSHOT_PATH);
+  return 0;
+}
@@ -0,0 +1,213 @@
+/*
+ * This file contains executable code for testing the spilling queue
+ * implementation.  Segment files are written to the current directory.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "spillq.h"
+
+/*
+ * A record big enough that a segment of two of them is over the file size
+ * limit used below to make spills fail.
+ */
+struct big_record {
+  int id;
+  char pad[8188];
+};
+
+/*
+ * Allocates a single-int record, as spillq_enqueue() expects.
+ */
+int* make_record(int i) {
+  int* record = malloc(sizeof(int));
+  *record = i;
+  return record;
+}
+
+/*
+ * Enqueues big records `first` to `last` - 1.
+ */
+void enqueue_big(struct spillq* sq, int first, int last) {
+  for (int i = first; i < last; i++) {
+    struct big_record* record = malloc(sizeof(struct big_record));
+    record->id = i;
+    spillq_enqueue(sq, record);
+  }
+}
+
+/*
+ * Removes every segment file in `dir`.
+ */
+void remove_segments(const char* dir) {
+  char path[4096];
+  DIR* d = opendir(dir);
+  struct dirent* entry;
+  while (d && (entry = readdir(d))) {
+    if (strstr(entry->d_name, ".seg")) {
+      snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+      remove(path);
+    }
+  }
+  if (d) {
+    closedir(d);
+  }
+}
+
+int main(int argc, char** argv) {
+  int i, n = 1000, high_water = 64, next = 0, errors = 0, peak = 0;
+  struct spillq* sq;
+  struct rlimit old_limit, limit;
+
+  sq = spillq_create(".", sizeof(int), high_water);
+
+  /*
+   * Enqueue everything, dequeueing one value for every three enqueued, so
+   * the queue grows well past its high-water mark.
+   */
+  printf("== Enqueueing %d records with a high-water mark of %d.\n", n,
+    high_water);
+  for (i = 0; i < n; i++) {
+    spillq_enqueue(sq, make_record(i));
+    if (spillq_spilled(sq) > peak) {
+      peak = spillq_spilled(sq);
+    }
+    if (i % 3 == 2) {
+      int* record = spillq_dequeue(sq);
+      if (*record != next++) {
+        errors++;
+      }
+      free(record);
+    }
+  }
+  printf("== Size (expect %d): %d\n", n - n / 3, spillq_size(sq));
+  printf("== Spilled records to disk (expect 1)? %d\n", peak > 0);
+  printf("== In-memory records within 1.5x high-water (expect 1)? %d\n",
+    spillq_size(sq) - spillq_spilled(sq) <= high_water * 3 / 2);
+
+  /*
+   * Drain the queue; records must come back in FIFO order across the
+   * memory/disk boundary.
+   */
+  while (!spillq_isempty(sq)) {
+    int* front = spillq_front(sq);
+    int* record = spillq_dequeue(sq);
+    if (front != record || *record != next++) {
+      errors++;
+    }
+    free(record);
+  }
+  printf("== Order errors (expect 0): %d\n", errors);
+  printf("== Saw all records (expect 1)? %d\n", next == n);
+  printf("== Nothing left on disk (expect 0): %d\n", spillq_spilled(sq));
+
+  /*
+   * Freeing a queue with records still spilled must clean up its segments.
+   */
+  for (i = 0; i < 4 * high_water; i++) {
+    spillq_enqueue(sq, make_record(i));
+  }
+  printf("== Re-spilled before free (expect 1)? %d\n",
+    spillq_spilled(sq) > 0);
+  spillq_free(sq);
+
+  /*
+   * Spills that fail partway through writing a segment (here because of a
+   * file size limit) must leave the records in memory in FIFO order, and
+   * they are spilled once writes succeed again.  The queue spills two
+   * records per segment.
+   */
+  signal(SIGXFSZ, SIG_IGN);
+  getrlimit(RLIMIT_FSIZE, &old_limit);
+  limit = old_limit;
+  limit.rlim_cur = sizeof(struct big_record);
+
+  sq = spillq_create(".", sizeof(struct big_record), 8);
+  enqueue_big(sq, 0, 12);
+  printf("\n== Spilled before the limit (expect 4): %d\n", spillq_spilled(sq));
+  setrlimit(RLIMIT_FSIZE, &limit);
+  enqueue_big(sq, 12, 17);
+  printf("== Spilled with writes failing (expect 4): %d\n",
+    spillq_spilled(sq));
+  setrlimit(RLIMIT_FSIZE, &old_limit);
+  enqueue_big(sq, 17, 18);
+  printf("== Spilled once writes succeed (expect 10): %d\n",
+    spillq_spilled(sq));
+  errors = 0;
+  next = 0;
+  while (!spillq_isempty(sq)) {
+    struct big_record* record = spillq_dequeue(sq);
+    if (record->id != next++) {
+      errors++;
+    }
+    free(record);
+  }
+  printf("== Order errors after failed spills (expect 0): %d\n", errors);
+  printf("== Saw all records (expect 18): %d\n", next);
+  spillq_free(sq);
+
+  /*
+   * Two queues spilling to the same directory at once must keep their
+   * segments apart.
+   */
+  struct spillq* other = spillq_create(".", sizeof(int), high_water);
+  sq = spillq_create(".", sizeof(int), high_water);
+  for (i = 0; i < 4 * high_water; i++) {
+    spillq_enqueue(sq, make_record(i));
+    spillq_enqueue(other, make_record(-i));
+  }
+  printf("\n== Both queues spilled (expect 1)? %d\n",
+    spillq_spilled(sq) > 0 && spillq_spilled(other) > 0);
+  errors = 0;
+  for (i = 0; i < 4 * high_water; i++) {
+    int* record = spillq_dequeue(sq);
+    int* other_record = spillq_dequeue(other);
+    errors += *record != i || *other_record != -i;
+    free(record);
+    free(other_record);
+  }
+  printf("== Order errors with a shared directory (expect 0): %d\n", errors);
+  spillq_free(sq);
+  spillq_free(other);
+
+  /*
+   * A segment that can't be read back aborts the program rather than
+   * handing out garbage.  The queue spills into its own directory, whose
+   * segments a child process deletes before draining the queue.
+   */
+  char dir[] = "spilltest-XXXXXX";
+  if (!mkdtemp(dir)) {
+    perror("mkdtemp");
+    return 1;
+  }
+  sq = spillq_create(dir, sizeof(int), high_water);
+  for (i = 0; i < 4 * high_water; i++) {
+    spillq_enqueue(sq, make_record(i));
+  }
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    remove_segments(dir);
+    while (!spillq_isempty(sq)) {
+      free(spillq_dequeue(sq));
+    }
+    _exit(0);
+  }
+  int status;
+  waitpid(pid, &status, 0);
+  printf("\n== Missing segment aborted (expect 1)? %d\n",
+    WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT);
+  spillq_free(sq);
+  rmdir(dir);
+
+  return 0;
+}
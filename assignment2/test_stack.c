@@ -6,7 +6,6 @@
 #include <stdlib.h>
 
 #include "stack.h"
-#include "list.h"
 
 int main(int argc, char** argv) {
   int simtop, i, n = 16, k_pop = 4, k_push = 8;
@@ -84,16 +83,47 @@ int main(int argc, char** argv) {
   printf("\n== Is stack empty (expect 1)? %d\n", stack_isempty(s));
   printf("== Saw all test data (expect 1)? %d\n", simtop == 0);
 
+  /*
+   * Bulk-push all of the testing data, then bulk-pop it back off in two
+   * batches and make sure each batch comes back in push order.
+   */
+  printf("\n== Bulk pushing %d values; size (expect %d): ", n, n);
+  for (i = 0; i < n; i++) {
+    simstack[i] = &test_data[i];
+  }
+  stack_push_many(s, (void**)simstack, n);
+  printf("%d\n", stack_size(s));
+
+  int** popped = malloc(n * sizeof(int*));
+  int k = stack_pop_many(s, (void**)popped, k_push);
+  printf("== Bulk popped %d (expect %d): first / last (expected)\n", k, k_push);
+  printf("  - %4d / %4d (%4d / %4d)\n", *popped[0], *popped[k - 1],
+    test_data[n - k_push], test_data[n - 1]);
+  k = stack_pop_many(s, (void**)popped, n);
+  printf("== Bulk popped rest %d (expect %d): first / last (expected)\n", k,
+    n - k_push);
+  printf("  - %4d / %4d (%4d / %4d)\n", *popped[0], *popped[k - 1],
+    test_data[0], test_data[n - k_push - 1]);
+  printf("== Is stack empty (expect 1)? %d\n", stack_isempty(s));
+  free(popped);
+
+  /*
+   * A fixed-capacity stack should accept only as many values as it has room
+   * for.
+   */
+  struct stack* fixed = stack_create_fixed(k_push);
+  printf("\n== Bulk pushing %d values onto fixed stack of %d (expect %d): %d\n",
+    n, k_push, k_push, stack_push_many(fixed, (void**)simstack, n));
+  printf("== Top of fixed stack (expect %4d): %4d\n", test_data[k_push - 1],
+    *(int*)stack_top(fixed));
+  stack_free(fixed);
+
   /*
    * add some values to the stack to fully test stack_free() function
    */
-  struct list** ll = (struct list**) s;
-  if (ll){
-    for (i = 0; i < k_push; i++) {
-      list_insert(*ll, &test_data[i]);
-    }
+  for (i = 0; i < k_push; i++) {
+    stack_push(s, &test_data[i]);
   }
-  
 
   stack_free(s);
   free(test_data);
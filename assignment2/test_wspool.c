@@ -0,0 +1,256 @@
+/*
+ * This file contains executable code for testing the work-stealing thread
+ * pool and the parallel sort built on it.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "wspool.h"
+#include "psort.h"
+
+#define N_INDICES 1000000
+#define N_NODES 1000000
+#define N_SORT 1000000
+
+double now_sec() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Returns the process's resident set size in KB.
+ */
+long rss_kb() {
+  long size = 0, resident = 0;
+  FILE* file = fopen("/proc/self/statm", "r");
+  if (file) {
+    if (fscanf(file, "%ld %ld", &size, &resident) != 2) {
+      resident = 0;
+    }
+    fclose(file);
+  }
+  return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/*
+ * Fibonacci by spawning one recursive call and making the other, to test
+ * deep nesting of spawn and sync.
+ */
+struct fib_arg {
+  int n;
+  long result;
+};
+
+void fib_task(struct wspool* p, void* arg) {
+  struct fib_arg* f = arg;
+  if (f->n < 2) {
+    f->result = f->n;
+    return;
+  }
+  struct fib_arg a = { f->n - 1, 0 }, b = { f->n - 2, 0 };
+  wspool_spawn(p, fib_task, &a);
+  fib_task(p, &b);
+  wspool_sync(p);
+  f->result = a.result + b.result;
+}
+
+/*
+ * Counts how many times each index is visited by a parallel loop.
+ */
+int visits[N_INDICES];
+
+void visit_body(void* ctx, long begin, long end) {
+  for (long i = begin; i < end; i++) {
+    __atomic_add_fetch(&visits[i], 1, __ATOMIC_RELAXED);
+  }
+}
+
+/*
+ * A tree reduction: the sum of the values in a random binary tree.
+ */
+struct node {
+  long val;
+  struct node* left;
+  struct node* right;
+};
+
+struct node nodes[N_NODES];
+
+struct node* build_tree(int lo, int hi) {
+  if (lo >= hi) {
+    return NULL;
+  }
+  int root = lo + rand() % (hi - lo);
+  nodes[root].val = rand() % 1000;
+  nodes[root].left = build_tree(lo, root);
+  nodes[root].right = build_tree(root + 1, hi);
+  return &nodes[root];
+}
+
+long tree_sum(struct node* n) {
+  return n ? n->val + tree_sum(n->left) + tree_sum(n->right) : 0;
+}
+
+struct sum_arg {
+  struct node* node;
+  long result;
+};
+
+void sum_task(struct wspool* p, void* arg) {
+  struct sum_arg* s = arg;
+  if (!s->node) {
+    s->result = 0;
+    return;
+  }
+  struct sum_arg left = { s->node->left, 0 }, right = { s->node->right, 0 };
+  wspool_spawn(p, sum_task, &left);
+  sum_task(p, &right);
+  wspool_sync(p);
+  s->result = s->node->val + left.result + right.result;
+}
+
+/*
+ * Spawns many tasks without syncing, to make the deque grow and test the
+ * implicit sync when a task returns.
+ */
+long spawned;
+
+void count_task(struct wspool* p, void* arg) {
+  __atomic_add_fetch(&spawned, 1, __ATOMIC_RELAXED);
+}
+
+void spawn_many(struct wspool* p, void* arg) {
+  for (long i = 0; i < *(long*)arg; i++) {
+    wspool_spawn(p, count_task, NULL);
+  }
+}
+
+/*
+ * A parallel loop nested in each chunk of another.
+ */
+struct wspool* nested_pool;
+long nested_total;
+
+void inner_body(void* ctx, long begin, long end) {
+  __atomic_add_fetch(&nested_total, end - begin, __ATOMIC_RELAXED);
+}
+
+void outer_body(void* ctx, long begin, long end) {
+  for (long i = begin; i < end; i++) {
+    wspool_parallel_for(nested_pool, 0, 1000, 10, inner_body, NULL);
+  }
+}
+
+int cmp_int(const void* a, const void* b) {
+  int x = *(const int*)a, y = *(const int*)b;
+  return (x > y) - (x < y);
+}
+
+/*
+ * Sorts a random array of `n` ints with both psort() and qsort() and
+ * returns 1 if they agree.
+ */
+int check_sort(struct wspool* p, int n, int range) {
+  int* a = malloc((n + 1) * sizeof(int));
+  int* b = malloc((n + 1) * sizeof(int));
+  for (int i = 0; i < n; i++) {
+    a[i] = b[i] = rand() % range;
+  }
+  psort(p, a, n, sizeof(int), cmp_int);
+  qsort(b, n, sizeof(int), cmp_int);
+  int same = memcmp(a, b, n * sizeof(int)) == 0;
+  free(a);
+  free(b);
+  return same;
+}
+
+int main(int argc, char** argv) {
+  struct wspool* p;
+  int i, wrong;
+
+  srand(0);
+  p = wspool_create(4);
+  printf("== Workers (expect 4): %d\n", wspool_workers(p));
+
+  struct fib_arg f = { 25, 0 };
+  wspool_run(p, fib_task, &f);
+  printf("== fib(25) (expect 75025): %ld\n", f.result);
+
+  long count = 100000;
+  wspool_run(p, spawn_many, &count);
+  printf("== Spawned without sync (expect 100000): %ld\n", spawned);
+
+  /*
+   * Tasks stolen by other workers are recycled by the worker that spawned
+   * them, so a long-lived pool whose root task spawns many tasks for the
+   * others to steal doesn't keep allocating more.
+   */
+  long leaves = 20000;
+  for (i = 0; i < 50; i++) {
+    wspool_run(p, spawn_many, &leaves);
+  }
+  long rss = rss_kb();
+  for (i = 0; i < 400; i++) {
+    wspool_run(p, spawn_many, &leaves);
+  }
+  printf("== Memory grew by over 1 MB in 400 runs (expect 0): %d\n",
+    rss_kb() - rss > 1024);
+  fprintf(stderr, "RSS after 50 runs %ld KB, after 450 runs %ld KB\n", rss,
+    rss_kb());
+
+  wspool_parallel_for(p, 0, N_INDICES, 0, visit_body, NULL);
+  wspool_parallel_for(p, 0, N_INDICES, 1, visit_body, NULL);
+  wspool_parallel_for(p, 10, 10, 0, visit_body, NULL);
+  for (wrong = 0, i = 0; i < N_INDICES; i++) {
+    wrong += visits[i] != 2;
+  }
+  printf("== Indices not visited exactly twice (expect 0): %d\n", wrong);
+
+  nested_pool = p;
+  wspool_parallel_for(p, 0, 100, 3, outer_body, NULL);
+  printf("== Nested loop iterations (expect 100000): %ld\n", nested_total);
+
+  struct sum_arg s = { build_tree(0, N_NODES), 0 };
+  wspool_run(p, sum_task, &s);
+  printf("== Tree sum matches (expect 1): %d\n", s.result == tree_sum(s.node));
+
+  printf("== Sorts match qsort (expect 1 1 1 1): %d %d %d %d\n",
+    check_sort(p, 0, 10), check_sort(p, 5000, 10),
+    check_sort(p, 100000, 1000000), check_sort(p, 333333, 100));
+  wspool_free(p);
+
+  /*
+   * Timings, from 1 worker up to 8.
+   */
+  int* data = malloc(N_SORT * sizeof(int));
+  int* work = malloc(N_SORT * sizeof(int));
+  for (i = 0; i < N_SORT; i++) {
+    data[i] = rand();
+  }
+  for (int workers = 1; workers <= 8; workers *= 2) {
+    p = wspool_create(workers);
+    memcpy(work, data, N_SORT * sizeof(int));
+    double start = now_sec();
+    psort(p, work, N_SORT, sizeof(int), cmp_int);
+    double sort_time = now_sec() - start;
+
+    start = now_sec();
+    f.n = 30;
+    wspool_run(p, fib_task, &f);
+    double fib_time = now_sec() - start;
+    fprintf(stderr, "%d workers: psort %d ints %.1f ms, fib(30) %.1f ms, "
+      "%ld steals\n", workers, N_SORT, sort_time * 1e3, fib_time * 1e3,
+      wspool_steals(p));
+    wspool_free(p);
+  }
+  free(data);
+  free(work);
+  return 0;
+}
@@ -0,0 +1,384 @@
+/*
+ * This file contains an implementation of a hierarchical timing wheel
+ * (G. Varghese and T. Lauck, 1987), which keeps timers such as the call
+ * center's per-call timeouts.  Adding and cancelling a timer are O(1), and
+ * advancing the clock costs O(1) per timer fired or moved, however many
+ * timers are pending and however far it advances.  A binary heap, by
+ * comparison, costs O(log n) to add a timer and O(n) to find one to cancel.
+ * See the documentation below for more information on the individual
+ * functions in this implementation.
+ *
+ * Times are counted in ticks of whatever length the caller likes (the call
+ * center uses milliseconds).  The wheel has four levels of 256 slots each.
+ * A timer due in fewer than 256 ticks goes in the level-0 slot for its exact
+ * tick; one due in fewer than 256^2 ticks goes in the level-1 slot for its
+ * block of 256 ticks, and so on.  Each time the clock crosses into a new
+ * block at one level, the timers in that block's slot are moved ("cascaded")
+ * down to the finer slots below, so each timer is moved at most three times
+ * before it fires.  Timers further off than the wheel reaches (2^32 ticks)
+ * wait in the last slot and are cascaded back up again.  A bitmap of the
+ * non-empty slots at each level lets the clock jump straight to the next
+ * tick with a slot to fire or cascade, so an idle stretch costs nothing.
+ *
+ * Timers live in one array of nodes, linked into their slots' lists by
+ * index.  A timer's handle is its index together with the generation of the
+ * node, which changes whenever the node is freed, so a stale handle to a
+ * timer that has already fired or been cancelled is simply ignored.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "timerwheel.h"
+
+#define TIMER_WHEEL_BITS 8
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_INIT_CAPACITY 1024
+
+/*
+ * Furthest ahead of the clock a timer can be placed.
+ */
+#define TIMER_WHEEL_SPAN ((1LL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1)
+
+/*
+ * A single timer.  `slot` is the index of the slot list it's in, or -1 if
+ * the node is free, in which case `next` links the free list.
+ */
+struct timer_node {
+  long long expires;
+  void* arg;
+  int prev;
+  int next;
+  int slot;
+  unsigned int gen;
+};
+
+/*
+ * This is the structure that represents a timing wheel.  `cur` is the next
+ * tick to be processed, and every pending timer is due at or after it.
+ * `heads` holds the first node of each slot's list (or -1), level by level,
+ * and `bitmap` has a bit set for each non-empty slot.
+ */
+struct timer_wheel {
+  struct timer_node* nodes;
+  int capacity;
+  int free_list;
+  int count;
+  long long cur;
+  int heads[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS];
+  uint64_t bitmap[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS / 64];
+  void (*fire_fn)(void* ctx, void* arg);
+  void* ctx;
+};
+
+/*
+ * Auxilliary function to add nodes [from, to) to the free list.
+ */
+void _timer_free_range(struct timer_wheel* tw, int from, int to) {
+  for (int i = to - 1; i >= from; i--) {
+    tw->nodes[i].slot = -1;
+    tw->nodes[i].gen = 1;
+    tw->nodes[i].next = tw->free_list;
+    tw->free_list = i;
+  }
+}
+
+/*
+ * Auxilliary function to link node `i` into the slot for its expiry time.
+ */
+void _timer_place(struct timer_wheel* tw, int i) {
+  struct timer_node* node = &tw->nodes[i];
+  long long due = node->expires < tw->cur ? tw->cur : node->expires;
+  long long delta = due - tw->cur;
+  int level = 0;
+
+  if (delta > TIMER_WHEEL_SPAN) {
+    due = tw->cur + TIMER_WHEEL_SPAN;
+    delta = TIMER_WHEEL_SPAN;
+  }
+  while (delta >= 1LL << (TIMER_WHEEL_BITS * (level + 1))) {
+    level++;
+  }
+  int idx = (int)((due >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK);
+  int slot = level * TIMER_WHEEL_SLOTS + idx;
+
+  node->slot = slot;
+  node->prev = -1;
+  node->next = tw->heads[slot];
+  if (node->next >= 0) {
+    tw->nodes[node->next].prev = i;
+  }
+  tw->heads[slot] = i;
+  tw->bitmap[slot >> 6] |= 1ULL << (slot & 63);
+}
+
+/*
+ * Auxilliary function to unlink node `i` from its slot.
+ */
+void _timer_unlink(struct timer_wheel* tw, int i) {
+  struct timer_node* node = &tw->nodes[i];
+  if (node->prev >= 0) {
+    tw->nodes[node->prev].next = node->next;
+  } else {
+    tw->heads[node->slot] = node->next;
+    if (node->next < 0) {
+      tw->bitmap[node->slot >> 6] &= ~(1ULL << (node->slot & 63));
+    }
+  }
+  if (node->next >= 0) {
+    tw->nodes[node->next].prev = node->prev;
+  }
+}
+
+/*
+ * Auxilliary function to return node `i` to the free list.
+ */
+void _timer_release(struct timer_wheel* tw, int i) {
+  struct timer_node* node = &tw->nodes[i];
+  node->slot = -1;
+  node->gen = node->gen + 1 ? node->gen + 1 : 1;
+  node->next = tw->free_list;
+  tw->free_list = i;
+  tw->count--;
+}
+
+/*
+ * Auxilliary function to cascade timers down from the higher levels when
+ * the clock enters a new block of level-0 slots.
+ */
+void _timer_cascade(struct timer_wheel* tw) {
+  for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+    int idx = (int)((tw->cur >> (TIMER_WHEEL_BITS * level)) &
+      TIMER_WHEEL_MASK);
+    int slot = level * TIMER_WHEEL_SLOTS + idx;
+    int i = tw->heads[slot];
+    tw->heads[slot] = -1;
+    tw->bitmap[slot >> 6] &= ~(1ULL << (slot & 63));
+    while (i >= 0) {
+      int next = tw->nodes[i].next;
+      _timer_place(tw, i);
+      i = next;
+    }
+    if (idx != 0) {
+      break;
+    }
+  }
+}
+
+/*
+ * Auxilliary function returning how many slots after `start` the first
+ * non-empty slot of a level is, wrapping around, or -1 if they're all empty.
+ */
+int _timer_find(struct timer_wheel* tw, int level, int start) {
+  uint64_t* bitmap = tw->bitmap + level * TIMER_WHEEL_SLOTS / 64;
+  for (int k = 0; k <= TIMER_WHEEL_SLOTS / 64; k++) {
+    int w = ((start >> 6) + k) % (TIMER_WHEEL_SLOTS / 64);
+    uint64_t bits = bitmap[w];
+    if (k == 0) {
+      bits &= ~0ULL << (start & 63);
+    } else if (k == TIMER_WHEEL_SLOTS / 64) {
+      bits &= ~(~0ULL << (start & 63));
+    }
+    if (bits) {
+      return (w * 64 + __builtin_ctzll(bits) - start) & TIMER_WHEEL_MASK;
+    }
+  }
+  return -1;
+}
+
+/*
+ * Auxilliary function returning the first tick at or after the clock at
+ * which a non-empty slot is due to be fired (at level 0) or cascaded (at the
+ * levels above).  The wheel may not be empty.
+ */
+long long _timer_next_due(struct timer_wheel* tw) {
+  int d = _timer_find(tw, 0, (int)(tw->cur & TIMER_WHEEL_MASK));
+  long long due = d >= 0 ? tw->cur + d : -1;
+
+  /*
+   * At each level above, the next block boundary is at or after the clock,
+   * and is followed by the boundaries of the following 255 slots.
+   */
+  for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+    long long block = (tw->cur - 1) >> (TIMER_WHEEL_BITS * level);
+    d = _timer_find(tw, level, (int)((block + 1) & TIMER_WHEEL_MASK));
+    if (d >= 0) {
+      long long at = (block + 1 + d) << (TIMER_WHEEL_BITS * level);
+      if (due < 0 || at < due) {
+        due = at;
+      }
+    }
+  }
+  return due;
+}
+
+/*
+ * This function allocates and initializes an empty timing wheel and returns
+ * a pointer to it.
+ *
+ * Params:
+ *   now - the current time, in ticks.
+ *   fire_fn - the function called when a timer fires, with `ctx` and the
+ *     timer's `arg`.  It may add and cancel timers, but may not advance the
+ *     wheel.
+ *   ctx - an arbitrary pointer passed through unchanged to `fire_fn`.
+ */
+struct timer_wheel* timer_wheel_create(long long now,
+    void (*fire_fn)(void* ctx, void* arg), void* ctx) {
+  assert(fire_fn);
+  struct timer_wheel* tw = malloc(sizeof(struct timer_wheel));
+  assert(tw);
+  tw->capacity = TIMER_WHEEL_INIT_CAPACITY;
+  tw->nodes = malloc(tw->capacity * sizeof(struct timer_node));
+  assert(tw->nodes);
+  tw->free_list = -1;
+  _timer_free_range(tw, 0, tw->capacity);
+  tw->count = 0;
+  tw->cur = now;
+  for (int i = 0; i < TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS; i++) {
+    tw->heads[i] = -1;
+  }
+  for (int i = 0; i < TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS / 64; i++) {
+    tw->bitmap[i] = 0;
+  }
+  tw->fire_fn = fire_fn;
+  tw->ctx = ctx;
+  return tw;
+}
+
+/*
+ * This function frees the memory allocated to a given timing wheel.  Pending
+ * timers are dropped without firing.
+ *
+ * Params:
+ *   tw - the timing wheel to be destroyed.  May not be NULL.
+ */
+void timer_wheel_free(struct timer_wheel* tw) {
+  assert(tw);
+  free(tw->nodes);
+  free(tw);
+}
+
+/*
+ * This function returns the number of timers pending in a timing wheel.
+ */
+int timer_count(struct timer_wheel* tw) {
+  assert(tw);
+  return tw->count;
+}
+
+/*
+ * This function adds a timer to a timing wheel.  This is O(1) (amortized
+ * over the occasional doubling of the node array).
+ *
+ * Params:
+ *   tw - the timing wheel.  May not be NULL.
+ *   expires - the time, in ticks, at which the timer should fire.  A time
+ *     that has already passed fires on the next call to timer_advance().
+ *   arg - an arbitrary pointer passed to the wheel's fire function when the
+ *     timer fires.
+ *
+ * Return:
+ *   This function returns a handle to the timer, which is never 0.
+ */
+long long timer_add(struct timer_wheel* tw, long long expires, void* arg) {
+  assert(tw);
+  if (tw->free_list < 0) {
+    int old = tw->capacity;
+    tw->capacity *= 2;
+    tw->nodes = realloc(tw->nodes, tw->capacity * sizeof(struct timer_node));
+    assert(tw->nodes);
+    _timer_free_range(tw, old, tw->capacity);
+  }
+  int i = tw->free_list;
+  tw->free_list = tw->nodes[i].next;
+  tw->nodes[i].expires = expires;
+  tw->nodes[i].arg = arg;
+  _timer_place(tw, i);
+  tw->count++;
+  return (long long)tw->nodes[i].gen << 32 | i;
+}
+
+/*
+ * This function cancels a pending timer.  This is O(1).
+ *
+ * Params:
+ *   tw - the timing wheel.  May not be NULL.
+ *   timer - the handle of the timer to cancel, as returned by timer_add().
+ *
+ * Return:
+ *   This function returns 1 if the timer was cancelled or 0 if it had
+ *   already fired or been cancelled (or `timer` is 0).
+ */
+int timer_cancel(struct timer_wheel* tw, long long timer) {
+  assert(tw);
+  long long i = timer & 0xffffffffLL;
+  if (i >= tw->capacity || tw->nodes[i].slot < 0 ||
+      tw->nodes[i].gen != (unsigned int)(timer >> 32)) {
+    return 0;
+  }
+  _timer_unlink(tw, (int)i);
+  _timer_release(tw, (int)i);
+  return 1;
+}
+
+/*
+ * This function advances a timing wheel's clock, firing every timer due at
+ * or before the new time.  Timers due at the same tick fire in no
+ * particular order.
+ *
+ * Params:
+ *   tw - the timing wheel.  May not be NULL.
+ *   now - the current time, in ticks.  Times earlier than the wheel's clock
+ *     are ignored.
+ *
+ * Return:
+ *   This function returns the number of timers fired.
+ */
+int timer_advance(struct timer_wheel* tw, long long now) {
+  assert(tw);
+  int fired = 0;
+
+  while (tw->cur <= now) {
+    long long due = tw->count > 0 ? _timer_next_due(tw) : -1;
+    if (due < 0 || due > now) {
+      tw->cur = now + 1;
+      break;
+    }
+    tw->cur = due;
+    int idx = (int)(tw->cur & TIMER_WHEEL_MASK);
+    if (idx == 0) {
+      _timer_cascade(tw);
+    }
+    while (tw->heads[idx] >= 0) {
+      int i = tw->heads[idx];
+      void* arg = tw->nodes[i].arg;
+      _timer_unlink(tw, i);
+      _timer_release(tw, i);
+      tw->fire_fn(tw->ctx, arg);
+      fired++;
+    }
+    tw->cur++;
+  }
+  return fired;
+}
+
+/*
+ * This function returns a time no later than the earliest pending timer in
+ * a timing wheel, for use as a deadline to sleep until before advancing it.
+ * The time is exact if the timer is due within 256 ticks, and otherwise is
+ * when it (or another timer) is next cascaded.
+ *
+ * Params:
+ *   tw - the timing wheel.  May not be NULL.
+ *
+ * Return:
+ *   This function returns the time in ticks, or -1 if no timers are pending.
+ */
+long long timer_next(struct timer_wheel* tw) {
+  assert(tw);
+  return tw->count > 0 ? _timer_next_due(tw) : -1;
+}
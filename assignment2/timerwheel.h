@@ -0,0 +1,29 @@
+/*
+ * This file contains the definition of the interface for a hierarchical
+ * timing wheel, which keeps large numbers of timers with O(1) insertion and
+ * cancellation.  You can find descriptions of the timing wheel functions,
+ * including their parameters and their return values, in timerwheel.c.
+ */
+
+#ifndef __TIMERWHEEL_H
+#define __TIMERWHEEL_H
+
+/*
+ * Structure used to represent a timing wheel.
+ */
+struct timer_wheel;
+
+/*
+ * Timing wheel interface function prototypes.  Refer to timerwheel.c for
+ * documentation about each of these functions.
+ */
+struct timer_wheel* timer_wheel_create(long long now,
+  void (*fire_fn)(void* ctx, void* arg), void* ctx);
+void timer_wheel_free(struct timer_wheel* tw);
+int timer_count(struct timer_wheel* tw);
+long long timer_add(struct timer_wheel* tw, long long expires, void* arg);
+int timer_cancel(struct timer_wheel* tw, long long timer);
+int timer_advance(struct timer_wheel* tw, long long now);
+long long timer_next(struct timer_wheel* tw);
+
+#endif
@@ -0,0 +1,674 @@
+/*
+ * This file contains an implementation of a work-stealing thread pool for
+ * fork-join parallelism.  Work is expressed as tasks, which may spawn child
+ * tasks and then wait for them (wspool_spawn() and wspool_sync()), or as a
+ * parallel loop over a range of indices (wspool_parallel_for()), and the
+ * pool's workers balance the tasks across cores between them.  See the
+ * documentation below for more information on the individual functions in
+ * this implementation.
+ *
+ * Each worker has its own Chase-Lev deque of tasks (D. Chase and Y. Lev,
+ * 2005, with the memory orderings of N. M. Le et al., 2013).  A worker
+ * pushes the tasks it spawns onto the bottom of its deque and pops them back
+ * off the bottom, so its own work runs depth-first, without any contention,
+ * and with just a fence on each pop.  A worker with nothing to do steals
+ * from the top of a random other worker's deque, where the oldest, and
+ * usually biggest, tasks are, claiming a task with a single compare-and-swap
+ * on the top index.  Only when the owner and a thief go for the last task in
+ * a deque do they race for it on that same CAS.  Deques grow as needed; the
+ * arrays they outgrow are kept until the pool is freed, since a thief may
+ * still be reading one.
+ *
+ * A task that waits for its children runs other tasks in the meantime (its
+ * own children first, then whatever it can steal) instead of blocking, so
+ * workers stay busy however deeply tasks nest.  A task that returns without
+ * waiting for its children waits for them implicitly.  Workers that find
+ * nothing to steal for a while sleep on a condition variable until more
+ * tasks are spawned.
+ *
+ * The thread that calls wspool_run() acts as one of the workers while the
+ * root task runs, so a pool of N workers starts only N-1 threads.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "wspool.h"
+
+#define WSPOOL_CACHE_LINE 64
+#define WSPOOL_DEQUE_MIN 256
+#define WSPOOL_TASK_SLAB 256
+
+/*
+ * Number of times in a row an idle worker tries (and fails) to find a task
+ * to steal, yielding the processor in between, before going to sleep.
+ */
+#define WSPOOL_IDLE_ROUNDS 64
+
+/*
+ * A task.  `owner` is the worker that allocated it, and `pending` counts its
+ * children that haven't finished yet.  The fields from `body` to `grain` are
+ * only used by tasks that run part of a parallel loop.  `next` links free
+ * tasks.
+ */
+struct wspool_task {
+  struct wspool_worker* owner;
+  void (*fn)(struct wspool* p, void* arg);
+  void* arg;
+  struct wspool_task* parent;
+  long pending;
+  void (*body)(void* ctx, long begin, long end);
+  void* ctx;
+  long begin;
+  long end;
+  long grain;
+  struct wspool_task* next;
+};
+
+/*
+ * The circular array behind a deque.  `size` is a power of two, and
+ * `retired` is the (smaller) array it replaced.
+ */
+struct wspool_array {
+  int64_t size;
+  struct wspool_array* retired;
+  struct wspool_task* tasks[];
+};
+
+/*
+ * Task slabs are chained together so they can all be freed at once.
+ */
+struct wspool_slab {
+  struct wspool_slab* next;
+  struct wspool_task tasks[WSPOOL_TASK_SLAB];
+};
+
+/*
+ * A worker and its deque.  `top` is written by thieves and `returned` by
+ * other workers, so each is kept on a cache line of its own; the rest is
+ * only written by the worker itself.  `current` is the task the worker is
+ * running.  Tasks are allocated from `free_list`.  A finished task goes back
+ * onto its owner's free list if the owner ran it, or else onto the owner's
+ * `returned` stack, which the owner takes over whole when its free list
+ * runs out.  That way tasks always go back to the worker that spawns them,
+ * however many of them are stolen.
+ */
+struct wspool_worker {
+  int64_t top;
+  char pad0[WSPOOL_CACHE_LINE - sizeof(int64_t)];
+  struct wspool_task* returned;
+  char pad1[WSPOOL_CACHE_LINE - sizeof(struct wspool_task*)];
+  int64_t bottom;
+  struct wspool_array* array;
+  struct wspool* pool;
+  struct wspool_task* current;
+  struct wspool_task* free_list;
+  struct wspool_slab* slabs;
+  uint32_t seed;
+  long steals;
+  pthread_t thread;
+  char pad2[WSPOOL_CACHE_LINE];
+};
+
+/*
+ * This is the structure that represents a thread pool.  Idle workers sleep
+ * on `wake` until `epoch` changes; `sleepers` counts the workers about to
+ * sleep or asleep, so that spawning a task only takes the lock if there
+ * are any.  `running` is set while a root task runs.
+ */
+struct wspool {
+  struct wspool_worker* workers;
+  int n_workers;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  long epoch;
+  int sleepers;
+  int stop;
+  int running;
+};
+
+/*
+ * The worker the calling thread is acting as, or NULL if it isn't one.
+ */
+static __thread struct wspool_worker* _wspool_self;
+
+/*
+ * Auxilliary function to allocate a deque array of `size` slots.
+ */
+struct wspool_array* _wspool_array_create(int64_t size) {
+  struct wspool_array* a = malloc(sizeof(struct wspool_array) +
+    size * sizeof(struct wspool_task*));
+  assert(a);
+  a->size = size;
+  a->retired = NULL;
+  return a;
+}
+
+/*
+ * Auxilliary function to double the size of a worker's deque, which holds
+ * the tasks from `top` to `bottom`.  Only the worker itself may call this.
+ */
+struct wspool_array* _wspool_grow(struct wspool_worker* w, int64_t top,
+    int64_t bottom) {
+  struct wspool_array* old = w->array;
+  struct wspool_array* a = _wspool_array_create(old->size * 2);
+  for (int64_t i = top; i < bottom; i++) {
+    a->tasks[i & (a->size - 1)] = old->tasks[i & (old->size - 1)];
+  }
+  a->retired = old;
+  __atomic_store_n(&w->array, a, __ATOMIC_RELEASE);
+  return a;
+}
+
+/*
+ * Auxilliary function to push a task onto the bottom of the calling
+ * worker's own deque.
+ */
+void _wspool_push(struct wspool_worker* w, struct wspool_task* t) {
+  int64_t b = __atomic_load_n(&w->bottom, __ATOMIC_RELAXED);
+  int64_t top = __atomic_load_n(&w->top, __ATOMIC_ACQUIRE);
+  struct wspool_array* a = w->array;
+  if (b - top > a->size - 1) {
+    a = _wspool_grow(w, top, b);
+  }
+  __atomic_store_n(&a->tasks[b & (a->size - 1)], t, __ATOMIC_RELAXED);
+  __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Auxilliary function to pop a task off the bottom of the calling worker's
+ * own deque.  Returns NULL if it's empty.
+ */
+struct wspool_task* _wspool_take(struct wspool_worker* w) {
+  int64_t b = __atomic_load_n(&w->bottom, __ATOMIC_RELAXED) - 1;
+  struct wspool_array* a = w->array;
+  __atomic_store_n(&w->bottom, b, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  int64_t top = __atomic_load_n(&w->top, __ATOMIC_RELAXED);
+
+  struct wspool_task* t = NULL;
+  if (top <= b) {
+    t = __atomic_load_n(&a->tasks[b & (a->size - 1)], __ATOMIC_RELAXED);
+    if (top == b) {
+      /*
+       * The last task: a thief may be going for it too.
+       */
+      if (!__atomic_compare_exchange_n(&w->top, &top, top + 1, 0,
+          __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        t = NULL;
+      }
+      __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELEASE);
+    }
+  } else {
+    __atomic_store_n(&w->bottom, b + 1, __ATOMIC_RELEASE);
+  }
+  return t;
+}
+
+/*
+ * Auxilliary function to steal a task from the top of another worker's
+ * deque.  Returns NULL if it's empty or another thread got there first.
+ */
+struct wspool_task* _wspool_steal(struct wspool_worker* victim) {
+  int64_t top = __atomic_load_n(&victim->top, __ATOMIC_ACQUIRE);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  int64_t b = __atomic_load_n(&victim->bottom, __ATOMIC_ACQUIRE);
+  if (top >= b) {
+    return NULL;
+  }
+  struct wspool_array* a = __atomic_load_n(&victim->array, __ATOMIC_ACQUIRE);
+  struct wspool_task* t = __atomic_load_n(&a->tasks[top & (a->size - 1)],
+    __ATOMIC_RELAXED);
+  if (!__atomic_compare_exchange_n(&victim->top, &top, top + 1, 0,
+      __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+    return NULL;
+  }
+  return t;
+}
+
+/*
+ * Auxilliary function to try stealing a task from each of the other
+ * workers in turn, starting from a random one.
+ */
+struct wspool_task* _wspool_steal_any(struct wspool_worker* w) {
+  struct wspool* p = w->pool;
+  w->seed ^= w->seed << 13;
+  w->seed ^= w->seed >> 17;
+  w->seed ^= w->seed << 5;
+  int start = (int)(w->seed % p->n_workers);
+  for (int i = 0; i < p->n_workers; i++) {
+    struct wspool_worker* victim = &p->workers[(start + i) % p->n_workers];
+    if (victim != w) {
+      struct wspool_task* t = _wspool_steal(victim);
+      if (t) {
+        w->steals++;
+        return t;
+      }
+    }
+  }
+  return NULL;
+}
+
+/*
+ * Auxilliary function returning 1 if any worker's deque has a task in it.
+ */
+int _wspool_any_work(struct wspool* p) {
+  for (int i = 0; i < p->n_workers; i++) {
+    struct wspool_worker* w = &p->workers[i];
+    if (__atomic_load_n(&w->bottom, __ATOMIC_SEQ_CST) >
+        __atomic_load_n(&w->top, __ATOMIC_SEQ_CST)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*
+ * Auxilliary function to take a task from the calling worker's free list,
+ * refilling it from the tasks other workers have returned or, failing that,
+ * by carving out a new slab.
+ */
+struct wspool_task* _wspool_task_alloc(struct wspool_worker* w) {
+  struct wspool_task* t = w->free_list;
+  if (!t && __atomic_load_n(&w->returned, __ATOMIC_RELAXED)) {
+    t = __atomic_exchange_n(&w->returned, NULL, __ATOMIC_ACQUIRE);
+  }
+  if (!t) {
+    struct wspool_slab* slab = malloc(sizeof(struct wspool_slab));
+    assert(slab);
+    slab->next = w->slabs;
+    w->slabs = slab;
+    for (int i = WSPOOL_TASK_SLAB - 1; i >= 0; i--) {
+      slab->tasks[i].owner = w;
+      slab->tasks[i].next = w->free_list;
+      w->free_list = &slab->tasks[i];
+    }
+    t = w->free_list;
+  }
+  w->free_list = t->next;
+  t->parent = w->current;
+  t->pending = 0;
+  return t;
+}
+
+/*
+ * Auxilliary function to give a finished task back to the worker that
+ * allocated it.
+ */
+void _wspool_task_free(struct wspool_worker* w, struct wspool_task* t) {
+  struct wspool_worker* owner = t->owner;
+  if (owner == w) {
+    t->next = w->free_list;
+    w->free_list = t;
+    return;
+  }
+  struct wspool_task* head = __atomic_load_n(&owner->returned,
+    __ATOMIC_RELAXED);
+  do {
+    t->next = head;
+  } while (!__atomic_compare_exchange_n(&owner->returned, &head, t, 1,
+      __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+/*
+ * Auxilliary function to make a new task a child of the calling worker's
+ * current task and push it onto the worker's deque, waking a sleeping
+ * worker to steal it if there is one.
+ */
+void _wspool_spawn_task(struct wspool_worker* w, struct wspool_task* t) {
+  struct wspool* p = w->pool;
+  __atomic_add_fetch(&w->current->pending, 1, __ATOMIC_RELAXED);
+  _wspool_push(w, t);
+
+  /*
+   * Pairs with the check for work in _wspool_sleep(): either the sleeper
+   * sees this task or this sees the sleeper.
+   */
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&p->sleepers, __ATOMIC_RELAXED) > 0) {
+    pthread_mutex_lock(&p->lock);
+    __atomic_add_fetch(&p->epoch, 1, __ATOMIC_RELAXED);
+    pthread_cond_signal(&p->wake);
+    pthread_mutex_unlock(&p->lock);
+  }
+}
+
+void _wspool_wait(struct wspool_worker* w, struct wspool_task* t);
+
+/*
+ * Auxilliary function to run a task on the calling worker, wait for its
+ * children, free it and let its parent know it's finished.
+ */
+void _wspool_execute(struct wspool_worker* w, struct wspool_task* t) {
+  struct wspool_task* prev = w->current;
+  w->current = t;
+  t->fn(w->pool, t->arg);
+  _wspool_wait(w, t);
+  w->current = prev;
+
+  struct wspool_task* parent = t->parent;
+  _wspool_task_free(w, t);
+  if (parent) {
+    __atomic_sub_fetch(&parent->pending, 1, __ATOMIC_RELEASE);
+  }
+}
+
+/*
+ * Auxilliary function to run other tasks until all of task `t`'s children
+ * have finished.
+ */
+void _wspool_wait(struct wspool_worker* w, struct wspool_task* t) {
+  int idle = 0;
+  while (__atomic_load_n(&t->pending, __ATOMIC_ACQUIRE) > 0) {
+    struct wspool_task* next = _wspool_take(w);
+    if (!next) {
+      next = _wspool_steal_any(w);
+    }
+    if (next) {
+      _wspool_execute(w, next);
+      idle = 0;
+    } else if (++idle > WSPOOL_IDLE_ROUNDS) {
+      sched_yield();
+    }
+  }
+}
+
+/*
+ * Auxilliary function to put an idle worker to sleep until a task is
+ * spawned or the pool is freed.
+ */
+void _wspool_sleep(struct wspool* p) {
+  long epoch = __atomic_load_n(&p->epoch, __ATOMIC_ACQUIRE);
+  __atomic_add_fetch(&p->sleepers, 1, __ATOMIC_SEQ_CST);
+  if (!_wspool_any_work(p)) {
+    pthread_mutex_lock(&p->lock);
+    while (__atomic_load_n(&p->epoch, __ATOMIC_RELAXED) == epoch &&
+        !p->stop) {
+      pthread_cond_wait(&p->wake, &p->lock);
+    }
+    pthread_mutex_unlock(&p->lock);
+  }
+  __atomic_sub_fetch(&p->sleepers, 1, __ATOMIC_SEQ_CST);
+}
+
+/*
+ * Auxilliary function run by each of the pool's threads: steal and run
+ * tasks until the pool is freed.
+ */
+void* _wspool_worker_main(void* arg) {
+  struct wspool_worker* w = arg;
+  struct wspool* p = w->pool;
+  int idle = 0;
+
+  _wspool_self = w;
+  while (!__atomic_load_n(&p->stop, __ATOMIC_ACQUIRE)) {
+    struct wspool_task* t = _wspool_steal_any(w);
+    if (t) {
+      _wspool_execute(w, t);
+      idle = 0;
+    } else if (++idle < WSPOOL_IDLE_ROUNDS) {
+      sched_yield();
+    } else {
+      _wspool_sleep(p);
+      idle = 0;
+    }
+  }
+  return NULL;
+}
+
+/*
+ * This function allocates and initializes a thread pool and returns a
+ * pointer to it.
+ *
+ * Params:
+ *   workers - the number of workers, including the thread that calls
+ *     wspool_run(), so that `workers - 1` threads are started.  Must be at
+ *     least 1.
+ */
+struct wspool* wspool_create(int workers) {
+  assert(workers >= 1);
+  struct wspool* p = malloc(sizeof(struct wspool));
+  assert(p);
+  int err = posix_memalign((void**)&p->workers, WSPOOL_CACHE_LINE,
+    workers * sizeof(struct wspool_worker));
+  assert(err == 0);
+  p->n_workers = workers;
+  pthread_mutex_init(&p->lock, NULL);
+  pthread_cond_init(&p->wake, NULL);
+  p->epoch = 0;
+  p->sleepers = 0;
+  p->stop = 0;
+  p->running = 0;
+
+  for (int i = 0; i < workers; i++) {
+    struct wspool_worker* w = &p->workers[i];
+    w->top = w->bottom = 0;
+    w->array = _wspool_array_create(WSPOOL_DEQUE_MIN);
+    w->pool = p;
+    w->current = NULL;
+    w->free_list = NULL;
+    w->returned = NULL;
+    w->slabs = NULL;
+    w->seed = 2463534242u + 7919u * i;
+    w->steals = 0;
+  }
+  for (int i = 1; i < workers; i++) {
+    pthread_create(&p->workers[i].thread, NULL, _wspool_worker_main,
+      &p->workers[i]);
+  }
+  return p;
+}
+
+/*
+ * This function stops a thread pool's threads and frees the pool.  It may
+ * not be called while a task is running.
+ *
+ * Params:
+ *   p - the pool to be destroyed.  May not be NULL.
+ */
+void wspool_free(struct wspool* p) {
+  assert(p && !p->running);
+  pthread_mutex_lock(&p->lock);
+  __atomic_store_n(&p->stop, 1, __ATOMIC_RELEASE);
+  pthread_cond_broadcast(&p->wake);
+  pthread_mutex_unlock(&p->lock);
+
+  for (int i = 0; i < p->n_workers; i++) {
+    struct wspool_worker* w = &p->workers[i];
+    if (i > 0) {
+      pthread_join(w->thread, NULL);
+    }
+    struct wspool_array* a = w->array;
+    while (a) {
+      struct wspool_array* retired = a->retired;
+      free(a);
+      a = retired;
+    }
+    struct wspool_slab* next, * slab = w->slabs;
+    while (slab) {
+      next = slab->next;
+      free(slab);
+      slab = next;
+    }
+  }
+  pthread_mutex_destroy(&p->lock);
+  pthread_cond_destroy(&p->wake);
+  free(p->workers);
+  free(p);
+}
+
+/*
+ * This function returns the number of workers in a thread pool.
+ */
+int wspool_workers(struct wspool* p) {
+  assert(p);
+  return p->n_workers;
+}
+
+/*
+ * This function returns the number of tasks that workers have stolen from
+ * one another so far.  It's only exact when no task is running.
+ */
+long wspool_steals(struct wspool* p) {
+  assert(p);
+  long steals = 0;
+  for (int i = 0; i < p->n_workers; i++) {
+    steals += __atomic_load_n(&p->workers[i].steals, __ATOMIC_RELAXED);
+  }
+  return steals;
+}
+
+/*
+ * This function runs a task on a thread pool and returns once it and every
+ * task it spawned (and so on) have finished.  The calling thread acts as
+ * one of the pool's workers in the meantime.  Only one thread may run tasks
+ * on a pool at a time, and this may not be called from a task.
+ *
+ * Params:
+ *   p - the pool.  May not be NULL.
+ *   fn - the task, called with the pool and `arg`.
+ *   arg - an arbitrary pointer passed through unchanged to `fn`.
+ */
+void wspool_run(struct wspool* p, void (*fn)(struct wspool* p, void* arg),
+    void* arg) {
+  assert(p && fn && !_wspool_self);
+  int was_running = __atomic_exchange_n(&p->running, 1, __ATOMIC_ACQUIRE);
+  assert(!was_running);
+
+  struct wspool_worker* w = &p->workers[0];
+  _wspool_self = w;
+  struct wspool_task* t = _wspool_task_alloc(w);
+  t->fn = fn;
+  t->arg = arg;
+  _wspool_execute(w, t);
+  _wspool_self = NULL;
+  __atomic_store_n(&p->running, 0, __ATOMIC_RELEASE);
+}
+
+/*
+ * This function spawns a child of the calling task, which may run on any
+ * of the pool's workers, in parallel with the rest of the calling task,
+ * until the calling task waits for it with wspool_sync() (or returns).  It
+ * may only be called from a task.
+ *
+ * Params:
+ *   p - the pool running the calling task.  May not be NULL.
+ *   fn - the child task, called with the pool and `arg`.
+ *   arg - an arbitrary pointer passed through unchanged to `fn`.  Whatever
+ *     it points to must stay valid until the child has finished.
+ */
+void wspool_spawn(struct wspool* p, void (*fn)(struct wspool* p, void* arg),
+    void* arg) {
+  struct wspool_worker* w = _wspool_self;
+  assert(p && fn && w && w->pool == p && w->current);
+  struct wspool_task* t = _wspool_task_alloc(w);
+  t->fn = fn;
+  t->arg = arg;
+  _wspool_spawn_task(w, t);
+}
+
+/*
+ * This function waits until all of the calling task's children have
+ * finished, running other tasks in the meantime.  It may only be called
+ * from a task.
+ *
+ * Params:
+ *   p - the pool running the calling task.  May not be NULL.
+ */
+void wspool_sync(struct wspool* p) {
+  struct wspool_worker* w = _wspool_self;
+  assert(p && w && w->pool == p && w->current);
+  _wspool_wait(w, w->current);
+}
+
+/*
+ * Auxilliary function to run a parallel loop over [begin, end) from the
+ * calling task, by spawning the top half of the range as a child task
+ * until what's left is at most `grain` long.
+ */
+void _wspool_for(struct wspool* p, long begin, long end, long grain,
+    void (*body)(void* ctx, long begin, long end), void* ctx);
+
+/*
+ * Auxilliary task running one part of a parallel loop.  Its argument is the
+ * task itself.
+ */
+void _wspool_for_task(struct wspool* p, void* arg) {
+  struct wspool_task* t = arg;
+  _wspool_for(p, t->begin, t->end, t->grain, t->body, t->ctx);
+}
+
+void _wspool_for(struct wspool* p, long begin, long end, long grain,
+    void (*body)(void* ctx, long begin, long end), void* ctx) {
+  struct wspool_worker* w = _wspool_self;
+  while (end - begin > grain) {
+    long mid = begin + (end - begin) / 2;
+    struct wspool_task* t = _wspool_task_alloc(w);
+    t->fn = _wspool_for_task;
+    t->arg = t;
+    t->body = body;
+    t->ctx = ctx;
+    t->begin = mid;
+    t->end = end;
+    t->grain = grain;
+    _wspool_spawn_task(w, t);
+    end = mid;
+  }
+  if (begin < end) {
+    body(ctx, begin, end);
+  }
+  _wspool_wait(w, w->current);
+}
+
+/*
+ * Auxilliary root task for a parallel loop started from outside the pool.
+ * Its argument is a task holding the loop's parameters.
+ */
+void _wspool_for_root(struct wspool* p, void* arg) {
+  struct wspool_task* spec = arg;
+  _wspool_for(p, spec->begin, spec->end, spec->grain, spec->body, spec->ctx);
+}
+
+/*
+ * This function runs a loop body over a range of indices in parallel,
+ * split into chunks that the pool's workers share out between them, and
+ * returns once it has been run over the whole range.  It may be called from
+ * a task, in which case it also waits for any children the task had already
+ * spawned, or from outside the pool, as with wspool_run().
+ *
+ * Params:
+ *   p - the pool.  May not be NULL.
+ *   begin, end - the range of indices, [begin, end).
+ *   grain - the most indices to hand to one call of `body`, or 0 to split
+ *     the range into about 8 chunks per worker.
+ *   body - the loop body, called with `ctx` and a chunk [begin, end) of
+ *     the range.  Chunks may be run in any order and in parallel.
+ *   ctx - an arbitrary pointer passed through unchanged to `body`.
+ */
+void wspool_parallel_for(struct wspool* p, long begin, long end, long grain,
+    void (*body)(void* ctx, long begin, long end), void* ctx) {
+  assert(p && body && grain >= 0);
+  if (grain == 0) {
+    grain = (end - begin) / (8 * p->n_workers);
+    if (grain < 1) {
+      grain = 1;
+    }
+  }
+  if (_wspool_self) {
+    assert(_wspool_self->pool == p);
+    _wspool_for(p, begin, end, grain, body, ctx);
+    return;
+  }
+  struct wspool_task spec;
+  spec.begin = begin;
+  spec.end = end;
+  spec.grain = grain;
+  spec.body = body;
+  spec.ctx = ctx;
+  wspool_run(p, _wspool_for_root, &spec);
+}
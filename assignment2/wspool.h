@@ -0,0 +1,32 @@
+/*
+ * This file contains the definition of the interface for a work-stealing
+ * thread pool, which runs fork-join tasks across several cores.  You can
+ * find descriptions of the thread pool functions, including their
+ * parameters and their return values, in wspool.c.
+ */
+
+#ifndef __WSPOOL_H
+#define __WSPOOL_H
+
+/*
+ * Structure used to represent a thread pool.
+ */
+struct wspool;
+
+/*
+ * Thread pool interface function prototypes.  Refer to wspool.c for
+ * documentation about each of these functions.
+ */
+struct wspool* wspool_create(int workers);
+void wspool_free(struct wspool* p);
+int wspool_workers(struct wspool* p);
+long wspool_steals(struct wspool* p);
+void wspool_run(struct wspool* p, void (*fn)(struct wspool* p, void* arg),
+  void* arg);
+void wspool_spawn(struct wspool* p, void (*fn)(struct wspool* p, void* arg),
+  void* arg);
+void wspool_sync(struct wspool* p);
+void wspool_parallel_for(struct wspool* p, long begin, long end, long grain,
+  void (*body)(void* ctx, long begin, long end), void* ctx);
+
+#endif